@@ -37,6 +37,7 @@ INCLUDEPATHS += -I./src/DSF/tri_stripper_101
 INCLUDEPATHS += -I./src/RawImport
 INCLUDEPATHS += -I./src/Tiger
 INCLUDEPATHS += -I./src/SDTS
+INCLUDEPATHS += -I./src/VPF
 INCLUDEPATHS += -I./SDK/ac3d
 
 ifdef PLAT_LINUX
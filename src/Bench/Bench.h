@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+	BENCH - microbenchmark harness
+
+	Each benchmark is a small kernel run against a synthetic fixture: setup builds the fixture (not timed), run
+	does one timed pass and returns the number of "items" it processed (bytes, samples, faces, rules...), and
+	cleanup tears the fixture back down.  The driver in BenchMain.cpp times the run proc, counts heap allocations
+	made during it, and reports throughput as items per second.
+
+	Fixtures are procedural and seeded, so two runs on the same machine see exactly the same data.
+
+*/
+
+struct	Bench_t {
+	const char *	name;
+	const char *	unit;				// What run() counts - "bytes", "samples", etc.
+	void			(* setup)(void);
+	double			(* run)(void);		// Returns the number of items processed.
+	void			(* cleanup)(void);
+};
+
+// The table of benchmarks, terminated by an entry with a NULL name.
+extern Bench_t		gBenchmarks[];
+
+// Setup and run procs call this when a kernel's result is wrong - the message goes to stderr, the run carries on,
+// and bench exits with 1 at the end.
+void	BenchFail(const char * fmt, ...);
+
+/************************************************************************************************
+ * FIXTURES
+ ************************************************************************************************/
+
+#include "MapDefs.h"
+
+class	DEMGeo;
+struct	XObj8;
+struct	ImageInfo;
+
+// Scratch directory for files the fixtures write - always ends with a directory separator.
+extern string	gBenchTempDir;
+
+// A seeded uniform random number in [0..1) that does not depend on the C library.
+float	BenchRandom(unsigned int& ioSeed);
+
+// A seeded fractal height field, 1x1 degree, in meters.
+void	BenchMakeDEM(DEMGeo& outDEM, int inSize, int inSeed);
+
+// A map of roughly inBlocks x inBlocks city blocks - a jittered grid of streets so that the faces are
+// irregular quads, with every edge tagged as a road.
+void	BenchMakeBlocks(Pmwx& outMap, int inBlocks, int inSeed);
+
+// A DSF with inGrid x inGrid patches, each patch a triangulated inRes x inRes vertex grid, plus a point
+// object per patch.
+void	BenchMakeDSF(const char * inPath, int inGrid, int inRes, int inSeed);
+
+// An OBJ8 with inTris random triangles split into a few LODs.
+void	BenchMakeOBJ(XObj8& outObj, int inTris, int inSeed);
+
+// A 4-channel noise bitmap.
+void	BenchMakeBitmap(ImageInfo& outImage, int inSize, int inSeed);
+
+// Load a set of natural terrain rules shaped like the real tables: inRules rules whose ranges are random
+// slices of the parameter space, with a catch-all at the end so every query finds something.
+void	BenchMakeTerrainRules(int inRules, int inSeed);
+
+// Fill gRepTable with inTerrains x inRowsPerTerrain facade and object rows shaped like obj_properties.txt,
+// spread over inFeatures features (the first is NO_VALUE), and index it.
+void	BenchMakeObjTables(int inTerrains, int inFeatures, int inRowsPerTerrain, int inSeed);
+
+#endif /* BENCH_H */
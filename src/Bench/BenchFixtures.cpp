@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "Bench.h"
+#include "DEMDefs.h"
+#include "DEMTables.h"
+#include "MapCreate.h"
+#include "ParamDefs.h"
+#include "DSFLib.h"
+#include "XObjDefs.h"
+#include "BitmapUtils.h"
+#include "ObjTables.h"
+#include "EnumSystem.h"
+
+string	gBenchTempDir;
+
+/************************************************************************************************
+ * SEEDED NOISE
+ ************************************************************************************************/
+
+// We don't use rand() or the perlin tables - both depend on the C library's generator, and a baseline
+// recorded on one platform should see the same fixtures on another.
+
+static unsigned int	bench_hash(unsigned int x)
+{
+	x ^= x >> 16;	x *= 0x7feb352dU;
+	x ^= x >> 15;	x *= 0x846ca68bU;
+	x ^= x >> 16;
+	return x;
+}
+
+float	BenchRandom(unsigned int& seed)
+{
+	seed = seed * 1664525U + 1013904223U;
+	return (float) (bench_hash(seed) & 0xFFFFFF) / (float) 0x1000000;
+}
+
+static float	bench_lattice(int x, int y, int seed)
+{
+	return (float) (bench_hash(x * 73856093U ^ y * 19349663U ^ seed * 83492791U) & 0xFFFF) / 65535.0f;
+}
+
+static float	bench_noise(float x, float y, int seed)
+{
+	int		ix = (int) floorf(x);
+	int		iy = (int) floorf(y);
+	float	fx = x - (float) ix;
+	float	fy = y - (float) iy;
+	fx = fx * fx * (3.0f - 2.0f * fx);
+	fy = fy * fy * (3.0f - 2.0f * fy);
+	float	b = bench_lattice(ix, iy  , seed) * (1.0f - fx) + bench_lattice(ix+1, iy  , seed) * fx;
+	float	t = bench_lattice(ix, iy+1, seed) * (1.0f - fx) + bench_lattice(ix+1, iy+1, seed) * fx;
+	return b * (1.0f - fy) + t * fy;
+}
+
+/************************************************************************************************
+ * FIXTURES
+ ************************************************************************************************/
+
+void	BenchMakeDEM(DEMGeo& outDEM, int inSize, int inSeed)
+{
+	outDEM.resize(inSize, inSize);
+	outDEM.mWest = -118.0;
+	outDEM.mSouth = 34.0;
+	outDEM.mEast = -117.0;
+	outDEM.mNorth = 35.0;
+	outDEM.mPost = 1;
+
+	for (int y = 0; y < inSize; ++y)
+	for (int x = 0; x < inSize; ++x)
+	{
+		float	fx = (float) x / (float) inSize;
+		float	fy = (float) y / (float) inSize;
+		float	h = 0.0f, amp = 1500.0f, freq = 4.0f;
+		for (int octave = 0; octave < 6; ++octave)
+		{
+			h += amp * bench_noise(fx * freq, fy * freq, inSeed + octave);
+			amp *= 0.45f;
+			freq *= 2.0f;
+		}
+		outDEM(x,y) = h;
+	}
+}
+
+void	BenchMakeBlocks(Pmwx& outMap, int inBlocks, int inSeed)
+{
+	unsigned int	seed = inSeed;
+	double			step = 1.0 / (double) inBlocks;
+
+	// Jitter every interior grid node so blocks are irregular, but by less than half a block so no streets cross.
+	vector<Point_2>		nodes((inBlocks+1) * (inBlocks+1));
+	for (int y = 0; y <= inBlocks; ++y)
+	for (int x = 0; x <= inBlocks; ++x)
+	{
+		double	jx = (x == 0 || x == inBlocks) ? 0.0 : (BenchRandom(seed) - 0.5) * 0.6 * step;
+		double	jy = (y == 0 || y == inBlocks) ? 0.0 : (BenchRandom(seed) - 0.5) * 0.6 * step;
+		nodes[x + y * (inBlocks+1)] = Point_2(-118.0 + x * step + jx, 34.0 + y * step + jy);
+	}
+
+	GIS_halfedge_data		street;
+	GISNetworkSegment_t		seg;
+	seg.mFeatType = road_Local;
+	seg.mRepType = NO_VALUE;
+	seg.mSourceHeight = 0.0;
+	seg.mTargetHeight = 0.0;
+	street.mSegments.push_back(seg);
+
+	vector<Segment_2>			curves;
+	vector<GIS_halfedge_data>	data;
+	for (int y = 0; y <= inBlocks; ++y)
+	for (int x = 0; x <= inBlocks; ++x)
+	{
+		const Point_2&	p = nodes[x + y * (inBlocks+1)];
+		if (x < inBlocks) { curves.push_back(Segment_2(p, nodes[x + 1 + y * (inBlocks+1)])); data.push_back(street); }
+		if (y < inBlocks) { curves.push_back(Segment_2(p, nodes[x + (y + 1) * (inBlocks+1)])); data.push_back(street); }
+	}
+
+	Map_CreateWithLineData(outMap, curves, data);
+}
+
+void	BenchMakeDSF(const char * inPath, int inGrid, int inRes, int inSeed)
+{
+	unsigned int	seed = inSeed;
+	void * f = DSFCreateWriter(-118.0, 34.0, -117.0, 35.0, -500.0, 5000.0, 8);
+	DSFCallbacks_t	cbs;
+	DSFGetWriterCallbacks(&cbs);
+
+	cbs.AcceptProperty_f("sim/west", "-118", f);
+	cbs.AcceptProperty_f("sim/east", "-117", f);
+	cbs.AcceptProperty_f("sim/south", "34", f);
+	cbs.AcceptProperty_f("sim/north", "35", f);
+	cbs.AcceptTerrainDef_f("terrain_Water", f);
+	cbs.AcceptTerrainDef_f("lib/g10/terrain10/bench.ter", f);
+	cbs.AcceptObjectDef_f("lib/bench.obj", f);
+
+	double	pc[7];
+	double	cell = 1.0 / (double) (inGrid * (inRes-1));
+	for (int py = 0; py < inGrid; ++py)
+	for (int px = 0; px < inGrid; ++px)
+	{
+		cbs.BeginPatch_f(1, 0.0, -1.0, dsf_Flag_Physical, 7, f);
+		for (int r = 0; r < inRes-1; ++r)
+		{
+			cbs.BeginPrimitive_f(dsf_TriStrip, f);
+			for (int c = 0; c < inRes; ++c)
+			for (int k = 1; k >= 0; --k)
+			{
+				int		gx = px * (inRes-1) + c;
+				int		gy = py * (inRes-1) + r + k;
+				pc[0] = -118.0 + gx * cell;
+				pc[1] =   34.0 + gy * cell;
+				pc[2] = 1000.0 * bench_noise(gx * 0.05f, gy * 0.05f, inSeed);
+				pc[3] = BenchRandom(seed) - 0.5;
+				pc[4] = BenchRandom(seed) - 0.5;
+				pc[5] = (double) c / (double) (inRes-1);
+				pc[6] = (double) (r + k) / (double) (inRes-1);
+				cbs.AddPatchVertex_f(pc, f);
+			}
+			cbs.EndPrimitive_f(f);
+		}
+		cbs.EndPatch_f(f);
+
+		double	op[4] = { -118.0 + (px + 0.5) / (double) inGrid, 34.0 + (py + 0.5) / (double) inGrid, 360.0 * BenchRandom(seed) };
+		cbs.AddObject_f(0, op, 3, f);
+	}
+
+	DSFWriteToFile(inPath, f);
+	DSFDestroyWriter(f);
+}
+
+void	BenchMakeOBJ(XObj8& outObj, int inTris, int inSeed)
+{
+	unsigned int	seed = inSeed;
+	outObj.texture = "bench.png";
+	outObj.use_metalness = 0;
+	outObj.glass_blending = 0;
+	outObj.geo_tri.clear(8);
+	outObj.geo_lines.clear(6);
+	outObj.geo_lights.clear(6);
+	outObj.indices.clear();
+	outObj.lods.clear();
+
+	for (int n = 0; n < inTris * 3; ++n)
+	{
+		float	pt[8];
+		for (int i = 0; i < 3; ++i)	pt[i] = 20.0f * BenchRandom(seed) - 10.0f;
+		pt[3] = 0.0f; pt[4] = 1.0f; pt[5] = 0.0f;
+		pt[6] = BenchRandom(seed); pt[7] = BenchRandom(seed);
+		outObj.indices.push_back(outObj.geo_tri.append(pt));
+	}
+
+	// Three LODs, each one triangle command over a third of the index buffer.
+	int	per_lod = (inTris / 3) * 3;
+	for (int l = 0; l < 3; ++l)
+	{
+		XObjLOD8	lod;
+		lod.lod_near = l * 1000.0f;
+		lod.lod_far = (l+1) * 1000.0f;
+		XObjCmd8	cmd;
+		cmd.cmd = obj8_Tris;
+		cmd.idx_offset = l * per_lod;
+		cmd.idx_count = per_lod;
+		lod.cmds.push_back(cmd);
+		outObj.lods.push_back(lod);
+	}
+	outObj.geo_tri.get_minmax(outObj.xyz_min, outObj.xyz_max);
+}
+
+void	BenchMakeBitmap(ImageInfo& outImage, int inSize, int inSeed)
+{
+	CreateNewBitmap(inSize, inSize, 4, &outImage);
+	for (int y = 0; y < inSize; ++y)
+	{
+		unsigned char * p = outImage.data + y * (inSize * 4 + outImage.pad);
+		for (int x = 0; x < inSize; ++x)
+		for (int c = 0; c < 4; ++c)
+			*p++ = (unsigned char) (255.0f * bench_noise(x * 0.03f, y * 0.03f, inSeed + c));
+	}
+}
+
+void	BenchMakeTerrainRules(int inRules, int inSeed)
+{
+	unsigned int	seed = inSeed;
+	gNaturalTerrainRules.clear();
+
+	#define	RAND_RANGE(lo,hi,vmin,vmax,span) { float c = lo + (hi-lo) * BenchRandom(seed); rule.vmin = c; rule.vmax = c + (hi-lo) * span; }
+
+	for (int n = 0; n <= inRules; ++n)
+	{
+		NaturalTerrainRule_t	rule;
+		memset(&rule, 0, sizeof(rule));
+		rule.terrain = rule.zoning = rule.landuse = rule.soil_style = rule.agri_style = rule.clim_style = NO_VALUE;
+		if (n < inRules)
+		{
+			// Like the real tables: most rules gate on climate and slope, fewer on the urban and relief inputs.
+			RAND_RANGE(-20.0f, 35.0f, temp_min, temp_max, 0.2f)
+			RAND_RANGE(0.0f, 1.0f, slope_min, slope_max, 0.3f)
+			RAND_RANGE(0.0f, 3000.0f, rain_min, rain_max, 0.25f)
+			if (n % 3 == 0) RAND_RANGE(0.0f, 40.0f, temp_rng_min, temp_rng_max, 0.4f)
+			if (n % 4 == 0) RAND_RANGE(0.0f, 1.0f, rel_elev_min, rel_elev_max, 0.5f)
+			if (n % 5 == 0) RAND_RANGE(0.0f, 1000.0f, elev_range_min, elev_range_max, 0.5f)
+			if (n % 7 == 0) RAND_RANGE(0.0f, 1.0f, urban_density_min, urban_density_max, 0.3f)
+			if (n % 11 == 0) RAND_RANGE(-60.0f, 60.0f, lat_min, lat_max, 0.5f)
+		}
+		rule.name = n;
+		gNaturalTerrainRules.push_back(rule);
+	}
+
+	#undef RAND_RANGE
+}
+
+void	BenchMakeObjTables(int inTerrains, int inFeatures, int inRowsPerTerrain, int inSeed)
+{
+	unsigned int	seed = inSeed;
+	gRepTable.clear();
+	gRepFeatureIndex.clear();
+
+	vector<int>	terrains, features;
+	char	name[64];
+	for (int n = 0; n < inTerrains; ++n)
+	{
+		sprintf(name, "bench_terrain_%d", n);
+		terrains.push_back(LookupTokenCreate(name));
+	}
+	for (int n = 0; n < inFeatures; ++n)
+	{
+		sprintf(name, "bench_feature_%d", n);
+		features.push_back(n ? LookupTokenCreate(name) : NO_VALUE);
+	}
+
+	// Like obj_properties.txt: rows are grouped by terrain, with some any-terrain rows mixed in, and facades
+	// and objects interleaved.  Objects come in height ladders the way OBS_PROP expands them, tallest first.
+	for (int t = 0; t < inTerrains; ++t)
+	for (int n = 0; n < inRowsPerTerrain; )
+	{
+		RepInfo_t	info;
+		info.terrain = BenchRandom(seed) < 0.1f ? NO_VALUE : terrains[t];
+		info.feature = features[(int) (BenchRandom(seed) * inFeatures)];
+		info.road = BenchRandom(seed) < 0.3f;
+		info.fill = BenchRandom(seed) < 0.3f;
+		if (BenchRandom(seed) < 0.4f)
+		{
+			info.obj_type = rep_Fac;
+			info.width_min = 10.0f + 150.0f * BenchRandom(seed);
+			info.width_max = info.width_min + 200.0f * BenchRandom(seed);
+			info.depth_min = 5.0f + 60.0f * BenchRandom(seed);
+			info.depth_max = info.depth_min + 100.0f * BenchRandom(seed);
+			info.height_min = 5.0f + 40.0f * BenchRandom(seed);
+			info.height_max = info.height_min + 150.0f * BenchRandom(seed);
+			sprintf(name, "bench_fac_%d_%d", t, n);
+			info.obj_name = LookupTokenCreate(name);
+			gRepTable.push_back(info);
+			++n;
+		}
+		else
+		{
+			info.obj_type = rep_Obj;
+			info.width_min = info.width_max = 5.0f + 80.0f * BenchRandom(seed);
+			info.depth_min = info.depth_max = 5.0f + 80.0f * BenchRandom(seed);
+			info.height_min = 0;
+			int steps = 1 + BenchRandom(seed) * 8.0f;
+			for (int h = 10 * steps; h > 0 && n < inRowsPerTerrain; h -= 10, ++n)
+			{
+				info.height_max = h;
+				sprintf(name, "bench_obj_%d_%d", t, n);
+				info.obj_name = LookupTokenCreate(name);
+				gRepTable.push_back(info);
+			}
+		}
+	}
+	IndexObjTables();
+}
@@ -0,0 +1,2412 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "Bench.h"
+#include "DEMDefs.h"
+#include "DEMAlgs.h"
+#include "DEMTables.h"
+#include "GreedyMesh.h"
+#include "MeshDefs.h"
+#include "MapAlgs.h"
+#include "PolyRasterUtils.h"
+#include "DSFLib.h"
+#include "XObjDefs.h"
+#include "XObjReadWrite.h"
+#include "BitmapUtils.h"
+#include "FileUtils.h"
+#include "WED_XMLWriter.h"
+#include "WED_XMLReader.h"
+#include "WED_PropertyHelper.h"
+#include "WED_Archive.h"
+#include "WED_Persistent.h"
+#include "WED_UndoMgr.h"
+#include "IODefs.h"
+#include "WED_PackageMgr.h"
+#include "WED_LibraryMgr.h"
+#include "WED_Messages.h"
+#include "PlatformUtils.h"
+#include "ParallelUtils.h"
+#include "AptIO.h"
+#include "MemFileUtils.h"
+#include "WED_GatewayPack.h"
+#include "ObjTables.h"
+#include "EnumSystem.h"
+#include "WED_SnapGrid.h"
+#include "CompGeomUtils.h"
+#include "GUI_FontMetrics.h"
+#include "NetAlgs.h"
+#include "NetHelpers.h"
+#include "VPFTable.h"
+#include <json/json.h>
+
+void	GenFakeDSFFile(const char * path);		// DSFLib_TestGen.cpp
+
+// WED_PropertyHelper reads WED's unit preference, which lives in WED_Application - not part of the bench.
+#if IBM
+int					gIsFeet = 0;
+#else
+extern const int	gIsFeet = 0;
+#endif
+
+static double	file_size(const string& path)
+{
+	FILE * fi = fopen(path.c_str(), "rb");
+	if (fi == NULL) return 0.0;
+	fseek(fi, 0, SEEK_END);
+	double sz = ftell(fi);
+	fclose(fi);
+	return sz;
+}
+
+/************************************************************************************************
+ * DSF
+ ************************************************************************************************/
+
+// Sink callbacks - we count vertices so the reader can't be optimized into doing nothing.
+
+static bool	bench_NextPass(int, void *) { return true; }
+static int	bench_AcceptDef(const char *, void *) { return 1; }
+static void	bench_AcceptProperty(const char *, const char *, void *) { }
+static void	bench_BeginPatch(unsigned int, double, double, unsigned char, int, void *) { }
+static void	bench_BeginPrimitive(int, void *) { }
+static void	bench_AddPatchVertex(double c[], void * ref) { *((double *) ref) += 1.0; }
+static void	bench_End(void *) { }
+static void	bench_AddObject(unsigned int, double c[4], int, void * ref) { *((double *) ref) += 1.0; }
+static void	bench_BeginSegment(unsigned int, unsigned int, double c[], bool, void *) { }
+static void	bench_SegmentPoint(double c[], bool, void *) { }
+static void	bench_BeginPolygon(unsigned int, unsigned short, int, void *) { }
+static void	bench_AddPolygonPoint(double * c, void * ref) { *((double *) ref) += 1.0; }
+static void	bench_AddRasterData(DSFRasterHeader_t *, void *, void *) { }
+static void	bench_SetFilter(int, void *) { }
+
+static double	read_dsf(const string& path)
+{
+	DSFCallbacks_t	cbs;
+	cbs.NextPass_f = bench_NextPass;
+	cbs.AcceptTerrainDef_f = bench_AcceptDef;
+	cbs.AcceptObjectDef_f = bench_AcceptDef;
+	cbs.AcceptPolygonDef_f = bench_AcceptDef;
+	cbs.AcceptNetworkDef_f = bench_AcceptDef;
+	cbs.AcceptRasterDef_f = bench_AcceptDef;
+	cbs.AcceptProperty_f = bench_AcceptProperty;
+	cbs.BeginPatch_f = bench_BeginPatch;
+	cbs.BeginPrimitive_f = bench_BeginPrimitive;
+	cbs.AddPatchVertex_f = bench_AddPatchVertex;
+	cbs.EndPrimitive_f = bench_End;
+	cbs.EndPatch_f = bench_End;
+	cbs.AddObject_f = bench_AddObject;
+	cbs.BeginSegment_f = bench_BeginSegment;
+	cbs.AddSegmentShapePoint_f = bench_SegmentPoint;
+	cbs.EndSegment_f = bench_SegmentPoint;
+	cbs.BeginPolygon_f = bench_BeginPolygon;
+	cbs.BeginPolygonWinding_f = bench_End;
+	cbs.AddPolygonPoint_f = bench_AddPolygonPoint;
+	cbs.EndPolygonWinding_f = bench_End;
+	cbs.EndPolygon_f = bench_End;
+	cbs.AddRasterData_f = bench_AddRasterData;
+	cbs.SetFilter_f = bench_SetFilter;
+
+	double	count = 0.0;
+	if (DSFReadFile(path.c_str(), malloc, free, &cbs, NULL, &count) != dsf_ErrOK)
+		BenchFail("could not read %s\n", path.c_str());
+	return count;
+}
+
+static string	s_dsf_path;
+
+static void		dsf_write_setup(void) { s_dsf_path = gBenchTempDir + "bench_write.dsf"; }
+static double	dsf_write_run(void) { BenchMakeDSF(s_dsf_path.c_str(), 8, 64, 1); return file_size(s_dsf_path); }
+static void		dsf_cleanup(void) { FILE_delete_file(s_dsf_path.c_str(), false); }
+
+static void		dsf_read_setup(void) { s_dsf_path = gBenchTempDir + "bench_read.dsf"; BenchMakeDSF(s_dsf_path.c_str(), 8, 64, 2); }
+static double	dsf_read_run(void) { read_dsf(s_dsf_path); return file_size(s_dsf_path); }
+
+// The hand-built test DSF: tiny, but it exercises the overlay patches with odd coordinate depths.
+static void		dsf_read_fake_setup(void) { s_dsf_path = gBenchTempDir + "bench_fake.dsf"; GenFakeDSFFile(s_dsf_path.c_str()); }
+
+/************************************************************************************************
+ * DEM
+ ************************************************************************************************/
+
+static DEMGeo	s_dem;
+
+static void		dem_cleanup(void) { s_dem.resize(0,0); }
+
+static void		greedy_mesh_setup(void) { BenchMakeDEM(s_dem, 513, 3); }
+static double	greedy_mesh_run(void)
+{
+	CDT					mesh;
+	DEMMask				used(s_dem.mWidth, s_dem.mHeight, false);
+	CDT::Face_handle	hint;
+	int					corners[4][2] = { { 0, 0 }, { s_dem.mWidth-1, 0 }, { s_dem.mWidth-1, s_dem.mHeight-1 }, { 0, s_dem.mHeight-1 } };
+	for (int n = 0; n < 4; ++n)
+	{
+		CDT::Vertex_handle v = mesh.insert(CDT::Point(s_dem.x_to_lon(corners[n][0]), s_dem.y_to_lat(corners[n][1])), hint);
+		v->info().height = s_dem.get(corners[n][0], corners[n][1]);
+		used.set(corners[n][0], corners[n][1], true);
+		hint = v->face();
+	}
+	GreedyMeshBuild(mesh, s_dem, used, 5.0, 0.0, 20000, NULL);
+	return mesh.number_of_vertices();
+}
+
+static void		gaussian_blur_setup(void) { BenchMakeDEM(s_dem, 1024, 4); }
+static double	gaussian_blur_run(void)
+{
+	// Blurring the same DEM over and over costs the same each pass, so we don't need a fresh copy.
+	GaussianBlurDEM(s_dem, 3.0);
+	return (double) s_dem.mWidth * (double) s_dem.mHeight;
+}
+
+/************************************************************************************************
+ * MAP
+ ************************************************************************************************/
+
+static Pmwx		s_map;
+
+static void		poly_raster_setup(void)
+{
+	BenchMakeBlocks(s_map, 64, 5);
+	s_dem.resize(2048, 2048);
+	s_dem.mWest = -118.0;	s_dem.mEast = -117.0;
+	s_dem.mSouth = 34.0;	s_dem.mNorth = 35.0;
+}
+
+static double	poly_raster_run(void)
+{
+	double	pixels = 0.0;
+	for (Pmwx::Face_iterator f = s_map.faces_begin(); f != s_map.faces_end(); ++f)
+	if (!f->is_unbounded())
+	{
+		PolyRasterizer<double>	rast;
+		int y = SetupRasterizerForDEM(f, s_dem, rast);
+		rast.StartScanline(y);
+		while (!rast.DoneScan())
+		{
+			int x1, x2;
+			while (rast.GetRange(x1, x2))
+				pixels += (x2 - x1);
+			++y;
+			if (y >= s_dem.mHeight) break;
+			rast.AdvanceScanline(y);
+		}
+	}
+	return pixels;
+}
+
+static void		poly_raster_cleanup(void) { s_map.clear(); dem_cleanup(); }
+
+/************************************************************************************************
+ * TERRAIN RULES
+ ************************************************************************************************/
+
+struct	TerrainQuery_t {
+	float	slope, temp, temp_rng, rain, heading, rel_elev, elev_range, urban_density, lat;
+};
+
+static vector<TerrainQuery_t>	s_queries;
+
+static void		find_terrain_setup(void)
+{
+	BenchMakeTerrainRules(400, 6);
+	unsigned int seed = 7;
+	s_queries.resize(50000);
+	for (int n = 0; n < s_queries.size(); ++n)
+	{
+		TerrainQuery_t& q = s_queries[n];
+		q.slope = BenchRandom(seed);
+		q.temp = -20.0f + 55.0f * BenchRandom(seed);
+		q.temp_rng = 40.0f * BenchRandom(seed);
+		q.rain = 3000.0f * BenchRandom(seed);
+		q.heading = 2.0f * BenchRandom(seed) - 1.0f;
+		q.rel_elev = BenchRandom(seed);
+		q.elev_range = 1000.0f * BenchRandom(seed);
+		q.urban_density = BenchRandom(seed);
+		q.lat = -60.0f + 120.0f * BenchRandom(seed);
+	}
+}
+
+static double	find_terrain_run(void)
+{
+	int	check = 0;
+	for (int n = 0; n < s_queries.size(); ++n)
+	{
+		const TerrainQuery_t& q = s_queries[n];
+		check += FindNaturalTerrain(NO_VALUE, NO_VALUE, NO_VALUE, NO_VALUE, NO_VALUE, NO_VALUE,
+					q.slope, q.slope, q.temp, q.temp_rng, q.rain, 0, q.heading, q.rel_elev, q.elev_range,
+					q.urban_density, 0.0f, 0.0f, DEM_NO_DATA, q.lat);
+	}
+	if (check < 0) BenchFail("terrain rules returned no match.\n");
+	return s_queries.size();
+}
+
+static void		find_terrain_cleanup(void) { gNaturalTerrainRules.clear(); s_queries.clear(); }
+
+/************************************************************************************************
+ * OBJ AND DDS
+ ************************************************************************************************/
+
+static string	s_obj_path;
+
+static void		xobj8_read_setup(void)
+{
+	XObj8	obj;
+	BenchMakeOBJ(obj, 30000, 8);
+	s_obj_path = gBenchTempDir + "bench.obj";
+	XObj8Write(s_obj_path.c_str(), obj);
+}
+
+static double	xobj8_read_run(void)
+{
+	XObj8	obj;
+	if (!XObj8Read(s_obj_path.c_str(), obj))
+		BenchFail("could not read %s\n", s_obj_path.c_str());
+	return file_size(s_obj_path);
+}
+
+static void		xobj8_read_cleanup(void) { FILE_delete_file(s_obj_path.c_str(), false); }
+
+static ImageInfo	s_image;
+static string		s_dds_path;
+
+static void		dds_write_setup(void) { BenchMakeBitmap(s_image, 1024, 9); s_dds_path = gBenchTempDir + "bench.dds"; }
+static double	dds_write_run(void)
+{
+	WriteBitmapToDDS(s_image, 5, s_dds_path.c_str(), 0);
+	return (double) s_image.width * (double) s_image.height;
+}
+static void		dds_write_cleanup(void) { DestroyBitmap(&s_image); FILE_delete_file(s_dds_path.c_str(), false); }
+
+/************************************************************************************************
+ * WED XML SAVE
+ ************************************************************************************************/
+
+// A synthetic airport shaped like what WED_Archive::SaveToXML writes: per object the class/id/parent header,
+// sources, viewers and children lists, then the property elements - taxiway-style chains of airport nodes
+// with lat/lon at 9 decimals and line attribute sets.  inChains chains of inNodes nodes each.
+static void	write_airport_xml(FILE * fi, int inChains, int inNodes, int inSeed)
+{
+	unsigned int seed = inSeed;
+	int	id = 1;
+	fprintf(fi,"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+	WED_XMLElement	top_level("doc",0,fi);
+	WED_XMLElement * objs = top_level.add_sub_element("objects");
+
+	int apt_id = id++;
+	{
+		WED_XMLElement * obj = objs->add_sub_element("object");
+		obj->add_attr_c_str("class","WED_Airport");
+		obj->add_attr_int("id",apt_id);
+		obj->add_attr_int("parent_id",0);
+		obj->add_sub_element("sources");
+		obj->add_sub_element("viewers");
+		WED_XMLElement * chld = obj->add_sub_element("children");
+		for(int c = 0; c < inChains; ++c)
+			chld->add_sub_element("child")->add_attr_int("id",apt_id + 1 + c * (inNodes + 1));
+		WED_XMLElement * h = obj->add_or_find_sub_element("hierarchy");
+		h->add_attr_stl_str("name","Bench International");
+		h->add_attr_int("locked",0);
+		h->add_attr_int("hidden",0);
+		WED_XMLElement * a = obj->add_or_find_sub_element("airport");
+		a->add_attr_c_str("kind","airport");
+		a->add_attr_stl_str("ICAO","XBEN");
+		a->add_attr_int("elevation",123);
+		obj->flush();
+	}
+
+	for(int c = 0; c < inChains; ++c)
+	{
+		int chain_id = id++;
+		WED_XMLElement * obj = objs->add_sub_element("object");
+		obj->add_attr_c_str("class","WED_AirportChain");
+		obj->add_attr_int("id",chain_id);
+		obj->add_attr_int("parent_id",apt_id);
+		obj->add_sub_element("sources");
+		obj->add_sub_element("viewers");
+		WED_XMLElement * chld = obj->add_sub_element("children");
+		for(int n = 0; n < inNodes; ++n)
+			chld->add_sub_element("child")->add_attr_int("id",chain_id + 1 + n);
+		WED_XMLElement * h = obj->add_or_find_sub_element("hierarchy");
+		h->add_attr_stl_str("name","Taxiway & Apron <bench>");
+		h->add_attr_int("locked",0);
+		h->add_attr_int("hidden",0);
+		obj->add_sub_element("airport_chain")->add_attr_int("closed",0);
+		obj->flush();
+
+		double	lon = -118.0 + BenchRandom(seed) * 0.05;
+		double	lat = 34.0 + BenchRandom(seed) * 0.05;
+		for(int n = 0; n < inNodes; ++n)
+		{
+			lon += (BenchRandom(seed) - 0.5) * 0.0005;
+			lat += (BenchRandom(seed) - 0.5) * 0.0005;
+			WED_XMLElement * node = objs->add_sub_element("object");
+			node->add_attr_c_str("class","WED_AirportNode");
+			node->add_attr_int("id",id++);
+			node->add_attr_int("parent_id",chain_id);
+			node->add_sub_element("sources");
+			node->add_sub_element("viewers");
+			node->add_sub_element("children");
+			WED_XMLElement * nh = node->add_or_find_sub_element("hierarchy");
+			nh->add_attr_stl_str("name","Node");
+			nh->add_attr_int("locked",0);
+			nh->add_attr_int("hidden",0);
+			WED_XMLElement * pt = node->add_or_find_sub_element("point");
+			pt->add_attr_double("latitude",lat,9);
+			pt->add_attr_double("longitude",lon,9);
+			WED_XMLElement * bz = node->add_or_find_sub_element("bezier");
+			bz->add_attr_double("ctrl_latitude_lo",lat,9);
+			bz->add_attr_double("ctrl_longitude_lo",lon,9);
+			bz->add_attr_double("ctrl_latitude_hi",lat,9);
+			bz->add_attr_double("ctrl_longitude_hi",lon,9);
+			bz->add_attr_int("split",0);
+			WED_XMLElement * marks = node->add_or_find_sub_element("markings");
+			marks->add_sub_element("marking")->add_attr_c_str("value","Solid Yellow");
+			if(n % 3 == 0)
+				marks->add_sub_element("marking")->add_attr_c_str("value","Taxiway Centerline Lights");
+			node->flush();
+		}
+	}
+}
+
+static string	s_xml_path;
+
+static void		wed_xml_write_setup(void) { s_xml_path = gBenchTempDir + "bench.wed.xml"; }
+static double	wed_xml_write_run(void)
+{
+	FILE * fi = fopen(s_xml_path.c_str(),"w");
+	if(!fi) return 0.0;
+	write_airport_xml(fi, 200, 250, 10);
+	fclose(fi);
+	return file_size(s_xml_path);
+}
+static void		wed_xml_write_cleanup(void) { FILE_delete_file(s_xml_path.c_str(), false); }
+
+/************************************************************************************************
+ * WED XML LOAD
+ ************************************************************************************************/
+
+// Stand-ins for the classes write_airport_xml emits, with the same property titles as the real ones - the
+// real ones need a whole archive behind them.  Everything else in the file (sources, children, markings...)
+// goes through the property dispatch as a miss, just as it does for a WED_Thing.
+
+class	BenchXMLThing : public WED_PropertyHelper {
+public:
+	WED_PropStringText		name;
+	WED_PropBoolText		locked;
+	WED_PropBoolText		hidden;
+
+	BenchXMLThing() :
+		name(this,PROP_Name("Name", XML_Name("hierarchy","name")),"unnamed entity"),
+		locked(this,PROP_Name("Locked", XML_Name("hierarchy","locked")),0),
+		hidden(this,PROP_Name("Hidden", XML_Name("hierarchy","hidden")),0) { }
+	virtual ~BenchXMLThing() { }
+
+	virtual	void				PropEditCallback(int before) { }
+	virtual	int					CountSubs(void) { return 0; }
+	virtual	IPropertyObject *	GetNthSub(int n) { return NULL; }
+};
+
+class	BenchXMLAirport : public BenchXMLThing {
+public:
+	WED_PropIntText			elevation;
+	WED_PropStringText		icao;
+	BenchXMLAirport() :
+		elevation(this,PROP_Name("Field Elevation",	XML_Name("airport",	"elevation")),	0,6),
+		icao(this,PROP_Name("Airport ID", XML_Name("airport", "icao")), "xxxx") { }
+};
+
+class	BenchXMLChain : public BenchXMLThing {
+public:
+	WED_PropBoolText		closed;
+	BenchXMLChain() : closed(this,PROP_Name("Closed", XML_Name("airport_chain","closed")),0) { }
+};
+
+class	BenchXMLNode : public BenchXMLThing {
+public:
+	WED_PropDoubleText		latitude;
+	WED_PropDoubleText		longitude;
+	WED_PropBoolText		is_split;
+	WED_PropDoubleText		ctrl_lat_lo;
+	WED_PropDoubleText		ctrl_lon_lo;
+	WED_PropDoubleText		ctrl_lat_hi;
+	WED_PropDoubleText		ctrl_lon_hi;
+	BenchXMLNode() :
+		latitude (this,PROP_Name("latitude" ,XML_Name("point","latitude" )),0.0,13,9),
+		longitude(this,PROP_Name("longitude",XML_Name("point","longitude")),0.0,14,9),
+		is_split   (this,PROP_Name("Split",                  XML_Name("bezier","split")),0),
+		ctrl_lat_lo(this,PROP_Name("control_latitude_lo" ,XML_Name("bezier","ctrl_latitude_lo" )),0.0,13,9),
+		ctrl_lon_lo(this,PROP_Name("control_longitude_lo",XML_Name("bezier","ctrl_longitude_lo")),0.0,14,9),
+		ctrl_lat_hi(this,PROP_Name("control_latitude_hi" ,XML_Name("bezier","ctrl_latitude_hi" )),0.0,13,9),
+		ctrl_lon_hi(this,PROP_Name("control_longitude_hi",XML_Name("bezier","ctrl_longitude_hi")),0.0,14,9) { }
+};
+
+class	bench_state_writer : public IOWriter {
+public:
+	bench_state_writer(vector<char>& dst) : mDst(dst) { }
+	virtual	void	WriteShort(short v)		{ put(&v, sizeof(v)); }
+	virtual	void	WriteInt(int v)			{ put(&v, sizeof(v)); }
+	virtual	void	WriteFloat(float v)		{ put(&v, sizeof(v)); }
+	virtual	void	WriteDouble(double v)	{ put(&v, sizeof(v)); }
+	virtual	void	WriteBulk(const char * inBuf, int inLength, bool /*inZip*/) { put(inBuf, inLength); }
+private:
+	void	put(const void * p, int l) { mDst.insert(mDst.end(), (const char *) p, (const char *) p + l); }
+	vector<char>&	mDst;
+};
+
+// Plays the part of WED_Archive: makes an object per <object> and hands it the element's children.
+class	BenchXMLLoader : public WED_XMLHandler {
+public:
+	vector<BenchXMLThing *>	objs;
+	vector<const char *>	classes;
+	vector<int>				ids;
+	vector<int>				parents;
+
+	~BenchXMLLoader() { for(int n = 0; n < objs.size(); ++n) delete objs[n]; }
+
+	virtual void		StartElement(WED_XMLReader * reader, const XML_Char * name, const XML_Char ** atts)
+	{
+		if(strcmp(name,"object") != 0) return;
+		const XML_Char * cls = get_att("class", atts);
+		const XML_Char * id = get_att("id", atts);
+		const XML_Char * parent_id = get_att("parent_id", atts);
+		BenchXMLThing * obj;
+		if(cls && strcmp(cls,"WED_AirportNode") == 0)			{ obj = new BenchXMLNode;		classes.push_back("WED_AirportNode");	}
+		else if(cls && strcmp(cls,"WED_AirportChain") == 0)	{ obj = new BenchXMLChain;		classes.push_back("WED_AirportChain");	}
+		else													{ obj = new BenchXMLAirport;	classes.push_back("WED_Airport");		}
+		objs.push_back(obj);
+		ids.push_back(id ? atoi(id) : 0);
+		parents.push_back(parent_id ? atoi(parent_id) : 0);
+		reader->PushHandler(obj);
+	}
+	virtual	void		EndElement(void) { }
+	virtual	void		PopHandler(void) { }
+};
+
+static bool		load_bench_xml(const string& path, BenchXMLLoader& loader)
+{
+	WED_PropertyHelper::ResetXMLDispatch();				// As WED_Document does before each load.
+	WED_XMLReader	reader;
+	reader.PushHandler(&loader);
+	bool	exists;
+	string	err = reader.ReadFile(path.c_str(), &exists);
+	if(!err.empty())
+		BenchFail("could not load %s: %s\n", path.c_str(), err.c_str());
+	return err.empty();
+}
+
+// Writes what the loader holds back out the way WED_Archive::SaveToXML does - the class/id/parent header,
+// then the properties.  The loader keeps no sources, viewers or children, so those lists are not written.
+static void		save_bench_xml(const string& path, const BenchXMLLoader& loader)
+{
+	FILE * fi = fopen(path.c_str(),"w");
+	if(!fi) { BenchFail("could not write %s\n", path.c_str()); return; }
+	fprintf(fi,"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+	{
+		WED_XMLElement	top_level("doc",0,fi);
+		WED_XMLElement * objs = top_level.add_sub_element("objects");
+		for(int n = 0; n < loader.objs.size(); ++n)
+		{
+			WED_XMLElement * obj = objs->add_sub_element("object");
+			obj->add_attr_c_str("class",loader.classes[n]);
+			obj->add_attr_int("id",loader.ids[n]);
+			obj->add_attr_int("parent_id",loader.parents[n]);
+			loader.objs[n]->PropsToXML(obj);
+			obj->flush();
+		}
+	}
+	fclose(fi);
+}
+
+static bool		same_file_bytes(const string& a, const string& b)
+{
+	MFMemFile * fa = MemFile_Open(a.c_str());
+	MFMemFile * fb = MemFile_Open(b.c_str());
+	bool same = fa && fb &&
+		MemFile_GetEnd(fa) - MemFile_GetBegin(fa) == MemFile_GetEnd(fb) - MemFile_GetBegin(fb) &&
+		memcmp(MemFile_GetBegin(fa), MemFile_GetBegin(fb), MemFile_GetEnd(fa) - MemFile_GetBegin(fa)) == 0;
+	if(fa) MemFile_Close(fa);
+	if(fb) MemFile_Close(fb);
+	return same;
+}
+
+// The binary image WED_Thing::WriteTo would put in the undo and copy/paste streams for the loaded object.
+static void		bench_xml_image(const BenchXMLLoader& loader, int n, vector<char>& out)
+{
+	out.clear();
+	bench_state_writer	w(out);
+	w.WriteInt(loader.ids[n]);
+	w.WriteInt(loader.parents[n]);
+	loader.objs[n]->WritePropsTo(&w);
+}
+
+static string	s_xml_save1_path;
+static string	s_xml_save2_path;
+
+// Setup also does a load -> save -> load -> save round trip of the file and fails unless the two saves are
+// byte for byte the same and every object comes back from the second load with the same class, ids and
+// WriteTo image it had after the first - the dispatch cache must not lose or misroute anything on reload.
+static void		wed_xml_load_setup(void)
+{
+	s_xml_path = gBenchTempDir + "bench_load.wed.xml";
+	s_xml_save1_path = gBenchTempDir + "bench_load_save1.wed.xml";
+	s_xml_save2_path = gBenchTempDir + "bench_load_save2.wed.xml";
+	FILE * fi = fopen(s_xml_path.c_str(),"w");
+	if(!fi) return;
+	write_airport_xml(fi, 200, 250, 11);
+	fclose(fi);
+
+	BenchXMLLoader	first, second;
+	if(!load_bench_xml(s_xml_path, first)) return;
+	save_bench_xml(s_xml_save1_path, first);
+	if(!load_bench_xml(s_xml_save1_path, second)) return;
+	save_bench_xml(s_xml_save2_path, second);
+
+	if(!same_file_bytes(s_xml_save1_path, s_xml_save2_path))
+		BenchFail("%s and %s differ after a load/save round trip.\n", s_xml_save1_path.c_str(), s_xml_save2_path.c_str());
+	if(first.objs.size() != second.objs.size())
+	{
+		BenchFail("round trip loaded %d objects, then %d.\n", (int) first.objs.size(), (int) second.objs.size());
+		return;
+	}
+	vector<char>	a, b;
+	for(int n = 0; n < first.objs.size(); ++n)
+	{
+		bench_xml_image(first, n, a);
+		bench_xml_image(second, n, b);
+		if(strcmp(first.classes[n], second.classes[n]) != 0 || a != b)
+		{
+			BenchFail("object %d (%s) changed across a load/save round trip.\n", first.ids[n], first.classes[n]);
+			return;
+		}
+	}
+}
+
+static double	wed_xml_load_run(void)
+{
+	BenchXMLLoader	loader;
+	if(!load_bench_xml(s_xml_path, loader))
+		return 0.0;
+	if(loader.objs.size() != 1 + 200 * 251 || dynamic_cast<BenchXMLNode *>(loader.objs.back()) == NULL ||
+			static_cast<BenchXMLNode *>(loader.objs.back())->latitude.value == 0.0)
+		BenchFail("%s did not load as written.\n", s_xml_path.c_str());
+	return file_size(s_xml_path);
+}
+
+static void		wed_xml_load_cleanup(void)
+{
+	FILE_delete_file(s_xml_path.c_str(), false);
+	FILE_delete_file(s_xml_save1_path.c_str(), false);
+	FILE_delete_file(s_xml_save2_path.c_str(), false);
+}
+
+/************************************************************************************************
+ * WED UNDO
+ ************************************************************************************************/
+
+// WED_UndoMgr reads its memory budget from the prefs, which the bench never loads.
+const char *	GUI_GetPrefString(const char *, const char *, const char * def) { return def; }
+
+// A persistent object with a name, a point and a list - mutating the point changes bytes in place (the
+// patched case in WED_UndoLayer::Compact) while renames and list edits change the length of the image.
+class	BenchUndoThing : public WED_Persistent {
+
+DECLARE_PERSISTENT(BenchUndoThing)
+
+public:
+
+			void	Mutate(unsigned int& ioSeed);
+
+	virtual	bool 	ReadFrom(IOReader * reader);
+	virtual	void 	WriteTo(IOWriter * writer);
+	virtual	void	ToXML(WED_XMLElement *) { }
+	virtual	void	FromXML(WED_XMLReader *, const XML_Char **) { }
+	virtual	void	PostChangeNotify(void) { }
+
+private:
+
+	string			mName;
+	double			mX;
+	double			mY;
+	vector<int>		mList;
+};
+
+DEFINE_PERSISTENT(BenchUndoThing)
+
+BenchUndoThing::BenchUndoThing(WED_Archive * a) : WED_Persistent(a), mX(0.0), mY(0.0) { }
+BenchUndoThing::BenchUndoThing(WED_Archive * a, int id) : WED_Persistent(a, id), mX(0.0), mY(0.0) { }
+BenchUndoThing::~BenchUndoThing() { }
+
+void	BenchUndoThing::CopyFrom(const BenchUndoThing * rhs)
+{
+	StateChanged();
+	mName = rhs->mName;
+	mX = rhs->mX;
+	mY = rhs->mY;
+	mList = rhs->mList;
+}
+
+void	BenchUndoThing::Mutate(unsigned int& ioSeed)
+{
+	StateChanged();
+	int what = BenchRandom(ioSeed) * 4.0f;
+	int n = BenchRandom(ioSeed) * 100.0f;
+	switch(what) {
+	case 0:
+		mX += BenchRandom(ioSeed) - 0.5f;
+		mY += BenchRandom(ioSeed) - 0.5f;
+		break;
+	case 1:
+		mName = string("node ") + string(1 + n % 7, 'a' + n % 26);
+		break;
+	case 2:
+		mList.insert(mList.begin() + n % (mList.size() + 1), n);
+		break;
+	default:
+		if(!mList.empty())
+			mList[n % mList.size()] = -n;
+		break;
+	}
+}
+
+bool 	BenchUndoThing::ReadFrom(IOReader * reader)
+{
+	int n;
+	reader->ReadInt(n);
+	mName.resize(n);
+	if(n) reader->ReadBulk(&mName[0], n, false);
+	reader->ReadDouble(mX);
+	reader->ReadDouble(mY);
+	reader->ReadInt(n);
+	mList.resize(n);
+	for(int i = 0; i < n; ++i)
+		reader->ReadInt(mList[i]);
+	return false;
+}
+
+void 	BenchUndoThing::WriteTo(IOWriter * writer)
+{
+	writer->WriteInt(mName.size());
+	writer->WriteBulk(mName.c_str(), mName.size(), false);
+	writer->WriteDouble(mX);
+	writer->WriteDouble(mY);
+	writer->WriteInt(mList.size());
+	for(vector<int>::iterator i = mList.begin(); i != mList.end(); ++i)
+		writer->WriteInt(*i);
+}
+
+// Every live object's id and image, in id order.
+static void	undo_snapshot(WED_Archive& archive, int max_id, vector<char>& out)
+{
+	out.clear();
+	bench_state_writer	w(out);
+	for(int id = 1; id < max_id; ++id)
+	if(WED_Persistent * obj = archive.Fetch(id))
+	{
+		w.WriteInt(id);
+		obj->WriteTo(&w);
+	}
+}
+
+#define UNDO_OBJECTS	2000
+#define UNDO_COMMANDS	90		// WED_UndoMgr keeps at most 100 levels - stay under it so we can undo all the way back.
+
+static void		wed_undo_setup(void)
+{
+	static bool registered = false;
+	if(!registered)
+		BenchUndoThing_Register();
+	registered = true;
+}
+
+// Seeded commands that change, create and delete objects; then we undo every one of them and redo every
+// one of them, checking the whole archive against the state each command left behind.
+static double	wed_undo_run(void)
+{
+	unsigned int	seed = 17;
+	WED_Archive		archive(NULL);
+	WED_UndoMgr		undo(&archive, NULL);
+	archive.SetUndoManager(&undo);
+	undo.SetByteBudget((size_t) 1024 * 1024 * 1024);
+
+	vector<BenchUndoThing *>	live;
+	vector<vector<char> >		states(UNDO_COMMANDS + 1);
+
+	archive.StartCommand("Create");
+	for(int n = 0; n < UNDO_OBJECTS; ++n)
+	{
+		live.push_back(BenchUndoThing::CreateTyped(&archive));
+		for(int k = 0; k < 4; ++k)
+			live.back()->Mutate(seed);
+	}
+	archive.CommitCommand();
+	undo_snapshot(archive, live.back()->GetID() + 1, states[0]);
+
+	for(int c = 1; c <= UNDO_COMMANDS; ++c)
+	{
+		archive.StartCommand("Edit");
+		int edits = 1 + BenchRandom(seed) * UNDO_OBJECTS / 10;
+		for(int e = 0; e < edits; ++e)
+			live[(int) (BenchRandom(seed) * live.size())]->Mutate(seed);
+		if(c % 3 == 0)
+		{
+			int victim = BenchRandom(seed) * live.size();
+			live[victim]->Delete();
+			live.erase(live.begin() + victim);
+			live.push_back(BenchUndoThing::CreateTyped(&archive));
+			live.back()->Mutate(seed);
+		}
+		archive.CommitCommand();
+		undo_snapshot(archive, live.back()->GetID() + 1, states[c]);
+	}
+
+	int max_id = live.back()->GetID() + 1;	// Creates always go on the back.
+	vector<char>	now;
+	int				bad = 0;
+	for(int c = UNDO_COMMANDS; c > 0; --c)
+	{
+		undo.Undo();
+		undo_snapshot(archive, max_id, now);
+		if(now != states[c-1]) ++bad;
+	}
+	for(int c = 1; c <= UNDO_COMMANDS; ++c)
+	{
+		undo.Redo();
+		undo_snapshot(archive, max_id, now);
+		if(now != states[c]) ++bad;
+	}
+	if(bad)
+		BenchFail("%d of %d undo/redo steps did not restore the archive.\n", bad, 2 * UNDO_COMMANDS);
+	return 3 * UNDO_COMMANDS;
+}
+
+/************************************************************************************************
+ * WED LIBRARY SCAN
+ ************************************************************************************************/
+
+// The library index lives in the cache folder and the package manager can put up an alert - both come from
+// PlatformUtils, which needs the GUI toolkit.
+string			GetCacheFolder() { return gBenchTempDir + "bench_cache"; }
+void			DoUserAlert(const char * inMsg) { fprintf(stderr, "%s\n", inMsg); }
+
+#define LIB_PACKS		40
+#define LIB_EXPORTS		250		// per pack
+
+static WED_PackageMgr *	s_packages = NULL;
+static WED_LibraryMgr *	s_library = NULL;
+static string			s_xp_path;
+
+// An X-Plane folder with LIB_PACKS custom packs, each with a library.txt and the art it exports.  One file in
+// twenty is on disk in a different case than library.txt says, like a lot of real third-party libraries.
+static void		lib_make_fixture(void)
+{
+	s_xp_path = gBenchTempDir + "bench_xp";
+	FILE_make_dir_exist((s_xp_path + DIR_STR "Resources" DIR_STR "default scenery").c_str());
+	FILE_make_dir_exist(GetCacheFolder().c_str());
+	for(int p = 0; p < LIB_PACKS; ++p)
+	{
+		char pack[256], line[256];
+		sprintf(pack, "%s" DIR_STR "Custom Scenery" DIR_STR "Bench Pack %02d", s_xp_path.c_str(), p);
+		FILE_make_dir_exist((string(pack) + DIR_STR "objects").c_str());
+		FILE * lib = fopen((string(pack) + DIR_STR "library.txt").c_str(), "w");
+		if(!lib) return;
+		fprintf(lib, "A\n800\nLIBRARY\n\n");
+		for(int e = 0; e < LIB_EXPORTS; ++e)
+		{
+			if(e % 50 == 0)
+				fprintf(lib, e % 100 ? "PRIVATE\n" : "PUBLIC\n");
+			fprintf(lib, "EXPORT lib/bench/group_%d/item_%d.obj objects/item_%02d_%d.obj\n", e % 8, e, p, e);
+			sprintf(line, "%s" DIR_STR "objects" DIR_STR "%s_%02d_%d.obj", pack, e % 20 ? "item" : "Item", p, e);
+			FILE * obj = fopen(line, "w");
+			if(obj) fclose(obj);
+		}
+		fclose(lib);
+	}
+	s_packages = new WED_PackageMgr(s_xp_path.c_str());
+	s_library = new WED_LibraryMgr("");			// Scans once, which writes the index.
+}
+
+static void		lib_cleanup(void)
+{
+	delete s_library;
+	delete s_packages;
+	s_library = NULL;
+	s_packages = NULL;
+	FILE_delete_dir_recursive(s_xp_path + DIR_STR);
+	FILE_delete_dir_recursive(GetCacheFolder() + DIR_STR);
+}
+
+static double	lib_rescan(void)
+{
+	s_library->ReceiveMessage(s_packages, msg_SystemFolderChanged, 0);
+	if(s_library->GetNumVariants("lib/bench/group_1/item_1.obj") != LIB_PACKS)
+		BenchFail("the library did not pick up every pack.\n");
+	return LIB_PACKS * LIB_EXPORTS;
+}
+
+// Every library.txt parsed from scratch.
+static void		lib_scan_setup(void) { lib_make_fixture(); }
+static double	lib_scan_run(void)
+{
+	FILE_delete_file((GetCacheFolder() + DIR_STR "wed_library_index.bin").c_str(), false);
+	return lib_rescan();
+}
+
+// Every pack served from the index - but one file has been renamed since it was written, which the index
+// must not hide.
+static void		lib_scan_cached_setup(void)
+{
+	lib_make_fixture();
+	char old_name[256], new_name[256];
+	sprintf(old_name, "%s" DIR_STR "Custom Scenery" DIR_STR "Bench Pack 00" DIR_STR "objects" DIR_STR "item_00_1.obj", s_xp_path.c_str());
+	sprintf(new_name, "%s" DIR_STR "Custom Scenery" DIR_STR "Bench Pack 00" DIR_STR "objects" DIR_STR "ITEM_00_1.obj", s_xp_path.c_str());
+	FILE_rename_file(old_name, new_name);
+}
+
+static double	lib_scan_cached_run(void)
+{
+	double n = lib_rescan();
+	string rpath = s_library->GetResourcePath("lib/bench/group_1/item_1.obj");
+	if(FILE_get_file_name(rpath) != "ITEM_00_1.obj")
+		BenchFail("the library index served a stale path: %s\n", rpath.c_str());
+	return n;
+}
+
+/************************************************************************************************
+ * WED TEXTURE LOAD
+ ************************************************************************************************/
+
+// Opening an airport asks WED_TexMgr for a few dozen textures, PNG and DDS.  The serial run decodes them one after
+// another, as LookupTexture used to on the draw path.  The queued run hands them to a ParallelQueue sized the way
+// WED_TexMgr sizes it and polls until the last one is back - how long until the map is fully textured.
+
+#define TEX_COUNT	24
+#define TEX_SIZE	512
+
+static vector<string>	s_tex_paths;
+
+// The same work as WED_TexMgr::TexJob.
+struct	bench_tex_job : public ParallelQueueJob {
+	string		fpath;
+	ImageInfo	im;
+	int			res;
+
+	virtual	void operator()()
+	{
+		im.data = NULL;
+		res = MakeSupportedType(fpath.c_str(), &im);
+	}
+};
+
+static void		tex_load_setup(void)
+{
+	s_tex_paths.clear();
+	for(int n = 0; n < TEX_COUNT; ++n)
+	{
+		ImageInfo	im;
+		BenchMakeBitmap(im, TEX_SIZE, 100 + n);
+		char name[64];
+		sprintf(name, "bench_tex_%02d.%s", n, n % 2 ? "dds" : "png");
+		string path = gBenchTempDir + name;
+		if(n % 2)	WriteBitmapToDDS(im, 5, path.c_str(), 0);
+		else		WriteBitmapToPNG(&im, path.c_str(), NULL, 0, 2.2f);
+		DestroyBitmap(&im);
+		s_tex_paths.push_back(path);
+	}
+}
+
+static void		tex_load_cleanup(void)
+{
+	for(vector<string>::iterator p = s_tex_paths.begin(); p != s_tex_paths.end(); ++p)
+		FILE_delete_file(p->c_str(), false);
+	s_tex_paths.clear();
+}
+
+static double	tex_finish(bench_tex_job& job)
+{
+	if(job.res != 0)
+	{
+		BenchFail("could not decode %s\n", job.fpath.c_str());
+		return 0.0;
+	}
+	double pixels = (double) job.im.width * (double) job.im.height;
+	DestroyBitmap(&job.im);
+	return pixels;
+}
+
+static double	tex_load_serial_run(void)
+{
+	double pixels = 0.0;
+	for(vector<string>::iterator p = s_tex_paths.begin(); p != s_tex_paths.end(); ++p)
+	{
+		bench_tex_job	job;
+		job.fpath = *p;
+		job();
+		pixels += tex_finish(job);
+	}
+	return pixels;
+}
+
+static double	tex_load_queued_run(void)
+{
+	vector<bench_tex_job>	jobs(s_tex_paths.size());
+	ParallelQueue			queue(max(ParallelWorkerCount() - 1, 1));
+	for(int n = 0; n < (int) jobs.size(); ++n)
+	{
+		jobs[n].fpath = s_tex_paths[n];
+		queue.Push(&jobs[n]);
+	}
+
+	double pixels = 0.0;
+	vector<ParallelQueueJob *>	done;
+	while(1)
+	{
+		done.clear();
+		queue.PopDone(done);
+		for(vector<ParallelQueueJob *>::iterator d = done.begin(); d != done.end(); ++d)
+			pixels += tex_finish(*static_cast<bench_tex_job *>(*d));
+		if(queue.CountPending() == 0)
+			break;
+		if(done.empty())
+			boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+	}
+	return pixels;
+}
+
+/************************************************************************************************
+ * APT.DAT READ
+ ************************************************************************************************/
+
+// A synthetic apt.dat the shape of a big scenery pack: each airport gets a runway, a curved taxiway polygon, a
+// painted line, signs and ramp starts.  Setup reads it once with one worker and once with the full pool and checks
+// that both give the same airports, written back out; it then indexes the file and reads a seeded handful of airports
+// (plus a code that is not in it) with ReadAptIndexICAO and checks them against the same airports out of the full
+// read.  The run times the parallel read.
+
+#define APT_COUNT	3000
+
+static string	s_apt_path;
+
+static int	bench_apt_print(void * ref, const char * fmt, ...)
+{
+	char buf[4096];
+	va_list	va;
+	va_start(va, fmt);
+	int n = vsnprintf(buf, sizeof(buf), fmt, va);
+	va_end(va);
+	*((string *) ref) += buf;
+	return n;
+}
+
+static void		apt_read_setup(void)
+{
+	s_apt_path = gBenchTempDir + "bench_apt.dat";
+	FILE * fi = fopen(s_apt_path.c_str(), "w");
+	if (fi == NULL) return;
+	fprintf(fi, "I\n1100 Generated by the xptools bench.\n\n");
+
+	unsigned int seed = 39;
+	for (int a = 0; a < APT_COUNT; ++a)
+	{
+		double lon = -170.0 + 340.0 * BenchRandom(seed);
+		double lat = -60.0 + 120.0 * BenchRandom(seed);
+		fprintf(fi, "1 %d 0 0 B%03d Bench Airport %d\n", (int) (2000.0 * BenchRandom(seed)), a, a);
+		fprintf(fi, "100 45.00 1 0 0.25 1 2 1 09 %.8lf %.8lf 0.00 0.00 2 1 0 0 27 %.8lf %.8lf 0.00 0.00 2 1 0 0\n",
+			lat, lon, lat, lon + 0.03);
+
+		fprintf(fi, "110 1 0.25 0.00 Apron %d\n", a);
+		for (int n = 0; n < 12; ++n)
+		{
+			double plon = lon + 0.005 * cos(n * M_PI / 6.0) + 0.015, plat = lat + 0.003 * sin(n * M_PI / 6.0) + 0.004;
+			if (n == 11)	fprintf(fi, "113 %.8lf %.8lf\n", plat, plon);
+			else if (n % 3)	fprintf(fi, "111 %.8lf %.8lf\n", plat, plon);
+			else			fprintf(fi, "112 %.8lf %.8lf %.8lf %.8lf 1 102\n", plat, plon, plat + 0.0004, plon + 0.0004);
+		}
+
+		fprintf(fi, "120 Centerline %d\n", a);
+		for (int n = 0; n < 8; ++n)
+			fprintf(fi, "%d %.8lf %.8lf%s\n", n == 7 ? 115 : 111, lat + 0.001 * n, lon + 0.002 * n, n == 7 ? "" : " 1 102");
+
+		for (int n = 0; n < 6; ++n)
+			fprintf(fi, "20 %.8lf %.8lf %.2lf 0 2 {@Y}A%d\n", lat + 0.0015, lon + 0.004 * n, 90.0, n);
+		for (int n = 0; n < 4; ++n)
+			fprintf(fi, "1300 %.8lf %.8lf %.2lf gate jets|turboprops Gate %d\n", lat + 0.006, lon + 0.01 + 0.0005 * n, 180.0, n);
+	}
+	fprintf(fi, "99\n");
+	fclose(fi);
+
+	AptVector	serial, parallel;
+	string		serial_txt, parallel_txt;
+	SetParallelWorkerCount(1);
+	string err = ReadAptFile(s_apt_path.c_str(), serial);
+	SetParallelWorkerCount(0);
+	if (err.empty())
+		err = ReadAptFile(s_apt_path.c_str(), parallel);
+	if (!err.empty())
+		BenchFail("could not read %s: %s\n", s_apt_path.c_str(), err.c_str());
+	WriteAptFileProcs(bench_apt_print, &serial_txt, serial, 1100);
+	WriteAptFileProcs(bench_apt_print, &parallel_txt, parallel, 1100);
+	if (serial.size() != APT_COUNT || serial_txt != parallel_txt)
+		BenchFail("parallel apt.dat read does not match the serial one (%d vs %d airports).\n",
+			(int) serial.size(), (int) parallel.size());
+
+	MFMemFile * mf = MemFile_Open(s_apt_path.c_str());
+	if (mf == NULL) return;
+	AptFileIndex_t	index;
+	set<string>		wanted;
+	AptVector		subset, expected;
+	string			subset_txt, expected_txt;
+	unsigned int	pick = 3900;
+	for (int n = 0; n < 40; ++n)
+	{
+		char icao[16];
+		sprintf(icao, "B%03d", (int) (APT_COUNT * BenchRandom(pick)) % APT_COUNT);
+		wanted.insert(icao);
+	}
+	wanted.insert("ZZZZ");
+	err = IndexAptFileMem(MemFile_GetBegin(mf), MemFile_GetEnd(mf), index);
+	if (err.empty())
+		err = ReadAptIndexICAO(index, wanted, subset);
+	MemFile_Close(mf);
+	if (!err.empty())
+		BenchFail("could not read airports by ICAO out of %s: %s\n", s_apt_path.c_str(), err.c_str());
+	for (AptVector::iterator a = serial.begin(); a != serial.end(); ++a)
+	if (wanted.count(a->icao))
+		expected.push_back(*a);
+	WriteAptFileProcs(bench_apt_print, &subset_txt, subset, 1100);
+	WriteAptFileProcs(bench_apt_print, &expected_txt, expected, 1100);
+	if (index.apt_begin.size() != APT_COUNT || subset.size() != wanted.size() - 1 || subset_txt != expected_txt)
+		BenchFail("ICAO subset read does not match the full read (%d of %d airports, %d indexed).\n",
+			(int) subset.size(), (int) wanted.size() - 1, (int) index.apt_begin.size());
+}
+
+static double	apt_read_run(void)
+{
+	MFMemFile * mf = MemFile_Open(s_apt_path.c_str());
+	if (mf == NULL) return 0.0;
+	AptVector	apts;
+	string err = ReadAptFileMem(MemFile_GetBegin(mf), MemFile_GetEnd(mf), apts);
+	double bytes = MemFile_GetEnd(mf) - MemFile_GetBegin(mf);
+	MemFile_Close(mf);
+	if (!err.empty() || apts.size() != APT_COUNT)
+		BenchFail("apt.dat read gave %d airports: %s\n", (int) apts.size(), err.c_str());
+	return bytes;
+}
+
+static void		apt_read_cleanup(void)
+{
+	FILE_delete_file(s_apt_path.c_str(), false);
+}
+
+/************************************************************************************************
+ * GATEWAY PACK
+ ************************************************************************************************/
+
+// A scenery pack as the gateway serves it: a little metadata around a multi-megabyte base64 zip, with the
+// slashes escaped the way the server's JSON encoder does.  gateway_pack_dom is the old import - read the file,
+// build a jsoncpp DOM, copy the blob out and decode it; gateway_pack_scan is WED_ReadGatewayPack on the mapped
+// file.  Setup checks both give the same ICAO, scenery ID and zip bytes; the ICAO carries a two- and a four-byte
+// UTF-8 character (the latter as a \u surrogate pair) and must come out as exactly those bytes.
+
+#define PACK_ZIP_BYTES	(6 * 1024 * 1024)
+
+static string	s_pack_path;
+
+extern "C" void decode( const char * startP, const char * endP, char * destP, char ** out);
+
+static void		pack_write_b64(FILE * fi, const vector<char>& data)
+{
+	static const char tbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	for (size_t n = 0; n < data.size(); n += 3)
+	{
+		unsigned int	v = (unsigned char) data[n] << 16;
+		if (n + 1 < data.size()) v |= (unsigned char) data[n+1] << 8;
+		if (n + 2 < data.size()) v |= (unsigned char) data[n+2];
+		char	q[4] = { tbl[(v >> 18) & 63], tbl[(v >> 12) & 63], tbl[(v >> 6) & 63], tbl[v & 63] };
+		if (n + 1 >= data.size()) q[2] = '=';
+		if (n + 2 >= data.size()) q[3] = '=';
+		for (int i = 0; i < 4; ++i)
+		if (q[i] == '/')	fputs("\\/", fi);
+		else				fputc(q[i], fi);
+	}
+}
+
+static bool		pack_read_dom(const string& path, string& icao, int& id, vector<char>& zip)
+{
+	string	text;
+	if (FILE_read_file_to_string(path, text) != 0)
+		return false;
+	Json::Value root = Json::Value(Json::objectValue);
+	Json::Reader reader;
+	if (!reader.parse(text, root))
+		return false;
+
+	string zipString = root["scenery"]["masterZipBlob"].asString();
+	zip.resize(zipString.length());
+	char * outP;
+	decode(&*zipString.begin(), &*zipString.end(), &*zip.begin(), &outP);
+	zip.resize(outP - &*zip.begin());
+	icao = root["scenery"]["icao"].asString();
+	id = root["scenery"]["sceneryId"].asInt();
+	return true;
+}
+
+static bool		pack_read_scan(const string& path, string& icao, int& id, vector<char>& zip)
+{
+	MFMemFile * mf = MemFile_Open(path.c_str());
+	if (mf == NULL)
+		return false;
+	bool ok = WED_ReadGatewayPack(MemFile_GetBegin(mf), MemFile_GetEnd(mf), icao, id, zip);
+	MemFile_Close(mf);
+	return ok;
+}
+
+static void		gateway_pack_setup(void)
+{
+	s_pack_path = gBenchTempDir + "bench_pack.json";
+	FILE * fi = fopen(s_pack_path.c_str(), "wb");
+	if (fi == NULL) return;
+
+	vector<char>	zip(PACK_ZIP_BYTES);
+	unsigned int	seed = 40;
+	for (size_t n = 0; n < zip.size(); ++n)
+		zip[n] = (char) (BenchRandom(seed) * 256.0f);
+
+	fprintf(fi, "{\"status\":\"ok\",\"features\":[{\"id\":1,\"name\":\"has_atc\"},{\"id\":2,\"name\":\"{brackets] in \\\"text\\\"\"}],\n");
+	fprintf(fi, "\"scenery\":{\"sceneryId\":41234,\"parentId\":40000,\"icao\":\"KB\\u00c9N\\ud83d\\ude80\",\"aptName\":\"Bench \\/ Field\",\n");
+	fprintf(fi, "\"additionalMetadata\":{\"city\":\"Nowhere\",\"tags\":[1,2,3,{\"x\":null}],\"score\":-1.5e3,\"ok\":true},\n");
+	fprintf(fi, "\"masterZipBlob\":\"");
+	pack_write_b64(fi, zip);
+	fprintf(fi, "\",\"dateUpload\":\"2018-01-01T00:00:00.000Z\"}}\n");
+	fclose(fi);
+
+	string			dom_icao, scan_icao;
+	int				dom_id = 0, scan_id = 0;
+	vector<char>	dom_zip, scan_zip;
+	if (!pack_read_dom(s_pack_path, dom_icao, dom_id, dom_zip) || !pack_read_scan(s_pack_path, scan_icao, scan_id, scan_zip))
+		BenchFail("could not read %s\n", s_pack_path.c_str());
+	else if (dom_icao != scan_icao || scan_icao != "KB\xC3\x89N\xF0\x9F\x9A\x80" || dom_id != scan_id || dom_zip != scan_zip || scan_zip != zip)
+		BenchFail("scanned scenery pack does not match the DOM import (%s/%d vs %s/%d).\n",
+			scan_icao.c_str(), scan_id, dom_icao.c_str(), dom_id);
+}
+
+static double	gateway_pack_dom_run(void)
+{
+	string			icao;
+	int				id;
+	vector<char>	zip;
+	pack_read_dom(s_pack_path, icao, id, zip);
+	return file_size(s_pack_path);
+}
+
+static double	gateway_pack_scan_run(void)
+{
+	string			icao;
+	int				id;
+	vector<char>	zip;
+	pack_read_scan(s_pack_path, icao, id, zip);
+	return file_size(s_pack_path);
+}
+
+static void		gateway_pack_cleanup(void)
+{
+	FILE_delete_file(s_pack_path.c_str(), false);
+}
+
+/************************************************************************************************
+ * OBJ TABLES
+ ************************************************************************************************/
+
+// The size queries the autogen placer makes per block.  obj_query_scan is the linear scan over the terrain's
+// table range that QueryUsableFacsBySize/QueryUsableObjsBySize used to do; obj_query_index is the indexed
+// version.  Setup runs a separate seeded batch through both and fails unless every result list is identical.
+
+#define OBJ_QUERY_COUNT		100000
+#define OBJ_QUERY_CHECKS	200000
+
+struct	ObjQuery_t {
+	int		is_fac;
+	int		feature, terrain;
+	float	w, d, h;
+	int		road, fill;
+	int		max_results;
+};
+
+static vector<ObjQuery_t>	s_obj_queries;
+
+static int	scan_query_facs(int feature, int terrain, float inLongSide, float inShortSide, float inTargetHeight, int * outResults, int inMaxResults)
+{
+	int ret = 0;
+	RepTableTerrainIndex::iterator range = gRepTableTerrainIndex.find(terrain);
+	if (range == gRepTableTerrainIndex.end()) return 0;
+	for (int row = range->second.first; row < range->second.second; ++row)
+	{
+		RepInfo_t& rec = gRepTable[row];
+		if (rec.obj_type == rep_Fac)
+		if ((rec.feature == feature) &&
+			(rec.terrain == NO_VALUE || rec.terrain == terrain) &&
+			(inLongSide >= rec.width_min && inLongSide <= rec.width_max) &&
+			(inShortSide >= rec.depth_min && inShortSide <= rec.depth_max) &&
+			(inTargetHeight >= rec.height_min && inTargetHeight <= rec.height_max))
+		{
+			outResults[ret] = row;
+			++ret;
+			if (ret >= inMaxResults)
+				return ret;
+		}
+	}
+	return ret;
+}
+
+static int	scan_query_objs(int feature, int terrain, float inWidth, float inDepth, float inHeightMax, int road, int fill, int * outResults, int inMaxResults)
+{
+	int ret = 0;
+	RepTableTerrainIndex::iterator range = gRepTableTerrainIndex.find(terrain);
+	if (range == gRepTableTerrainIndex.end()) return 0;
+	for (int row = range->second.first; row < range->second.second; ++row)
+	{
+		RepInfo_t& rec = gRepTable[row];
+		if (rec.obj_type == rep_Obj)
+		if ((rec.feature == feature) &&
+			(rec.terrain == NO_VALUE || rec.terrain == terrain) &&
+			(inWidth == -1 || (inWidth >= rec.width_max)) &&
+			(inDepth == -1 || (inDepth >= rec.depth_max)) &&
+			(inHeightMax >= rec.height_max) &&
+			(!fill || rec.fill) &&
+			(!road || rec.road))
+		{
+			outResults[ret] = row;
+			++ret;
+			if (ret >= inMaxResults)
+				return ret;
+		}
+	}
+	return ret;
+}
+
+static void		obj_make_queries(vector<ObjQuery_t>& outQueries, int inCount, unsigned int seed)
+{
+	outQueries.resize(inCount);
+	for (int n = 0; n < inCount; ++n)
+	{
+		ObjQuery_t& q(outQueries[n]);
+		char	name[64];
+		q.is_fac = BenchRandom(seed) < 0.5f;
+		// A few queries ask for terrains and features the table has never heard of.
+		sprintf(name, "bench_feature_%d", (int) (BenchRandom(seed) * 14.0f));
+		q.feature = BenchRandom(seed) < 0.1f ? NO_VALUE : LookupTokenCreate(name);
+		sprintf(name, "bench_terrain_%d", (int) (BenchRandom(seed) * 42.0f));
+		q.terrain = BenchRandom(seed) < 0.05f ? NO_VALUE : LookupTokenCreate(name);
+		q.w = BenchRandom(seed) < 0.1f ? -1.0f : 200.0f * BenchRandom(seed);
+		q.d = BenchRandom(seed) < 0.1f ? -1.0f : 120.0f * BenchRandom(seed);
+		q.h = 120.0f * BenchRandom(seed);
+		q.road = BenchRandom(seed) < 0.3f;
+		q.fill = BenchRandom(seed) < 0.3f;
+		q.max_results = BenchRandom(seed) < 0.5f ? 1 + BenchRandom(seed) * 4.0f : 1000;
+	}
+}
+
+static int		obj_query(const ObjQuery_t& q, bool index, int * results)
+{
+	if (q.is_fac)	return index ?	QueryUsableFacsBySize(q.feature, q.terrain, q.w, q.d, q.h, results, q.max_results) :
+									scan_query_facs(q.feature, q.terrain, q.w, q.d, q.h, results, q.max_results);
+	else			return index ?	QueryUsableObjsBySize(q.feature, q.terrain, q.w, q.d, q.h, q.road, q.fill, results, q.max_results) :
+									scan_query_objs(q.feature, q.terrain, q.w, q.d, q.h, q.road, q.fill, results, q.max_results);
+}
+
+static void		obj_query_setup(void)
+{
+	BenchMakeObjTables(40, 12, 600, 42);
+
+	vector<ObjQuery_t>	checks;
+	obj_make_queries(checks, OBJ_QUERY_CHECKS, 4242);
+	vector<int>	scan(1000), idx(1000);
+	int	bad = 0;
+	for (int n = 0; n < checks.size(); ++n)
+	{
+		int ns = obj_query(checks[n], false, &*scan.begin());
+		int ni = obj_query(checks[n], true, &*idx.begin());
+		if (ns != ni || !equal(scan.begin(), scan.begin() + ns, idx.begin()))
+			++bad;
+	}
+	if (bad)
+		BenchFail("indexed object queries differ from the linear scan in %d of %d queries.\n", bad, (int) checks.size());
+
+	obj_make_queries(s_obj_queries, OBJ_QUERY_COUNT, 17);
+}
+
+static double	obj_query_run(bool index)
+{
+	int results[1000];
+	int	total = 0;
+	for (int n = 0; n < s_obj_queries.size(); ++n)
+		total += obj_query(s_obj_queries[n], index, results);
+	if (total == 0) BenchFail("no object query found anything.\n");
+	return s_obj_queries.size();
+}
+
+static double	obj_query_scan_run(void)	{ return obj_query_run(false); }
+static double	obj_query_index_run(void)	{ return obj_query_run(true); }
+
+static void		obj_query_cleanup(void)
+{
+	gRepTable.clear();
+	IndexObjTables();
+	s_obj_queries.clear();
+}
+
+/************************************************************************************************
+ * WED SNAP
+ ************************************************************************************************/
+
+// Dragging a vertex with snapping on, over a dense synthetic airport: rings of taxiway nodes, a third of them
+// beziers with handles (some off-screen), and shared nodes stacked on top of each other.  Every drag step moves
+// the dragged node and then asks for the nearest other point within the snap radius.  snap_drag_rebuild is what
+// SnapMovePoint used to do per step - rebuild the cache and scan every point in pixels; snap_drag_grid patches the
+// node's slots in a WED_SnapGrid and queries it.  Setup runs a separate drag through both and fails unless every
+// step snaps to the same slot.  (The rebuild kernel only copies the points - the real re-walk of the world costs more.)
+
+#define SNAP_NODES			60000
+#define SNAP_DRAG_STEPS		2000
+#define SNAP_RADIUS_PX		4
+
+// The same linear lon/lat to pixel mapping as WED_MapZoomerNew.
+struct	bench_zoomer {
+	double	lon_c, lat_c, lon_cos, p2d, px_c_x, px_c_y;
+
+	Point2	LLToPixel(const Point2& p) { return Point2(px_c_x + (p.x() - lon_c) * lon_cos / p2d, px_c_y + (p.y() - lat_c) / p2d); }
+	Point2	PixelToLL(const Point2& p) { return Point2(lon_c + (p.x() - px_c_x) * p2d / lon_cos, lat_c + (p.y() - px_c_y) * p2d); }
+};
+
+struct	bench_snap_slot {
+	Point2			loc;
+	const void *	owner;
+	bool			has;
+};
+
+static vector<bench_snap_slot>	s_snap_slots;
+static vector<int>				s_snap_first;		// first slot of each node
+static vector<char>				s_snap_owners;		// a node's owner is the address of its byte in here
+static bench_zoomer				s_snap_zoomer;
+static Bbox2					s_snap_bounds;
+
+static void		snap_make_layout(void)
+{
+	unsigned int seed = 44;
+	s_snap_zoomer.lon_c = -118.40;	s_snap_zoomer.lat_c = 33.94;
+	s_snap_zoomer.lon_cos = cos(s_snap_zoomer.lat_c * DEG_TO_RAD);
+	s_snap_zoomer.p2d = 0.03 / 1600.0;
+	s_snap_zoomer.px_c_x = 800.0;	s_snap_zoomer.px_c_y = 800.0;
+	s_snap_bounds = Bbox2(s_snap_zoomer.PixelToLL(Point2(0,0)), s_snap_zoomer.PixelToLL(Point2(1600,1600)));
+
+	s_snap_slots.clear();
+	s_snap_first.clear();
+	s_snap_owners.assign(SNAP_NODES, 0);
+	double	px = s_snap_zoomer.p2d;
+	Point2	ring_c;
+	for (int n = 0; n < SNAP_NODES; ++n)
+	{
+		if (n % 40 == 0)
+			ring_c = s_snap_zoomer.PixelToLL(Point2(1700.0 * BenchRandom(seed) - 50.0, 1700.0 * BenchRandom(seed) - 50.0));
+		bench_snap_slot	sl;
+		sl.owner = &s_snap_owners[n];
+		sl.has = true;
+		if (n % 40 != 0 && BenchRandom(seed) < 0.1f)
+			sl.loc = s_snap_slots[s_snap_first[n-1]].loc;			// a node shared with the previous one
+		else
+		{
+			double a = (n % 40) * 2.0 * M_PI / 40.0;
+			sl.loc = ring_c + Vector2(cos(a), sin(a)) * (60.0 * px) + Vector2(BenchRandom(seed) - 0.5, BenchRandom(seed) - 0.5) * (6.0 * px);
+		}
+		s_snap_first.push_back(s_snap_slots.size());
+		s_snap_slots.push_back(sl);
+		if (BenchRandom(seed) < 0.33f)
+		for (int h = 0; h < 2; ++h)
+		{
+			bench_snap_slot	hs(sl);
+			hs.has = BenchRandom(seed) < 0.8f;
+			hs.loc = sl.loc + Vector2(BenchRandom(seed) - 0.5, BenchRandom(seed) - 0.5) * (40.0 * px);
+			s_snap_slots.push_back(hs);
+		}
+	}
+}
+
+static void		snap_fill_grid(WED_SnapGrid& grid)
+{
+	grid.Clear();
+	for (int n = 0; n < s_snap_slots.size(); ++n)
+		grid.AddSlot(s_snap_slots[n].owner, s_snap_slots[n].has, s_snap_slots[n].loc);
+	grid.Build(s_snap_bounds);
+}
+
+// A drag picks a node, then moves it to a new track point every step.
+static int		snap_drag_node(unsigned int& seed)
+{
+	return (int) (BenchRandom(seed) * SNAP_NODES);
+}
+
+static Point2	snap_drag_step(unsigned int& seed, int step)
+{
+	// Every few steps, head right onto another node so there is something to snap to.
+	if (step % 3 == 0)
+	{
+		int other = (int) (BenchRandom(seed) * SNAP_NODES);
+		double px = s_snap_zoomer.p2d;
+		return s_snap_slots[s_snap_first[other]].loc + Vector2(BenchRandom(seed) - 0.5, BenchRandom(seed) - 0.5) * (6.0 * px);
+	}
+	return s_snap_zoomer.PixelToLL(Point2(1600.0 * BenchRandom(seed), 1600.0 * BenchRandom(seed)));
+}
+
+static void		snap_move_node(WED_SnapGrid * grid, int node, const Point2& loc)
+{
+	int first = s_snap_first[node];
+	int last = node + 1 < s_snap_first.size() ? s_snap_first[node+1] : s_snap_slots.size();
+	Vector2	delta(s_snap_slots[first].loc, loc);
+	for (int n = first; n < last; ++n)
+	{
+		s_snap_slots[n].loc = s_snap_slots[n].loc + delta;
+		if (grid)
+			grid->SetSlot(n, s_snap_slots[n].has, s_snap_slots[n].loc);
+	}
+}
+
+// What SnapMovePoint did before the grid: a fresh cache of every point, scanned front to back.
+static int		snap_scan(const Point2& pt, const void * skip)
+{
+	vector<pair<Point2, const void *> >	cache;
+	for (int n = 0; n < s_snap_slots.size(); ++n)
+	if (s_snap_slots[n].has)
+		cache.push_back(pair<Point2, const void *>(s_snap_slots[n].loc, s_snap_slots[n].owner));
+
+	double	smallest_dist = 9.9e9;
+	int		best = -1;
+	for (int n = 0; n < cache.size(); ++n)
+	if (cache[n].second != skip)
+	{
+		double dist = Vector2(s_snap_zoomer.LLToPixel(cache[n].first), s_snap_zoomer.LLToPixel(pt)).squared_length();
+		if (dist < (SNAP_RADIUS_PX * SNAP_RADIUS_PX) && dist < smallest_dist)
+		{
+			smallest_dist = dist;
+			best = n;
+		}
+	}
+	// Map the index in the cache back to a slot number.
+	for (int n = 0; n < s_snap_slots.size() && best >= 0; ++n)
+	if (s_snap_slots[n].has && best-- == 0)
+		return n;
+	return -1;
+}
+
+static void		snap_setup(void)
+{
+	snap_make_layout();
+
+	// Re-set every slot back to front, so each cell lists its slots highest first - the order where getting ties
+	// wrong would show.
+	WED_SnapGrid	grid;
+	snap_fill_grid(grid);
+	for (int n = s_snap_slots.size() - 1; n >= 0; --n)
+		grid.SetSlot(n, s_snap_slots[n].has, s_snap_slots[n].loc);
+	unsigned int seed = 4400;
+	int bad = 0, snaps = 0, steps = 0;
+	for (int d = 0; d < 20; ++d)
+	{
+		int node = snap_drag_node(seed);
+		for (int i = 0; i < 100; ++i, ++steps)
+		{
+			Point2 track = snap_drag_step(seed, i);
+			snap_move_node(&grid, node, track);
+			int slow = snap_scan(track, s_snap_slots[s_snap_first[node]].owner);
+			int fast = grid.FindNearest(&s_snap_zoomer, track, SNAP_RADIUS_PX, s_snap_slots[s_snap_first[node]].owner);
+			if (slow != fast) ++bad;
+			if (fast >= 0) ++snaps;
+		}
+	}
+	if (bad || snaps == 0)
+		BenchFail("snap grid differs from the linear scan on %d of %d drag steps (%d snapped).\n", bad, steps, snaps);
+	snap_make_layout();
+}
+
+static double	snap_drag_rebuild_run(void)
+{
+	unsigned int seed = 45;
+	int node = snap_drag_node(seed);
+	for (int i = 0; i < SNAP_DRAG_STEPS / 20; ++i)		// 20x fewer steps - it is that slow.
+	{
+		Point2 track = snap_drag_step(seed, i);
+		snap_move_node(NULL, node, track);
+		snap_scan(track, s_snap_slots[s_snap_first[node]].owner);
+	}
+	return SNAP_DRAG_STEPS / 20;
+}
+
+static double	snap_drag_grid_run(void)
+{
+	WED_SnapGrid	grid;
+	snap_fill_grid(grid);				// once per edit, like the first SnapMovePoint of a drag
+	unsigned int seed = 45;
+	int node = snap_drag_node(seed);
+	for (int i = 0; i < SNAP_DRAG_STEPS; ++i)
+	{
+		Point2 track = snap_drag_step(seed, i);
+		snap_move_node(&grid, node, track);
+		grid.FindNearest(&s_snap_zoomer, track, SNAP_RADIUS_PX, s_snap_slots[s_snap_first[node]].owner);
+	}
+	return SNAP_DRAG_STEPS;
+}
+
+static void		snap_cleanup(void)
+{
+	s_snap_slots.clear();
+	s_snap_first.clear();
+	s_snap_owners.clear();
+}
+
+/************************************************************************************************
+ * SELECT CROSSING / DOUBLES
+ ************************************************************************************************/
+
+// The broad phases behind Select Crossing Edges and Select Doubles, on a synthetic ATC network: chains of taxi
+// routes with shared nodes, axis-parallel and zero-length edges, and clusters of nodes a few centimeters apart.
+// box_pairs_scan and near_points_scan are the all-pairs loops those commands used to run; box_pairs_sweep and
+// near_points_grid are FindOverlappingBoxes and FindNextNearPoints.  Setup runs a second, differently seeded layout
+// through both and fails unless the sorted box pairs and every point's next near point match.
+
+#define CROSS_EDGES		10000
+#define NEAR_POINTS		20000
+#define NEAR_DIST		(1.0 * MTR_TO_DEG_LAT)
+
+static vector<Bbox2>	s_cross_boxes;
+static vector<Point2>	s_near_pts;
+
+static void		cross_make_layout(unsigned int seed)
+{
+	s_cross_boxes.clear();
+	s_near_pts.clear();
+	Point2	at;
+	for (int n = 0; n < NEAR_POINTS; ++n)
+	{
+		float r = BenchRandom(seed);
+		if (n % 50 == 0)
+			at = Point2(-118.43 + 0.06 * BenchRandom(seed), 33.92 + 0.04 * BenchRandom(seed));
+		if (n > 0 && r < 0.05f)
+			at = s_near_pts[n - 1 - (int) (BenchRandom(seed) * min(n, 8))];			// stacked on an earlier node
+		else if (r < 0.15f)
+			at = at + Vector2(BenchRandom(seed) - 0.5, BenchRandom(seed) - 0.5) * (2.5 * NEAR_DIST);	// just about too close
+		else if (r < 0.3f)
+			at = at + Vector2(BenchRandom(seed) < 0.5f ? 0.0003 : 0.0, BenchRandom(seed) < 0.5f ? 0.0 : 0.0002);	// axis-parallel
+		else
+			at = at + Vector2(BenchRandom(seed) - 0.5, BenchRandom(seed) - 0.5) * 0.0008;
+		s_near_pts.push_back(at);
+	}
+
+	// Route edges run along the node chain, so consecutive edges share a node and some are zero length.
+	for (int n = 1; n < NEAR_POINTS && s_cross_boxes.size() < CROSS_EDGES; n += 2)
+	if (n % 50 != 0)
+		s_cross_boxes.push_back(Bbox2(s_near_pts[n-1], s_near_pts[n]));
+}
+
+static void		box_pairs_scan(vector<pair<int,int> >& outPairs)
+{
+	for (int i = 0; i < s_cross_boxes.size(); ++i)
+	for (int j = i + 1; j < s_cross_boxes.size(); ++j)
+	if (s_cross_boxes[i].overlap(s_cross_boxes[j]))
+		outPairs.push_back(pair<int,int>(i, j));
+}
+
+static void		near_points_scan(vector<int>& outNext)
+{
+	outNext.assign(s_near_pts.size(), -1);
+	for (int i = 0; i < s_near_pts.size(); ++i)
+	for (int j = i + 1; j < s_near_pts.size(); ++j)
+	if (s_near_pts[i].squared_distance(s_near_pts[j]) < (NEAR_DIST * NEAR_DIST))
+	{
+		outNext[i] = j;
+		break;
+	}
+}
+
+static void		cross_setup(void)
+{
+	cross_make_layout(4500);
+	vector<pair<int,int> >	slow_pairs, fast_pairs;
+	vector<int>				slow_next, fast_next;
+	box_pairs_scan(slow_pairs);
+	FindOverlappingBoxes(s_cross_boxes, fast_pairs);
+	sort(fast_pairs.begin(), fast_pairs.end());
+	near_points_scan(slow_next);
+	FindNextNearPoints(s_near_pts, NEAR_DIST, fast_next);
+
+	int bad_next = 0, doubles = 0;
+	for (int n = 0; n < slow_next.size(); ++n)
+	{
+		if (n >= fast_next.size() || slow_next[n] != fast_next[n]) ++bad_next;
+		if (slow_next[n] != -1) ++doubles;
+	}
+	if (slow_pairs != fast_pairs || slow_pairs.empty())
+		BenchFail("box sweep found %d overlapping pairs, the all-pairs scan %d.\n", (int) fast_pairs.size(), (int) slow_pairs.size());
+	if (bad_next || doubles == 0)
+		BenchFail("near point grid differs from the all-pairs scan on %d of %d points (%d doubles).\n",
+			bad_next, (int) slow_next.size(), doubles);
+	cross_make_layout(45);
+}
+
+static double	box_pairs_scan_run(void)
+{
+	vector<pair<int,int> >	pairs;
+	box_pairs_scan(pairs);
+	return s_cross_boxes.size();
+}
+
+static double	box_pairs_sweep_run(void)
+{
+	vector<pair<int,int> >	pairs;
+	FindOverlappingBoxes(s_cross_boxes, pairs);
+	return s_cross_boxes.size();
+}
+
+static double	near_points_scan_run(void)
+{
+	vector<int>	next;
+	near_points_scan(next);
+	return s_near_pts.size();
+}
+
+static double	near_points_grid_run(void)
+{
+	vector<int>	next;
+	FindNextNearPoints(s_near_pts, NEAR_DIST, next);
+	return s_near_pts.size();
+}
+
+static void		cross_cleanup(void)
+{
+	s_cross_boxes.clear();
+	s_near_pts.clear();
+}
+
+/************************************************************************************************
+ * GUI TEXT MEASURE
+ ************************************************************************************************/
+
+// Redrawing a big text table: a 100k-row set of names and paths, mostly ASCII with some accented, Cyrillic and CJK
+// rows, scrolled through a 50-row window 5 rows per frame - every visible row is measured and then truncated to
+// its column each frame.  text_measure_chars does what GUI_Fonts did before GUI_FontMetrics - a char_map lookup per
+// char per call; text_measure_cached goes through GUI_FontMetrics.  The font is a stand-in with made-up advances
+// and a hash_map for its chars, so only the measuring is timed, not FreeType.  Setup walks the whole set through
+// both and fails unless every width, fit and truncation comes out the same.
+
+#define TEXT_ROWS			100000
+#define TEXT_WINDOW			50
+#define TEXT_SCROLL			5
+#define TEXT_COLUMN			180.0f
+
+struct	bench_font {
+	hash_map<UTF32, float>	char_map;
+	GUI_FontMetrics			metrics;
+
+	float	require_char(UTF32 c, float s)
+	{
+		if (c == '\t') return 0.0f;
+		hash_map<UTF32, float>::iterator i = char_map.find(c);
+		if (i != char_map.end()) return i->second * s;
+		float adv = 3.0f + (float) ((c * 2654435761u) >> 28) * 0.5f;
+		char_map[c] = adv;
+		metrics.set_advance(c, adv);
+		return adv * s;
+	}
+};
+
+static vector<string>	s_text_rows;
+static bench_font *		s_text_font_chars = NULL;
+static bench_font *		s_text_font_cached = NULL;
+
+static void		text_make_rows(void)
+{
+	static const char * words[] = { "Terminal", "Taxiway", "hangar", "lib/airport/", "Ramp_Start", "objects/", "Apron",
+		"facade", ".obj", ".fac", "Gate", "Fuel", "tower", "Flughafen", "A\xc3\xa9roport", "Z\xc3\xbcrich", "\xd0\x90\xd1\x8d\xd1\x80\xd0\xbe\xd0\xbf\xd0\xbe\xd1\x80\xd1\x82", "\xd0\xa8\xd0\xb5\xd1\x80\xd0\xb5\xd0\xbc\xd0\xb5\xd1\x82\xd1\x8c\xd0\xb5\xd0\xb2\xd0\xbe",
+		"\xe7\xa9\xba\xe6\xb8\xaf", "\xe6\x9d\xb1\xe4\xba\xac\xe5\x9b\xbd\xe9\x9a\x9b", "-", "_", " ", "/", "17L", "09R", "B737", "A320" };
+	const int nwords = sizeof(words) / sizeof(words[0]);
+	unsigned int seed = 46;
+	s_text_rows.resize(TEXT_ROWS);
+	for (int r = 0; r < TEXT_ROWS; ++r)
+	{
+		string& row(s_text_rows[r]);
+		int target = 6 + (int) (BenchRandom(seed) * BenchRandom(seed) * 120.0f);
+		bool intl = BenchRandom(seed) < 0.15f;
+		while (row.size() < target)
+		{
+			int w = (int) (BenchRandom(seed) * nwords);
+			if (!intl && w >= 14 && w < 20) w -= 6;
+			row += words[w];
+			if (BenchRandom(seed) < 0.3f)
+			{
+				char num[16];
+				sprintf(num, "%d", r);
+				row += num;
+			}
+		}
+	}
+}
+
+// What GUI_MeasureRange, GUI_FitForward, GUI_FitReverse and GUI_TruncateText did per char before GUI_FontMetrics.
+static float	text_measure_chars(bench_font * f, const char * inStart, const char * inEnd)
+{
+	float str_width = 0;
+	const UTF8 * p = (const UTF8 *) inStart;
+	const UTF8 * e = (const UTF8 *) inEnd;
+	while(p < e){
+		UTF32 c = UTF8_decode(p);
+		str_width += f->require_char(c,1.0f);
+		p=UTF8_next(p, e);
+	}
+	return str_width;
+}
+
+static int		text_fit_forward_chars(bench_font * f, const char * inStart, const char * inEnd, float width)
+{
+	float so_far = 0.0;
+	const UTF8 * p = (const UTF8 *) inStart;
+	const UTF8 * e = (const UTF8 *) inEnd;
+	while(p < e)
+	{
+		UTF32 c = UTF8_decode(p);
+		so_far += f->require_char(c,1.0f);
+		if(so_far > width)
+			break;
+		p=UTF8_next(p, e);
+	}
+	return (const char *) p - inStart;
+}
+
+static int		text_fit_reverse_chars(bench_font * f, const char * inStart, const char * inEnd, float width)
+{
+	float so_far = 0.0;
+	const UTF8 * s = (const UTF8 *) inStart;
+	const UTF8 * e = (const UTF8 *) inEnd;
+	if(s== e) return 0;
+	--e;
+	e = UTF8_align(e);
+	int ct = 0;
+	while(e >= s)
+	{
+		UTF32 c = UTF8_decode(e);
+		so_far += f->require_char(c,1.0f);
+		if(so_far > width)
+			break;
+		e = UTF8_prev(e);
+		++ct;
+	}
+	return ct;
+}
+
+static void		text_truncate_chars(bench_font * f, string& ioText, float inSpace)
+{
+	if (ioText.empty()) return;
+	int chars = text_fit_forward_chars(f, &*ioText.begin(), &*ioText.end(), inSpace);
+	if (chars == ioText.length()) return;
+	if (chars < 0) { ioText.clear(); return; }
+	ioText.erase(chars);
+	if (ioText.length() > 0)	ioText[ioText.length()-1] = '.';
+	if (ioText.length() > 1)	ioText[ioText.length()-2] = '.';
+	if (ioText.length() > 2)	ioText[ioText.length()-3] = '.';
+}
+
+static void		text_measure_setup(void)
+{
+	text_make_rows();
+	s_text_font_chars = new bench_font;
+	s_text_font_cached = new bench_font;
+
+	int bad = 0, calls = 0;
+	for (int top = 0; top < TEXT_ROWS; top += TEXT_SCROLL)
+	for (int r = top; r < top + TEXT_WINDOW && r < TEXT_ROWS; ++r)
+	{
+		const string& row(s_text_rows[r]);
+		const char * b = row.c_str(), * e = b + row.size();
+		float col = TEXT_COLUMN * (0.25f + 0.75f * (r % 4) / 3.0f);
+		string slow_t(row), fast_t(row);
+		text_truncate_chars(s_text_font_chars, slow_t, col);
+		s_text_font_cached->metrics.truncate(s_text_font_cached, fast_t, col);
+		if (text_measure_chars(s_text_font_chars, b, e) != s_text_font_cached->metrics.measure(s_text_font_cached, b, e))	++bad;
+		if (slow_t != fast_t)																								++bad;
+		if (r >= top + TEXT_WINDOW - TEXT_SCROLL)		// once per row, as it scrolls in
+		{
+			if (text_fit_forward_chars(s_text_font_chars, b, e, col) != s_text_font_cached->metrics.fit_forward(s_text_font_cached, b, e, col))	++bad;
+			if (text_fit_reverse_chars(s_text_font_chars, b, e, col) != s_text_font_cached->metrics.fit_reverse(s_text_font_cached, b, e, col))	++bad;
+		}
+		calls += 2;
+	}
+	if (bad)
+		BenchFail("GUI_FontMetrics differs from per-char measuring on %d of %d calls.\n", bad, calls);
+
+	// Start the timed runs from fresh fonts.
+	delete s_text_font_chars;
+	delete s_text_font_cached;
+	s_text_font_chars = new bench_font;
+	s_text_font_cached = new bench_font;
+}
+
+static double	text_measure_chars_run(void)
+{
+	double rows = 0;
+	for (int top = 0; top < TEXT_ROWS; top += TEXT_SCROLL)
+	for (int r = top; r < top + TEXT_WINDOW && r < TEXT_ROWS; ++r, ++rows)
+	{
+		const string& row(s_text_rows[r]);
+		text_measure_chars(s_text_font_chars, row.c_str(), row.c_str() + row.size());
+		string t(row);
+		text_truncate_chars(s_text_font_chars, t, TEXT_COLUMN * (0.25f + 0.75f * (r % 4) / 3.0f));
+	}
+	return rows;
+}
+
+static double	text_measure_cached_run(void)
+{
+	double rows = 0;
+	for (int top = 0; top < TEXT_ROWS; top += TEXT_SCROLL)
+	for (int r = top; r < top + TEXT_WINDOW && r < TEXT_ROWS; ++r, ++rows)
+	{
+		const string& row(s_text_rows[r]);
+		s_text_font_cached->metrics.measure(s_text_font_cached, row.c_str(), row.c_str() + row.size());
+		string t(row);
+		s_text_font_cached->metrics.truncate(s_text_font_cached, t, TEXT_COLUMN * (0.25f + 0.75f * (r % 4) / 3.0f));
+	}
+	return rows;
+}
+
+static void		text_measure_cleanup(void)
+{
+	delete s_text_font_chars;
+	delete s_text_font_cached;
+	s_text_font_chars = NULL;
+	s_text_font_cached = NULL;
+	s_text_rows.clear();
+}
+
+/************************************************************************************************
+ * VPF DECODE
+ ************************************************************************************************/
+
+// A synthetic VPF edge table shaped like the EDG tables VPFImport reads: int keys, triplet keys of every width,
+// a variable-length name, a counted coordinate array, and fixed fields after the variable ones.  vpf_decode_offsets
+// is the old iterator's per-row walk - size every column of every row into an offset vector, then fetch;
+// vpf_decode_serial is VPFTableIterator over the compiled row layout; vpf_decode_parallel indexes the rows and
+// decodes them with ParallelForVPFRows.  Setup decodes a table all three ways and fails unless every row matches.
+
+#define VPF_EDGES	60000
+
+struct	bench_vpf_edge {
+	int					id, start_node, end_node;
+	VPF_TripletKey		keys[4];
+	string				name, code;
+	vector<Point2>		shape;
+	double				length;
+
+	bool operator==(const bench_vpf_edge& rhs) const
+	{
+		for (int k = 0; k < 4; ++k)
+		if (keys[k].row_id != rhs.keys[k].row_id || keys[k].tile_id != rhs.keys[k].tile_id || keys[k].next_row_id != rhs.keys[k].next_row_id)
+			return false;
+		return id == rhs.id && start_node == rhs.start_node && end_node == rhs.end_node &&
+			name == rhs.name && code == rhs.code && shape == rhs.shape && length == rhs.length;
+	}
+};
+
+static string			s_vpf_path;
+
+// The table is little endian and built a byte at a time, so it reads the same on any host.
+static void		vpf_put(string& out, unsigned int v, int bytes)
+{
+	for (int b = 0; b < bytes; ++b)
+		out += (char) ((v >> (8 * b)) & 0xFF);
+}
+
+static void		vpf_put_float(string& out, float f)
+{
+	unsigned int v;
+	memcpy(&v, &f, 4);
+	vpf_put(out, v, 4);
+}
+
+static unsigned int	vpf_get(const char * p, int bytes)
+{
+	unsigned int v = 0;
+	for (int b = 0; b < bytes; ++b)
+		v |= (unsigned int) (unsigned char) p[b] << (8 * b);
+	return v;
+}
+
+static float	vpf_get_float(const char * p)
+{
+	unsigned int v = vpf_get(p, 4);
+	float f;
+	memcpy(&f, &v, 4);
+	if (-1.0e-9 < f && f < 1.0e-9)
+		f = 0.0;
+	return f;
+}
+
+static void		vpf_write_table(const string& path, unsigned int seed)
+{
+	static const int widths[4] = { 0, 1, 2, 4 };
+	string	header = "L;EDG;Bench edge primitive table;"
+					 "id=I,1,P,Row ID:start_node=I,1,F,Start node:end_node=I,1,F,End node:"
+					 "right_face=K,1,F,Right face:left_face=K,1,F,Left face:right_edge=K,1,F,Right edge:left_edge=K,1,F,Left edge:"
+					 "name=T,*,N,Name:coordinates=C,*,N,Coordinates:length=F,1,N,Length:code=T,4,N,Code:;";
+	string	rows;
+	for (int r = 0; r < VPF_EDGES; ++r)
+	{
+		vpf_put(rows, r + 1, 4);
+		vpf_put(rows, (int) (BenchRandom(seed) * VPF_EDGES) + 1, 4);
+		vpf_put(rows, (int) (BenchRandom(seed) * VPF_EDGES) + 1, 4);
+		for (int k = 0; k < 4; ++k)
+		{
+			int w[3] = { widths[(int) (BenchRandom(seed) * 4)], widths[(int) (BenchRandom(seed) * 4)], widths[(int) (BenchRandom(seed) * 4)] };
+			unsigned char ctrl = 0;
+			for (int f = 0; f < 3; ++f)
+				ctrl |= (w[f] == 4 ? 3 : w[f]) << (6 - 2 * f);
+			rows += (char) ctrl;
+			for (int f = 0; f < 3; ++f)
+				vpf_put(rows, (unsigned int) (BenchRandom(seed) * 4294967295.0), w[f]);
+		}
+
+		int name_len = (int) (BenchRandom(seed) * 12);
+		vpf_put(rows, name_len, 4);
+		for (int c = 0; c < name_len; ++c)
+			rows += (char) ('A' + (int) (BenchRandom(seed) * 26));
+
+		int pts = 2 + (int) (BenchRandom(seed) * 30);
+		vpf_put(rows, pts, 4);
+		for (int p = 0; p < pts; ++p)
+		{
+			vpf_put_float(rows, BenchRandom(seed) < 0.05f ? 0.0f : -180.0f + 360.0f * BenchRandom(seed));
+			vpf_put_float(rows, -90.0f + 180.0f * BenchRandom(seed));
+		}
+
+		vpf_put_float(rows, 1.0f + 1000.0f * BenchRandom(seed));
+		for (int c = 0; c < 4; ++c)
+			rows += (char) ('0' + (int) (BenchRandom(seed) * 10));
+	}
+
+	string	file;
+	vpf_put(file, header.size(), 4);
+	file += header;
+	file += rows;
+	FILE * fi = fopen(path.c_str(), "wb");
+	if (fi == NULL) return;
+	fwrite(file.c_str(), 1, file.size(), fi);
+	fclose(fi);
+}
+
+// What VPFTableIterator::ParseCurrent used to do for every row: walk every column and record where it starts.
+static int		vpf_offset_walk(const VPF_TableDef& def, const char * rec, vector<int>& offsets)
+{
+	offsets.clear();
+	int off = 0;
+	for (int i = 0; i < def.columns.size(); ++i)
+	{
+		int itemSize = 0;
+		switch(def.columns[i].dataType) {
+		case 'X':
+		case 'T':
+		case 'L':
+		case 'M':
+		case 'N':	itemSize = 1;	break;
+		case 'S':	itemSize = 2;	break;
+		case 'F':
+		case 'I':	itemSize = 4;	break;
+		case 'R':
+		case 'C':	itemSize = 8;	break;
+		case 'Z':	itemSize = 12;	break;
+		case 'B':
+		case 'D':	itemSize = 20;	break;
+		case 'Y':	itemSize = 24;	break;
+		case 'K':
+			{
+				unsigned char ctrl = rec[off];
+				itemSize = 1;
+				for (int f = 0; f < 4; ++f)
+				{
+					int w = (ctrl >> (6 - 2 * f)) & 3;
+					itemSize += (w == 3 ? 4 : w);
+				}
+			}
+			break;
+		}
+		offsets.push_back(off);
+		if (def.columns[i].elementCount == 0)
+			off += 4 + itemSize * (int) vpf_get(rec + off, 4);
+		else
+			off += itemSize * def.columns[i].elementCount;
+	}
+	return off;
+}
+
+static void		vpf_decode_key(const char * p, VPF_TripletKey& k)
+{
+	unsigned char ctrl = *p++;
+	unsigned int * dst[3] = { &k.row_id, &k.tile_id, &k.next_row_id };
+	for (int f = 0; f < 3; ++f)
+	{
+		int w = (ctrl >> (6 - 2 * f)) & 3;
+		if (w == 3) w = 4;
+		*dst[f] = vpf_get(p, w);
+		p += w;
+	}
+}
+
+static bool		vpf_decode_offsets(MFMemFile * mf, const VPF_TableDef& def, vector<bench_vpf_edge>& out)
+{
+	const char *	rec = MemFile_GetBegin(mf);
+	const char *	end = MemFile_GetEnd(mf);
+	vector<int>		offsets;
+	rec += 4 + vpf_get(rec, 4);
+	out.clear();
+	while (rec < end)
+	{
+		int len = vpf_offset_walk(def, rec, offsets);
+		out.push_back(bench_vpf_edge());
+		bench_vpf_edge& e(out.back());
+		e.id = vpf_get(rec + offsets[0], 4);
+		e.start_node = vpf_get(rec + offsets[1], 4);
+		e.end_node = vpf_get(rec + offsets[2], 4);
+		for (int k = 0; k < 4; ++k)
+			vpf_decode_key(rec + offsets[3 + k], e.keys[k]);
+		e.name = string(rec + offsets[7] + 4, rec + offsets[7] + 4 + vpf_get(rec + offsets[7], 4));
+		int pts = vpf_get(rec + offsets[8], 4);
+		for (int p = 0; p < pts; ++p)
+			e.shape.push_back(Point2(vpf_get_float(rec + offsets[8] + 4 + 8 * p), vpf_get_float(rec + offsets[8] + 8 + 8 * p)));
+		e.length = vpf_get_float(rec + offsets[9]);
+		e.code = string(rec + offsets[10], rec + offsets[10] + 4);
+		rec += len;
+	}
+	return rec == end;
+}
+
+static bool		vpf_decode_row(VPFTableIterator& iter, bench_vpf_edge& e)
+{
+	return	iter.GetNthFieldAsInt(0, e.id) &&
+			iter.GetNthFieldAsInt(1, e.start_node) &&
+			iter.GetNthFieldAsInt(2, e.end_node) &&
+			iter.GetNthFieldAsTripletKey(3, e.keys[0]) &&
+			iter.GetNthFieldAsTripletKey(4, e.keys[1]) &&
+			iter.GetNthFieldAsTripletKey(5, e.keys[2]) &&
+			iter.GetNthFieldAsTripletKey(6, e.keys[3]) &&
+			iter.GetNthFieldAsString(7, e.name) &&
+			iter.GetNthFieldAsCoordPairArray(8, e.shape) &&
+			iter.GetNthFieldAsDouble(9, e.length) &&
+			iter.GetNthFieldAsString(10, e.code);
+}
+
+static bool		vpf_decode_serial(MFMemFile * mf, const VPF_TableDef& def, vector<bench_vpf_edge>& out)
+{
+	out.clear();
+	for (VPFTableIterator iter(mf, def); !iter.Done(); iter.Next())
+	{
+		out.push_back(bench_vpf_edge());
+		if (!vpf_decode_row(iter, out.back()))
+			return false;
+	}
+	return true;
+}
+
+struct	bench_vpf_row_job {
+	vector<bench_vpf_edge> *	out;
+	vector<char> *				ok;
+
+	void operator()(VPFTableIterator& iter, int row)
+	{
+		(*ok)[row] = vpf_decode_row(iter, (*out)[row]);
+	}
+};
+
+static bool		vpf_decode_parallel(MFMemFile * mf, const VPF_TableDef& def, vector<bench_vpf_edge>& out)
+{
+	vector<const char *>	rows;
+	if (!IndexVPFTableRows(mf, def, rows))
+		return false;
+	vector<char>			ok(rows.size() - 1, 0);
+	out.clear();
+	out.resize(rows.size() - 1);
+	bench_vpf_row_job	job = { &out, &ok };
+	ParallelForVPFRows(mf, def, rows, job);
+	return find(ok.begin(), ok.end(), 0) == ok.end();
+}
+
+static void		vpf_decode_setup(void)
+{
+	s_vpf_path = gBenchTempDir + "bench_edg";
+	vpf_write_table(s_vpf_path, 4900);
+
+	MFMemFile * mf = MemFile_Open(s_vpf_path.c_str());
+	VPF_TableDef	def;
+	if (mf == NULL || !ReadVPFTableHeader(mf, def) || def.columns.size() != 11)
+	{
+		BenchFail("could not read the header of %s\n", s_vpf_path.c_str());
+		if (mf) MemFile_Close(mf);
+		return;
+	}
+	vector<bench_vpf_edge>	old_rows, serial_rows, parallel_rows;
+	bool old_ok = vpf_decode_offsets(mf, def, old_rows);
+	bool serial_ok = vpf_decode_serial(mf, def, serial_rows);
+	bool parallel_ok = vpf_decode_parallel(mf, def, parallel_rows);
+	MemFile_Close(mf);
+
+	int bad_serial = 0, bad_parallel = 0;
+	for (int n = 0; n < old_rows.size(); ++n)
+	{
+		if (n >= serial_rows.size() || !(serial_rows[n] == old_rows[n]))		++bad_serial;
+		if (n >= parallel_rows.size() || !(parallel_rows[n] == old_rows[n]))	++bad_parallel;
+	}
+	if (!old_ok || !serial_ok || !parallel_ok || old_rows.size() != VPF_EDGES || serial_rows.size() != VPF_EDGES ||
+		parallel_rows.size() != VPF_EDGES || bad_serial || bad_parallel)
+		BenchFail("VPF layout decode differs from the offset walk on %d serial and %d parallel rows of %d (%d/%d/%d decoded).\n",
+			bad_serial, bad_parallel, VPF_EDGES, (int) old_rows.size(), (int) serial_rows.size(), (int) parallel_rows.size());
+}
+
+static double	vpf_decode_run(bool (* decode)(MFMemFile *, const VPF_TableDef&, vector<bench_vpf_edge>&))
+{
+	MFMemFile * mf = MemFile_Open(s_vpf_path.c_str());
+	if (mf == NULL) return 0.0;
+	VPF_TableDef			def;
+	vector<bench_vpf_edge>	rows;
+	if (ReadVPFTableHeader(mf, def))
+		decode(mf, def, rows);
+	MemFile_Close(mf);
+	return rows.size();
+}
+
+static double	vpf_decode_offsets_run(void)	{ return vpf_decode_run(vpf_decode_offsets);	}
+static double	vpf_decode_serial_run(void)		{ return vpf_decode_run(vpf_decode_serial);		}
+static double	vpf_decode_parallel_run(void)	{ return vpf_decode_run(vpf_decode_parallel);	}
+
+static void		vpf_decode_cleanup(void)
+{
+	FILE_delete_file(s_vpf_path.c_str(), false);
+}
+
+/************************************************************************************************
+ * ROAD JUNCTIONS
+ ************************************************************************************************/
+
+// The junction pass of repair_network over a synthetic road network: a jittered 100x100 street grid with a highway
+// on every 8th row and column, some streets next to the highways turned into ramps, a fifth of the highway and ramp
+// edges pointing the wrong way (so strands crash) and a quarter of the blocks water.  Crossings of highways and streets
+// start out level, so every junction on a highway needs optimizing.  net_junctions_serial is the pass as it was
+// before the waves - one junction at a time, scoring every level combination; net_junctions_waves is what
+// repair_network runs now.  Setup runs the serial reference, the serial pass with the repeat skip, and the waves,
+// and fails unless each leaves every halfedge's source and target heights and the crash start list exactly as the
+// reference did.
+
+#define NET_BLOCKS			100
+#define NET_HIGHWAY_EVERY	8
+
+static Pmwx									s_net_map;
+static vector<GISNetworkSegmentVector>		s_net_start;		// every halfedge's segments before optimizing
+static map<Pmwx::Vertex_handle,int>			s_net_vert_idx;
+static int									s_net_reps[3];		// highway, ramp, street
+
+static int		net_grid_coord(double v, double lo)
+{
+	return (int) floor((v - lo) * NET_BLOCKS + 0.5);
+}
+
+static void		net_make_map(void)
+{
+	static const char *	names[3] = { "bench_highway", "bench_ramp", "bench_street" };
+	static const int	uses[3] = { use_Limited, use_Ramp, use_Street };
+	for (int r = 0; r < 3; ++r)
+	{
+		s_net_reps[r] = LookupTokenCreate(names[r]);
+		NetRepInfo	info;
+		memset(&info, 0, sizeof(info));
+		info.semi_l = info.semi_r = 5.0f;
+		info.use_mode = uses[r];
+		info.is_oneway = r < 2;
+		gNetReps[s_net_reps[r]] = info;
+	}
+
+	BenchMakeBlocks(s_net_map, NET_BLOCKS, 50);
+	unsigned int seed = 51;
+
+	// Which edges are highway is decided from the grid row and column of their ends.
+	for (Pmwx::Edge_iterator e = s_net_map.edges_begin(); e != s_net_map.edges_end(); ++e)
+	{
+		Point2	p1(cgal2ben(e->source()->point())), p2(cgal2ben(e->target()->point()));
+		int x1 = net_grid_coord(p1.x(), -118.0), y1 = net_grid_coord(p1.y(), 34.0);
+		int x2 = net_grid_coord(p2.x(), -118.0), y2 = net_grid_coord(p2.y(), 34.0);
+		bool hwy = (y1 == y2 && y1 % NET_HIGHWAY_EVERY == 4) || (x1 == x2 && x1 % NET_HIGHWAY_EVERY == 4);
+		bool near_hwy = y1 % NET_HIGHWAY_EVERY == 4 || y2 % NET_HIGHWAY_EVERY == 4 || x1 % NET_HIGHWAY_EVERY == 4 || x2 % NET_HIGHWAY_EVERY == 4;
+
+		int rep = s_net_reps[2];
+		if (hwy)											rep = s_net_reps[0];
+		else if (near_hwy && BenchRandom(seed) < 0.3f)		rep = s_net_reps[1];
+		set_he_rep_type(e, rep);
+
+		if (rep != s_net_reps[2] && BenchRandom(seed) < 0.2f)
+			swap_he_road_dir(e);
+		if (rep == s_net_reps[2] && BenchRandom(seed) < 0.1f)
+			set_he_level_at(e, e->source(), 1.0);			// a street that already starts up on a bridge
+	}
+
+	for (Pmwx::Face_iterator f = s_net_map.faces_begin(); f != s_net_map.faces_end(); ++f)
+	if (!f->is_unbounded() && BenchRandom(seed) < 0.25f)
+		f->data().mTerrainType = terrain_Water;
+
+	s_net_start.clear();
+	for (Pmwx::Halfedge_iterator h = s_net_map.halfedges_begin(); h != s_net_map.halfedges_end(); ++h)
+		s_net_start.push_back(h->data().mSegments);
+
+	s_net_vert_idx.clear();
+	for (Pmwx::Vertex_iterator v = s_net_map.vertices_begin(); v != s_net_map.vertices_end(); ++v)
+		s_net_vert_idx.insert(map<Pmwx::Vertex_handle,int>::value_type(v, s_net_vert_idx.size()));
+}
+
+static void		net_restore_map(void)
+{
+	int n = 0;
+	for (Pmwx::Halfedge_iterator h = s_net_map.halfedges_begin(); h != s_net_map.halfedges_end(); ++h, ++n)
+		h->data().mSegments = s_net_start[n];
+}
+
+// Runs one junction pass from the starting levels and records every height it leaves and the crash starts.
+static void		net_run_pass(bool in_serial, bool skip_repeats, vector<double>& out_heights, vector<int>& out_crsh)
+{
+	net_restore_map();
+	list<Pmwx::Vertex_handle>	crsh_starts;
+	optimize_junctions(s_net_map, crsh_starts, in_serial, skip_repeats);
+
+	out_heights.clear();
+	for (Pmwx::Halfedge_iterator h = s_net_map.halfedges_begin(); h != s_net_map.halfedges_end(); ++h)
+	for (GISNetworkSegmentVector::iterator seg = h->data().mSegments.begin(); seg != h->data().mSegments.end(); ++seg)
+	{
+		out_heights.push_back(seg->mSourceHeight);
+		out_heights.push_back(seg->mTargetHeight);
+	}
+	out_crsh.clear();
+	for (list<Pmwx::Vertex_handle>::iterator v = crsh_starts.begin(); v != crsh_starts.end(); ++v)
+		out_crsh.push_back(s_net_vert_idx[*v]);
+}
+
+static int		net_count_diffs(const vector<double>& h1, const vector<int>& c1, const vector<double>& h2, const vector<int>& c2)
+{
+	int bad = 0;
+	if (h1.size() != h2.size() || c1.size() != c2.size())
+		return max(h1.size(), h2.size()) + max(c1.size(), c2.size());
+	for (int n = 0; n < h1.size(); ++n)
+		if (h1[n] != h2[n]) ++bad;
+	for (int n = 0; n < c1.size(); ++n)
+		if (c1[n] != c2[n]) ++bad;
+	return bad;
+}
+
+static void		net_junctions_setup(void)
+{
+	net_make_map();
+
+	vector<double>	ref_h, h;
+	vector<int>		ref_c, c;
+	net_run_pass(true, false, ref_h, ref_c);
+
+	int changed = 0;
+	for (int n = 0, k = 0; n < s_net_start.size(); ++n)
+	for (GISNetworkSegmentVector::iterator seg = s_net_start[n].begin(); seg != s_net_start[n].end(); ++seg, k += 2)
+		if (seg->mSourceHeight != ref_h[k] || seg->mTargetHeight != ref_h[k+1]) ++changed;
+
+	net_run_pass(true, true, h, c);
+	int bad_skip = net_count_diffs(ref_h, ref_c, h, c);
+	net_run_pass(false, true, h, c);
+	int bad_waves = net_count_diffs(ref_h, ref_c, h, c);
+
+	if (bad_skip || bad_waves || changed == 0 || ref_c.empty())
+		BenchFail("junction levels differ from the serial pass: %d with the repeat skip, %d in waves "
+				  "(%d of %d roads re-leveled, %d crash starts).\n",
+			bad_skip, bad_waves, changed, (int) s_net_start.size(), (int) ref_c.size());
+}
+
+static double	net_junctions_serial_run(void)
+{
+	net_restore_map();
+	list<Pmwx::Vertex_handle>	crsh_starts;
+	optimize_junctions(s_net_map, crsh_starts, true, false);
+	return s_net_map.number_of_vertices();
+}
+
+static double	net_junctions_waves_run(void)
+{
+	net_restore_map();
+	list<Pmwx::Vertex_handle>	crsh_starts;
+	optimize_junctions(s_net_map, crsh_starts);
+	return s_net_map.number_of_vertices();
+}
+
+static void		net_junctions_cleanup(void)
+{
+	s_net_map.clear();
+	s_net_start.clear();
+	s_net_vert_idx.clear();
+	for (int r = 0; r < 3; ++r)
+		gNetReps.erase(s_net_reps[r]);
+}
+
+/************************************************************************************************
+ * TABLE
+ ************************************************************************************************/
+
+Bench_t	gBenchmarks[] = {
+	{ "dsf_write",				"bytes",	dsf_write_setup,		dsf_write_run,		dsf_cleanup				},
+	{ "dsf_read",				"bytes",	dsf_read_setup,			dsf_read_run,		dsf_cleanup				},
+	{ "dsf_read_fake",			"bytes",	dsf_read_fake_setup,	dsf_read_run,		dsf_cleanup				},
+	{ "greedy_mesh",			"vertices",	greedy_mesh_setup,		greedy_mesh_run,	dem_cleanup				},
+	{ "gaussian_blur",			"samples",	gaussian_blur_setup,	gaussian_blur_run,	dem_cleanup				},
+	{ "poly_raster",			"pixels",	poly_raster_setup,		poly_raster_run,	poly_raster_cleanup		},
+	{ "find_natural_terrain",	"queries",	find_terrain_setup,		find_terrain_run,	find_terrain_cleanup	},
+	{ "xobj8_read",				"bytes",	xobj8_read_setup,		xobj8_read_run,		xobj8_read_cleanup		},
+	{ "dds_write",				"pixels",	dds_write_setup,		dds_write_run,		dds_write_cleanup		},
+	{ "wed_xml_write",			"bytes",	wed_xml_write_setup,	wed_xml_write_run,	wed_xml_write_cleanup	},
+	{ "wed_xml_load",			"bytes",	wed_xml_load_setup,		wed_xml_load_run,	wed_xml_load_cleanup	},
+	{ "wed_undo",				"commands",	wed_undo_setup,			wed_undo_run,		NULL					},
+	{ "library_scan",			"exports",	lib_scan_setup,			lib_scan_run,		lib_cleanup				},
+	{ "library_scan_cached",	"exports",	lib_scan_cached_setup,	lib_scan_cached_run,lib_cleanup				},
+	{ "tex_load_serial",		"pixels",	tex_load_setup,			tex_load_serial_run,tex_load_cleanup		},
+	{ "tex_load_queued",		"pixels",	tex_load_setup,			tex_load_queued_run,tex_load_cleanup		},
+	{ "apt_read",				"bytes",	apt_read_setup,			apt_read_run,		apt_read_cleanup		},
+	{ "gateway_pack_dom",		"bytes",	gateway_pack_setup,		gateway_pack_dom_run,	gateway_pack_cleanup	},
+	{ "gateway_pack_scan",		"bytes",	gateway_pack_setup,		gateway_pack_scan_run,	gateway_pack_cleanup	},
+	{ "obj_query_scan",			"queries",	obj_query_setup,		obj_query_scan_run,		obj_query_cleanup		},
+	{ "obj_query_index",		"queries",	obj_query_setup,		obj_query_index_run,	obj_query_cleanup		},
+	{ "snap_drag_rebuild",		"steps",	snap_setup,				snap_drag_rebuild_run,	snap_cleanup		},
+	{ "snap_drag_grid",			"steps",	snap_setup,				snap_drag_grid_run,		snap_cleanup		},
+	{ "box_pairs_scan",			"boxes",	cross_setup,			box_pairs_scan_run,		cross_cleanup		},
+	{ "box_pairs_sweep",		"boxes",	cross_setup,			box_pairs_sweep_run,	cross_cleanup		},
+	{ "near_points_scan",		"points",	cross_setup,			near_points_scan_run,	cross_cleanup		},
+	{ "near_points_grid",		"points",	cross_setup,			near_points_grid_run,	cross_cleanup		},
+	{ "text_measure_chars",		"rows",		text_measure_setup,		text_measure_chars_run,	text_measure_cleanup	},
+	{ "text_measure_cached",	"rows",		text_measure_setup,		text_measure_cached_run,text_measure_cleanup	},
+	{ "vpf_decode_offsets",		"rows",		vpf_decode_setup,		vpf_decode_offsets_run,	vpf_decode_cleanup		},
+	{ "vpf_decode_serial",		"rows",		vpf_decode_setup,		vpf_decode_serial_run,	vpf_decode_cleanup		},
+	{ "vpf_decode_parallel",	"rows",		vpf_decode_setup,		vpf_decode_parallel_run,vpf_decode_cleanup		},
+	{ "net_junctions_serial",	"junctions",net_junctions_setup,	net_junctions_serial_run,	net_junctions_cleanup	},
+	{ "net_junctions_waves",	"junctions",net_junctions_setup,	net_junctions_waves_run,	net_junctions_cleanup	},
+	{ NULL,						NULL,		NULL,					NULL,				NULL					}
+};
@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "Bench.h"
+#include "PerfUtils.h"
+#include "FileUtils.h"
+#include "PlatformUtils.h"
+#include <json/json.h>
+#include <new>
+#include <stdarg.h>
+
+/*
+	Usage: bench [-list] [-filter <substring>] [-iters <n>] [-tmp <dir>] [-json <out.json>]
+	             [-baseline <base.json>] [-tolerance <percent>]
+
+	Each selected benchmark runs once to warm up and then -iters times; we report the best and mean pass time,
+	throughput (items/sec, from the best pass) and heap allocations per pass.  With -baseline we compare
+	throughput against a JSON file previously written with -json and exit with 1 if any benchmark is more than
+	-tolerance percent slower.  We also exit with 1 if any benchmark's own correctness check failed (BenchFail).
+
+*/
+
+/************************************************************************************************
+ * ALLOCATION COUNTING
+ ************************************************************************************************/
+
+// We only see C++ allocations here - DSFLib and libsquish malloc some of their buffers directly.  The parallel
+// kernels allocate from worker threads too, so the counters are bumped atomically.
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+	#define	bench_atomic_add(p, v)	_InterlockedExchangeAdd64((p), (v))
+#else
+	#define	bench_atomic_add(p, v)	__sync_fetch_and_add((p), (v))
+#endif
+
+static volatile long long	s_alloc_count = 0;
+static volatile long long	s_alloc_bytes = 0;
+
+void* operator new(std::size_t sz) throw (std::bad_alloc)
+{
+	if (sz == 0) sz = 1;
+	bench_atomic_add(&s_alloc_count, 1LL);
+	bench_atomic_add(&s_alloc_bytes, (long long) sz);
+	void * p = malloc(sz);
+	while (p == 0)
+	{
+		new_handler handler = set_new_handler(NULL);
+							  set_new_handler(handler);
+		if (! handler)
+			throw bad_alloc();
+		handler();
+		p = malloc(sz);
+	}
+	return p;
+}
+
+void* operator new[](std::size_t s) throw (std::bad_alloc)
+{
+	return operator new(s);
+}
+
+void operator delete(void * p) throw()
+{
+	free(p);
+}
+
+void operator delete[](void * p) throw()
+{
+	free(p);
+}
+
+/************************************************************************************************
+ * CHECKS
+ ************************************************************************************************/
+
+static int	s_failures = 0;
+
+void	BenchFail(const char * fmt, ...)
+{
+	++s_failures;
+	va_list	va;
+	va_start(va, fmt);
+	fprintf(stderr, "FAILED: ");
+	vfprintf(stderr, fmt, va);
+	va_end(va);
+}
+
+/************************************************************************************************
+ * DRIVER
+ ************************************************************************************************/
+
+struct	BenchResult_t {
+	int		iters;
+	double	best_us;
+	double	mean_us;
+	double	items;
+	double	allocs;		// per pass
+	double	alloc_bytes;	// per pass
+};
+
+static void	run_one(Bench_t& b, int iters, BenchResult_t& r)
+{
+	if (b.setup) b.setup();
+	r.items = b.run();				// Warm-up - also tells us how many items a pass processes.
+
+	r.iters = iters;
+	r.best_us = 0.0;
+	r.mean_us = 0.0;
+	long long	allocs = 0, bytes = 0;
+	for (int n = 0; n < iters; ++n)
+	{
+		long long			a0 = s_alloc_count, b0 = s_alloc_bytes;
+		unsigned long long	t0 = query_hpc();
+		b.run();
+		unsigned long long	t1 = query_hpc();
+		allocs += s_alloc_count - a0;
+		bytes += s_alloc_bytes - b0;
+
+		double us = hpc_to_microseconds(t1 - t0);
+		if (n == 0 || us < r.best_us) r.best_us = us;
+		r.mean_us += us;
+	}
+	r.mean_us /= (double) iters;
+	r.allocs = (double) allocs / (double) iters;
+	r.alloc_bytes = (double) bytes / (double) iters;
+
+	if (b.cleanup) b.cleanup();
+}
+
+static double	throughput(const BenchResult_t& r)
+{
+	return r.best_us > 0.0 ? r.items * 1000000.0 / r.best_us : 0.0;
+}
+
+int main(int argc, char * argv[])
+{
+	string	filter, json_path, baseline_path;
+	int		iters = 5;
+	double	tolerance = 10.0;
+	bool	list_only = false;
+
+	gBenchTempDir = "/tmp/";
+	#if IBM
+	gBenchTempDir = ".\\";
+	#endif
+
+	for (int n = 1; n < argc; ++n)
+	{
+		string	arg(argv[n]);
+		bool	has_value = (n + 1) < argc;
+		if (arg == "-list")								list_only = true;
+		else if (arg == "-filter" && has_value)			filter = argv[++n];
+		else if (arg == "-iters" && has_value)			iters = max(1, atoi(argv[++n]));
+		else if (arg == "-json" && has_value)			json_path = argv[++n];
+		else if (arg == "-baseline" && has_value)		baseline_path = argv[++n];
+		else if (arg == "-tolerance" && has_value)		tolerance = atof(argv[++n]);
+		else if (arg == "-tmp" && has_value)
+		{
+			gBenchTempDir = argv[++n];
+			if (gBenchTempDir.empty() || gBenchTempDir[gBenchTempDir.size()-1] != DIR_CHAR)
+				gBenchTempDir += DIR_STR;
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [-list] [-filter <substring>] [-iters <n>] [-tmp <dir>] [-json <out.json>] [-baseline <base.json>] [-tolerance <percent>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	Json::Value		baseline;
+	if (!baseline_path.empty())
+	{
+		string	text;
+		FILE *	fi = fopen(baseline_path.c_str(), "rb");
+		if (fi)
+		{
+			char	buf[4096];
+			size_t	got;
+			while ((got = fread(buf, 1, sizeof(buf), fi)) > 0)
+				text.append(buf, got);
+			fclose(fi);
+		}
+		Json::Reader	reader;
+		if (text.empty() || !reader.parse(text, baseline))
+		{
+			fprintf(stderr, "Could not read baseline %s\n", baseline_path.c_str());
+			return 1;
+		}
+	}
+
+	Json::Value		report(Json::objectValue);
+	report["iters"] = iters;
+	Json::Value&	results = report["benchmarks"];
+	int				regressions = 0;
+
+	printf("%-24s %12s %12s %16s %12s %14s", "benchmark", "best ms", "mean ms", "items/sec", "allocs", "alloc bytes");
+	if (!baseline_path.empty()) printf(" %10s", "vs base");
+	printf("\n");
+
+	for (Bench_t * b = gBenchmarks; b->name; ++b)
+	{
+		if (!filter.empty() && strstr(b->name, filter.c_str()) == NULL)
+			continue;
+		if (list_only)
+		{
+			printf("%s (%s)\n", b->name, b->unit);
+			continue;
+		}
+
+		BenchResult_t	r;
+		int				failures = s_failures;
+		run_one(*b, iters, r);
+
+		Json::Value&	j = results[b->name];
+		j["unit"] = b->unit;
+		j["items"] = r.items;
+		j["best_us"] = r.best_us;
+		j["mean_us"] = r.mean_us;
+		j["throughput"] = throughput(r);
+		j["allocs"] = r.allocs;
+		j["alloc_bytes"] = r.alloc_bytes;
+
+		printf("%-24s %12.3f %12.3f %16.0f %12.0f %14.0f", b->name, r.best_us / 1000.0, r.mean_us / 1000.0, throughput(r), r.allocs, r.alloc_bytes);
+
+		if (!baseline_path.empty())
+		{
+			const Json::Value&	base = baseline["benchmarks"][b->name];
+			if (base.isObject() && base["throughput"].asDouble() > 0.0)
+			{
+				double	ratio = throughput(r) / base["throughput"].asDouble();
+				printf(" %9.1f%%", (ratio - 1.0) * 100.0);
+				if (ratio < 1.0 - tolerance / 100.0)
+				{
+					printf("  REGRESSION");
+					++regressions;
+				}
+			}
+			else
+				printf(" %10s", "new");
+		}
+		if (s_failures != failures)
+			printf("  FAILED");
+		printf("\n");
+		fflush(stdout);
+	}
+
+	if (!json_path.empty() && !list_only)
+	{
+		FILE * fo = fopen(json_path.c_str(), "w");
+		if (fo == NULL)
+		{
+			fprintf(stderr, "Could not write %s\n", json_path.c_str());
+			return 1;
+		}
+		Json::StyledWriter	writer;
+		string				text = writer.write(report);
+		fwrite(text.c_str(), 1, text.size(), fo);
+		fclose(fo);
+	}
+
+	if (s_failures)
+		printf("%d correctness check(s) failed.\n", s_failures);
+	if (regressions)
+		printf("%d benchmark(s) regressed by more than %.1f%%.\n", regressions, tolerance);
+	return (s_failures || regressions) ? 1 : 0;
+}
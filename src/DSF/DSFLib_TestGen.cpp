@@ -22,6 +22,7 @@
  */
 #include "DSFLib.h"
 #include "DSFDefs.h"
+#include "DSFPointPool.h"
 #include <stdlib.h> /* for rand() */
 
 // +34-118
@@ -510,7 +511,8 @@ void	BuildOnePatch(DSFCallbacks_t * cbs, void * f, int x, int y)
 	cbs->EndPrimitive_f(f);
 	cbs->EndPatch_f(f);
 
-	int d = depths[layer-1];
+	// The composite + border layers want 10 planes, but the writer's tuples top out at MAX_TUPLE_LEN (9).
+	int d = min(depths[layer-1], MAX_TUPLE_LEN - 5);
 	int n = (d % 2) ? (d-1) : d;
 	cbs->BeginPatch_f(layer, 0.0, -1.0, dsf_Flag_Overlay, d+5, f);
 	cbs->BeginPrimitive_f(dsf_TriFan, f);
@@ -524,7 +526,7 @@ void	BuildOnePatch(DSFCallbacks_t * cbs, void * f, int x, int y)
 
 void	GenFakeDSFFile(const char * path)
 {
-	void * f = DSFCreateWriter(-118.0, 34.0, -117.0, 35.0, 8);
+	void * f = DSFCreateWriter(-118.0, 34.0, -117.0, 35.0, -100.0, 1000.0, 8);
 	DSFCallbacks_t	cbs;
 	DSFGetWriterCallbacks(&cbs);
 
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "GUI_FontMetrics.h"
+
+#define FM_RUN_CACHE_SIZE		4096
+
+GUI_FontMetrics::GUI_FontMetrics()
+{
+	clear();
+}
+
+void GUI_FontMetrics::clear(void)
+{
+	fast_advance.assign(FM_FAST_CHARS, -1.0f);
+	fast_advance['\t'] = 0.0f;
+	run_lru.clear();
+	run_index.clear();
+}
+
+void GUI_FontMetrics::set_advance(UTF32 inChar, float inAdvance)
+{
+	if (inChar < FM_FAST_CHARS)
+		fast_advance[inChar] = inAdvance;
+}
+
+bool GUI_FontMetrics::find_run(const string& inRun, float& outWidth)
+{
+	hash_map<string, run_list::iterator>::iterator i = run_index.find(inRun);
+	if (i == run_index.end()) return false;
+	run_lru.splice(run_lru.begin(), run_lru, i->second);
+	outWidth = i->second->second;
+	return true;
+}
+
+void GUI_FontMetrics::add_run(const string& inRun, float inWidth)
+{
+	if (run_index.size() >= FM_RUN_CACHE_SIZE)
+	{
+		run_index.erase(run_lru.back().first);
+		run_lru.pop_back();
+	}
+	run_lru.push_front(pair<string, float>(inRun, inWidth));
+	run_index[inRun] = run_lru.begin();
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef GUI_FontMetrics_H
+#define GUI_FontMetrics_H
+
+#include "GUI_Unicode.h"
+#include <list>
+
+// Advances for the basic multilingual plane are kept in a flat table so measuring doesn't hash every char.
+#define FM_FAST_CHARS			0x10000
+
+// Measured widths of recently seen long runs.  With the flat advance table, runs shorter than this measure
+// faster than we can copy and hash them for a lookup.
+#define FM_RUN_CACHE_MIN_LEN	48
+
+// The measuring side of one font: the advance of every char seen so far, and the widths of recent long runs.
+// It knows nothing of glyphs or textures - chars it has not seen are asked of the font with
+// font->require_char(c, 1.0f), and the font reports each advance it works out back through set_advance.
+// Clear it whenever the font is reset, so nothing measured at the old size is ever handed out.
+
+class	GUI_FontMetrics {
+public:
+					 GUI_FontMetrics();
+
+	void			clear(void);
+	void			set_advance(UTF32 inChar, float inAdvance);
+
+	template <class Font>
+	inline float	advance(Font * inFont, UTF32 inChar);
+
+	// The same as the GUI_MeasureRange, GUI_FitForward, GUI_FitReverse and GUI_TruncateText calls, for this font.
+	template <class Font>
+	float			measure(Font * inFont, const char * inStart, const char * inEnd);
+	template <class Font>
+	int				fit_forward(Font * inFont, const char * inStart, const char * inEnd, float inSpace);
+	template <class Font>
+	int				fit_reverse(Font * inFont, const char * inStart, const char * inEnd, float inSpace);
+	template <class Font>
+	void			truncate(Font * inFont, string& ioText, float inSpace);
+
+private:
+
+	template <class Font>
+	float			measure_chars(Font * inFont, const char * inStart, const char * inEnd);
+
+	bool			find_run(const string& inRun, float& outWidth);
+	void			add_run(const string& inRun, float inWidth);
+
+	typedef list<pair<string, float> >	run_list;
+
+	vector<float>							fast_advance;		// BMP chars -> advance, or -1 if not required yet.
+	run_list								run_lru;			// most recently used first
+	hash_map<string, run_list::iterator>	run_index;
+};
+
+template <class Font>
+inline float GUI_FontMetrics::advance(Font * inFont, UTF32 inChar)
+{
+	if (inChar < FM_FAST_CHARS && fast_advance[inChar] >= 0.0f)
+		return fast_advance[inChar];
+	return inFont->require_char(inChar, 1.0f);
+}
+
+template <class Font>
+float GUI_FontMetrics::measure_chars(Font * inFont, const char * inStart, const char * inEnd)
+{
+	float str_width = 0;
+	const UTF8 * p = (const UTF8 *) inStart;
+	const UTF8 * e = (const UTF8 *) inEnd;
+	while(p < e){
+		UTF32 c = UTF8_decode(p);
+		str_width += advance(inFont, c);
+		p=UTF8_next(p, e);
+	}
+	return str_width;
+}
+
+template <class Font>
+float GUI_FontMetrics::measure(Font * inFont, const char * inStart, const char * inEnd)
+{
+	if(inEnd - inStart < FM_RUN_CACHE_MIN_LEN)
+		return measure_chars(inFont, inStart, inEnd);
+
+	// A cache hit means every char in the run was required when it was measured, and the font only clears its
+	// chars along with us - so drawing still finds every char established.
+	string run(inStart, inEnd);
+	float str_width;
+	if(find_run(run, str_width))
+		return str_width;
+	str_width = measure_chars(inFont, inStart, inEnd);
+	add_run(run, str_width);
+	return str_width;
+}
+
+template <class Font>
+int GUI_FontMetrics::fit_forward(Font * inFont, const char * inStart, const char * inEnd, float inSpace)
+{
+	float so_far = 0.0;
+	const UTF8 * p = (const UTF8 *) inStart;
+	const UTF8 * e = (const UTF8 *) inEnd;
+	while(p < e)
+	{
+		UTF32 c = UTF8_decode(p);
+		so_far += advance(inFont, c);
+		if(so_far > inSpace)
+			break;
+		p=UTF8_next(p, e);
+	}
+	return (const char *) p - inStart;
+}
+
+template <class Font>
+int GUI_FontMetrics::fit_reverse(Font * inFont, const char * inStart, const char * inEnd, float inSpace)
+{
+	float so_far = 0.0;
+	const UTF8 * s = (const UTF8 *) inStart;
+	const UTF8 * e = (const UTF8 *) inEnd;
+	if(s== e) return 0;
+	--e;
+	e = UTF8_align(e);
+	int ct = 0;
+	while(e >= s)
+	{
+		UTF32 c = UTF8_decode(e);
+		so_far += advance(inFont, c);
+		if(so_far > inSpace)
+			break;
+		e = UTF8_prev(e);
+		++ct;
+	}
+	return ct;
+}
+
+template <class Font>
+void GUI_FontMetrics::truncate(Font * inFont, string& ioText, float inSpace)
+{
+	if (ioText.empty()) return;
+
+	// Advances are never negative, so if the whole string fits, every prefix does - and the (usually cached)
+	// width tells us we're done without fitting char by char.
+	if (measure(inFont, &*ioText.begin(), &*ioText.end()) <= inSpace) return;
+
+	int chars = fit_forward(inFont, &*ioText.begin(), &*ioText.end(), inSpace);
+	if (chars == ioText.length()) return;
+	if (chars < 0) { ioText.clear(); return; }
+	ioText.erase(chars);
+	if (ioText.length() > 0)	ioText[ioText.length()-1] = '.';
+	if (ioText.length() > 1)	ioText[ioText.length()-2] = '.';
+	if (ioText.length() > 2)	ioText[ioText.length()-3] = '.';
+}
+
+#endif /* GUI_FontMetrics_H */
@@ -37,6 +37,7 @@
 #endif
 
 #include "GUI_Fonts.h"
+#include "GUI_FontMetrics.h"
 #include "GUI_Unicode.h"
 
 #include <ft2build.h>
@@ -102,6 +103,7 @@ public:
 	float				line_ascent;		// distance from the baseline to the top of all drawing
 
 	OGL_char_map		char_map;
+	GUI_FontMetrics		metrics;			// advances of the chars in char_map, and recent run widths
 	unsigned char *		image_mem;
 
 	FT_Face				face;
@@ -185,6 +187,7 @@ void TT_font_info::clear(const string& inPath, float inSize)
 	tex_height = 0;
 	tex_dirty = 0;
 	char_map.clear();
+	metrics.clear();
 
 	if(image_mem) free(image_mem);
 	image_mem = NULL;
@@ -239,6 +242,7 @@ float TT_font_info::require_char(UTF32 inChar, float s)
 		info.advance_x = 0.0f;
 		info.status = err;
 		char_map[inChar] = info;
+		metrics.set_advance(inChar, 0.0f);
 		return 0.0f;
 	}
 
@@ -291,6 +295,7 @@ float TT_font_info::require_char(UTF32 inChar, float s)
 	info.advance_x	= (float) glyph->metrics.horiAdvance * X_SCALE / 64.0f;
 	info.status = 0;
 	char_map[inChar] = info;
+	metrics.set_advance(inChar, info.advance_x);
 
 	ProcessBitmapSection(width,height,glyph->bitmap.buffer);
 	CopyBitmapSection(width, height, glyph->bitmap.buffer,
@@ -378,56 +383,24 @@ float GUI_MeasureRange(int inFontID, const char * inStart, const char * inEnd)
 {
 	if(inStart == inEnd) return 0.0f;
 	TT_establish_font(inFontID);
-	float str_width = 0;
-	const UTF8 * p = (const UTF8 *) inStart;
-	const UTF8 * e = (const UTF8 *) inEnd;
-	while(p < e){
-		UTF32 c = UTF8_decode(p);
-		str_width += tt_font[inFontID]->require_char(c,1.0f);
-		p=UTF8_next(p, (const UTF8 *)inEnd);
-	}
-	return str_width;
+	TT_font_info * f = tt_font[inFontID];
+	return f->metrics.measure(f, inStart, inEnd);
 }
 
 int GUI_FitForward(int inFontID, const char* inStart, const char* inEnd,float width)
 {
 	if(inStart == inEnd) return 0;
 	TT_establish_font(inFontID);
-	float so_far = 0.0;
-	const UTF8 * p = (const UTF8 *) inStart;
-	const UTF8 * e = (const UTF8 *) inEnd;
-	while(p < e)
-	{
-		UTF32 c = UTF8_decode(p);
-		so_far += tt_font[inFontID]->require_char(c,1.0f);
-		if(so_far > width)
-			break;
-		p=UTF8_next(p, (const UTF8 *)inEnd);
-	}
-	return (const char *) p - inStart;
+	TT_font_info * f = tt_font[inFontID];
+	return f->metrics.fit_forward(f, inStart, inEnd, width);
 }
 
 int GUI_FitReverse(int inFontID, const char* inStart, const char* inEnd,float width)
 {
 	if(inStart == inEnd) return 0;
 	TT_establish_font(inFontID);
-	float so_far = 0.0;
-	const UTF8 * s = (const UTF8 *) inStart;
-	const UTF8 * e = (const UTF8 *) inEnd;
-	if(s== e) return 0;
-	--e;
-	e = UTF8_align(e);
-	int ct = 0;
-	while(e >= s)
-	{
-		UTF32 c = UTF8_decode(e);
-		so_far += tt_font[inFontID]->require_char(c,1.0f);
-		if(so_far > width)
-			break;
-		e = UTF8_prev(e);
-		++ct;
-	}
-	return ct;
+	TT_font_info * f = tt_font[inFontID];
+	return f->metrics.fit_reverse(f, inStart, inEnd, width);
 }
 
 float	GUI_GetLineHeight(int inFontID)
@@ -454,15 +427,9 @@ void	GUI_TruncateText(
 				float							inSpace)
 {
 	if (ioText.empty()) return;
-
-	int chars = GUI_FitForward(inFontID, &*ioText.begin(), &*ioText.end(), inSpace);
-	if (chars == ioText.length()) return;
-	if (chars < 0) { ioText.clear(); return; }
-	ioText.erase(chars);
-	if (ioText.length() > 0)	ioText[ioText.length()-1] = '.';
-	if (ioText.length() > 1)	ioText[ioText.length()-2] = '.';
-	if (ioText.length() > 2)	ioText[ioText.length()-3] = '.';
-
+	TT_establish_font(inFontID);
+	TT_font_info * f = tt_font[inFontID];
+	f->metrics.truncate(f, ioText, inSpace);
 }
 
 void	GUI_FontDraw(
@@ -106,13 +106,22 @@ int	main(int argc, char * argv[])
 		XESInit(false);			// no forests
 		MakeDirectRules();
 
-		if(argc != 6)
+		if(argc != 6 && argc != 10)
 		{
-			fprintf(stderr, "USAGE: MeshTool <script.txt> <file.xes> <file.hgt> <dir_base> <file.dsf>\n");
+			fprintf(stderr, "USAGE: MeshTool <script.txt> <file.xes> <file.hgt> <dir_base> <file.dsf> [<west> <south> <east> <north>]\n");
+			fprintf(stderr, "       With a tile window, only that part of a .tif or .bil elevation file is read.\n");
 			exit(1);
 		}
 
 		DEMGeo	dem_elev;
+		double	window_bounds[4];
+		double * window = NULL;
+		if(argc == 10)
+		{
+			for(int n = 0; n < 4; ++n)
+				window_bounds[n] = atof(argv[6+n]);
+			window = window_bounds;
+		}
 
 		if(strstr(argv[3],".bil"))
 		{
@@ -127,13 +136,13 @@ int	main(int argc, char * argv[])
 		
 			ReadHDR(argv[3], spec, false);
 		
-			if(!ReadRawWithHeader(dem_elev, argv[3], spec))
+			if(!ReadRawWithHeader(dem_elev, argv[3], spec, window))
 			{
 				fprintf(stderr,"Could not read bil file: %s\n", argv[3]);
 				exit(1);
 			}
 		}
-		if(strstr(argv[3],".hgt"))
+		else if(strstr(argv[3],".hgt"))
 		{
 			if (!ReadRawHGT(dem_elev, argv[3]))
 			{
@@ -144,7 +153,7 @@ int	main(int argc, char * argv[])
 		else if(strstr(argv[3],".tif"))
 		{
 			int align = dem_want_Post;
-			if (!ExtractGeoTiff(dem_elev, argv[3], align,false))
+			if (!ExtractGeoTiff(dem_elev, argv[3], align,false, window))
 			{
 				fprintf(stderr,"Could not read GeoTIFF file: %s\n", argv[3]);
 				exit(1);
@@ -53,28 +53,22 @@ int g_color_face_with_supr = 0;
 int g_color_face_with_appr = 0;
 int g_color_face_use_supr_tint = 0;
 
-void	IndexPmwx(Pmwx& pmwx, PmwxIndex_t& index)
+static Bbox2	FaceBounds(Face_handle f)
 {
-	index.faces.clear();
-	vector<pair<Bbox2, Face_handle> >	faces;
-	faces.reserve(pmwx.number_of_faces());	
-	for(Pmwx::Face_iterator f = pmwx.faces_begin(); f != pmwx.faces_end(); ++f)
-	if(!f->is_unbounded())
+	Pmwx::Ccb_halfedge_circulator circ, stop;
+	circ = stop = f->outer_ccb();
+	Bbox2	bbox(cgal2ben(circ->source()->point()));
+	do
 	{
-		Pmwx::Ccb_halfedge_circulator circ, stop;
-		circ = stop = f->outer_ccb();
-		Bbox2	bbox(cgal2ben(circ->source()->point()));
-		do
-		{
-			bbox += cgal2ben(circ->source()->point());
-		} while(++circ != stop);
+		bbox += cgal2ben(circ->source()->point());
+	} while(++circ != stop);
+	return bbox;
+}
 
-		faces.push_back(pair<Bbox2,Face_handle>(bbox, f));
-	}	
-	index.faces.insert(faces.begin(),faces.end());
-	faces.clear();
-	trim(faces);
-	
+// Edge and vertex boxes are just their end points - cheaper to recompute than to look up, so both the full and
+// incremental index rebuild these trees from scratch.
+static void	IndexEdgesAndVertices(Pmwx& pmwx, PmwxIndex_t& index)
+{
 	index.halfedges.clear();
 	vector<pair<Bbox2, Halfedge_handle> >	halfedges;
 	halfedges.reserve(pmwx.number_of_edges());	
@@ -99,7 +93,33 @@ void	IndexPmwx(Pmwx& pmwx, PmwxIndex_t& index)
 	index.vertices.insert(vertices.begin(),vertices.end());	
 	vertices.clear();
 	trim(vertices);
+}
+
+void	IndexPmwx(Pmwx& pmwx, PmwxIndex_t& index)
+{
+	if(index.tracker.arrangement() != &pmwx)
+	{
+		if(index.tracker.is_attached())
+			index.tracker.detach();
+		index.tracker.attach(pmwx);
+	}
+
+	index.faces.clear();
+	vector<pair<Bbox2, Face_handle> >	faces;
+	faces.reserve(pmwx.number_of_faces());	
+	for(Pmwx::Face_iterator f = pmwx.faces_begin(); f != pmwx.faces_end(); ++f)
+	if(!f->is_unbounded())
+	{
+		f->data().mGLBounds = FaceBounds(f);
+		faces.push_back(pair<Bbox2,Face_handle>(f->data().mGLBounds, f));
+	}	
+	index.faces.insert(faces.begin(),faces.end());
+	faces.clear();
+	trim(faces);
 	
+	IndexEdgesAndVertices(pmwx, index);
+
+	index.tracker.reset();
 }
 
 
@@ -391,6 +411,48 @@ static	void	SetColorForFace(Pmwx::Face_const_handle f, GLubyte outColor[4])
 	}
 }
 
+static void	PrecalcFace(Face_handle f)
+{
+	f->data().mGLTris.clear();
+	#if !NO_FACE_RENDER
+	gAccum = &f->data().mGLTris;
+
+	GLUtriangulatorObj *tobj;   /* tessellation object */
+	GLdouble v[3];              /* passed to gluTessVertex, prototype used 3d */
+
+	tobj = gluNewTess();
+	gluTessCallback(tobj, GLU_BEGIN, (GLvoid (STDCALL_MACRO *)())PRECALC_Begin);
+	gluTessCallback(tobj, GLU_VERTEX, (GLvoid (STDCALL_MACRO *)())PRECALC_Vertex2fv);
+	gluTessCallback(tobj, GLU_END, (GLvoid (STDCALL_MACRO *)()) PRECALC_End);
+	gluBeginPolygon(tobj);
+	gluNextContour(tobj, GLU_EXTERIOR);
+
+	Pmwx::Ccb_halfedge_circulator i, stop;
+	i = stop = f->outer_ccb();
+	do {
+		const float * p = i->source()->data().mGL;
+		v[0] = CGAL::to_double(i->source()->point().x());
+		v[1] = CGAL::to_double(i->source()->point().y());
+		v[2] = 0.0;
+		gluTessVertex(tobj, v, (GLvoid*) p);
+	} while (++i != stop);
+	for (Pmwx::Hole_iterator hole = f->holes_begin(); hole != f->holes_end(); ++hole)
+	{
+		gluNextContour(tobj, GLU_INTERIOR);
+		i = stop = *hole;
+		do {
+			const float * p = i->source()->data().mGL;			
+			v[0] = CGAL::to_double(i->source()->point().x());
+			v[1] = CGAL::to_double(i->source()->point().y());
+		    v[2] = 0.0;
+			gluTessVertex(tobj, v, (GLvoid *) p);
+		} while (++i != stop);
+	}
+	gluEndPolygon(tobj);
+	gluDeleteTess(tobj);
+	#endif
+}
+
 void	PrecalcOGL(Pmwx&						ioMap, ProgressFunc inFunc)
 {
 	int total = ioMap.number_of_vertices() + ioMap.number_of_halfedges() + ioMap.number_of_faces();
@@ -419,49 +481,125 @@ void	PrecalcOGL(Pmwx&						ioMap, ProgressFunc inFunc)
 	{
 		PROGRESS_CHECK(inFunc, 0, 1, "Building preview of vector map...", ctr, total, 1000)
 
-		f->data().mGLTris.clear();
-		#if !NO_FACE_RENDER
-		gAccum = &f->data().mGLTris;
+		PrecalcFace(f);
+	}
 
-		GLUtriangulatorObj *tobj;   /* tessellation object */
-		GLdouble v[3];              /* passed to gluTessVertex, prototype used 3d */
+	PROGRESS_DONE(inFunc, 0, 1, "Building preview of vector map...")
 
-		tobj = gluNewTess();
-		gluTessCallback(tobj, GLU_BEGIN, (GLvoid (STDCALL_MACRO *)())PRECALC_Begin);
-		gluTessCallback(tobj, GLU_VERTEX, (GLvoid (STDCALL_MACRO *)())PRECALC_Vertex2fv);
-		gluTessCallback(tobj, GLU_END, (GLvoid (STDCALL_MACRO *)()) PRECALC_End);
-		gluBeginPolygon(tobj);
-		gluNextContour(tobj, GLU_EXTERIOR);
+	RecalcOGLColors(ioMap, inFunc);
+}
 
-		Pmwx::Ccb_halfedge_circulator i, stop;
-		i = stop = f->outer_ccb();
-		do {
-			const float * p = i->source()->data().mGL;
-			v[0] = CGAL::to_double(i->source()->point().x());
-			v[1] = CGAL::to_double(i->source()->point().y());
-			v[2] = 0.0;
-			gluTessVertex(tobj, v, (GLvoid*) p);
-		} while (++i != stop);
-		for (Pmwx::Hole_iterator hole = f->holes_begin(); hole != f->holes_end(); ++hole)
+#if DEV
+template <class Handle>
+static bool	SameHandles(vector<Handle>& a, vector<Handle>& b)
+{
+	sort(a.begin(), a.end());
+	sort(b.begin(), b.end());
+	return a == b;
+}
+
+// Debug check of an incremental update: an index built from scratch must answer every face and edge query over
+// the touched area exactly like the patched one.  Face bounds are recomputed here rather than taken from the
+// cache, so stale cached bounds show up too.
+static void	CrossCheckIndex(Pmwx& pmwx, PmwxIndex_t& index, const vector<Bbox2>& dirty_bounds)
+{
+	PmwxIndex_t	scratch;
+	vector<pair<Bbox2, Face_handle> >	faces;
+	for(Pmwx::Face_iterator f = pmwx.faces_begin(); f != pmwx.faces_end(); ++f)
+	if(!f->is_unbounded())
+		faces.push_back(pair<Bbox2,Face_handle>(FaceBounds(f), f));
+	scratch.faces.insert(faces.begin(),faces.end());
+	IndexEdgesAndVertices(pmwx, scratch);
+
+	int bad = 0;
+	vector<Face_handle>		f1, f2;
+	vector<Halfedge_handle>	h1, h2;
+	for(vector<Bbox2>::const_iterator b = dirty_bounds.begin(); b != dirty_bounds.end(); ++b)
+	{
+		FindFaceTouchesPt(pmwx, index, b->centroid(), f1);
+		FindFaceTouchesPt(pmwx, scratch, b->centroid(), f2);
+		if(!SameHandles(f1, f2)) ++bad;
+		FindFaceTouchesRectFast(pmwx, index, b->p1, b->p2, f1);
+		FindFaceTouchesRectFast(pmwx, scratch, b->p1, b->p2, f2);
+		if(!SameHandles(f1, f2)) ++bad;
+		FindFaceFullyInRect(pmwx, index, b->p1, b->p2, f1);
+		FindFaceFullyInRect(pmwx, scratch, b->p1, b->p2, f2);
+		if(!SameHandles(f1, f2)) ++bad;
+		FindHalfedgeTouchesRectFast(pmwx, index, b->p1, b->p2, h1);
+		FindHalfedgeTouchesRectFast(pmwx, scratch, b->p1, b->p2, h2);
+		if(!SameHandles(h1, h2)) ++bad;
+		FindHalfedgeFullyInRect(pmwx, index, b->p1, b->p2, h1);
+		FindHalfedgeFullyInRect(pmwx, scratch, b->p1, b->p2, h2);
+		if(!SameHandles(h1, h2)) ++bad;
+	}
+	if(bad)
+		printf("Incremental map index differs from a full rebuild on %d queries over %d dirty areas.\n", bad, (int) dirty_bounds.size());
+	DebugAssert(bad == 0);
+}
+#endif
+
+bool	UpdatePrecalcAndIndex(Pmwx& pmwx, PmwxIndex_t& index, ProgressFunc inFunc)
+{
+	if(index.tracker.lost || index.tracker.arrangement() != &pmwx)
+		return false;
+
+	const set<Face_handle>& dirty(index.tracker.dirty_faces);
+	int total = pmwx.number_of_faces();
+	int ctr = 0;
+
+	PROGRESS_START(inFunc, 0, 1, "Updating preview of vector map...")
+
+	// Vertex positions are cheap and the re-tessellated faces point right at them, so refresh them all first.
+	for (Pmwx::Vertex_iterator v = pmwx.vertices_begin(); v != pmwx.vertices_end(); ++v)
+	{
+		v->data().mGL[0] = CGAL::to_double(v->point().x());
+		v->data().mGL[1] = CGAL::to_double(v->point().y());
+	}
+
+	// Only touched faces pay for a CCB walk and a tessellation; the rest reuse their cached bounds.  We still
+	// walk every face to rebuild the tree - RTree2 can't be edited in place.
+	index.faces.clear();
+	vector<pair<Bbox2, Face_handle> >	faces;
+	faces.reserve(pmwx.number_of_faces());	
+#if DEV
+	vector<Bbox2>	dirty_bounds;
+	Bbox2			dirty_all;
+#endif
+	for(Pmwx::Face_iterator f = pmwx.faces_begin(); f != pmwx.faces_end(); ++f, ++ctr)
+	if(!f->is_unbounded())
+	{
+		PROGRESS_CHECK(inFunc, 0, 1, "Updating preview of vector map...", ctr, total, 1000)
+		if(dirty.count(f))
 		{
-			gluNextContour(tobj, GLU_INTERIOR);
-			i = stop = *hole;
-			do {
-				const float * p = i->source()->data().mGL;			
-				v[0] = CGAL::to_double(i->source()->point().x());
-				v[1] = CGAL::to_double(i->source()->point().y());
-			    v[2] = 0.0;
-				gluTessVertex(tobj, v, (GLvoid *) p);
-			} while (++i != stop);
+			PrecalcFace(f);
+			f->data().mGLBounds = FaceBounds(f);
+#if DEV
+			dirty_bounds.push_back(f->data().mGLBounds);
+			dirty_all += f->data().mGLBounds;
+#endif
 		}
-		gluEndPolygon(tobj);
-		gluDeleteTess(tobj);
-		#endif
+		faces.push_back(pair<Bbox2,Face_handle>(f->data().mGLBounds, f));
 	}
+	index.faces.insert(faces.begin(),faces.end());
+	faces.clear();
+	trim(faces);
 
-	PROGRESS_DONE(inFunc, 0, 1, "Building preview of vector map...")
+	IndexEdgesAndVertices(pmwx, index);
 
-	RecalcOGLColors(ioMap, inFunc);
+#if DEV
+	if(!dirty_bounds.empty())
+	{
+		dirty_bounds.push_back(dirty_all);
+		CrossCheckIndex(pmwx, index, dirty_bounds);
+	}
+#endif
+
+	PROGRESS_DONE(inFunc, 0, 1, "Updating preview of vector map...")
+
+	index.tracker.reset();
+
+	RecalcOGLColors(pmwx, inFunc);
+	return true;
 }
 
 void	RecalcOGLColors(Pmwx& ioMap, ProgressFunc inFunc)
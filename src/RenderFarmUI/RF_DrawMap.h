@@ -39,6 +39,62 @@ void	PrecalcOGL(Pmwx&						ioMap, ProgressFunc inFunc);
 void	RecalcOGLColors(Pmwx&					ioMap, ProgressFunc inFunc);
 
 
+// The tracker watches the map that was last indexed and remembers which faces an edit touched, so the index and
+// the pre-tessellated faces can be patched instead of rebuilt.  Handles are only ever looked up, never
+// dereferenced, so a stale entry for something that was since deleted is harmless.  Anything we can't follow piece
+// by piece (clear, assign, a global sweep) just sets "lost" and the next update is a full one.
+class	PmwxIndexTracker_t : public CGAL::Arr_observer<Arrangement_2> {
+public:
+	PmwxIndexTracker_t() : lost(true) { }
+
+	bool					lost;
+	set<Face_handle>		dirty_faces;
+
+	void	reset(void) { lost = false; dirty_faces.clear(); }
+
+	virtual void after_attach() { lost = true; }
+	virtual void before_detach() { lost = true; }
+	virtual void after_assign() { lost = true; }
+	virtual void after_clear() { lost = true; }
+	virtual void before_global_change() { lost = true; }
+
+	virtual void after_modify_vertex(Vertex_handle v) {
+		if(!v->is_isolated())
+		{
+			Halfedge_around_vertex_circulator circ, stop;
+			circ = stop = v->incident_halfedges();
+			do {
+				dirty_faces.insert(circ->face());
+				dirty_faces.insert(circ->twin()->face());
+			} while(++circ != stop);
+		}
+	}
+
+	virtual void after_create_edge(Halfedge_handle e) { dirty_edge(e); }
+	virtual void after_modify_edge(Halfedge_handle e) { dirty_edge(e); }
+	virtual void after_split_edge(Halfedge_handle e1, Halfedge_handle e2) { dirty_edge(e1); dirty_edge(e2); }
+	virtual void after_merge_edge(Halfedge_handle e) { dirty_edge(e); }
+	virtual void before_remove_edge(Halfedge_handle e) { dirty_edge(e); }
+
+	virtual void after_split_face(Face_handle f, Face_handle new_f, bool is_hole) { dirty_faces.insert(f); dirty_faces.insert(new_f); }
+	virtual void before_merge_face(Face_handle f1, Face_handle f2, Halfedge_handle e) { dirty_faces.erase(f2); }
+	virtual void after_merge_face(Face_handle f) { dirty_faces.insert(f); }
+
+	virtual void after_split_outer_ccb(Face_handle f, Ccb_halfedge_circulator h1, Ccb_halfedge_circulator h2) { dirty_faces.insert(f); }
+	virtual void after_split_inner_ccb(Face_handle f, Ccb_halfedge_circulator h1, Ccb_halfedge_circulator h2) { dirty_faces.insert(f); }
+	virtual void after_add_outer_ccb(Ccb_halfedge_circulator h) { dirty_faces.insert(h->face()); }
+	virtual void after_add_inner_ccb(Ccb_halfedge_circulator h) { dirty_faces.insert(h->face()); }
+	virtual void after_merge_outer_ccb(Face_handle f, Ccb_halfedge_circulator h) { dirty_faces.insert(f); }
+	virtual void after_merge_inner_ccb(Face_handle f, Ccb_halfedge_circulator h) { dirty_faces.insert(f); }
+	virtual void before_move_outer_ccb(Face_handle from_f, Face_handle to_f, Ccb_halfedge_circulator h) { dirty_faces.insert(from_f); dirty_faces.insert(to_f); }
+	virtual void before_move_inner_ccb(Face_handle from_f, Face_handle to_f, Ccb_halfedge_circulator h) { dirty_faces.insert(from_f); dirty_faces.insert(to_f); }
+	virtual void after_remove_outer_ccb(Face_handle f) { dirty_faces.insert(f); }
+	virtual void after_remove_inner_ccb(Face_handle f) { dirty_faces.insert(f); }
+
+private:
+	void	dirty_edge(Halfedge_handle e) { dirty_faces.insert(e->face()); dirty_faces.insert(e->twin()->face()); }
+};
+
 struct PmwxIndex_t {
 	PmwxIndex_t() { }
 	typedef	RTree2<Face_handle,16>		FaceTree;
@@ -49,6 +105,8 @@ struct PmwxIndex_t {
 	HalfedgeTree 	halfedges;
 	VertexTree		vertices;
 
+	PmwxIndexTracker_t	tracker;
+
 	void	IndexPmwx(Pmwx& pmwx, PmwxIndex_t& index);
 
 private:
@@ -56,8 +114,13 @@ private:
 	PmwxIndex_t& operator=(const PmwxIndex_t&);
 };
 
+// Full rebuild - also starts tracking edits to pmwx.
 void	IndexPmwx(Pmwx& pmwx, PmwxIndex_t& index);
 
+// Incremental update of both the index and the PrecalcOGL data, for only what was touched since the last full
+// IndexPmwx/PrecalcOGL pair.  Returns false (and does nothing) if the tracker lost the map - call the full versions.
+bool	UpdatePrecalcAndIndex(Pmwx& pmwx, PmwxIndex_t& index, ProgressFunc inFunc);
+
 	
 
 void	DrawMapBucketed(
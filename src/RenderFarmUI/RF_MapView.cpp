@@ -656,12 +656,16 @@ void	RF_MapView::Draw(GUI_GraphState * state)
 	{
 		if (mNeedRecalcMapFull)
 		{
-//			RF_ProgressFunc(0, 1, "Building graphics for vector map...", 0.0);
-//			gMap.Index();
-//			RF_ProgressFunc(0, 1, "Building graphics for vector map...", 0.5);
-			PrecalcOGL(gMap,RF_ProgressFunc);
-//			RF_ProgressFunc(0, 1, "Building graphics for vector map...", 1.0);
-			IndexPmwx(gMap,gMapIndex);
+			// Edits we could follow only touch the faces they changed; a new file or global change rebuilds it all.
+			if (!UpdatePrecalcAndIndex(gMap,gMapIndex,RF_ProgressFunc))
+			{
+//				RF_ProgressFunc(0, 1, "Building graphics for vector map...", 0.0);
+//				gMap.Index();
+//				RF_ProgressFunc(0, 1, "Building graphics for vector map...", 0.5);
+				PrecalcOGL(gMap,RF_ProgressFunc);
+//				RF_ProgressFunc(0, 1, "Building graphics for vector map...", 1.0);
+				IndexPmwx(gMap,gMapIndex);
+			}
 		}
 		else if (mNeedRecalcMapMeta)
 		{
@@ -1513,6 +1517,7 @@ void	RF_MapView::HandleNotification(int catagory, int message, void * param)
 		switch(message) {
 		case rf_Msg_FileLoaded:
 			{
+				gMapIndex.tracker.lost = true;
 				mNeedRecalcMapFull = true;
 				mNeedRecalcMapMeta = true;
 				mNeedRecalcDEM = true;
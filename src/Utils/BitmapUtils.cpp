@@ -1278,7 +1278,8 @@ int		WriteBitmapToPNG(const struct ImageInfo * inImage, const char * inFilePath,
 
 	png_set_bgr(png_ptr);
 
-	png_set_PLTE(png_ptr, info_ptr, (png_colorp) inPalette, inPaletteLen);
+	if (inPalette)		// libpng 1.6 rejects an empty palette
+		png_set_PLTE(png_ptr, info_ptr, (png_colorp) inPalette, inPaletteLen);
 
     png_set_IHDR(png_ptr, info_ptr, inImage->width, inImage->height, 8,
     	(inImage->channels == 1) ? (inPalette ? PNG_COLOR_TYPE_PALETTE : PNG_COLOR_TYPE_GRAY) :
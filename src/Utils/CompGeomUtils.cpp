@@ -1346,3 +1346,80 @@ Point2	CoordTranslator2::Reverse(const Point2& input) const
 }
 
 
+
+struct	box_xmin_less {
+	const vector<Bbox2> * boxes;
+	bool operator()(int lhs, int rhs) const {
+		return (*boxes)[lhs].xmin() < (*boxes)[rhs].xmin() || ((*boxes)[lhs].xmin() == (*boxes)[rhs].xmin() && lhs < rhs);
+	}
+};
+
+void	FindOverlappingBoxes(const vector<Bbox2>& inBoxes, vector<pair<int,int> >& outPairs)
+{
+	vector<int>	order(inBoxes.size());
+	for (int n = 0; n < order.size(); ++n)
+		order[n] = n;
+	box_xmin_less	cmp;
+	cmp.boxes = &inBoxes;
+	sort(order.begin(), order.end(), cmp);
+
+	// Active holds every box we've passed whose right edge might still reach the sweep line.
+	vector<int>	active;
+	for (vector<int>::iterator o = order.begin(); o != order.end(); ++o)
+	{
+		const Bbox2& me(inBoxes[*o]);
+		int keep = 0;
+		for (int a = 0; a < active.size(); ++a)
+		{
+			const Bbox2& other(inBoxes[active[a]]);
+			if (other.xmax() < me.xmin())
+				continue;
+			active[keep++] = active[a];
+			if (other.ymax() >= me.ymin() && me.ymax() >= other.ymin())
+				outPairs.push_back(pair<int,int>(min(*o, active[a]), max(*o, active[a])));
+		}
+		active.resize(keep);
+		active.push_back(*o);
+	}
+}
+
+void	FindNextNearPoints(const vector<Point2>& inPts, double dist, vector<int>& outNext)
+{
+	outNext.assign(inPts.size(), -1);
+	if (inPts.empty()) return;
+
+	// Cells are a hair bigger than dist, so that two points closer than dist are never more than one cell
+	// apart, even after rounding.
+	double cell = dist * 1.01;
+	typedef pair<pair<int,int>, int>	cell_pt;
+	vector<cell_pt>	cells(inPts.size());
+	for (int n = 0; n < inPts.size(); ++n)
+		cells[n] = cell_pt(pair<int,int>((int) floor(inPts[n].x() / cell), (int) floor(inPts[n].y() / cell)), n);
+
+	// Sorting by cell, then index, means each cell's points are a contiguous run in index order - the first
+	// close point past i in a run is that cell's best answer.
+	sort(cells.begin(), cells.end());
+
+	double dist2 = dist * dist;
+	for (int n = 0; n < cells.size(); ++n)
+	{
+		int i = cells[n].second;
+		int best = -1;
+		for (int dy = -1; dy <= 1; ++dy)
+		for (int dx = -1; dx <= 1; ++dx)
+		{
+			pair<int,int> c(cells[n].first.first + dx, cells[n].first.second + dy);
+			vector<cell_pt>::iterator j = upper_bound(cells.begin(), cells.end(), cell_pt(c, i));
+			for (; j != cells.end() && j->first == c; ++j)
+			{
+				if (best != -1 && j->second > best) break;
+				if (inPts[i].squared_distance(inPts[j->second]) < dist2)
+				{
+					best = j->second;
+					break;
+				}
+			}
+		}
+		outNext[i] = best;
+	}
+}
@@ -304,6 +304,17 @@ void	SmoothPolygon(Polygon2& ioPolygon, double smooth_radius, double max_turn_de
 void	MakePolygonConvex(Polygon2& ioPolygon);
 #endif
 
+// Given a set of boxes, find every pair that overlaps (touching counts).  This sweeps the boxes left to right,
+// so only boxes whose x ranges overlap are ever compared.  Pairs are (i,j) with i < j, in no particular order.
+// Use this as the broad phase for an exact intersection test - any two segments or beziers that cross have
+// overlapping bounds.
+void	FindOverlappingBoxes(const vector<Bbox2>& inBoxes, vector<pair<int,int> >& outPairs);
+
+// Given a set of points, for each point find the lowest-indexed LATER point that is closer than dist,
+// or -1 if there isn't one.  Points are bucketed into a grid of dist-sized cells so only neighboring
+// cells are searched.
+void	FindNextNearPoints(const vector<Point2>& inPts, double dist, vector<int>& outNext);
+
 
 
 #endif
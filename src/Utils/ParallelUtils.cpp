@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+#include "ParallelUtils.h"
+
+static int	sWorkerCount = 0;
+
+int		ParallelWorkerCount(void)
+{
+	if (sWorkerCount > 0)
+		return sWorkerCount;
+	int hw = boost::thread::hardware_concurrency();
+	return hw > 0 ? hw : 1;
+}
+
+void	SetParallelWorkerCount(int inCount)
+{
+	sWorkerCount = inCount > 0 ? inCount : 0;
+}
+
+struct	ParallelQueue_Worker {
+	ParallelQueue *	queue;
+	void operator()() { queue->Worker(); }
+};
+
+ParallelQueue::ParallelQueue(int inWorkers) : mWorkers(inWorkers > 0 ? inWorkers : ParallelWorkerCount()), mQuit(false), mRunning(0)
+{
+}
+
+ParallelQueue::~ParallelQueue()
+{
+	{
+		boost::mutex::scoped_lock	l(mLock);
+		mQuit = true;
+		mQueue.clear();
+	}
+	mWake.notify_all();
+	mThreads.join_all();
+}
+
+void	ParallelQueue::Push(ParallelQueueJob * inJob)
+{
+	{
+		boost::mutex::scoped_lock	l(mLock);
+		mQueue.push_back(inJob);
+		// Threads are started on first use - plenty of queues never get any work.
+		if (mThreads.size() < mWorkers && mThreads.size() < mQueue.size() + mRunning)
+		{
+			ParallelQueue_Worker	worker;
+			worker.queue = this;
+			mThreads.create_thread(worker);
+		}
+	}
+	mWake.notify_one();
+}
+
+void	ParallelQueue::PopDone(vector<ParallelQueueJob *>& outJobs)
+{
+	boost::mutex::scoped_lock	l(mLock);
+	outJobs.insert(outJobs.end(), mDone.begin(), mDone.end());
+	mDone.clear();
+}
+
+int		ParallelQueue::CountPending(void)
+{
+	boost::mutex::scoped_lock	l(mLock);
+	return mQueue.size() + mRunning + mDone.size();
+}
+
+void	ParallelQueue::Worker(void)
+{
+	boost::mutex::scoped_lock	l(mLock);
+	while (1)
+	{
+		while (!mQuit && mQueue.empty())
+			mWake.wait(l);
+		if (mQuit)
+			return;
+
+		ParallelQueueJob * job = mQueue.front();
+		mQueue.pop_front();
+		++mRunning;
+		l.unlock();
+		(*job)();
+		l.lock();
+		--mRunning;
+		mDone.push_back(job);
+	}
+}
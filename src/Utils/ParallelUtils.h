@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+#ifndef PARALLELUTILS_H
+#define PARALLELUTILS_H
+
+/*
+	ParallelUtils - THEORY OF OPERATION
+
+	These are the minimal tools we need to spread data-parallel work across cores.
+	A job is any functor with an operator()(int) that can be called for every index
+	in a range; indices are handed out to worker threads from a shared counter.
+
+	The jobs must not touch any shared mutable state - the usual pattern is for each
+	index to write into its own slot of a pre-sized vector, and for the caller to
+	merge or emit those slots in index order once ParallelFor returns.  Done that way
+	the result is the same no matter how many threads ran or in what order.
+
+	If only one worker is configured (or there is only one job), the jobs are simply
+	run in order on the calling thread.
+
+	ParallelQueue is for work the caller does NOT want to wait for - e.g. the UI decoding
+	images while it keeps drawing.  Jobs are pushed onto a queue that a few background
+	threads work off; finished jobs are collected later with PopDone, typically from a
+	timer or the draw code on the UI thread.  The same rule applies: a job may only touch
+	its own data until it has been handed back.
+
+ */
+
+#include <boost/thread.hpp>
+#include <deque>
+#include <vector>
+
+// How many threads data-parallel work may use - defaults to the number of hardware threads.
+int		ParallelWorkerCount(void);
+// Pass 0 to go back to the hardware default, 1 to run everything on the calling thread.
+void	SetParallelWorkerCount(int inCount);
+
+template <class Job>
+struct	ParallelFor_Worker {
+	Job *			job;
+	int				count;
+	int *			next;
+	boost::mutex *	lock;
+
+	void operator()()
+	{
+		while(1)
+		{
+			int i;
+			{
+				boost::mutex::scoped_lock	l(*lock);
+				i = (*next)++;
+			}
+			if (i >= count)
+				return;
+			(*job)(i);
+		}
+	}
+};
+
+template <class Job>
+void	ParallelFor(int inCount, Job& inJob)
+{
+	int workers = ParallelWorkerCount();
+	if (workers > inCount)
+		workers = inCount;
+
+	if (workers <= 1)
+	{
+		for (int i = 0; i < inCount; ++i)
+			inJob(i);
+		return;
+	}
+
+	boost::mutex				lock;
+	int							next = 0;
+	ParallelFor_Worker<Job>		worker;
+	worker.job = &inJob;
+	worker.count = inCount;
+	worker.next = &next;
+	worker.lock = &lock;
+
+	boost::thread_group	threads;
+	for (int t = 1; t < workers; ++t)
+		threads.create_thread(worker);
+	worker();
+	threads.join_all();
+}
+
+class	ParallelQueueJob {
+public:
+	virtual			~ParallelQueueJob() { }
+	virtual	void	operator()() = 0;
+};
+
+// The queue never owns its jobs.  Deleting it drops whatever has not been started yet
+// and waits for the running jobs to finish - after that the caller may delete them all.
+class	ParallelQueue {
+public:
+						 ParallelQueue(int inWorkers);		// 0 means ParallelWorkerCount()
+						~ParallelQueue();
+
+			void		Push(ParallelQueueJob * inJob);
+			void		PopDone(std::vector<ParallelQueueJob *>& outJobs);	// Appends the jobs finished since the last call
+			int			CountPending(void);					// Queued, running or finished but not popped yet
+
+private:
+
+	friend struct ParallelQueue_Worker;
+			void		Worker(void);
+
+	int								mWorkers;
+	bool							mQuit;
+	int								mRunning;
+	std::deque<ParallelQueueJob *>	mQueue;
+	std::vector<ParallelQueueJob *>	mDone;
+	boost::mutex					mLock;
+	boost::condition_variable		mWake;
+	boost::thread_group				mThreads;
+
+	ParallelQueue(const ParallelQueue&);
+	ParallelQueue& operator=(const ParallelQueue&);
+};
+
+#endif /* PARALLELUTILS_H */
@@ -72,6 +72,14 @@ template <typename T>					bool is_subset(const set<T>& sub, const set<T>& s);
 template <typename Priority, typename Value>
 class pqueue;
 
+// INDEXED BINARY HEAP
+// A priority queue in one flat vector.  Each value stores its own slot in the heap (found via the
+// Slot functor, which returns an int& for a value, -1 meaning "not queued") so erasing and re-prioritizing
+// are O(LOGN) with no node allocation.  Equal priorities pop in insertion order, exactly like a multimap.
+
+template <typename Priority, typename Value, typename Slot>
+class indexed_heap;
+
 // SEQUENCE STUFF
 // Sequence uses () to know that it is valid.
 
@@ -385,6 +393,165 @@ private:
 
 };
 
+template <typename Priority, typename Value, typename Slot>
+class indexed_heap {
+public:
+	typedef Priority								priority_type;
+	typedef Value									value_type;
+
+	indexed_heap(const Slot& slot = Slot()) : slot_(slot), seq_(0) { }
+
+	void			insert(const priority_type& p, const value_type& v)
+	{
+		DebugAssert(slot_(v) == -1);
+		items_.push_back(item(p,seq_++,v));
+		sift_up(items_.size()-1);
+	}
+
+	// Change the priority of a queued value; it goes behind any equal priorities, as if erased and re-inserted.
+	void			reprioritize(const value_type& v, const priority_type& p)
+	{
+		int i = slot_(v);
+		DebugAssert(i >= 0 && i < items_.size());
+		bool up = p < items_[i].p;		// Equal priority still moves it back, behind the others.
+		items_[i].p = p;
+		items_[i].seq = seq_++;
+		if(up)	sift_up(i);
+		else	sift_down(i);
+	}
+
+	bool			erase(const value_type& v)
+	{
+		int i = slot_(v);
+		if(i < 0)
+			return false;
+		DebugAssert(i < items_.size() && items_[i].v == v);
+		slot_(v) = -1;
+		if(i != items_.size()-1)
+		{
+			items_[i] = items_.back();
+			items_.pop_back();
+			place(i);
+			if(i > 0 && earlier(items_[i],items_[(i-1)/2]))
+				sift_up(i);
+			else
+				sift_down(i);
+		}
+		else
+			items_.pop_back();
+		return true;
+	}
+
+	void			pop_front()
+	{
+		DebugAssert(!items_.empty());
+		erase(items_.front().v);
+	}
+
+	priority_type		front_priority() const
+	{
+		DebugAssert(!items_.empty());
+		return items_.front().p;
+	}
+
+	value_type			front_value() const
+	{
+		DebugAssert(!items_.empty());
+		return items_.front().v;
+	}
+
+	priority_type		priority(const value_type& v) const
+	{
+		DebugAssert(slot_(v) >= 0);
+		return items_[slot_(v)].p;
+	}
+
+	bool			contains(const value_type& v) const	{ return slot_(v) >= 0;	}
+	bool			empty(void) const					{ return items_.empty(); }
+	size_t			size(void) const					{ return items_.size();	}
+	void			reserve(size_t n)					{ items_.reserve(n);	}
+
+	// Clears the queue - the slots of the values still queued are left alone, the caller resets them.
+	void			clear(void)
+	{
+		items_.clear();
+		seq_ = 0;
+	}
+
+	// Bulk load: append any number of values in any order, then rebuild once - linear instead of NLOGN.
+	void			append(const priority_type& p, const value_type& v)
+	{
+		items_.push_back(item(p,seq_++,v));
+		place(items_.size()-1);
+	}
+
+	void			rebuild(void)
+	{
+		for(int i = (int) items_.size() / 2 - 1; i >= 0; --i)
+			sift_down(i);
+	}
+
+private:
+
+	struct item {
+		item(const priority_type& ip, unsigned long iseq, const value_type& iv) : p(ip), seq(iseq), v(iv) { }
+		priority_type	p;
+		unsigned long	seq;
+		value_type		v;
+	};
+
+	static bool earlier(const item& a, const item& b)
+	{
+		if(a.p < b.p) return true;
+		if(b.p < a.p) return false;
+		return a.seq < b.seq;
+	}
+
+	void	place(int i) { slot_(items_[i].v) = i; }
+
+	void	sift_up(int i)
+	{
+		item x(items_[i]);
+		while(i > 0)
+		{
+			int parent = (i-1)/2;
+			if(!earlier(x,items_[parent]))
+				break;
+			items_[i] = items_[parent];
+			place(i);
+			i = parent;
+		}
+		items_[i] = x;
+		place(i);
+	}
+
+	void	sift_down(int i)
+	{
+		int n = items_.size();
+		item x(items_[i]);
+		while(1)
+		{
+			int child = 2*i+1;
+			if(child >= n)
+				break;
+			if(child+1 < n && earlier(items_[child+1],items_[child]))
+				++child;
+			if(!earlier(items_[child],x))
+				break;
+			items_[i] = items_[child];
+			place(i);
+			i = child;
+		}
+		items_[i] = x;
+		place(i);
+	}
+
+	Slot			slot_;
+	vector<item>	items_;
+	unsigned long	seq_;
+
+};
+
 template<class InputIterator, class Separator, class OutputIterator>
 void tokenize_string(InputIterator begin, InputIterator end, OutputIterator oi, Separator sep)
 {
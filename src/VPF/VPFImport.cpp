@@ -187,6 +187,67 @@ static bool GetVPFLink(VPFTableIterator& iter, const VPF_TableDef& header, int r
 	return false;
 }
 
+// The edge table is the big one - every row carries its coordinate string - so its rows are decoded in
+// parallel.  Each row fills only its own VPF_Line and error slot; errors are reported in row order afterward.
+struct	VPF_EdgeRowJob {
+	const VPF_TableDef *			def;
+	bool							has_topo;
+	int								edg_id, edg_start_node, edg_end_node, edg_right_face, edg_left_face;
+	int								edg_right_edge, edg_left_edge, edg_coordinates;
+	int								num_lines;
+	const VPF_LineRule_t *			line_rules;
+	const vector<int> *				line_columns;
+	const vector<set<int> > *		line_matches;
+	vector<VPF_Line> *				lines;
+	vector<const char *>			errors;			// Per row: what we failed to read, or NULL
+
+	void operator()(VPFTableIterator& edgIter, int row)
+	{
+		int row_num, foreign_key, lin_attr_ref;
+		VPF_Line& line((*lines)[row]);
+
+		if (!edgIter.GetNthFieldAsInt(edg_id, row_num)) { errors[row] = "id"; return; }
+		if (row_num != row+1) { errors[row] = "a consecutive one-based id"; return; }
+
+		if (has_topo) {
+		if (!GetVPFLink(edgIter, *def, edg_left_face, foreign_key)) { errors[row] = "left_face"; return; }
+		line.left_fac_index = foreign_key-1;
+		if (!GetVPFLink(edgIter, *def, edg_right_face, foreign_key)) { errors[row] = "right_face"; return; }
+		line.right_fac_index = foreign_key-1;
+		}
+		if (!GetVPFLink(edgIter, *def, edg_left_edge, foreign_key)) { errors[row] = "left_edge"; return; }
+		line.left_edg_index = foreign_key-1;
+		if (!GetVPFLink(edgIter, *def, edg_right_edge, foreign_key)) { errors[row] = "right_edge"; return; }
+		line.right_edg_index = foreign_key-1;
+		if (!GetVPFLink(edgIter, *def, edg_start_node, foreign_key)) { errors[row] = "start_node"; return; }
+		line.start_cnd_index = foreign_key-1;
+		if (!GetVPFLink(edgIter, *def, edg_end_node, foreign_key)) { errors[row] = "end_node"; return; }
+		line.end_cnd_index = foreign_key-1;
+
+		if (!edgIter.GetNthFieldAsCoordPairArray(edg_coordinates, line.shape)) { errors[row] = "edge coordinates"; return; }
+		if (line.shape.size() < 2) { errors[row] = "at least two pts for edge"; return; }
+
+		line.start_node_pt = line.shape.front();
+		line.end_node_pt = line.shape.back();
+		NukeDupePts(line.shape);
+		line.he_trans_flags = 0;
+		line.he_param = NO_VALUE;
+
+		for (int i = 0; i < num_lines; ++i)
+		{
+			if (!edgIter.GetNthFieldAsInt((*line_columns)[i], lin_attr_ref)) { errors[row] = "a line attribute ref"; return; }
+			if ((*line_matches)[i].count(lin_attr_ref))
+			{
+//				if (line_rules[i].he_param)
+				DebugAssert(line_rules[i].he_param >= 0 && line_rules[i].he_param < gTokens.size());
+					line.he_param = line_rules[i].he_param;
+				if (line_rules[i].he_trans_flags)
+					line.he_trans_flags |= line_rules[i].he_trans_flags;
+			}
+		}
+	}
+};
+
 bool	VPFImportTopo3(
 					const char * 		inCoverageDir,
 					const char * 		inTile,
@@ -372,13 +433,12 @@ bool	VPFImportTopo3(
 
 		StMemFile			edg(thePath);
 		VPF_TableDef		edgDef;
-		vector<Point2>		edgPts;
 		if (!edg()) { printf("Could not open '%s'\n", thePath); return false; }
 
 		if (!ReadVPFTableHeader(edg, edgDef)) { printf("Could not read VPF header for '%s'\n", thePath); return false; }
 
 		int edg_id, edg_start_node, edg_end_node, edg_right_face, edg_left_face, edg_coordinates;
-		int edg_right_edge, edg_left_edge, lin_attr_ref;
+		int edg_right_edge, edg_left_edge;
 		if (!FindColumn(edgDef, "id", edg_id, require_Int, thePath)) return false;
 		if (!FindColumn(edgDef, "start_node", edg_start_node, require_Link, thePath)) return false;
 		if (!FindColumn(edgDef, "end_node", edg_end_node, require_Link, thePath)) return false;
@@ -391,51 +451,34 @@ bool	VPFImportTopo3(
 		for (i = 0; i < numLines; ++i)
 			if (!FindColumn(edgDef, inLineRules[i].ref_column, lineColumns[i], require_Int, thePath)) return false;
 
-		expected_row = 1;
-		for (VPFTableIterator edgIter(edg, edgDef); !edgIter.Done(); edgIter.Next(), ++expected_row)
+		VPF_EdgeRowJob	job;
+		job.def = &edgDef;
+		job.has_topo = inHasTopo;
+		job.edg_id = edg_id;
+		job.edg_start_node = edg_start_node;
+		job.edg_end_node = edg_end_node;
+		job.edg_right_face = edg_right_face;
+		job.edg_left_face = edg_left_face;
+		job.edg_right_edge = edg_right_edge;
+		job.edg_left_edge = edg_left_edge;
+		job.edg_coordinates = edg_coordinates;
+		job.num_lines = numLines;
+		job.line_rules = inLineRules;
+		job.line_columns = &lineColumns;
+		job.line_matches = &lineMatches;
+		job.lines = &lines;
+
+		vector<const char *>	rows;
+		if (!IndexVPFTableRows(edg, edgDef, rows)) { printf("Could not find the rows of '%s'\n", thePath); return false; }
+		lines.resize(rows.size() - 1);
+		job.errors.resize(lines.size(), NULL);
+		ParallelForVPFRows(edg, edgDef, rows, job);
+
+		for (expected_row = 1; expected_row <= lines.size(); ++expected_row)
+		if (job.errors[expected_row-1])
 		{
-			if (!edgIter.GetNthFieldAsInt(edg_id, row_num)) { printf("Could not read id on row %d of '%s'\n", expected_row, thePath); return false; }
-			if (row_num != expected_row) { printf("Row numbers in table '%s' are not consecutive one-based.\n", thePath); return false; }
-			lines.push_back(VPF_Line());
-
-			if (inHasTopo) {
-			if (!GetVPFLink(edgIter, edgDef, edg_left_face, foreign_key)) { printf("Could not read left_face on row %d of '%s'\n", expected_row, thePath); return false; }
-			lines.back().left_fac_index = foreign_key-1;
-			if (!GetVPFLink(edgIter, edgDef, edg_right_face, foreign_key)) { printf("Could not read right_face on row %d of '%s'\n", expected_row, thePath); return false; }
-			lines.back().right_fac_index = foreign_key-1;
-			}
-			if (!GetVPFLink(edgIter, edgDef, edg_left_edge, foreign_key)) { printf("Could not read left_edge on row %d of '%s'\n", expected_row, thePath); return false; }
-			lines.back().left_edg_index = foreign_key-1;
-			if (!GetVPFLink(edgIter, edgDef, edg_right_edge, foreign_key)) { printf("Could not read right_edge on row %d of '%s'\n", expected_row, thePath); return false; }
-			lines.back().right_edg_index = foreign_key-1;
-			if (!GetVPFLink(edgIter, edgDef, edg_start_node, foreign_key)) { printf("Could not read start_node on row %d of '%s'\n", expected_row, thePath); return false; }
-			lines.back().start_cnd_index = foreign_key-1;
-			if (!GetVPFLink(edgIter, edgDef, edg_end_node, foreign_key)) { printf("Could not read end_node on row %d of '%s'\n", expected_row, thePath); return false; }
-			lines.back().end_cnd_index = foreign_key-1;
-
-			if (!edgIter.GetNthFieldAsCoordPairArray(edg_coordinates, edgPts)) { printf("Could not read edge coordinates on row %s of '%s'\n", expected_row, thePath); return false; }
-			if (edgPts.size() < 2) { printf("Less than two pts for edge on row %s of '%s'\n", expected_row, thePath); return false; }
-
-			lines.back().start_node_pt = edgPts.front();
-			lines.back().end_node_pt = edgPts.back();
-			lines.back().shape = edgPts;
-			NukeDupePts(lines.back().shape);
-			lines.back().he_trans_flags = 0;
-			lines.back().he_param = NO_VALUE;
-
-			for (i = 0; i < numLines; ++i)
-			{
-				if (!edgIter.GetNthFieldAsInt(lineColumns[i], lin_attr_ref)) { printf("Could not read col %d of row %d as int in file %s\n", lineColumns[i], expected_row, thePath); return false; }
-				if (lineMatches[i].count(lin_attr_ref))
-				{
-//					if (inLineRules[i].he_param)
-					DebugAssert(inLineRules[i].he_param >= 0 && inLineRules[i].he_param < gTokens.size());
-						lines.back().he_param = inLineRules[i].he_param;
-					if (inLineRules[i].he_trans_flags)
-						lines.back().he_trans_flags |= inLineRules[i].he_trans_flags;
-				}
-			}
-
+			printf("Could not read %s on row %d of '%s'\n", job.errors[expected_row-1], expected_row, thePath);
+			return false;
 		}
 	}
 
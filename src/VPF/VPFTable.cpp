@@ -60,6 +60,124 @@ void	TokenizeString(const string& inString, vector<string>& outTokens, char inSe
 	}
 }
 
+// Bytes per element for a column type; -1 for a triplet key, whose size depends on its control byte.
+static int	ElementSize(char inType)
+{
+	switch(inType) {
+	case 'X':					// Null field
+	case 'T':					// ASCII
+	case 'L':					// Latin-1
+	case 'M':					// Multilingual
+	case 'N':					// Multilingual
+		return 1;
+	case 'S':					// short
+		return 2;
+	case 'F':					// float
+	case 'I':					// int
+		return 4;
+	case 'R':					// double
+	case 'C':					// float pair
+		return 8;
+	case 'Z':					// float triple
+		return 12;
+	case 'B':					// double pair
+		return 20;
+	case 'D':					// Date
+		return 20;
+	case 'Y':					// double triple
+		return 24;
+	case 'K':
+		return -1;
+	default:
+		return 0;
+	}
+}
+
+static int	TripletKeySize(unsigned char ctrlCode)
+{
+	int	itemSize = 1;
+	if ((ctrlCode & 0xC0) == 0xC0)	itemSize += 4;
+	if ((ctrlCode & 0xC0) == 0x80)	itemSize += 2;
+	if ((ctrlCode & 0xC0) == 0x40)	itemSize += 1;
+	if ((ctrlCode & 0x30) == 0x30)	itemSize += 4;
+	if ((ctrlCode & 0x30) == 0x20)	itemSize += 2;
+	if ((ctrlCode & 0x30) == 0x10)	itemSize += 1;
+	if ((ctrlCode & 0x0C) == 0x0C)	itemSize += 4;
+	if ((ctrlCode & 0x0C) == 0x08)	itemSize += 2;
+	if ((ctrlCode & 0x0C) == 0x04)	itemSize += 1;
+	if ((ctrlCode & 0x03) == 0x03)	itemSize += 4;
+	if ((ctrlCode & 0x03) == 0x02)	itemSize += 2;
+	if ((ctrlCode & 0x03) == 0x01)	itemSize += 1;
+	return itemSize;
+}
+
+static void	CompileRowLayout(VPF_TableDef& ioDef)
+{
+	VPF_RowLayout&	l(ioDef.layout);
+	int				n = ioDef.columns.size();
+	int				anchor = -1;
+	int				delta = 0;
+
+	l.elementSize.resize(n);
+	l.anchor.resize(n);
+	l.delta.resize(n);
+	l.varColumns.clear();
+
+	for (int i = 0; i < n; ++i)
+	{
+		l.elementSize[i] = ElementSize(ioDef.columns[i].dataType);
+		l.anchor[i] = anchor;
+		l.delta[i] = delta;
+		if (l.elementSize[i] < 0 || ioDef.columns[i].elementCount == 0)
+		{
+			l.varColumns.push_back(i);
+			anchor = l.varColumns.size() - 1;
+			delta = 0;
+		}
+		else
+			delta += l.elementSize[i] * ioDef.columns[i].elementCount;
+	}
+	l.tailDelta = delta;
+	l.fixedRowLength = l.varColumns.empty() ? delta : -1;
+}
+
+// Measures the row at inRecord, only reading its variable-length fields.  If outVarEnds is not null, the end
+// offset of each of them is saved there too.
+static int	MeasureRow(const VPF_TableDef& inDef, const char * inRecord, int * outVarEnds)
+{
+	const VPF_RowLayout& l(inDef.layout);
+	if (l.fixedRowLength >= 0)
+		return l.fixedRowLength;
+
+	int off = 0;
+	for (int k = 0; k < l.varColumns.size(); ++k)
+	{
+		int i = l.varColumns[k];
+		off += l.delta[i];
+		int itemSize = l.elementSize[i];
+		if (itemSize < 0)
+			itemSize = TripletKeySize(inRecord[off]);
+		if (inDef.columns[i].elementCount == 0)
+		{
+			int varCount = *((int *) (inRecord + off));
+			EndianSwapBuffer(inDef.endian, platform_Native, kFlipInt, &varCount);
+			off += 4 + itemSize * varCount;
+		} else
+			off += itemSize * inDef.columns[i].elementCount;
+		if (outVarEnds)
+			outVarEnds[k] = off;
+	}
+	return off + l.tailDelta;
+}
+
+static const char *	FirstRecord(MFMemFile * inFile, const VPF_TableDef& inDef)
+{
+	const char * p = MemFile_GetBegin(inFile);
+	int headerLen = *((int *) p);
+	EndianSwapBuffer(inDef.endian, platform_Native, kFlipInt, &headerLen);
+	return p + headerLen + 4;
+}
+
 bool	ReadVPFTableHeader(MFMemFile * inFile, VPF_TableDef& outDef)
 {
 	const char *	bPtr = MemFile_GetBegin(inFile);
@@ -130,6 +248,7 @@ bool	ReadVPFTableHeader(MFMemFile * inFile, VPF_TableDef& outDef)
 
 		outDef.columns.push_back(colDef);
 	}
+	CompileRowLayout(outDef);
 	return true;
 }
 
@@ -252,21 +371,59 @@ int		VPF_TableDef::GetColumnByName(const string& inName) const
 
 
 
+bool	IndexVPFTableRows(MFMemFile * inFile, const VPF_TableDef& inDef, vector<const char *>& outRows)
+{
+	const char *	p = FirstRecord(inFile, inDef);
+	const char *	e = MemFile_GetEnd(inFile);
+	int				len = inDef.layout.fixedRowLength;
+
+	outRows.clear();
+	if (len > 0)
+	{
+		if ((e - p) % len) return false;
+		outRows.reserve((e - p) / len + 1);
+		for (; p < e; p += len)
+			outRows.push_back(p);
+	}
+	else
+	{
+		while (p < e)
+		{
+			outRows.push_back(p);
+			len = MeasureRow(inDef, p, NULL);
+			if (len <= 0 || len > e - p) return false;
+			p += len;
+		}
+	}
+	outRows.push_back(e);
+	return true;
+}
+
 VPFTableIterator::VPFTableIterator(MFMemFile * inFile, const VPF_TableDef& inDef) :
 	mFile(inFile),
 	mDef(inDef)
 {
-	mCurrentRecord = MemFile_GetBegin(inFile);
-	int headerLen = *((int *) mCurrentRecord);
-	EndianSwapBuffer(mDef.endian, platform_Native, kFlipInt, &headerLen);
-	mCurrentRecord += (headerLen + 4);
+	mCurrentRecord = FirstRecord(inFile, mDef);
+	mEnd = MemFile_GetEnd(inFile);
+	mVarEnds.resize(mDef.layout.varColumns.size());
+
+	ParseCurrent();
+}
+
+VPFTableIterator::VPFTableIterator(MFMemFile * inFile, const VPF_TableDef& inDef, const char * inBegin, const char * inEnd) :
+	mFile(inFile),
+	mCurrentRecord(inBegin),
+	mEnd(inEnd),
+	mDef(inDef)
+{
+	mVarEnds.resize(mDef.layout.varColumns.size());
 
 	ParseCurrent();
 }
 
 bool	VPFTableIterator::Done(void)
 {
-	return (mCurrentRecord == NULL || mCurrentRecord == MemFile_GetEnd(mFile));
+	return (mCurrentRecord == NULL || mCurrentRecord == mEnd);
 }
 
 void	VPFTableIterator::Next(void)
@@ -285,7 +442,7 @@ bool	VPFTableIterator::Error(void)
 
 int		VPFTableIterator::GetFieldCount(void)
 {
-	return mFieldOffsets.size();
+	return mDef.columns.size();
 }
 
 // RAW FETCHERS
@@ -302,7 +459,7 @@ static const char *	GetRawDouble(const char * inP, double& outDouble, PlatformTy
 bool	VPFTableIterator::GetNthFieldAsString(int n, string& s)
 {
 	if (!mCurrentRecord) return false;
-	const char * sstart = mCurrentRecord + mFieldOffsets[n];
+	const char * sstart = FieldStart(n);
 	int len = mDef.columns[n].elementCount;
 	if (len == 0)
 	{
@@ -332,10 +489,10 @@ bool	VPFTableIterator::GetNthFieldAsInt(int n, int& v)
 	double	dval;
 	if (mDef.columns[n].elementCount != 1) return false;
 	switch(mDef.columns[n].dataType) {
-	case 'S':	GetRawShort(mCurrentRecord + mFieldOffsets[n], sval, mDef.endian);	v = sval; return true;
-	case 'I':	GetRawInt(mCurrentRecord + mFieldOffsets[n], ival, mDef.endian);	v = ival; return true;
-	case 'F':	GetRawFloat(mCurrentRecord + mFieldOffsets[n], fval, mDef.endian);	v = fval; return true;
-	case 'R':	GetRawDouble(mCurrentRecord + mFieldOffsets[n], dval, mDef.endian);	v = dval; return true;
+	case 'S':	GetRawShort(FieldStart(n), sval, mDef.endian);	v = sval; return true;
+	case 'I':	GetRawInt(FieldStart(n), ival, mDef.endian);	v = ival; return true;
+	case 'F':	GetRawFloat(FieldStart(n), fval, mDef.endian);	v = fval; return true;
+	case 'R':	GetRawDouble(FieldStart(n), dval, mDef.endian);	v = dval; return true;
 	default:	return false;
 	}
 }
@@ -349,10 +506,10 @@ bool	VPFTableIterator::GetNthFieldAsDouble(int n, double& v)
 	double	dval;
 	if (mDef.columns[n].elementCount != 1) return false;
 	switch(mDef.columns[n].dataType) {
-	case 'S':	GetRawShort(mCurrentRecord + mFieldOffsets[n], sval, mDef.endian);	v = sval; ZeroFixd(v); return true;
-	case 'I':	GetRawInt(mCurrentRecord + mFieldOffsets[n], ival, mDef.endian);	v = ival; ZeroFixd(v); return true;
-	case 'F':	GetRawFloat(mCurrentRecord + mFieldOffsets[n], fval, mDef.endian);	v = fval; ZeroFixd(v); return true;
-	case 'R':	GetRawDouble(mCurrentRecord + mFieldOffsets[n], dval, mDef.endian);	v = dval; ZeroFixd(v); return true;
+	case 'S':	GetRawShort(FieldStart(n), sval, mDef.endian);	v = sval; ZeroFixd(v); return true;
+	case 'I':	GetRawInt(FieldStart(n), ival, mDef.endian);	v = ival; ZeroFixd(v); return true;
+	case 'F':	GetRawFloat(FieldStart(n), fval, mDef.endian);	v = fval; ZeroFixd(v); return true;
+	case 'R':	GetRawDouble(FieldStart(n), dval, mDef.endian);	v = dval; ZeroFixd(v); return true;
 	default:	return false;
 	}
 }
@@ -364,7 +521,7 @@ bool	VPFTableIterator::GetNthFieldAsCoordPair(int n, Point2& p)
 
 	double	d1, d2;
 	float	f1, f2;
-	const char * start = mCurrentRecord + mFieldOffsets[n];
+	const char * start = FieldStart(n);
 
 	switch(mDef.columns[n].dataType) {
 	case 'C':		// Two-pair float
@@ -395,7 +552,7 @@ bool	VPFTableIterator::GetNthFieldAsCoordTriple(int n , Point3& p)
 
 	double	d1, d2, d3 = 0.0;;
 	float	f1, f2, f3 = 0.0;;
-	const char * start = mCurrentRecord + mFieldOffsets[n];
+	const char * start = FieldStart(n);
 	bool	hasThree = true;
 
 	switch(mDef.columns[n].dataType) {
@@ -431,7 +588,7 @@ bool	VPFTableIterator::GetNthFieldAsCoordTriple(int n , Point3& p)
 bool	VPFTableIterator::GetNthFieldAsIntArray(int n, vector<int>& v)
 {
 	if (!mCurrentRecord) return false;
-	const char * start = mCurrentRecord + mFieldOffsets[n];
+	const char * start = FieldStart(n);
 	int len = mDef.columns[n].elementCount;
 	short	sval;
 	int		ival;
@@ -456,7 +613,7 @@ bool	VPFTableIterator::GetNthFieldAsIntArray(int n, vector<int>& v)
 bool	VPFTableIterator::GetNthFieldAsDoubleArray(int n, vector<double>& v)
 {
 	if (!mCurrentRecord) return false;
-	const char * start = mCurrentRecord + mFieldOffsets[n];
+	const char * start = FieldStart(n);
 	int len = mDef.columns[n].elementCount;
 	short	sval;
 	int		ival;
@@ -481,7 +638,7 @@ bool	VPFTableIterator::GetNthFieldAsDoubleArray(int n, vector<double>& v)
 bool	VPFTableIterator::GetNthFieldAsCoordPairArray(int n, vector<Point2>& v)
 {
 	if (!mCurrentRecord) return false;
-	const char * start = mCurrentRecord + mFieldOffsets[n];
+	const char * start = FieldStart(n);
 	int len = mDef.columns[n].elementCount;
 	double	d1, d2, d3;
 	float	f1, f2, f3;
@@ -530,7 +687,7 @@ bool	VPFTableIterator::GetNthFieldAsCoordPairArray(int n, vector<Point2>& v)
 bool	VPFTableIterator::GetNthFieldAsCoordTripleArray(int n, vector<Point3>& v)
 {
 	if (!mCurrentRecord) return false;
-	const char * start = mCurrentRecord + mFieldOffsets[n];
+	const char * start = FieldStart(n);
 	int len = mDef.columns[n].elementCount;
 	double	d1, d2, d3;
 	float	f1, f2, f3;
@@ -586,7 +743,7 @@ bool	VPFTableIterator::GetNthFieldAsTripletKey(int n, VPF_TripletKey& k)
 	if (mDef.columns[n].dataType != 'K') return false;
 	if (mDef.columns[n].elementCount != 1) return false;
 
-	const char *	start = mCurrentRecord + mFieldOffsets[n];
+	const char *	start = FieldStart(n);
 	unsigned char ctrlCode = *start;
 	++start;
 	unsigned char	cval;
@@ -612,79 +769,16 @@ bool	VPFTableIterator::GetNthFieldAsTripletKey(int n, VPF_TripletKey& k)
 }
 
 
+// Only the variable-length fields are sized here - every other field is found from them via the layout
+// when (and if) someone asks for it.
 void	VPFTableIterator::ParseCurrent(void)
 {
-	if (mCurrentRecord == MemFile_GetEnd(mFile))	return;
-	mFieldOffsets.clear();
-	int off = 0;
-	int	itemSize = 0;
-	int	varCount;
-	unsigned char ctrlCode;
-	for (int i = 0; i < mDef.columns.size(); ++i)
-	{
-		switch(mDef.columns[i].dataType) {
-		case 'X':				// Null field
-			itemSize = 0;
-		case 'T':					// ASCII
-		case 'L':					// Latin-1
-		case 'M':					// Multilingual
-		case 'N':					// Multilingual
-			itemSize = 1;
-			break;
-		case 'S':					// short
-			itemSize = 2;
-			break;
-		case 'F':					// float
-		case 'I':					// int
-			itemSize = 4;
-			break;
-		case 'R':					// double
-		case 'C':					// float pair
-			itemSize = 8;
-			break;
-		case 'Z':					// float triple
-			itemSize = 12;
-			break;
-		case 'B':					// double pair
-			itemSize = 20;
-			break;
-		case 'D':					// Date
-			itemSize = 20;
-			break;
-		case 'Y':					// double triple
-			itemSize = 24;
-			break;
-		case 'K':
-			ctrlCode = mCurrentRecord[off];
-			itemSize = 1;
-			if ((ctrlCode & 0xC0) == 0xC0)	itemSize += 4;
-			if ((ctrlCode & 0xC0) == 0x80)	itemSize += 2;
-			if ((ctrlCode & 0xC0) == 0x40)	itemSize += 1;
-			if ((ctrlCode & 0x30) == 0x30)	itemSize += 4;
-			if ((ctrlCode & 0x30) == 0x20)	itemSize += 2;
-			if ((ctrlCode & 0x30) == 0x10)	itemSize += 1;
-			if ((ctrlCode & 0x0C) == 0x0C)	itemSize += 4;
-			if ((ctrlCode & 0x0C) == 0x08)	itemSize += 2;
-			if ((ctrlCode & 0x0C) == 0x04)	itemSize += 1;
-			if ((ctrlCode & 0x03) == 0x03)	itemSize += 4;
-			if ((ctrlCode & 0x03) == 0x02)	itemSize += 2;
-			if ((ctrlCode & 0x03) == 0x01)	itemSize += 1;
-			break;
-		}
-		if (mDef.columns[i].elementCount == 0)
-		{
-			varCount = *((int *) (mCurrentRecord + off));
-			EndianSwapBuffer(mDef.endian, platform_Native, kFlipInt, &varCount);
-			itemSize = 4 + itemSize * varCount;
-		} else
-			itemSize *= mDef.columns[i].elementCount;
+	if (mCurrentRecord == mEnd)	return;
 
-		mFieldOffsets.push_back(off);
-		off += itemSize;
-	}
+	int off = MeasureRow(mDef, mCurrentRecord, mVarEnds.empty() ? NULL : &*mVarEnds.begin());
 
 	mNextRecord = mCurrentRecord + off;
-	if (mNextRecord <= mCurrentRecord || mNextRecord > MemFile_GetEnd(mFile))
+	if (mNextRecord <= mCurrentRecord || mNextRecord > mEnd)
 		mCurrentRecord = NULL;
 }
 
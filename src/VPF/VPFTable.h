@@ -28,6 +28,7 @@
 
 #include "EndianUtils.h"
 #include "MemFileUtils.h"
+#include "ParallelUtils.h"
 
 struct	VPF_TripletKey {
 	unsigned int row_id;
@@ -49,6 +50,18 @@ struct	VPF_ColumnDef {
 	string		narrativeFileName;
 };
 
+// A row layout is compiled once per table from its column defs.  Every column sits a fixed number of bytes
+// past the end of the last variable-length field before it (or past the row start), so finding a column or
+// the next row only means sizing the variable-length fields - and a table without any is a plain stride.
+struct	VPF_RowLayout {
+	vector<int>		elementSize;		// Per column: bytes per element, -1 for a triplet key (sized by its control byte)
+	vector<int>		anchor;				// Per column: index into varColumns of the last variable field before it, or -1
+	vector<int>		delta;				// Per column: bytes from the anchor's end (or the row start) to the column
+	vector<int>		varColumns;			// Columns whose size varies from row to row, in order
+	int				tailDelta;			// Bytes from the last variable field's end to the end of the row
+	int				fixedRowLength;		// Row length if there are no variable fields, otherwise -1
+};
+
 struct	VPF_TableDef {
 
 	PlatformType			endian;
@@ -56,6 +69,7 @@ struct	VPF_TableDef {
 	string					name;
 	string					desc;
 	vector<VPF_ColumnDef>	columns;
+	VPF_RowLayout			layout;			// Built by ReadVPFTableHeader
 
 	// These accessors allow you to learn things about
 	// fields without having to parse the codes from PVF.
@@ -82,9 +96,15 @@ bool	ReadVPFTableHeader(MFMemFile * inFile, VPF_TableDef& outDef);
 void	DumpVPFTableHeader(const VPF_TableDef& inDef);
 void	DumpVPFTable(MFMemFile * inFile, const VPF_TableDef& inDef);
 
+// Finds the start of every row plus the end of the last one (so rows+1 entries).  Fixed-length tables are
+// computed without touching the data; otherwise only the variable-length fields are read.
+bool	IndexVPFTableRows(MFMemFile * inFile, const VPF_TableDef& inDef, vector<const char *>& outRows);
+
 class	VPFTableIterator {
 public:
 	VPFTableIterator(MFMemFile * inFile, const VPF_TableDef& inDef);
+	// Iterate only [inBegin, inEnd) - both must be row boundaries, e.g. from IndexVPFTableRows.
+	VPFTableIterator(MFMemFile * inFile, const VPF_TableDef& inDef, const char * inBegin, const char * inEnd);
 
 	bool	Done(void);
 	void	Next(void);
@@ -116,13 +136,44 @@ public:
 
 private:
 
-	void	ParseCurrent(void);
+	void			ParseCurrent(void);
+	const char *	FieldStart(int n) const { int a = mDef.layout.anchor[n]; return mCurrentRecord + (a < 0 ? 0 : mVarEnds[a]) + mDef.layout.delta[n]; }
 
 	MFMemFile *		mFile;				// Mem in file
 	const char *	mCurrentRecord;		// Base addr of current record
 	const char *	mNextRecord;		// Base addr of next record, defines our length
-	vector<int>		mFieldOffsets;		// Offsets in cur record of all fields (in bytes)
+	const char *	mEnd;				// End of the rows we iterate
+	vector<int>		mVarEnds;			// Offsets in cur record of the end of each variable-length field (in bytes)
 	VPF_TableDef	mDef;				// Def of our table
 };
 
+#define VPF_ROWS_PER_RANGE 1024
+
+template <class Job>
+struct	VPFRowRange_Job {
+	MFMemFile *						file;
+	const VPF_TableDef *			def;
+	const vector<const char *> *	rows;
+	Job *							job;
+
+	void operator()(int r)
+	{
+		int b = r * VPF_ROWS_PER_RANGE;
+		int e = min(b + VPF_ROWS_PER_RANGE, (int) rows->size() - 1);
+		VPFTableIterator	iter(file, *def, (*rows)[b], (*rows)[e]);
+		for (int n = b; n < e && !iter.Done(); ++n, iter.Next())
+			(*job)(iter, n);
+	}
+};
+
+// Runs job(iter, row) on every row of the table (row is zero-based, inRows from IndexVPFTableRows), with the
+// rows split into contiguous ranges that ParallelFor hands to the workers - each range gets its own iterator
+// over the mapped file.  The job may only write to its own row's slot.
+template <class Job>
+void	ParallelForVPFRows(MFMemFile * inFile, const VPF_TableDef& inDef, const vector<const char *>& inRows, Job& job)
+{
+	VPFRowRange_Job<Job>	ranges = { inFile, &inDef, &inRows, &job };
+	ParallelFor((inRows.size() - 1 + VPF_ROWS_PER_RANGE - 1) / VPF_ROWS_PER_RANGE, ranges);
+}
+
 #endif
@@ -69,6 +69,7 @@ void		WED_Archive::ChangedObject(WED_Persistent * inObject, int change_kind)
 {
 	if (mDying) return;
 	++mCacheKey;
+	mChangedIDs.insert(inObject->GetID());
 #if WITHNWLINK
 	if (mNWAdapter) mNWAdapter->ObjectChanged(inObject, change_kind);
 #endif
@@ -81,6 +82,7 @@ void		WED_Archive::AddObject(WED_Persistent * inObject)
 {
 	if (mDying) return;
 	++mCacheKey;
+	mChangedIDs.insert(inObject->GetID());
 	mID = max(mID,inObject->GetID()+1);
 	ObjectMap::iterator iter = mObjects.find(inObject->GetID());
 	DebugAssert(iter == mObjects.end() || iter->second == NULL);
@@ -100,6 +102,7 @@ void		WED_Archive::RemoveObject(WED_Persistent * inObject)
 {
 	if (mDying) return;
 	++mCacheKey;
+	mChangedIDs.insert(inObject->GetID());
 	ObjectMap::iterator iter = mObjects.find(inObject->GetID());
 	Assert(iter != mObjects.end());
 	iter->second = NULL;
@@ -118,6 +121,7 @@ void	WED_Archive::ClearAll(void)
 	for (ObjectMap::iterator ob = mObjects.begin(); ob != mObjects.end(); ++ob)
 	if (ob->second != NULL)
 		ob->second->Delete();
+	mChangedIDs.clear();
 }
 
 void			WED_Archive::SaveToXML(WED_XMLElement * parent)
@@ -170,6 +174,9 @@ void			WED_Archive::AbortCommand(void)
 
 	DebugAssert(mUndoMgr != NULL);
 	mUndoMgr->AbortCommand();
+	// No msg_ArchiveChanged goes out for an aborted command - the cache key bump above makes listeners start over -
+	// so the IDs it touched must not leak into the next command's change set.
+	mChangedIDs.clear();
 }
 
 int	WED_Archive::NewID(void)
@@ -247,4 +254,5 @@ void		WED_Archive::PopHandler(void)
 {
 	mOpCount = 0;
 	++mCacheKey;
+	mChangedIDs.clear();
 }
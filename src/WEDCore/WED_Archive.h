@@ -95,6 +95,10 @@ public:
 
 	long long		CacheKey(void);
 
+	// IDs of every object created, changed or destroyed since the last msg_ArchiveChanged went out.  Listeners can use
+	// this from their ReceiveMessage to apply just the change instead of rebuilding everything from the root.
+	const set<int>&	GetChangedIDs(void) const { return mChangedIDs; }
+
 	void			Validate(void);
 
 	IResolver *		GetResolver(void) { return mResolver; }
@@ -133,6 +137,7 @@ private:
 	int				mOpCount;
 
 	long long		mCacheKey;
+	set<int>		mChangedIDs;
 
 	IResolver *		mResolver;
 
@@ -295,6 +295,7 @@ void	WED_Document::Revert(void)
 
 		WED_XMLReader	reader;
 		reader.PushHandler(this);
+		WED_PropertyHelper::ResetXMLDispatch();
 		string fname(mFilePath);
 		fname+=".xml";
 		mArchive.ClearAll();
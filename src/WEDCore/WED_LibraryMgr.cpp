@@ -29,7 +29,9 @@
 #include "FileUtils.h"
 #include "PlatformUtils.h"
 #include "MemFileUtils.h"
+#include "ParallelUtils.h"
 #include <time.h>
+#include <sys/stat.h>
 
 static void clean_vpath(string& s)
 {
@@ -94,6 +96,19 @@ static int is_direct_parent(const string& parent, const string& child)
 																	return true;
 }
 
+WED_LibraryMgr::res_key_t::res_key_t(const string& p) : path(p), lower(p), slash(-1), starts_digit(false), has_num(false), num(0)
+{
+	for(string::size_type n = 0; n < lower.size(); ++n)
+	{
+		lower[n] = tolower((unsigned char) lower[n]);
+		if(lower[n] == '/') slash = n;
+	}
+	const char * base = lower.c_str() + slash + 1;
+	starts_digit = isdigit((unsigned char) *base);
+	if(starts_digit || *base == '-' || *base == '+' || isspace((unsigned char) *base))	// anything else can't scan as %d
+		has_num = sscanf(base, "%d", &num) > 0;
+}
+
 //Library manager constructor
 WED_LibraryMgr::WED_LibraryMgr(const string& ilocal_package) : local_package(ilocal_package)
 {
@@ -142,11 +157,11 @@ void		WED_LibraryMgr::GetResourceChildren(const string& r, int filter_package, v
 
 	while(me != res_table.end())
 	{
-		if(me->first.size() < r.size())								break;
-		if(strncasecmp(me->first.c_str(),r.c_str(),r.size()) != 0)	break;
+		if(me->first.path.size() < r.size())								break;
+		if(strncasecmp(me->first.path.c_str(),r.c_str(),r.size()) != 0)	break;
 		// Ben says: even in WED 1.6 we still don't show private or deprecated stuff
 		if(me->second.status >= status_Public)
-		if(is_direct_parent(r,me->first))
+		if(is_direct_parent(r,me->first.path))
 		{
 			bool want_it = true;
 			switch(filter_package) {
@@ -159,7 +174,7 @@ void		WED_LibraryMgr::GetResourceChildren(const string& r, int filter_package, v
 			}
 			if(want_it)
 			{
-				children.push_back(me->first);
+				children.push_back(me->first.path);
 			}
 		}
 		++me;
@@ -271,107 +286,305 @@ struct local_scan_t {
 	WED_LibraryMgr * who;
 };
 
-void		WED_LibraryMgr::Rescan()
+// Parsing every library.txt is most of the cost of a rescan - X-Plane itself ships a few hundred of them - so the
+// packages are parsed on worker threads into plain entry lists, which are then accumulated in package order on the
+// main thread, giving exactly the table a serial scan would.  The entry lists are also kept in an index file in the
+// cache folder, keyed by each library.txt's path, size and date, so an unchanged package needs no parsing at all.
+
+// One EXPORT line of a library.txt - rpath already made absolute and case-corrected (again on every scan, if it came from the index).
+struct lib_entry_t {
+	string	vpath;
+	string	rpath;
+	int		status;			// PUBLIC, PRIVATE, DEPRECATED, SEMI_DEPRECATED in effect at this line
+	int		new_until;		// date given with that PUBLIC, 0 if none.  Compared to today when accumulated, so cached entries age correctly.
+	bool	is_backup;
+};
+
+struct lib_package_t {
+	string				pack_base;
+	string				lib_path;		// case-corrected path of the library.txt
+	long long			lib_size;		// -1 if there is no library.txt
+	long long			lib_time;
+	bool				parsed;			// entries came from the file, not from the index
+	vector<lib_entry_t>	entries;
+};
+
+typedef map<string, lib_package_t>	lib_index_t;	// by lib_path
+
+#define LIB_INDEX_NAME		"wed_library_index.bin"
+#define LIB_INDEX_MAGIC		"WEDLIBIDX1"
+
+static string lib_index_path(void)
 {
-	res_table.clear();
-	int np = gPackageMgr->CountPackages();
+	string folder = GetCacheFolder();
+	if(folder.empty()) return folder;
+	return folder + DIR_STR LIB_INDEX_NAME;
+}
 
-	for(int p = 0; p < np; ++p)
+struct lib_index_reader {
+	const char * p;
+	const char * e;
+	bool ok;
+
+	lib_index_reader(const char * b, const char * ie) : p(b), e(ie), ok(true) { }
+
+	template<class T> T val(void)
 	{
-		//the physical directory of the scenery pack
-		string pack_base;
-		//Get the pack's physical location
-		gPackageMgr->GetNthPackagePath(p,pack_base);
-		
-		pack_base += DIR_STR "library.txt";
+		T v = T();
+		if(e - p < (ptrdiff_t) sizeof(T)) { ok = false; p = e; return v; }
+		memcpy(&v, p, sizeof(T));
+		p += sizeof(T);
+		return v;
+	}
+	void str(string& s)
+	{
+		int len = val<int>();
+		if(len < 0 || e - p < len) { ok = false; p = e; s.clear(); return; }
+		s.assign(p, len);
+		p += len;
+	}
+};
 
-		bool is_default_pack = gPackageMgr->IsPackageDefault(p);
+struct lib_index_writer {
+	vector<char>	buf;
+
+	template<class T> void val(const T& v) { buf.insert(buf.end(), (const char *) &v, (const char *) &v + sizeof(T)); }
+	void str(const string& s) { val<int>(s.size()); buf.insert(buf.end(), s.begin(), s.end()); }
+};
 
-		//Connects the physical Library.txt to the virual Memory File system? (95% sure) -Ted
-		MFMemFile * lib = MemFile_Open(pack_base.c_str());
+static void lib_index_load(lib_index_t& index)
+{
+	index.clear();
+	string path = lib_index_path();
+	if(path.empty()) return;
 
-		if(lib)
-		{
-			gPackageMgr->GetNthPackagePath(p,pack_base);
-			MFScanner	s;
-			MFS_init(&s, lib);
+	MFMemFile * f = MemFile_Open(path.c_str());
+	if(!f) return;
 
-			int cur_status = status_Public;
-			int lib_version[] = { 800, 0 };
-			
-			if(MFS_xplane_header(&s,lib_version,"LIBRARY",NULL))
-			while(!MFS_done(&s))
+	lib_index_reader r(MemFile_GetBegin(f), MemFile_GetEnd(f));
+	const int magic_len = strlen(LIB_INDEX_MAGIC);
+	if(r.e - r.p >= magic_len && memcmp(r.p, LIB_INDEX_MAGIC, magic_len) == 0)
+	{
+		r.p += magic_len;
+		int np = r.val<int>();
+		for(int n = 0; n < np && r.ok; ++n)
+		{
+			string lib_path;
+			r.str(lib_path);
+			lib_package_t& pack = index[lib_path];
+			pack.lib_path = lib_path;
+			pack.lib_size = r.val<long long>();
+			pack.lib_time = r.val<long long>();
+			pack.parsed = false;
+			int ne = r.val<int>();
+			if(ne < 0) r.ok = false;
+			for(int i = 0; i < ne && r.ok; ++i)
 			{
-				string vpath, rpath;
+				lib_entry_t e;
+				r.str(e.vpath);
+				r.str(e.rpath);
+				e.status = r.val<int>();
+				e.new_until = r.val<int>();
+				e.is_backup = r.val<char>() != 0;
+				pack.entries.push_back(e);
+			}
+		}
+	}
+	MemFile_Close(f);
+	if(!r.ok)
+		index.clear();							// damaged or truncated - just parse everything again
+}
 
-				bool is_export_export  = MFS_string_match(&s,"EXPORT",false);
-				bool is_export_extend  = MFS_string_match(&s,"EXPORT_EXTEND",false);
-				bool is_export_exclude = MFS_string_match(&s,"EXPORT_EXCLUDE",false);
-				bool is_export_backup  = MFS_string_match(&s,"EXPORT_BACKUP",false);
+static void lib_index_save(const vector<lib_package_t>& packs)
+{
+	string path = lib_index_path();
+	if(path.empty()) return;
+
+	lib_index_writer w;
+	w.buf.insert(w.buf.end(), LIB_INDEX_MAGIC, LIB_INDEX_MAGIC + strlen(LIB_INDEX_MAGIC));
+	int np = 0;
+	for(vector<lib_package_t>::const_iterator p = packs.begin(); p != packs.end(); ++p)
+		if(p->lib_size >= 0) ++np;
+	w.val<int>(np);
+	for(vector<lib_package_t>::const_iterator p = packs.begin(); p != packs.end(); ++p)
+	if(p->lib_size >= 0)
+	{
+		w.str(p->lib_path);
+		w.val<long long>(p->lib_size);
+		w.val<long long>(p->lib_time);
+		w.val<int>(p->entries.size());
+		for(vector<lib_entry_t>::const_iterator e = p->entries.begin(); e != p->entries.end(); ++e)
+		{
+			w.str(e->vpath);
+			w.str(e->rpath);
+			w.val<int>(e->status);
+			w.val<int>(e->new_until);
+			w.val<char>(e->is_backup);
+		}
+	}
 
-				if(is_export_export || is_export_extend ||
-				   is_export_exclude || is_export_backup )
-				{
-					MFS_string(&s,&vpath);
-					MFS_string_eol(&s,&rpath);
-					clean_vpath(vpath);
-					clean_rpath(rpath);
-					
-					if (is_no_true_subdir_path(rpath)) break; // ignore paths that lead outside current scenery directory
-					rpath=pack_base+DIR_STR+rpath;
-					FILE_case_correct( (char *) rpath.c_str());  /* yeah - I know I'm overriding the 'const' protection of the c_str() here.
-					   But I know this operation is never going to change the strings length, so thats OK to do.
-					   And I have to case-correct the path right here, as this path later is not only used by the case insensitive MF_open()
-					   but also to derive the paths to the textures referenced in those assets. And those textures are loaded with case-sensitive fopen.	
-					   */
-					AccumResource(vpath, p, rpath, is_export_backup, is_default_pack, cur_status);
-				}
-				else if(MFS_string_match(&s,"EXPORT_RATIO",false))
-				{
-				    double x = MFS_double(&s);
-					MFS_string(&s,&vpath);
-					MFS_string_eol(&s,&rpath);
-					clean_vpath(vpath);
-					clean_rpath(rpath);
-					if (is_no_true_subdir_path(rpath)) break; // ignore paths that lead outside current scenery directory
-					rpath=pack_base+DIR_STR+rpath;
-					FILE_case_correct( (char *) rpath.c_str());  // yeah - I know I'm overriding the 'const' protection of the c_str() here.
-					AccumResource(vpath, p, rpath,false,is_default_pack, cur_status);
-				}
-				else
-				{
-					if(MFS_string_match(&s,"PUBLIC",true))
-					{	
-						cur_status = status_Public;
-						
-						int new_until = 0;
-						new_until = MFS_int(&s);
-						if (new_until > 20170101)
-						{
-							time_t rawtime;
-							struct tm * timeinfo;
-							time (&rawtime);
-							timeinfo = localtime (&rawtime);							
-							int now = 10000 * (timeinfo->tm_year+1900) +100*timeinfo->tm_mon + timeinfo->tm_mday;
-							if (new_until >= now)
-							{
-								cur_status = status_New;
-							}
-						}
-					}
-					else if(MFS_string_match(&s,"PRIVATE",true))    
-						cur_status = status_Private;
-					else if(MFS_string_match(&s,"DEPRECATED",true)) 
-						cur_status = status_Deprecated;
-					else if(MFS_string_match(&s,"SEMI_DEPRECATED",true)) 
-						cur_status = status_Yellow;
-						
-					MFS_string_eol(&s,NULL);
-				}
+	// Write aside and rename, so a second WED starting up never sees half a file.
+	string temp = path + ".tmp";
+	FILE * fi = fopen(temp.c_str(), "wb");
+	if(!fi) return;
+	bool ok = w.buf.empty() || fwrite(&w.buf[0], 1, w.buf.size(), fi) == w.buf.size();
+	ok = (fclose(fi) == 0) && ok;
+	if(ok && FILE_rename_file(temp.c_str(), path.c_str()) != 0)	// windows won't move onto an existing file
+	{
+		FILE_delete_file(path.c_str(), false);
+		ok = FILE_rename_file(temp.c_str(), path.c_str()) == 0;
+	}
+	if(!ok)
+		FILE_delete_file(temp.c_str(), false);
+}
+
+// Parses one library.txt into pack.entries - this runs on a worker thread, so it may not touch the library or package manager.
+static void lib_parse_package(lib_package_t& pack)
+{
+	MFMemFile * lib = MemFile_Open(pack.lib_path.c_str());
+	if(!lib) return;
+
+	MFScanner	s;
+	MFS_init(&s, lib);
+
+	int cur_status = status_Public;
+	int cur_new_until = 0;
+	int lib_version[] = { 800, 0 };
+
+	if(MFS_xplane_header(&s,lib_version,"LIBRARY",NULL))
+	while(!MFS_done(&s))
+	{
+		lib_entry_t e;
+
+		bool is_export_export  = MFS_string_match(&s,"EXPORT",false);
+		bool is_export_extend  = MFS_string_match(&s,"EXPORT_EXTEND",false);
+		bool is_export_exclude = MFS_string_match(&s,"EXPORT_EXCLUDE",false);
+		bool is_export_backup  = MFS_string_match(&s,"EXPORT_BACKUP",false);
+		bool is_export_ratio   = false;
+
+		if(!(is_export_export || is_export_extend || is_export_exclude || is_export_backup))
+			if((is_export_ratio = MFS_string_match(&s,"EXPORT_RATIO",false)))
+				MFS_double(&s);
+
+		if(is_export_export || is_export_extend || is_export_exclude || is_export_backup || is_export_ratio)
+		{
+			MFS_string(&s,&e.vpath);
+			MFS_string_eol(&s,&e.rpath);
+			clean_vpath(e.vpath);
+			clean_rpath(e.rpath);
+
+			if (is_no_true_subdir_path(e.rpath)) break; // ignore paths that lead outside current scenery directory
+			e.rpath=pack.pack_base+DIR_STR+e.rpath;
+			FILE_case_correct( (char *) e.rpath.c_str());  /* yeah - I know I'm overriding the 'const' protection of the c_str() here.
+			   But I know this operation is never going to change the strings length, so thats OK to do.
+			   And I have to case-correct the path right here, as this path later is not only used by the case insensitive MF_open()
+			   but also to derive the paths to the textures referenced in those assets. And those textures are loaded with case-sensitive fopen.
+			   */
+			e.status = cur_status;
+			e.new_until = (cur_status == status_Public) ? cur_new_until : 0;
+			e.is_backup = is_export_backup;
+			pack.entries.push_back(e);
+		}
+		else
+		{
+			if(MFS_string_match(&s,"PUBLIC",true))
+			{
+				cur_status = status_Public;
+				cur_new_until = MFS_int(&s);
+				if (cur_new_until <= 20170101)
+					cur_new_until = 0;
 			}
-			MemFile_Close(lib);
+			else if(MFS_string_match(&s,"PRIVATE",true))
+				cur_status = status_Private;
+			else if(MFS_string_match(&s,"DEPRECATED",true))
+				cur_status = status_Deprecated;
+			else if(MFS_string_match(&s,"SEMI_DEPRECATED",true))
+				cur_status = status_Yellow;
+
+			MFS_string_eol(&s,NULL);
 		}
 	}
+	MemFile_Close(lib);
+}
+
+struct lib_scan_job {
+	vector<lib_package_t> *	packs;
+	const lib_index_t *		index;
+
+	void operator()(int n)
+	{
+		lib_package_t& pack = (*packs)[n];
+		pack.lib_path = pack.pack_base + DIR_STR "library.txt";
+		FILE_case_correct((char *) pack.lib_path.c_str());
+		pack.lib_size = -1;
+		pack.lib_time = 0;
+		pack.parsed = false;
+
+		struct stat info;
+		if(FILE_get_file_meta_data(pack.lib_path, info) != 0)
+			return;
+		pack.lib_size = info.st_size;
+		pack.lib_time = info.st_mtime;
+
+		lib_index_t::const_iterator i = index->find(pack.lib_path);
+		if(i != index->end() && i->second.lib_size == pack.lib_size && i->second.lib_time == pack.lib_time)
+		{
+			// The art can be renamed without touching library.txt, so the cached case-corrections may be stale - redo them.
+			// For a path that still matches that is just a stat, and FILE_case_correct is a no-op off Linux.
+			pack.entries = i->second.entries;
+			for(vector<lib_entry_t>::iterator e = pack.entries.begin(); e != pack.entries.end(); ++e)
+				FILE_case_correct((char *) e->rpath.c_str());
+		}
+		else
+		{
+			lib_parse_package(pack);
+			pack.parsed = true;
+		}
+	}
+};
+
+void		WED_LibraryMgr::Rescan()
+{
+	res_table.clear();
+	int np = gPackageMgr->CountPackages();
+
+	vector<lib_package_t> packs(np);
+	for(int p = 0; p < np; ++p)
+		gPackageMgr->GetNthPackagePath(p,packs[p].pack_base);	//the physical directory of the scenery pack
+
+	lib_index_t index;
+	lib_index_load(index);
+
+	lib_scan_job job;
+	job.packs = &packs;
+	job.index = &index;
+	ParallelFor(np, job);
+
+	time_t rawtime;
+	struct tm * timeinfo;
+	time (&rawtime);
+	timeinfo = localtime (&rawtime);
+	int now = 10000 * (timeinfo->tm_year+1900) +100*timeinfo->tm_mon + timeinfo->tm_mday;
+
+	bool index_dirty = false;
+	int index_used = 0;
+	for(int p = 0; p < np; ++p)
+	{
+		const lib_package_t& pack = packs[p];
+		bool is_default_pack = gPackageMgr->IsPackageDefault(p);
+		for(vector<lib_entry_t>::const_iterator e = pack.entries.begin(); e != pack.entries.end(); ++e)
+		{
+			int status = e->status;
+			if (e->new_until && e->new_until >= now)
+				status = status_New;
+			AccumResource(e->vpath, p, e->rpath, e->is_backup, is_default_pack, status);
+		}
+		if(pack.parsed) index_dirty = true;
+		else if(pack.lib_size >= 0) ++index_used;
+	}
+	if(index_dirty || index_used != (int) index.size())
+		lib_index_save(packs);
+
 	RescanLines();
 
 	string package_base;
@@ -403,12 +616,12 @@ void WED_LibraryMgr::RescanLines()
 	default_lines.clear();
 	
 	res_map_t::iterator m = res_table.begin();
-	while(m != res_table.end() && m->first.find("lib/airport/lines/",0) == string::npos )
+	while(m != res_table.end() && m->first.path.find("lib/airport/lines/",0) == string::npos )
 		++m;
 
-	while(m != res_table.end() && m->first.find("lib/airport/lines/",0) != string::npos )
+	while(m != res_table.end() && m->first.path.find("lib/airport/lines/",0) != string::npos )
 	{
-		string resnam(m->first);
+		string resnam(m->first.path);
 		resnam.erase(0,strlen("lib/airport/lines/"));
 
 		if(resnam[0] >= '0' && resnam[0] <= '9' &&
@@ -442,7 +655,7 @@ void WED_LibraryMgr::RescanLines()
 			
 			if(linetype > 0 && linetype < 100)
 			{
-				default_lines[linetype] = m->first;
+				default_lines[linetype] = m->first.path;
 				if(existing_line_types.count(linetype) == 0)
 				{
 					const char * icon = "line_Unknown";
@@ -450,7 +663,7 @@ void WED_LibraryMgr::RescanLines()
 #if 0
 					// that would be nice - but we can't parse the .lin statement here, the ResourceMgr isn't available
 					lin_info_t linfo;
-					if (rmgr->GetLin(m->first,linfo))
+					if (rmgr->GetLin(m->first.path,linfo))
 					{
 						// determine Chroma & Hue for the preview color line
 						float R = linfo.rgb[0], G = linfo.rgb[1], B = linfo.rgb[2];
@@ -512,12 +725,12 @@ void WED_LibraryMgr::RescanLines()
 	}
 	
 	m=res_table.begin();
-	while(m != res_table.end() && m->first.find("lib/airport/lights/slow/",0) == string::npos )
+	while(m != res_table.end() && m->first.path.find("lib/airport/lights/slow/",0) == string::npos )
 		++m;
 
-	while(m != res_table.end() && m->first.find("lib/airport/lights/slow/",0) != string::npos )
+	while(m != res_table.end() && m->first.path.find("lib/airport/lights/slow/",0) != string::npos )
 	{
-		string resnam(m->first);
+		string resnam(m->first.path);
 		resnam.erase(0,strlen("lib/airport/lights/slow/"));
 
 		if(resnam[0] >= '0' && resnam[0] <= '9' &&
@@ -548,7 +761,7 @@ void WED_LibraryMgr::RescanLines()
 			
 			if(lighttype > 100 && lighttype < 200)
 			{
-				default_lines[lighttype] = m->first;
+				default_lines[lighttype] = m->first.path;
 				if(existing_line_types.count(lighttype) == 0)
 				{
 					const char * icon = "line_Unknown";
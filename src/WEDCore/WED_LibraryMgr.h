@@ -118,40 +118,43 @@ private:
 	// all leading digits are treated as a number - so 3a.lin is listed after 20a.lin, aka numeric order.
 	// If two start with the same number (e.g. 01, 001 and 1) - its normal lexicographic order again.
 	// e.g.  0  00  01aa  1aa  009x 10aa 10bb  aa  bb
+	//
+	// The table is keyed by the path plus everything that ordering needs - lower-cased text, where the
+	// base name starts and its leading number - worked out once when the key is made, so a comparison
+	// is just a couple of byte compares.
+
+	struct res_key_t {
+		res_key_t(const string& p);
+
+		string		path;			// the vpath as given
+		string		lower;			// lower-cased, for case-insensitive compares
+		int			slash;			// position of the last '/', -1 if there is none
+		bool		starts_digit;	// base name begins with 0-9
+		bool		has_num;		// base name parses as an integer (num)
+		int			num;
+	};
 
-	struct compare_str_no_case {
-		bool operator()(const string& lhs, const string& rhs) const {
-			string::size_type pl = lhs.find_last_of('/') ;
-			string::size_type pr = rhs.find_last_of('/') ;
-
-			if(pl == pr)
+	struct compare_res_key {
+		bool operator()(const res_key_t& lhs, const res_key_t& rhs) const {
+			if(lhs.slash == rhs.slash)
 			{
-				if(pl == string::npos)
-					pl = 0;
-				else
+				int pl = 0;
+				if(lhs.slash >= 0)
 				{
-					int path_cmp = strncasecmp(lhs.c_str(),rhs.c_str(),pl);
+					int path_cmp = memcmp(lhs.lower.c_str(), rhs.lower.c_str(), lhs.slash);
 					if(path_cmp != 0) return path_cmp < 0;
-					pl += 1;
-				}
-				const char * l = lhs.c_str() + pl;
-				const char * r = rhs.c_str() + pl;
-
-				if((*l >= '0' && *l <= '9') || (*r >= '0' && *r <= '9'))
-				{
-					int int_l, int_r;
-					if(sscanf(l,"%d",&int_l) > 0)
-						if(sscanf(r,"%d",&int_r) > 0)
-							if(int_l != int_r)
-								return int_l < int_r;
+					pl = lhs.slash + 1;
 				}
-				return strcasecmp(l,r) < 0;
+				if(lhs.starts_digit || rhs.starts_digit)
+					if(lhs.has_num && rhs.has_num && lhs.num != rhs.num)
+						return lhs.num < rhs.num;
+				return strcmp(lhs.lower.c_str() + pl, rhs.lower.c_str() + pl) < 0;
 			}
-			return strcasecmp(lhs.c_str(),rhs.c_str()) < 0;
+			return strcmp(lhs.lower.c_str(), rhs.lower.c_str()) < 0;
 		}
 	};
 
-	typedef map<string,res_info_t,compare_str_no_case>	res_map_t;
+	typedef map<res_key_t,res_info_t,compare_res_key>	res_map_t;
 	res_map_t			res_table;
 
 	string				local_package;
@@ -45,7 +45,9 @@ enum {
 	msg_SystemFolderChanged,
 	msg_SystemFolderUpdated,
 
-	msg_LibraryChanged
+	msg_LibraryChanged,
+
+	msg_TexturesLoaded						// Sent by the texture manager when background decodes finished - views should redraw
 
 #if WITHNWLINK
 	,msg_NetworkStatusInfo
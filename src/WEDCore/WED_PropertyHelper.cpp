@@ -32,6 +32,7 @@
 #include "MathUtils.h"
 #include "XESConstants.h"
 #include <algorithm>
+#include <typeinfo>
 
 inline int remap(const map<int,int>& m, int v)
 {
@@ -102,24 +103,95 @@ void		WED_PropertyHelper::PropsToXML(WED_XMLElement * parent)
 }
 
 
+// Every instance of a given helper sub-class registers the same property items in the same order, and
+// whether an item takes an element or attribute depends only on its title.  So the first time a class
+// sees a given element (or element/attribute pair) we do the linear scan over mItems and remember which
+// item took it (or -1 for none); after that the lookup goes straight to that item.  Keys are the exact
+// case of the XML; a differently-cased spelling just gets its own entry.
+struct	WED_PropertyDispatch {
+	hash_map<string, int>	elements;
+	hash_map<string, int>	attributes;
+};
+
+struct	type_info_less {
+	bool operator()(const type_info * a, const type_info * b) const { return a->before(*b); }
+};
+
+typedef map<const type_info *, WED_PropertyDispatch, type_info_less>	PropertyDispatchMap;
+
+// The dispatch state for the load in progress - ResetXMLDispatch empties it between loads.
+static PropertyDispatchMap		s_dispatch_tables;
+static const type_info *		s_dispatch_last_cls = NULL;
+static WED_PropertyDispatch *	s_dispatch_last_table = NULL;
+static string					s_dispatch_key;				// Scratch element/attribute key, kept to save an allocation per attribute.
+
+static WED_PropertyDispatch *	dispatch_for_class(const type_info& cls)
+{
+	// Loads tend to hit long runs of the same class, so don't even go to the map for those.
+	if(s_dispatch_last_cls == NULL || *s_dispatch_last_cls != cls)
+	{
+		s_dispatch_last_cls = &cls;
+		s_dispatch_last_table = &s_dispatch_tables[&cls];
+	}
+	return s_dispatch_last_table;
+}
+
+void		WED_PropertyHelper::ResetXMLDispatch(void)
+{
+	s_dispatch_tables.clear();
+	s_dispatch_last_cls = NULL;
+	s_dispatch_last_table = NULL;
+}
+
 void		WED_PropertyHelper::StartElement(
 								WED_XMLReader * reader,
 								const XML_Char *	name,
 								const XML_Char **	atts)
 {
+	WED_PropertyDispatch * table = dispatch_for_class(typeid(*this));
 	int n;
-	for(n = 0; n < mItems.size(); ++n)
-	if(mItems[n]->WantsElement(reader,name))
-		return;
 
+	hash_map<string, int>::iterator ei = table->elements.find(name);
+	if(ei == table->elements.end())
+	{
+		for(n = 0; n < mItems.size(); ++n)
+		if(mItems[n]->WantsElement(reader,name))
+			break;
+		table->elements[name] = n < mItems.size() ? n : -1;
+		if(n < mItems.size())
+			return;
+	}
+	else if(ei->second >= 0)
+	{
+		DebugAssert(ei->second < mItems.size());
+		if(mItems[ei->second]->WantsElement(reader,name))
+			return;
+	}
+
+	string& key(s_dispatch_key);
 	while(*atts)
 	{
 		const XML_Char * k = *atts++;
 		const XML_Char * v = *atts++;
-		for(n = 0; n < mItems.size(); ++n)
-		if(mItems[n]->WantsAttribute(name,k,v))
-			break;
-	}		
+
+		key.assign(name);
+		key.push_back(0);
+		key.append(k);
+
+		hash_map<string, int>::iterator ai = table->attributes.find(key);
+		if(ai == table->attributes.end())
+		{
+			for(n = 0; n < mItems.size(); ++n)
+			if(mItems[n]->WantsAttribute(name,k,v))
+				break;
+			table->attributes[key] = n < mItems.size() ? n : -1;
+		}
+		else if(ai->second >= 0)
+		{
+			DebugAssert(ai->second < mItems.size());
+			mItems[ai->second]->WantsAttribute(name,k,v);
+		}
+	}
 }
 
 void		WED_PropertyHelper::EndElement(void)
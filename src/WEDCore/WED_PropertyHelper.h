@@ -108,6 +108,10 @@ public:
 	virtual	void		EndElement(void);
 	virtual	void		PopHandler(void);
 
+	// StartElement remembers which item takes each element and attribute, per class.  Call this before
+	// each XML load so that nothing learned from one file carries over to the next.
+	static	void		ResetXMLDispatch(void);
+
 	// This is virtual so remappers like WED_Runway can "fix" the results
 	virtual	int			PropertyItemNumber(const WED_PropertyItem * item) const;
 private:
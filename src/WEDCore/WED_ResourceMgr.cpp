@@ -34,6 +34,32 @@
 #include "WED_PackageMgr.h"
 #include "CompGeomDefs2.h"
 #include "MathUtils.h"
+#include "GUI_Prefs.h"
+
+// Preview memory in MB; can be overridden with resource_memory_mb in the [preferences] section.
+#define DEFAULT_RESOURCE_BUDGET_MB "256"
+// Delay between going over budget and trimming - the trim must not run inside a draw.
+#define TRIM_DELAY 0.5
+
+// A rough size of an OBJ's geometry - good enough to weigh one preview against another.
+static size_t obj_bytes(const XObj8 * obj)
+{
+	size_t bytes = sizeof(XObj8) + obj->indices.size() * sizeof(int);
+	bytes += (size_t) obj->geo_tri.count()    * 8 * sizeof(float);
+	bytes += (size_t) obj->geo_lines.count()  * 6 * sizeof(float);
+	bytes += (size_t) obj->geo_lights.count() * 6 * sizeof(float);
+	for(vector<XObjLOD8>::const_iterator l = obj->lods.begin(); l != obj->lods.end(); ++l)
+		bytes += l->cmds.size() * sizeof(XObjCmd8);
+	return bytes;
+}
+
+static size_t obj_bytes(const vector<XObj8 *>& objs)
+{
+	size_t bytes = 0;
+	for(vector<XObj8 *>::const_iterator o = objs.begin(); o != objs.end(); ++o)
+		bytes += obj_bytes(*o);
+	return bytes;
+}
 
 static void process_texture_path(const string& path_of_obj, string& path_of_tex)
 {
@@ -49,12 +75,15 @@ static void process_texture_path(const string& path_of_obj, string& path_of_tex)
 	path_of_tex = parent + ".bmp";
 }
 
-WED_ResourceMgr::WED_ResourceMgr(WED_LibraryMgr * in_library) : mLibrary(in_library)
+WED_ResourceMgr::WED_ResourceMgr(WED_LibraryMgr * in_library) : mLibrary(in_library), mLRUBytes(0), mTrimPending(false)
 {
+	int mb = atoi(GUI_GetPrefString("preferences","resource_memory_mb",DEFAULT_RESOURCE_BUDGET_MB));
+	mLRUBudget = (size_t) max(mb, 1) * 1024 * 1024;
 }
 
 WED_ResourceMgr::~WED_ResourceMgr()
 {
+	Stop();
 	Purge();
 }
 
@@ -79,6 +108,95 @@ void	WED_ResourceMgr::Purge(void)
 	mFor.clear();
 	mFac.clear();
 	mStr.clear();
+
+	mLRU.clear();
+	mLRUIndex.clear();
+	mLRUBytes = 0;
+}
+
+void	WED_ResourceMgr::TouchLRU(const string& key)
+{
+	map<const string *, lru_list_t::iterator>::iterator i = mLRUIndex.find(&key);
+	if(i != mLRUIndex.end() && i->second != mLRU.begin())
+		mLRU.splice(mLRU.begin(), mLRU, i->second);
+}
+
+void	WED_ResourceMgr::AddLRU(int kind, const string& key, size_t bytes)
+{
+	map<const string *, lru_list_t::iterator>::iterator i = mLRUIndex.find(&key);
+	if(i == mLRUIndex.end())
+	{
+		lru_entry_t e;
+		e.kind = kind;
+		e.key = &key;
+		e.bytes = 0;
+		mLRU.push_front(e);
+		i = mLRUIndex.insert(pair<const string *, lru_list_t::iterator>(&key, mLRU.begin())).first;
+	}
+	else
+		mLRU.splice(mLRU.begin(), mLRU, i->second);
+
+	i->second->bytes += bytes;
+	mLRUBytes += bytes;
+
+	if(mLRUBytes > mLRUBudget && !mTrimPending)
+	{
+		mTrimPending = true;
+		Start(TRIM_DELAY);
+	}
+}
+
+void	WED_ResourceMgr::Evict(const lru_entry_t& e)
+{
+	string key(*e.key);		// e.key points into the map entry we are about to erase
+	switch(e.kind) {
+	case lru_Obj:
+		{
+			map<string, vector<XObj8 *> >::iterator i = mObj.find(key);
+			for(vector<XObj8 *>::iterator j = i->second.begin(); j != i->second.end(); ++j)
+				delete *j;
+			mObj.erase(i);
+		}
+		break;
+	case lru_Fac:
+		{
+			map<string, vector<fac_info_t> >::iterator i = mFac.find(key);
+			for(vector<fac_info_t>::iterator j = i->second.begin(); j != i->second.end(); ++j)
+				for(vector<XObj8 *>::iterator k = j->previews.begin(); k != j->previews.end(); ++k)
+					delete *k;
+			mFac.erase(i);
+		}
+		break;
+	case lru_Str:
+		{
+			map<string, str_info_t>::iterator i = mStr.find(key);
+			for(vector<XObj8 *>::iterator j = i->second.previews.begin(); j != i->second.previews.end(); ++j)
+				delete *j;
+			mStr.erase(i);
+		}
+		break;
+	case lru_For:
+		{
+			map<string, XObj8 *>::iterator i = mFor.find(key);
+			delete i->second;
+			mFor.erase(i);
+		}
+		break;
+	}
+}
+
+void	WED_ResourceMgr::TimerFired(void)
+{
+	Stop();
+	mTrimPending = false;
+	while(mLRUBytes > mLRUBudget && !mLRU.empty())
+	{
+		lru_entry_t e = mLRU.back();
+		mLRU.pop_back();
+		mLRUIndex.erase(e.key);
+		mLRUBytes -= e.bytes;
+		Evict(e);
+	}
 }
 
 int		WED_ResourceMgr::GetNumVariants(const string& path)
@@ -125,8 +243,10 @@ bool	WED_ResourceMgr::GetObjRelative(const string& obj_path, const string& paren
 	else
 		obj->texture_draped = obj->texture;
 
-	mObj[lib_key].push_back(obj);
-	
+	map<string,vector<XObj8 *> >::iterator o = mObj.insert(pair<const string, vector<XObj8 *> >(lib_key, vector<XObj8 *>())).first;
+	o->second.push_back(obj);
+	AddLRU(lru_Obj, o->first, obj_bytes(obj));
+
 	return true;
 }
 
@@ -138,6 +258,7 @@ bool	WED_ResourceMgr::GetObj(const string& path, XObj8 *& obj, int variant)
 	{
 		DebugAssert(variant < i->second.size());
 		obj = i->second[variant];
+		TouchLRU(i->first);
 		return true;
 	}
 		
@@ -172,7 +293,9 @@ bool	WED_ResourceMgr::GetObj(const string& path, XObj8 *& obj, int variant)
 		else
 			obj->texture_draped = obj->texture;
 
-		mObj[path].push_back(obj);
+		map<string,vector<XObj8 *> >::iterator o = mObj.insert(pair<const string, vector<XObj8 *> >(path, vector<XObj8 *>())).first;
+		o->second.push_back(obj);
+		AddLRU(lru_Obj, o->first, obj_bytes(obj));
 	}
 
 	return true;
@@ -295,6 +418,7 @@ bool	WED_ResourceMgr::GetStr(const string& path, str_info_t& out_info)
 	if(i != mStr.end())
 	{
 		out_info = i->second;
+		TouchLRU(i->first);
 		return true;
 	}
 
@@ -364,7 +488,8 @@ bool	WED_ResourceMgr::GetStr(const string& path, str_info_t& out_info)
 		MFS_string_eol(&s,NULL);
 	}
 	MemFile_Close(str);
-	mStr[path] = out_info;
+	i = mStr.insert(pair<const string, str_info_t>(path, out_info)).first;
+	AddLRU(lru_Str, i->first, obj_bytes(out_info.previews));
 	return true;
 }
 
@@ -507,6 +632,7 @@ bool	WED_ResourceMgr::GetFac(const string& path, fac_info_t& out_info, int varia
 //printf("OLD FAC p=%s, v=%d, nv=%d\n",path.c_str(),variant, (int) i->second.size());
 		DebugAssert(variant < i->second.size());
 		out_info = i->second[variant];
+		TouchLRU(i->first);
 		return true;
 	}
 
@@ -711,7 +837,9 @@ bool	WED_ResourceMgr::GetFac(const string& path, fac_info_t& out_info, int varia
 		WED_MakeFacadePreview(out_info, wall, wall_tex, roof_uv, roof_tex);
 
 		if (no_roof_mesh) out_info.roof = false;
-		mFac[path].push_back(out_info);
+		i = mFac.insert(pair<const string, vector<fac_info_t> >(path, vector<fac_info_t>())).first;
+		i->second.push_back(out_info);
+		AddLRU(lru_Fac, i->first, obj_bytes(out_info.previews));
 	}
 	
 	out_info = mFac[path].front();
@@ -747,6 +875,7 @@ bool	WED_ResourceMgr::GetFor(const string& path,  XObj8 *& obj)
 	if(i != mFor.end())
 	{
 		obj = i->second;
+		TouchLRU(i->first);
 		return true;
 	}
 	
@@ -934,7 +1063,8 @@ bool	WED_ResourceMgr::GetFor(const string& path,  XObj8 *& obj)
 	cmd.idx_count  = 6*quads;
 	obj->lods.back().cmds.push_back(cmd);
 
-	mFor[path] = obj;
+	i = mFor.insert(pair<const string, XObj8 *>(path, obj)).first;
+	AddLRU(lru_For, i->first, obj_bytes(obj));
     // only problem is that the texture path contain spaces -> obj reader can not read that
     // but still valuable for checking the values/structure
 //    XObj8Write(mLibrary->CreateLocalResourcePath("forest_preview.obj").c_str(), *obj);
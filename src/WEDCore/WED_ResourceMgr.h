@@ -42,13 +42,22 @@
 	it's also definitely not very dangerous at this point in the code's development - that is, WED is not so big that this
 	represents a scalability issue.
 
+	MEMORY
+
+	OBJ, FAC, STR and FOR previews carry real geometry, so those caches are kept in an LRU with a byte budget
+	(resource_memory_mb in the preferences).  Callers never keep the XObj8 pointers past the current draw, but
+	they do hold them during it - so trimming is only ever done from a timer, never while a Get call is running.
+	POL, LIN, AGP and road info are small and stay cached until the library changes.
+
 */
 
 #include "GUI_Listener.h"
 #include "GUI_Broadcaster.h"
+#include "GUI_Timer.h"
 #include "IBase.h"
 #include "XObjDefs.h"
 #include "CompGeomDefs2.h"
+#include <list>
 
 class	WED_LibraryMgr;
 
@@ -123,7 +132,7 @@ struct agp_t {
 #endif
 
 
-class WED_ResourceMgr : public GUI_Broadcaster, public GUI_Listener, public virtual IBase {
+class WED_ResourceMgr : public GUI_Broadcaster, public GUI_Listener, public GUI_Timer, public virtual IBase {
 public:
 
 					 WED_ResourceMgr(WED_LibraryMgr * in_library);
@@ -154,7 +163,22 @@ public:
 							intptr_t				inMsg,
 							intptr_t				inParam);
 
+	virtual	void	TimerFired(void);
+
 private:
+
+	enum { lru_Obj, lru_Fac, lru_Str, lru_For };
+
+	struct lru_entry_t {
+		int				kind;
+		const string *	key;		// the key string inside the cache map - stable while the entry exists
+		size_t			bytes;
+	};
+	typedef list<lru_entry_t>	lru_list_t;
+
+			void	TouchLRU(const string& key);
+			void	AddLRU(int kind, const string& key, size_t bytes);
+			void	Evict(const lru_entry_t& e);
 	
 	map<string,vector<fac_info_t> > mFac;
 	map<string,pol_info_t>		mPol;
@@ -168,6 +192,12 @@ private:
 	map<string,road_info_t>		mRoad;
 #endif	
 	WED_LibraryMgr *			mLibrary;
+
+	lru_list_t					mLRU;			// most recently used first
+	map<const string *, lru_list_t::iterator>	mLRUIndex;
+	size_t						mLRUBytes;
+	size_t						mLRUBudget;
+	bool						mTrimPending;
 };	
 
 #endif /* WED_ResourceMgr_H */
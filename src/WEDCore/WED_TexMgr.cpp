@@ -26,6 +26,9 @@
 #include "MemFileUtils.h"
 #include "TexUtils.h"
 #include "WED_PackageMgr.h"
+#include "WED_Messages.h"
+#include "GUI_Prefs.h"
+#include "ParallelUtils.h"
 
 #if APL
 	#include <OpenGL/gl.h>
@@ -33,18 +36,59 @@
 	#include <GL/gl.h>
 #endif
 
-WED_TexMgr::WED_TexMgr(const string& package) : mPackage(package)
+// Texture memory in MB; can be overridden with texture_memory_mb in the [preferences] section.
+#define DEFAULT_TEXTURE_BUDGET_MB "512"
+// A texture drawn within this many seconds is never evicted.
+#define EVICT_MIN_AGE 3
+// How often the queue is polled while decodes are outstanding or we are over budget.  Decoded images wait in
+// memory until a poll has seen them and the redraw has uploaded them, so keep this near a frame.
+#define POLL_INTERVAL 0.02
+
+// One image decode.  The worker only touches the job - the TexInfo is updated by FinishLoads on the UI thread.
+struct	WED_TexMgr::TexJob : public ParallelQueueJob {
+	TexInfo *	info;
+	string		fpath;
+	ImageInfo	im;
+	int			res;
+
+	virtual	void operator()()
+	{
+		im.data = NULL;
+		res = MakeSupportedType(fpath.c_str(), &im);
+	}
+};
+
+WED_TexMgr::WED_TexMgr(const string& package) : mPackage(package), mQueue(NULL), mPolling(false), mBytes(0)
 {
+	int mb = atoi(GUI_GetPrefString("preferences","texture_memory_mb",DEFAULT_TEXTURE_BUDGET_MB));
+	mByteBudget = (size_t) max(mb, 1) * 1024 * 1024;
+	// Leave a core to the UI - it is still drawing while we decode.
+	mQueue = new ParallelQueue(max(ParallelWorkerCount() - 1, 1));
 }
 
 WED_TexMgr::~WED_TexMgr()
 {
+	Stop();
+	delete mQueue;		// waits for running decodes - after this no worker touches the jobs
 	for(map<string,TexInfo *>::iterator t = mTexes.begin(); t != mTexes.end(); ++t)
 	{
-		GLuint id = t->second->tex_id;
-		glDeleteTextures(1, &id);
+		if(t->second->job)
+		{
+			if(t->second->job->im.data) free(t->second->job->im.data);
+			delete t->second->job;
+		}
+		if(t->second->tex_id)
+		{
+			GLuint id = t->second->tex_id;
+			glDeleteTextures(1, &id);
+		}
 		delete t->second;
 	}
+	for(vector<int>::iterator e = mEvicted.begin(); e != mEvicted.end(); ++e)
+	{
+		GLuint id = *e;
+		glDeleteTextures(1, &id);
+	}
 }
 
 TexRef		WED_TexMgr::LookupTexture(const char * path, bool is_absolute, int flags)
@@ -52,14 +96,30 @@ TexRef		WED_TexMgr::LookupTexture(const char * path, bool is_absolute, int flags
 	TexMap::iterator i = mTexes.find(path);
 	if (i == mTexes.end())
 	{
-		return LoadTexture(path, is_absolute,flags);
+		TexInfo * inf = new TexInfo;
+		inf->tex_id = 0;
+		inf->vis_x = inf->vis_y = inf->act_x = inf->act_y = inf->org_x = inf->org_y = 1;
+		inf->flags = flags;
+		inf->fpath = is_absolute ? path : gPackageMgr->ComputePath(mPackage, path);
+		inf->bytes = 0;
+		inf->last_use = time(NULL);
+		inf->job = NULL;
+		mTexes[path] = inf;
+		QueueLoad(inf);
+		return inf;
 	}
+	if(i->second->state == state_Failed)
+		return NULL;
 	return i->second;
 }
 
+// The draw path - the only place we upload or delete GL textures.
 int			WED_TexMgr::GetTexID(TexRef ref)
 {
-	return ((TexInfo *) ref)->tex_id;
+	FinishLoads();
+	TexInfo * i = (TexInfo *) ref;
+	Use(i);
+	return i->tex_id;
 }
 
 void		WED_TexMgr::GetTexInfo(
@@ -80,60 +140,135 @@ void		WED_TexMgr::GetTexInfo(
 	if (org_y) *org_y = i->org_y;
 }
 
-WED_TexMgr::TexInfo *	WED_TexMgr::LoadTexture(const char * path, bool is_absolute, int flags)
+void		WED_TexMgr::TimerFired(void)
 {
-	string fpath;
+	// Only tell the views - the upload itself happens in their draw code, where the GL context is current.
+	int	waiting = mDone.size();
+	CollectDone();
+	if((int) mDone.size() > waiting)
+		BroadcastMessage(msg_TexturesLoaded, 0);
 
-	fpath = is_absolute ? path : gPackageMgr->ComputePath(mPackage, path);
-
-	TexInfo * inf = new TexInfo;
-
-	ImageInfo	im;
+	TrimToBudget();
 
-/*
-	MFMemFile * dds_file;
-	dds_file = MemFile_Open(path);
-	if(dds_file)
+	if(mQueue->CountPending() == 0 && mBytes <= mByteBudget)
 	{
-		if (LoadTextureFromDDS((unsigned const char *) MemFile_GetBegin(dds_file),(unsigned const char *) MemFile_GetEnd(dds_file),tn,0,&inf->act_x, &inf->act_y))
-		{
-			inf->tex_id = tn;
-			inf->org_x = inf->vis_x = inf->act_x;
-			inf->org_y = inf->vis_y = inf->act_y;
-			MemFile_Close(dds_file);
-			return inf;
-		}
-		MemFile_Close(dds_file);
+		Stop();
+		mPolling = false;
 	}
-*/
-	int res = MakeSupportedType(fpath.c_str(),&im);
-	if(res != 0)
+}
+
+void		WED_TexMgr::QueueLoad(TexInfo * inf)
+{
+	inf->state = state_Queued;
+	inf->job = new TexJob;
+	inf->job->info = inf;
+	inf->job->fpath = inf->fpath;
+	inf->job->im.data = NULL;
+	inf->job->res = -1;
+	mQueue->Push(inf->job);
+	StartPolling();
+}
+
+void		WED_TexMgr::StartPolling(void)
+{
+	if(!mPolling)
 	{
-		delete inf;
-		return NULL;
+		Start(POLL_INTERVAL);
+		mPolling = true;
 	}
+}
 
-	GLuint tn;
-	glGenTextures(1,&tn);
+void		WED_TexMgr::CollectDone(void)
+{
+	vector<ParallelQueueJob *> done;
+	mQueue->PopDone(done);
+	for(vector<ParallelQueueJob *>::iterator d = done.begin(); d != done.end(); ++d)
+		mDone.push_back(static_cast<TexJob *>(*d));
+}
 
-	inf->tex_id = tn;
-	inf->org_x = im.width;
-	inf->org_y = im.height;
+void		WED_TexMgr::Use(TexInfo * inf)
+{
+	inf->last_use = time(NULL);
+	if(inf->state == state_Evicted)
+		QueueLoad(inf);
+}
 
-	float s,t;
-	if (!LoadTextureFromImage(im, tn, flags, &inf->act_x, &inf->act_y, &s,&t))
+void		WED_TexMgr::FinishLoads(void)
+{
+	for(vector<int>::iterator e = mEvicted.begin(); e != mEvicted.end(); ++e)
 	{
-		delete inf;
-		if (im.data) free(im.data);
-		return NULL;
+		GLuint id = *e;
+		glDeleteTextures(1, &id);
 	}
+	mEvicted.clear();
 
-	inf->vis_x = (float) inf->act_x * s;
-	inf->vis_y = (float) inf->act_y * t;
+	CollectDone();
+	if(mDone.empty())
+		return;
 
-	mTexes[path] = inf;
-	// janos says: im.data caused a _big_ memory leak :-)
-	if (im.data) free(im.data);
-	return inf;
+	for(vector<TexJob *>::iterator d = mDone.begin(); d != mDone.end(); ++d)
+	{
+		TexJob * job = *d;
+		TexInfo * inf = job->info;
+		inf->job = NULL;
+
+		if(job->res != 0)
+			inf->state = state_Failed;
+		else
+		{
+			GLuint tn;
+			glGenTextures(1,&tn);
+
+			int act_x, act_y;
+			float s,t;
+			if (!LoadTextureFromImage(job->im, tn, inf->flags, &act_x, &act_y, &s,&t))
+			{
+				glDeleteTextures(1, &tn);
+				inf->state = state_Failed;
+			}
+			else
+			{
+				inf->tex_id = tn;
+				inf->org_x = job->im.width;
+				inf->org_y = job->im.height;
+				inf->act_x = act_x;
+				inf->act_y = act_y;
+				inf->vis_x = (float) act_x * s;
+				inf->vis_y = (float) act_y * t;
+				inf->bytes = (size_t) act_x * act_y * 4;
+				if(inf->flags & tex_Mipmap) inf->bytes += inf->bytes / 3;
+				inf->state = state_Loaded;
+				mBytes += inf->bytes;
+			}
+		}
+		// janos says: im.data caused a _big_ memory leak :-)
+		if (job->im.data) free(job->im.data);
+		delete job;
+	}
+	mDone.clear();
+	if(mBytes > mByteBudget)
+		StartPolling();
 }
 
+void		WED_TexMgr::TrimToBudget(void)
+{
+	if(mBytes <= mByteBudget)
+		return;
+
+	vector<pair<time_t, TexInfo *> > loaded;
+	time_t	too_recent = time(NULL) - EVICT_MIN_AGE;
+	for(TexMap::iterator t = mTexes.begin(); t != mTexes.end(); ++t)
+		if(t->second->state == state_Loaded && t->second->last_use < too_recent)
+			loaded.push_back(pair<time_t, TexInfo *>(t->second->last_use, t->second));
+	sort(loaded.begin(), loaded.end());
+
+	for(vector<pair<time_t, TexInfo *> >::iterator l = loaded.begin(); l != loaded.end() && mBytes > mByteBudget; ++l)
+	{
+		TexInfo * inf = l->second;
+		mEvicted.push_back(inf->tex_id);
+		inf->tex_id = 0;
+		inf->state = state_Evicted;
+		mBytes -= inf->bytes;
+		inf->bytes = 0;
+	}
+}
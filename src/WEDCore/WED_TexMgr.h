@@ -25,8 +25,31 @@
 #define WED_TexMgr_H
 
 #include "ITexMgr.h"
+#include "GUI_Broadcaster.h"
+#include "GUI_Timer.h"
 
-class WED_TexMgr : public virtual ITexMgr {
+class	ParallelQueue;
+
+/*
+	WED_TexMgr - THEORY OF OPERATION
+
+	Images are decoded on background threads, so opening a busy airport does not stall the UI.  LookupTexture
+	returns a TexRef right away; until its image is decoded the texture ID is 0 (callers already draw untextured
+	for that) and the sizes are 1x1.  LookupTexture and GetTexInfo never touch OpenGL - they may be called from
+	anywhere, e.g. when a selection changes.  Only GetTexID does GL work: it is what the draw code calls right
+	before binding, with the context current, so that is where finished decodes are uploaded and evicted textures
+	are deleted.  While decodes are outstanding a timer polls the queue and broadcasts msg_TexturesLoaded so views
+	redraw and pick them up.
+
+	Uploaded textures are kept in an LRU with a byte budget (texture_memory_mb in the preferences).  The same timer
+	trims the LRU while we are over budget; it only marks textures evicted and hands their GL names to the next
+	GetTexID to delete.  The TexRef stays valid and is simply re-queued when its ID is asked for again.  A texture
+	used in the last few seconds is never evicted, so nothing bound during the current frame goes away.
+
+	A texture whose image fails to decode is remembered as missing; LookupTexture returns NULL for it.
+*/
+
+class WED_TexMgr : public virtual ITexMgr, public GUI_Broadcaster, public GUI_Timer {
 public:
 
 						 WED_TexMgr(const string& package);
@@ -44,8 +67,19 @@ public:
 								int *	org_x,
 								int *	org_y);
 
+	virtual	void		TimerFired(void);
+
 private:
 
+	enum {
+		state_Queued,		// decode queued or running
+		state_Loaded,		// tex_id is valid
+		state_Evicted,		// GL texture dropped for the budget, re-queued on next use
+		state_Failed		// image could not be loaded
+	};
+
+	struct	TexJob;
+
 	struct	TexInfo {
 		int			tex_id;
 		int			vis_x;
@@ -54,6 +88,13 @@ private:
 		int			act_y;
 		int			org_x;
 		int			org_y;
+
+		int			state;
+		int			flags;
+		string		fpath;
+		size_t		bytes;			// GL memory estimate while loaded
+		time_t		last_use;
+		TexJob *	job;
 	};
 
 	typedef map<string,TexInfo *>	TexMap;
@@ -62,7 +103,19 @@ private:
 
 	string	mPackage;
 
-	TexInfo *	LoadTexture(const char * path, bool is_absolute, int flags);
+	ParallelQueue *		mQueue;
+	vector<TexJob *>	mDone;			// finished decodes waiting for the next GetTexID to upload them
+	vector<int>			mEvicted;		// GL names the timer evicted, waiting for the next GetTexID to delete them
+	bool				mPolling;
+	size_t				mBytes;
+	size_t				mByteBudget;
+
+	void		QueueLoad(TexInfo * inf);
+	void		StartPolling(void);
+	void		CollectDone(void);
+	void		FinishLoads(void);
+	void		Use(TexInfo * inf);
+	void		TrimToBudget(void);
 
 };
 
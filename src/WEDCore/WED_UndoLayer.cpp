@@ -23,26 +23,169 @@
 
 #include "WED_UndoLayer.h"
 #include "WED_Persistent.h"
-#include "WED_Buffer.h"
 #include "WED_Archive.h"
 #include "AssertUtils.h"
-#include "WED_FastBuffer.h"
+#include "IODefs.h"
 // NOTE: we could store no turd for created objs
 
+// Patch records are (int post_offset, int post_length, int pre_length, pre bytes...).  Runs of
+// differing bytes closer together than this get merged, since a new patch costs 12 bytes of header.
+#define	PATCH_MERGE_GAP		16
+
+/************************************************************************************************************************************
+ * BYTE STREAMS
+ ************************************************************************************************************************************/
+
+class	undo_writer : public IOWriter {
+public:
+	undo_writer(vector<char>& dst) : mDst(dst) { }
+
+	virtual	void	WriteShort(short v)		{ put(&v, sizeof(v)); }
+	virtual	void	WriteInt(int v)			{ put(&v, sizeof(v)); }
+	virtual	void	WriteFloat(float v)		{ put(&v, sizeof(v)); }
+	virtual	void	WriteDouble(double v)	{ put(&v, sizeof(v)); }
+	virtual	void	WriteBulk(const char * inBuf, int inLength, bool /*inZip*/) { put(inBuf, inLength); }
+
+private:
+	void	put(const void * p, int l) { mDst.insert(mDst.end(), (const char *) p, (const char *) p + l); }
+	vector<char>&	mDst;
+};
+
+class	undo_reader : public IOReader {
+public:
+	undo_reader(const char * p, const char * e) : mP(p), mE(e) { }
+
+	virtual	void	ReadShort(short& v)		{ get(&v, sizeof(v)); }
+	virtual	void	ReadInt(int& v)			{ get(&v, sizeof(v)); }
+	virtual	void	ReadFloat(float& v)		{ get(&v, sizeof(v)); }
+	virtual	void	ReadDouble(double& v)	{ get(&v, sizeof(v)); }
+	virtual	void	ReadBulk(char * inBuf, int inLength, bool /*inZip*/) { get(inBuf, inLength); }
+
+private:
+	void	get(void * p, int l) { DebugAssert(mE - mP >= l); memcpy(p, mP, l); mP += l; }
+	const char *	mP;
+	const char *	mE;
+};
+
+static unsigned int hash_bytes(const char * p, int l)
+{
+	unsigned int h = 2166136261u;
+	while(l--)
+	{
+		h ^= (unsigned char) *p++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static const char * begin_of(const vector<char>& v)
+{
+	return v.empty() ? NULL : &*v.begin();
+}
+
+static void put_int(vector<char>& dst, int v)
+{
+	dst.insert(dst.end(), (const char *) &v, (const char *) &v + sizeof(v));
+}
+
+static int get_int(const char *& p)
+{
+	int v;
+	memcpy(&v, p, sizeof(v));
+	p += sizeof(v);
+	return v;
+}
+
+static void put_patch(vector<char>& dst, int post_off, int post_len, const char * pre, int pre_len)
+{
+	put_int(dst, post_off);
+	put_int(dst, post_len);
+	put_int(dst, pre_len);
+	dst.insert(dst.end(), pre, pre + pre_len);
+}
+
+// Appends to dst the patches that turn post (n1 bytes) back into pre (n0 bytes).
+static void make_patches(const char * pre, int n0, const char * post, int n1, vector<char>& dst)
+{
+	int lim = min(n0, n1);
+	int p = 0;
+	while(p < lim && pre[p] == post[p])
+		++p;
+	int s = 0;
+	while(s < lim - p && pre[n0 - 1 - s] == post[n1 - 1 - s])
+		++s;
+
+	if(n0 != n1)
+	{
+		// Something was inserted or removed (child lists mostly) - the middle goes back as one run.
+		if(p + s < n0 || p + s < n1)
+			put_patch(dst, p, n1 - s - p, pre + p, n0 - s - p);
+		return;
+	}
+
+	int e = n0 - s;
+	int i = p;
+	while(i < e)
+	{
+		while(i < e && pre[i] == post[i])
+			++i;
+		if(i == e)
+			break;
+		int run_start = i;
+		int run_end = i;
+		while(i < e)
+		{
+			if(pre[i] != post[i])
+				run_end = ++i;
+			else if(i - run_end >= PATCH_MERGE_GAP)
+				break;
+			else
+				++i;
+		}
+		put_patch(dst, run_start, run_end - run_start, pre + run_start, run_end - run_start);
+		i = run_end;
+	}
+}
+
+// Rebuilds the pre image from the post image and the patches in [p,e), appending it to dst.
+static void apply_patches(const char * post, int n1, const char * p, const char * e, vector<char>& dst)
+{
+	int done = 0;
+	while(p < e)
+	{
+		int post_off = get_int(p);
+		int post_len = get_int(p);
+		int pre_len = get_int(p);
+		DebugAssert(post_off >= done && post_off + post_len <= n1);
+		dst.insert(dst.end(), post + done, post + post_off);
+		dst.insert(dst.end(), p, p + pre_len);
+		p += pre_len;
+		done = post_off + post_len;
+	}
+	dst.insert(dst.end(), post + done, post + n1);
+}
+
+/************************************************************************************************************************************
+ * UNDO LAYER
+ ************************************************************************************************************************************/
+
 WED_UndoLayer::WED_UndoLayer(WED_Archive * inArchive, const string& inName, const char * inFile, int inLine) :
-	mArchive(inArchive), mName(inName), mChangeMask(0), mFile(inFile), mLine(inLine)
+	mArchive(inArchive), mName(inName), mFile(inFile), mLine(inLine), mChangeMask(0), mCompacted(false)
 {
-	mStorage = new WED_FastBufferGroup;
 }
 
 WED_UndoLayer::~WED_UndoLayer(void)
 {
-//	for(ObjInfoMap::iterator i = mObjects.begin(); i != mObjects.end(); ++i)
-//	{
-//		if (i->second.buffer)
-//			delete i->second.buffer;
-//	}
-	delete mStorage;
+}
+
+void	WED_UndoLayer::SaveState(ObjInfo& info, WED_Persistent * inObject)
+{
+	DebugAssert(!mCompacted);
+	info.offset = mBytes.size();
+	undo_writer	w(mBytes);
+	inObject->WriteTo(&w);
+	info.length = mBytes.size() - info.offset;
+	info.dirty = inObject->GetDirty();
 }
 
 void 	WED_UndoLayer::ObjectCreated(WED_Persistent * inObject)
@@ -65,7 +208,10 @@ void 	WED_UndoLayer::ObjectCreated(WED_Persistent * inObject)
 		info.the_class = inObject->GetClass();
 		info.op = op_Created;
 		info.id = inObject->GetID();
-		info.buffer = NULL;
+		info.dirty = 0;
+		info.offset = 0;
+		info.length = -1;
+		info.delta = false;
 		mObjects.insert(ObjInfoMap::value_type(inObject->GetID(), info));
 	}
 }
@@ -89,10 +235,8 @@ void	WED_UndoLayer::ObjectChanged(WED_Persistent * inObject, int change_kind)
 		info.the_class = inObject->GetClass();
 		info.op = op_Changed;
 		info.id = inObject->GetID();
-		info.buffer = mStorage->MakeNewBuffer();
-//		info.buffer = new WED_Buffer;
-		inObject->WriteTo(info.buffer);
-		info.buffer->WriteInt(inObject->GetDirty());
+		info.delta = false;
+		SaveState(info, inObject);
 		mObjects.insert(ObjInfoMap::value_type(inObject->GetID(), info));
 	}
 }
@@ -127,53 +271,149 @@ void	WED_UndoLayer::ObjectDestroyed(WED_Persistent * inObject)
 		info.the_class = inObject->GetClass();
 		info.op = op_Destroyed;
 		info.id = inObject->GetID();
-		info.buffer = mStorage->MakeNewBuffer();
-//		info.buffer = new WED_Buffer;
-		inObject->WriteTo(info.buffer);
-		info.buffer->WriteInt(inObject->GetDirty());
+		info.delta = false;
+		SaveState(info, inObject);
 		mObjects.insert(ObjInfoMap::value_type(inObject->GetID(), info));
 	}
 
 }
 
+void	WED_UndoLayer::Compact(void)
+{
+	if (mCompacted) return;
+	mCompacted = true;
+
+	vector<char>	packed;
+	vector<char>	post;
+	for (ObjInfoMap::iterator i = mObjects.begin(); i != mObjects.end(); ++i)
+	{
+		ObjInfo& info(i->second);
+		if (info.length < 0) continue;
+		const char * pre = begin_of(mBytes) + info.offset;
+		size_t	dst = packed.size();
+
+		if (info.op == op_Changed)
+		{
+			WED_Persistent * obj = mArchive->Fetch(info.id);
+			Assert(obj != NULL);
+			post.clear();
+			undo_writer	w(post);
+			obj->WriteTo(&w);
+			const char * post_p = begin_of(post);
+
+			make_patches(pre, info.length, post_p, post.size(), packed);
+			if (packed.size() - dst < (size_t) info.length)
+			{
+				#if DEV
+				vector<char> check;
+				apply_patches(post_p, post.size(), begin_of(packed) + dst, begin_of(packed) + packed.size(), check);
+				DebugAssert(check.size() == (size_t) info.length && equal(check.begin(), check.end(), pre));
+				#endif
+				info.delta = true;
+				info.cur_length = post.size();
+				info.cur_hash = hash_bytes(post_p, post.size());
+				info.offset = dst;
+				info.length = packed.size() - dst;
+				continue;
+			}
+			// Not worth it - the object changed almost everywhere, keep the plain image.
+			packed.resize(dst);
+		}
+		packed.insert(packed.end(), pre, pre + info.length);
+		info.offset = dst;
+	}
+	// Copy rather than swap so the capacity slack from building doesn't stay on the undo stack.
+	vector<char>(packed.begin(), packed.end()).swap(mBytes);
+}
+
+size_t	WED_UndoLayer::GetMemoryUsage(void) const
+{
+	return sizeof(*this) + mBytes.capacity() + mObjects.size() * (sizeof(ObjInfo) + 2 * sizeof(void *));
+}
+
+void	WED_UndoLayer::PrintMemoryReport(void) const
+{
+	int	n_created = 0, n_full = 0, n_delta = 0;
+	for (ObjInfoMap::const_iterator i = mObjects.begin(); i != mObjects.end(); ++i)
+	{
+		if (i->second.length < 0)	++n_created;
+		else if (i->second.delta)	++n_delta;
+		else						++n_full;
+	}
+	printf("  %-40s %8zu bytes  %6d objs (%d delta, %d full, %d created)\n",
+		mName.c_str(), GetMemoryUsage(), (int) mObjects.size(), n_delta, n_full, n_created);
+}
+
 void	WED_UndoLayer::Execute(void)
 {
+	// Rebuild every delta'd object's pre-command image before we touch anything - once objects
+	// start reading their old state back, the post-command images the deltas were made against
+	// are gone.
+	vector<char>				images;
+	hash_map<int, pair<size_t, size_t> >	image_range;
+	vector<char>				post;
+	for (ObjInfoMap::iterator i = mObjects.begin(); i != mObjects.end(); ++i)
+	if (i->second.delta)
+	{
+		ObjInfo& info(i->second);
+		WED_Persistent * obj = mArchive->Fetch(info.id);
+		Assert(obj != NULL);
+		post.clear();
+		undo_writer	w(post);
+		obj->WriteTo(&w);
+		const char * post_p = begin_of(post);
+		if (post.size() != (size_t) info.cur_length || hash_bytes(post_p, post.size()) != info.cur_hash)
+			AssertPrintf("Undo of '%s': object %d (%s) was changed outside of the undo system.", mName.c_str(), info.id, info.the_class);
+		size_t start = images.size();
+		const char * rec = begin_of(mBytes) + info.offset;
+		apply_patches(post_p, post.size(), rec, rec + info.length, images);
+		image_range[info.id] = pair<size_t, size_t>(start, images.size());
+	}
+
 	vector<WED_Persistent *>	needs_post_call;
-	int d;
 	for (ObjInfoMap::iterator i = mObjects.begin(); i != mObjects.end(); ++i)
 	{
 		WED_Persistent * obj;
+		const char * p = NULL, * e = NULL;
+		if (i->second.delta)
+		{
+			pair<size_t, size_t> range = image_range[i->first];
+			p = begin_of(images) + range.first;
+			e = begin_of(images) + range.second;
+		}
+		else if (i->second.length >= 0)
+		{
+			p = begin_of(mBytes) + i->second.offset;
+			e = p + i->second.length;
+		}
+		undo_reader	r(p, e);
+
 		switch(i->second.op) {
 		case op_Created:
 			obj = mArchive->Fetch(i->first);
-			DebugAssert(i->second.buffer == NULL);
+			DebugAssert(i->second.length < 0);
 			Assert(obj != NULL);
 			obj->Delete();
 			break;
 		case op_Changed:
 			obj = mArchive->Fetch(i->first);
 			Assert(obj != NULL);
-			DebugAssert(i->second.buffer != NULL);
-			i->second.buffer->ResetRead();
+			DebugAssert(i->second.length >= 0);
 			obj->StateChanged();
-			if(obj->ReadFrom(i->second.buffer))
+			if(obj->ReadFrom(&r))
 				needs_post_call.push_back(obj);
-			i->second.buffer->ReadInt(d);
-			obj->SetDirty(d);
+			obj->SetDirty(i->second.dirty);
 			break;
 		case op_Destroyed:
 			obj = WED_Persistent::CreateByClass(i->second.the_class, mArchive, i->first);
 			DebugAssert(obj != NULL);
-			DebugAssert(i->second.buffer != NULL);
-			i->second.buffer->ResetRead();
-			if(obj->ReadFrom(i->second.buffer))
+			DebugAssert(i->second.length >= 0);
+			if(obj->ReadFrom(&r))
 				needs_post_call.push_back(obj);
-			i->second.buffer->ReadInt(d);
-			obj->SetDirty(d);
+			obj->SetDirty(i->second.dirty);
 			break;
 		}
 	}
 	for(vector<WED_Persistent *>::iterator o = needs_post_call.begin(); o != needs_post_call.end(); ++o)
 		(*o)->PostChangeNotify();
 }
-
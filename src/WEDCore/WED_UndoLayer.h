@@ -25,9 +25,6 @@
 #define WED_UNDOLAYER_H
 
 class	WED_Archive;
-class	WED_Buffer;
-class	WED_FastBuffer;
-class	WED_FastBufferGroup;
 class	WED_Persistent;
 
 #define 	UNDO_DISCARD	((WED_UndoLayer *) -1)
@@ -45,6 +42,13 @@ public:
 
 		void	Execute(void);
 
+		// Call once the command is over (the archive is in its post-command state): changed objects
+		// are re-serialized and only the bytes that differ from their pre-command image are kept.
+		void	Compact(void);
+
+		size_t	GetMemoryUsage(void) const;
+		void	PrintMemoryReport(void) const;
+
 		string	GetName(void) const { return mName; }
 		const char * GetFile(void) const { return mFile; }
 		int		GetLine(void) const { return mLine; }
@@ -60,22 +64,35 @@ private:
 			op_Destroyed
 	};
 
+	// Every object with saved state has a record in mBytes.  Before Compact() that is always the full
+	// WriteTo() image.  After Compact(), a changed object may instead hold a list of patches that turn its
+	// post-command image (cur_length bytes, hash cur_hash) back into the pre-command one.  This is only
+	// legal because layers are executed strictly in stack order - when we run, every object we touched
+	// is exactly as we left it.
 	struct ObjInfo {
 		LayerOp				op;
 		int					id;
 		const char *		the_class;
-		WED_FastBuffer *	buffer;
+		int					dirty;
+		size_t				offset;
+		int					length;			// -1 = no saved state (created objects)
+		bool				delta;
+		int					cur_length;
+		unsigned int		cur_hash;
 	};
 
 	typedef hash_map<int, ObjInfo>		ObjInfoMap;
 
+	void	SaveState(ObjInfo& info, WED_Persistent * inObject);
+
 	ObjInfoMap				mObjects;
+	vector<char>			mBytes;
 	WED_Archive *			mArchive;
 	string					mName;
 	const char *			mFile;
 	int						mLine;
 	int						mChangeMask;
-	WED_FastBufferGroup *	mStorage;
+	bool					mCompacted;
 
 	// Things we do not allow
 	WED_UndoLayer();
@@ -27,6 +27,7 @@
 #include "AssertUtils.h"
 #include "WED_Messages.h"
 #include "PlatformUtils.h"
+#include "GUI_Prefs.h"
 // UNDO STACK ORDER IS:
 
 // CHRONOLOGICAL FROM BEGIN TO END
@@ -34,10 +35,15 @@
 // The first op UNDONE is redo.front()
 
 #define WARN_IF_LESS_LEVEL	10
-#define MAX_UNDO_LEVELS 20
+#define MAX_UNDO_LEVELS 100
+
+// Undo memory in MB; can be overridden with undo_memory_mb in the [preferences] section.
+#define DEFAULT_UNDO_BUDGET_MB "256"
 
 WED_UndoMgr::WED_UndoMgr(WED_Archive * inArchive, WED_UndoFatalErrorHandler * panic_handler) : mCommand(NULL), mArchive(inArchive), mPanicHandler(panic_handler)
 {
+	int mb = atoi(GUI_GetPrefString("preferences","undo_memory_mb",DEFAULT_UNDO_BUDGET_MB));
+	mByteBudget = (size_t) max(mb, 1) * 1024 * 1024;
 }
 
 WED_UndoMgr::~WED_UndoMgr()
@@ -63,12 +69,6 @@ static const char * trim_file(const char * p)
 
 void	WED_UndoMgr::__StartCommand(const string& inName, const char * file, int line)
 {
-	while(mUndo.size() > MAX_UNDO_LEVELS)
-	{
-		delete mUndo.front();
-		mUndo.pop_front();
-	}
-	
 	// This is the asset case that often burns us: a command is started WHILE another command is going on.  This happens due to
 	// either bad UI code or unknown weird shit from the window mgr.
 	if (mCommand != NULL)
@@ -97,13 +97,17 @@ void	WED_UndoMgr::CommitCommand(void)
 	{
 		delete mCommand;
 		mCommand = NULL;
+		mArchive->mChangedIDs.clear();
 		return;
 	}
 	PurgeRedo();
+	mCommand->Compact();
 	mUndo.push_back(mCommand);
+	TrimToBudget();
 	int change_mask = mCommand->GetChangeMask();
 	mCommand = NULL;
 	mArchive->BroadcastMessage(msg_ArchiveChanged,change_mask);
+	mArchive->mChangedIDs.clear();
 }
 
 void	WED_UndoMgr::AbortCommand(void)
@@ -148,12 +152,14 @@ void	WED_UndoMgr::Undo(void)
 	int change_mask = undo->GetChangeMask();
 	undo->Execute();
 	mArchive->SetUndo(NULL);
+	redo->Compact();
 	mRedo.push_front(redo);
 	delete undo;
 	mUndo.pop_back();
 	mArchive->mOpCount--;
 	mArchive->mCacheKey++;
 	mArchive->BroadcastMessage(msg_ArchiveChanged,change_mask);
+	mArchive->mChangedIDs.clear();
 }
 
 void	WED_UndoMgr::Redo(void)
@@ -165,12 +171,15 @@ void	WED_UndoMgr::Redo(void)
 	int change_mask = redo->GetChangeMask();
 	redo->Execute();
 	mArchive->SetUndo(NULL);
+	undo->Compact();
 	mUndo.push_back(undo);
 	delete redo;
 	mRedo.pop_front();
+	TrimToBudget();
 	mArchive->mOpCount++;
 	mArchive->mCacheKey++;
 	mArchive->BroadcastMessage(msg_ArchiveChanged,change_mask);
+	mArchive->mChangedIDs.clear();
 }
 
 void	WED_UndoMgr::PurgeUndo(void)
@@ -187,8 +196,51 @@ void	WED_UndoMgr::PurgeRedo(void)
 	mRedo.clear();
 }
 
+void	WED_UndoMgr::SetByteBudget(size_t bytes)
+{
+	mByteBudget = bytes;
+	TrimToBudget();
+}
+
+size_t	WED_UndoMgr::GetMemoryUsage(void) const
+{
+	size_t total = 0;
+	for (LayerList::const_iterator l = mUndo.begin(); l != mUndo.end(); ++l)
+		total += (*l)->GetMemoryUsage();
+	for (LayerList::const_iterator l = mRedo.begin(); l != mRedo.end(); ++l)
+		total += (*l)->GetMemoryUsage();
+	return total;
+}
+
+void	WED_UndoMgr::PrintMemoryReport(void) const
+{
+	printf("Undo: %d levels, %zu bytes (budget %zu)\n", (int) mUndo.size(), GetMemoryUsage(), mByteBudget);
+	for (LayerList::const_iterator l = mUndo.begin(); l != mUndo.end(); ++l)
+		(*l)->PrintMemoryReport();
+	if (!mRedo.empty())
+	{
+		printf("Redo: %d levels\n", (int) mRedo.size());
+		for (LayerList::const_iterator l = mRedo.begin(); l != mRedo.end(); ++l)
+			(*l)->PrintMemoryReport();
+	}
+}
+
+void	WED_UndoMgr::TrimToBudget(void)
+{
+	size_t total = GetMemoryUsage();
+	while(mUndo.size() > 1 && (total > mByteBudget || mUndo.size() > MAX_UNDO_LEVELS))
+	{
+		total -= mUndo.front()->GetMemoryUsage();
+		delete mUndo.front();
+		mUndo.pop_front();
+	}
+}
+
 bool	WED_UndoMgr::ReleaseMemory(void)
 {
+#if DEV
+	PrintMemoryReport();
+#endif
 	if (mUndo.empty() && mRedo.empty()) return false;
 	if (mUndo.size() > WARN_IF_LESS_LEVEL)
 	{
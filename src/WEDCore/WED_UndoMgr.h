@@ -67,6 +67,12 @@ public:
 	void	PurgeUndo(void);
 	void	PurgeRedo(void);
 
+	// Old undo levels are dropped once the undo and redo stacks together go over this many bytes.
+	// The most recent undo is always kept, no matter how big it is.
+	void	SetByteBudget(size_t bytes);
+	size_t	GetMemoryUsage(void) const;
+	void	PrintMemoryReport(void) const;
+
 	// From GUI_MemoryHog
 	virtual	bool	ReleaseMemory(void);
 
@@ -74,12 +80,15 @@ private:
 
 	typedef list<WED_UndoLayer *>	LayerList;
 
+	void	TrimToBudget(void);
+
 	LayerList 		mUndo;
 	LayerList		mRedo;
 
 	WED_UndoLayer *				mCommand;
 	WED_Archive *				mArchive;
 	WED_UndoFatalErrorHandler *	mPanicHandler;
+	size_t						mByteBudget;
 
 };
 #endif
@@ -81,6 +81,8 @@
 #include "MemFileUtils.h"
 #include "PlatformUtils.h"
 #include "MathUtils.h"
+#include "ParallelUtils.h"
+#include "RTree2.h"
 
 #include "WED_Document.h"
 #include "WED_FileCache.h"
@@ -813,14 +815,15 @@ static void ValidateOneATCRunwayUse(WED_ATCRunwayUse* use, validation_error_vect
 		msgs.push_back(validation_error_t("ATC runway use must support at least one equipment type.", err_rwy_use_must_have_at_least_one_equip, use, apt));
 }
 
-static void TJunctionTest(vector<WED_TaxiRoute*> all_taxiroutes, validation_error_vector& msgs, WED_Airport * apt)
-{
-	static CoordTranslator2 translator;
-	Bbox2 box;
-	apt->GetBounds(gis_Geo, box);
-	CreateTranslatorForBounds(box,translator);
+/*	T-JUNCTION TEST
+
+	This is the one check that is quadratic in the size of an airport, so it is split in two.  While the airport is
+	being validated we only pull each taxi route's geometry (in meters), name and end-node valences into plain data
+	and index the routes by bounding box.  That is all the WED objects we ever touch.  The pairwise part then runs
+	later for every airport at once on worker threads (see RunTJunctionTests) and its findings are spliced back into
+	the message list at the spot where the test used to write them - so the report reads exactly as it always did.
 
-	/*For each edge A
+	For each edge A
 		for each OTHER edge B
 
 		If A and B intersect, do not mark them as a T - the intersection test will pick this up and we don't want to have double errors on a single user problem.
@@ -830,24 +833,94 @@ static void TJunctionTest(vector<WED_TaxiRoute*> all_taxiroutes, validation_erro
 				if end has a valence of 1
 					if the distance between A and the end node you are testing is < M meters
 						validation failure - that node is too close to a taxiway route but isn't joined.
-	*/
 
-	for (vector<WED_TaxiRoute*>::iterator edge_a_itr = all_taxiroutes.begin(); edge_a_itr != all_taxiroutes.end(); ++edge_a_itr)
+	Only a B whose bounding box comes within the threshold of A's can fail, so the index only hands us those - in
+	the same (collection) order the full double loop would have visited them.
+*/
+
+#define TJUNCTION_THRESHOLD 1.00
+
+struct tjunction_route {
+	WED_TaxiRoute *		route;
+	string				name;
+	Segment2			segment_m;
+	Point2				nodes_m[2];
+	WED_GISPoint *		nodes[2];
+	bool				dangling[2];		// node has a valence of 1
+};
+
+struct tjunction_job {
+	WED_Airport *					apt;
+	int								msg_pos;	// where in the message list our results go
+	vector<tjunction_route>			routes;
+	RTree2<int, 8>					index;
+	vector<vector<pair<int,int> > >	hits;		// for each A: (B, end of B) that fail, in visiting order
+};
+
+static void TJunctionTest(const vector<WED_TaxiRoute*>& all_taxiroutes, validation_error_vector& msgs, WED_Airport * apt, vector<tjunction_job *>& jobs)
+{
+	CoordTranslator2 translator;
+	Bbox2 box;
+	apt->GetBounds(gis_Geo, box);
+	CreateTranslatorForBounds(box,translator);
+
+	tjunction_job * job = new tjunction_job;
+	job->apt = apt;
+	job->msg_pos = msgs.size();
+	job->routes.resize(all_taxiroutes.size());
+	job->hits.resize(all_taxiroutes.size());
+
+	vector<RTree2<int, 8>::item_type> items;
+	items.reserve(all_taxiroutes.size());
+
+	for (int n = 0; n < all_taxiroutes.size(); ++n)
+	{
+		TaxiRouteInfo info(all_taxiroutes[n], translator);
+		tjunction_route& r(job->routes[n]);
+		r.route = all_taxiroutes[n];
+		r.name = info.taxiroute_name;
+		r.segment_m = info.taxiroute_segment_m;
+		for (int i = 0; i < 2; ++i)
+		{
+			r.nodes_m[i] = info.nodes_m[i];
+			r.nodes[i] = info.nodes[i];
+			set<WED_Thing*> node_viewers;
+			info.nodes[i]->GetAllViewers(node_viewers);
+			r.dangling[i] = node_viewers.size() == 1;
+		}
+		items.push_back(RTree2<int, 8>::item_type(Bbox2(r.nodes_m[0], r.nodes_m[1]), n));
+	}
+	job->index.insert(items.begin(), items.end());
+	jobs.push_back(job);
+}
+
+// One work item is one edge A of one airport; it only reads its job and writes its own hits slot.
+struct tjunction_worker {
+	vector<tjunction_job *> *	jobs;
+	vector<pair<int,int> >		work;		// (job, edge A)
+
+	void operator()(int w)
 	{
-		for (vector<WED_TaxiRoute*>::iterator edge_b_itr = all_taxiroutes.begin(); edge_b_itr != all_taxiroutes.end(); ++edge_b_itr)
+		tjunction_job * job = (*jobs)[work[w].first];
+		int a = work[w].second;
+		const tjunction_route& edge_a(job->routes[a]);
+
+		Bbox2 near_a(edge_a.segment_m);
+		near_a.expand(TJUNCTION_THRESHOLD);
+		vector<int> candidates;
+		job->index.query_value(near_a, back_inserter(candidates));
+		sort(candidates.begin(), candidates.end());
+
+		for (vector<int>::iterator b = candidates.begin(); b != candidates.end(); ++b)
 		{
 			//Skip over the same ones
-			if (edge_a_itr == edge_b_itr)
-			{
+			if (*b == a)
 				continue;
-			}
+			const tjunction_route& edge_b(job->routes[*b]);
 
-			TaxiRouteInfo edge_a(*edge_a_itr,translator);
-			TaxiRouteInfo edge_b(*edge_b_itr,translator);
- 
 			//tmp doesn't matter to us
 			Point2 tmp;
-			if (edge_a.taxiroute_segment_m.intersect(edge_b.taxiroute_segment_m,tmp) == true)
+			if (edge_a.segment_m.intersect(edge_b.segment_m,tmp) == true)
 			{
 				//An intersection is different from a T junction
 				continue;
@@ -855,15 +928,11 @@ static void TJunctionTest(vector<WED_TaxiRoute*> all_taxiroutes, validation_erro
 
 			bool found_duplicate = false;
 			for (int i = 0; i < 2 && found_duplicate == false; i++)
+			for (int j = 0; j < 2 && found_duplicate == false; j++)
+			if (edge_a.nodes_m[i] == edge_b.nodes_m[j])
 			{
-				for (int j = 0; j < 2 && found_duplicate == false; j++)
-				{
-					if (edge_a.nodes_m[i] == edge_b.nodes_m[j])
-					{
-						//This is a duplicate of the doubled up vertex test
-						found_duplicate = true;
-					}
-				}
+				//This is a duplicate of the doubled up vertex test
+				found_duplicate = true;
 			}
 
 			if (found_duplicate == true)
@@ -872,33 +941,49 @@ static void TJunctionTest(vector<WED_TaxiRoute*> all_taxiroutes, validation_erro
 				continue;
 			}
 
-			const double TJUNCTION_THRESHOLD = 1.00;
 			for (int i = 0; i < 2; i++)
+			if (edge_b.dangling[i])
 			{
-				set<WED_Thing*> node_viewers;
-				edge_b.nodes[i]->GetAllViewers(node_viewers);
+				double dist_b_node_to_a_edge = sqrt(edge_a.segment_m.squared_distance(edge_b.nodes_m[i]));
+				if (dist_b_node_to_a_edge < TJUNCTION_THRESHOLD)
+					job->hits[a].push_back(pair<int,int>(*b, i));
+			}
+		}
+	}
+};
 
-				int valence = node_viewers.size();
-				if (valence == 1)
-				{
-					double dist_b_node_to_a_edge = sqrt(edge_a.taxiroute_segment_m.squared_distance(edge_b.nodes_m[i]));
+static void RunTJunctionTests(vector<tjunction_job *>& jobs, validation_error_vector& msgs)
+{
+	tjunction_worker	worker;
+	worker.jobs = &jobs;
+	for (int j = 0; j < jobs.size(); ++j)
+	for (int a = 0; a < jobs[j]->routes.size(); ++a)
+		worker.work.push_back(pair<int,int>(j, a));
 
-					if (dist_b_node_to_a_edge < TJUNCTION_THRESHOLD)
-					{
-						vector<WED_Thing*> problem_children;
-						problem_children.push_back(*edge_a_itr);
+	ParallelFor(worker.work.size(), worker);
 
-						string problem_node_name;
+	validation_error_vector		merged;
+	int							copied = 0;
+	for (vector<tjunction_job *>::iterator j = jobs.begin(); j != jobs.end(); ++j)
+	{
+		tjunction_job * job = *j;
+		merged.insert(merged.end(), msgs.begin() + copied, msgs.begin() + job->msg_pos);
+		copied = job->msg_pos;
 
-						problem_children.push_back((edge_b.nodes[i]));
-						edge_b.nodes[i]->GetName(problem_node_name);
+		for (int a = 0; a < job->routes.size(); ++a)
+		for (vector<pair<int,int> >::iterator h = job->hits[a].begin(); h != job->hits[a].end(); ++h)
+		{
+			vector<WED_Thing*> problem_children;
+			problem_children.push_back(job->routes[a].route);
+			problem_children.push_back(job->routes[h->first].nodes[h->second]);
 
-						msgs.push_back(validation_error_t("Taxi route " + edge_a.taxiroute_name + " is not joined to a destination route.", err_taxi_route_not_joined_to_dest_route, problem_children, apt));
-					}
-				}
-			}
+			merged.push_back(validation_error_t("Taxi route " + job->routes[a].name + " is not joined to a destination route.", err_taxi_route_not_joined_to_dest_route, problem_children, job->apt));
 		}
+		delete job;
 	}
+	merged.insert(merged.end(), msgs.begin() + copied, msgs.end());
+	msgs.swap(merged);
+	jobs.clear();
 }
 
 static void ValidateOneATCFlow(WED_ATCFlow * flow, validation_error_vector& msgs, set<int>& legal_rwy_oneway, WED_Airport * apt)
@@ -1002,7 +1087,7 @@ static void ValidateOneATCFlow(WED_ATCFlow * flow, validation_error_vector& msgs
 	
 }
 
-static void ValidateATC(WED_Airport* apt, validation_error_vector& msgs, set<int>& legal_rwy_oneway, set<int>& legal_rwy_twoway)
+static void ValidateATC(WED_Airport* apt, validation_error_vector& msgs, set<int>& legal_rwy_oneway, set<int>& legal_rwy_twoway, vector<tjunction_job *>& tjunction_jobs)
 {
 	vector<WED_ATCFlow *>		flows;
 	vector<WED_TaxiRoute *>	taxi_routes;
@@ -1064,7 +1149,7 @@ static void ValidateATC(WED_Airport* apt, validation_error_vector& msgs, set<int
 		}
 	}
 
-	TJunctionTest(taxi_routes, msgs, apt);
+	TJunctionTest(taxi_routes, msgs, apt, tjunction_jobs);
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------
@@ -1891,7 +1976,7 @@ static void ValidateOneTruckParking(WED_TruckParkingLocation* truck_parking,vali
 #pragma mark -
 //------------------------------------------------------------------------------------------------------------------------------------
 
-static void ValidateOneAirport(WED_Airport* apt, validation_error_vector& msgs, WED_LibraryMgr* lib_mgr, WED_ResourceMgr * res_mgr, MFMemFile * mf)
+static void ValidateOneAirport(WED_Airport* apt, validation_error_vector& msgs, WED_LibraryMgr* lib_mgr, WED_ResourceMgr * res_mgr, MFMemFile * mf, vector<tjunction_job *>& tjunction_jobs)
 {
 	/*--Validate Airport Rules-------------------------------------------------
 		Airport Name rules
@@ -2023,7 +2108,7 @@ static void ValidateOneAirport(WED_Airport* apt, validation_error_vector& msgs,
 	WED_DoATCRunwayChecks(*apt, msgs);
 	#endif
 
-	ValidateATC(apt, msgs, legal_rwy_oneway, legal_rwy_twoway);
+	ValidateATC(apt, msgs, legal_rwy_oneway, legal_rwy_twoway, tjunction_jobs);
 
 	ValidateAirportFrequencies(apt,msgs);
 
@@ -2383,11 +2468,13 @@ validation_result_t	WED_ValidateApt(WED_Document * resolver, WED_MapPane * pane,
 			mf = MemFile_Open(res.out_path.c_str());
 	}
 
+	vector<tjunction_job *>	tjunction_jobs;
 	for(vector<WED_Airport *>::iterator a = apts.begin(); a != apts.end(); ++a)
 	{
-		ValidateOneAirport(*a, msgs, lib_mgr, res_mgr, mf);
+		ValidateOneAirport(*a, msgs, lib_mgr, res_mgr, mf, tjunction_jobs);
 	}
 	if (mf) MemFile_Close(mf);
+	RunTJunctionTests(tjunction_jobs, msgs);
 
 
 	// These are programmed to NOT iterate up INTO airports.  But you can START them at an airport.
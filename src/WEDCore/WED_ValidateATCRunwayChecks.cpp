@@ -28,6 +28,7 @@
 #include "CompGeomDefs2.h"
 #include "CompGeomUtils.h"
 #include "GISUtils.h"
+#include "RTree2.h"
 
 static CoordTranslator2 translator;
 
@@ -41,6 +42,37 @@ typedef vector<WED_GISPoint*>      TaxiRouteNodeVec_t;
 typedef vector<RunwayInfo>         RunwayInfoVec_t;
 typedef vector<TaxiRouteInfo>      TaxiRouteInfoVec_t;
 
+// The taxi routes of one airport in an RTree2 by the lat/lon bounds of their segments, built once per airport
+// and shared by the checks of every runway.  A route can only cross a runway's box or have a node in it if its
+// bounds overlap the box's bounds, so the checks below only visit what find() hands them - in collection order,
+// so the messages come out just as the scans over all routes made them.
+struct TaxiRouteIndex
+{
+	TaxiRouteIndex(const TaxiRouteInfoVec_t& in_routes) : routes(in_routes)
+	{
+		vector<RTree2<int, 8>::item_type> items;
+		items.reserve(routes.size());
+		for (int n = 0; n < routes.size(); ++n)
+		{
+			items.push_back(RTree2<int, 8>::item_type(Bbox2(routes[n].taxiroute_segment_geo), n));
+			lookup[routes[n].taxiroute_ptr] = n;
+		}
+		index.insert(items.begin(), items.end());
+	}
+
+	// Indices into routes of every route whose bounds touch where, in ascending order.
+	void find(const Bbox2& where, vector<int>& out)
+	{
+		out.clear();
+		index.query_value(where, back_inserter(out));
+		sort(out.begin(), out.end());
+	}
+
+	const TaxiRouteInfoVec_t&	routes;
+	RTree2<int, 8>				index;
+	map<WED_TaxiRoute*, int>	lookup;
+};
+
 //Collects 'potentially active' runways. 
 // - any runway that is referenced in at least one flow AND there is at least one runway segement taxi route on it
 // - if no flows are defined, all runways are considered active
@@ -599,7 +631,7 @@ static bool TaxiRouteParallelCheck( const RunwayInfo& runway_info,
 }
 
 static bool RunwayHasCorrectCoverage( const RunwayInfo& runway_info,
-									  const TaxiRouteInfoVec_t& all_taxiroutes,
+									  TaxiRouteIndex& all_taxiroutes,
 									  validation_error_vector& msgs,
 									  WED_Airport* apt)
 {
@@ -607,10 +639,14 @@ static bool RunwayHasCorrectCoverage( const RunwayInfo& runway_info,
 
 	vector<WED_GISPoint*> on_pavement_nodes;
 
+	vector<int> near_runway;
+	all_taxiroutes.find(runway_info.corners_geo.bounds(), near_runway);
+
 	//First pass, remove all points that are outside of the runway
-	for (TaxiRouteInfoVec_t::const_iterator itr = all_taxiroutes.begin(); itr != all_taxiroutes.end(); ++itr)
+	for (vector<int>::iterator r = near_runway.begin(); r != near_runway.end(); ++r)
 	{
-		for (vector<WED_GISPoint*>::const_iterator point_itr = itr->nodes.begin(); point_itr != itr->nodes.end(); ++point_itr)
+		const TaxiRouteInfo& route(all_taxiroutes.routes[*r]);
+		for (vector<WED_GISPoint*>::const_iterator point_itr = route.nodes.begin(); point_itr != route.nodes.end(); ++point_itr)
 		{
 			Point2 node;
 			(*point_itr)->GetLocation(gis_Geo, node);
@@ -737,7 +773,9 @@ static bool FindIfMarked( const int runway_number,        //enum from ATCRunwayO
 	return !found_marked;
 }
 
-static TaxiRouteInfoVec_t GetTaxiRoutesFromViewers(const WED_GISPoint* node)
+//Routes the index knows come from it, and only if near says they can hit - the others are never hits, so we
+//don't build their info.  A viewer the index doesn't know (e.g. one inside a hidden group) is always returned.
+static TaxiRouteInfoVec_t GetTaxiRoutesFromViewers(const WED_GISPoint* node, const TaxiRouteIndex& all_taxiroutes, const vector<char>& near)
 {
 	set<WED_Thing*> node_viewers = get_all_visible_viewers(node);
 
@@ -748,7 +786,11 @@ static TaxiRouteInfoVec_t GetTaxiRoutesFromViewers(const WED_GISPoint* node)
 		if(taxiroute != NULL)
 		if(taxiroute->AllowAircraft())
 		{
-			matching_taxiroutes.push_back(TaxiRouteInfo(taxiroute,translator));
+			map<WED_TaxiRoute*, int>::const_iterator known = all_taxiroutes.lookup.find(taxiroute);
+			if(known == all_taxiroutes.lookup.end())
+				matching_taxiroutes.push_back(TaxiRouteInfo(taxiroute,translator));
+			else if(near[known->second])
+				matching_taxiroutes.push_back(all_taxiroutes.routes[known->second]);
 		}
 	}
 
@@ -846,15 +888,36 @@ static Polygon2 MakeHotZoneHitBox( const RunwayInfo& runway_info, // The relaven
 }
 
 static bool DoHotZoneChecks( const RunwayInfo& runway_info,
-							 const TaxiRouteInfoVec_t& all_taxiroutes,
+							 TaxiRouteIndex& all_taxiroutes,
 							 validation_error_vector& msgs,
 							 WED_Airport* apt)
 {
 	int original_num_errors = msgs.size();
 	TaxiRouteNodeVec_t all_nodes;
-	for (int i = 0; i < all_taxiroutes.size(); ++i)
+	for (int i = 0; i < all_taxiroutes.routes.size(); ++i)
+	{
+		copy(all_taxiroutes.routes[i].nodes.begin(), all_taxiroutes.routes[i].nodes.end(), back_inserter(all_nodes));
+	}
+
+	//The hit boxes only depend on the runway, so make them once, and mark the routes that come near either box of a side
+	Polygon2 hit_boxes[2][2];
+	vector<char> near_side[2];
+	for (int runway_side = 0; runway_side < 2; ++runway_side)
 	{
-		copy(all_taxiroutes[i].nodes.begin(), all_taxiroutes[i].nodes.end(), back_inserter(all_nodes));
+		Bbox2 side_bounds;
+		for (int make_arrival = 0; make_arrival < 2; make_arrival++)
+		{
+			hit_boxes[runway_side][make_arrival] = MakeHotZoneHitBox(runway_info, runway_info.runway_numbers[runway_side], (bool)make_arrival);
+			if(hit_boxes[runway_side][make_arrival].empty() == false)
+				side_bounds += hit_boxes[runway_side][make_arrival].bounds();
+		}
+
+		near_side[runway_side].assign(all_taxiroutes.routes.size(), 0);
+		vector<int> near_routes;
+		if(side_bounds.is_null() == false)
+			all_taxiroutes.find(side_bounds, near_routes);
+		for (vector<int>::iterator r = near_routes.begin(); r != near_routes.end(); ++r)
+			near_side[runway_side][*r] = 1;
 	}
 	
 	//runway side 0 is the lower side, 1 is the higher side
@@ -868,7 +931,7 @@ static bool DoHotZoneChecks( const RunwayInfo& runway_info,
 			node_itr != all_nodes.end();
 			++node_itr)
 		{
-			TaxiRouteInfoVec_t taxiroutes = GetTaxiRoutesFromViewers(*node_itr);
+			TaxiRouteInfoVec_t taxiroutes = GetTaxiRoutesFromViewers(*node_itr, all_taxiroutes, near_side[runway_side]);
 			for(TaxiRouteInfoVec_t::iterator taxiroute_itr = taxiroutes.begin(); taxiroute_itr != taxiroutes.end(); ++taxiroute_itr)
 			{
 				//only maakr THE 	departures boxes
@@ -876,8 +939,8 @@ static bool DoHotZoneChecks( const RunwayInfo& runway_info,
 				{
 					int runway_number = runway_info.runway_numbers[runway_side];
 
-					//Make the hitbox baed on the runway and which side (low/high) you're currently on and if you need to be making arrival or departure
-					Polygon2 hit_box = MakeHotZoneHitBox(runway_info, runway_number, (bool)make_arrival);
+					//The hitbox baed on the runway and which side (low/high) you're currently on and if you need to be making arrival or departure
+					const Polygon2& hit_box = hit_boxes[runway_side][make_arrival];
 					if(hit_box.empty() == true)
 					{
 						continue;
@@ -937,7 +1000,7 @@ static bool DoHotZoneChecks( const RunwayInfo& runway_info,
 // flag all ground traffic routes that cross a runways hitbox
 
 static void AnyTruckRouteNearRunway( const RunwayInfo& runway_info,
-							 const TaxiRouteInfoVec_t& all_taxiroutes,
+							 TaxiRouteIndex& all_taxiroutes,
 							 validation_error_vector& msgs,
 							 WED_Airport* apt)
 {
@@ -952,9 +1015,13 @@ static void AnyTruckRouteNearRunway( const RunwayInfo& runway_info,
 	runway_hit_box[1] += len_ext - side_ext;
 	runway_hit_box[2] += len_ext + side_ext;
 	runway_hit_box[3] -= len_ext - side_ext;
+
+	vector<int> near_runway;
+	all_taxiroutes.find(runway_hit_box.bounds(), near_runway);
 	
-	for(TaxiRouteInfoVec_t::const_iterator route_itr = all_taxiroutes.begin(); route_itr != all_taxiroutes.end(); ++route_itr)
+	for(vector<int>::iterator r = near_runway.begin(); r != near_runway.end(); ++r)
 	{
+		const TaxiRouteInfo * route_itr = &all_taxiroutes.routes[*r];
 		if (runway_hit_box.intersects(route_itr->taxiroute_segment_geo) == true)
 		{
 			
@@ -1020,6 +1087,8 @@ void WED_DoATCRunwayChecks(WED_Airport& apt, validation_error_vector& msgs)
 		for(TaxiRouteVec_t::const_iterator itr = all_taxiroutes_plain.begin(); itr != all_taxiroutes_plain.end(); ++itr)
 			all_taxiroutes.push_back(TaxiRouteInfo(*itr,translator));
 		
+		TaxiRouteIndex taxiroute_index(all_taxiroutes);
+		
 		RunwayInfoVec_t potentially_active_runways = CollectPotentiallyActiveRunways(all_taxiroutes, msgs, &apt);
 		
 		ATCRunwayUseVec_t all_use_rules;
@@ -1044,7 +1113,7 @@ void WED_DoATCRunwayChecks(WED_Airport& apt, validation_error_vector& msgs)
 						{
 							if (DoTaxiRouteConnectivityChecks(*runway_info_itr, all_taxiroutes, matching_taxiroutes, msgs, &apt))
 							{
-								if (RunwayHasCorrectCoverage(*runway_info_itr, all_taxiroutes, msgs, &apt))
+								if (RunwayHasCorrectCoverage(*runway_info_itr, taxiroute_index, msgs, &apt))
 								{
 									//Add additional checks as needed here
 								}
@@ -1063,7 +1132,7 @@ void WED_DoATCRunwayChecks(WED_Airport& apt, validation_error_vector& msgs)
 			}
 	#endif
 			AssaignRunwayUse(*runway_info_itr, all_use_rules);
-			bool passes_hotzone_checks = DoHotZoneChecks(*runway_info_itr, all_taxiroutes, msgs, &apt);
+			bool passes_hotzone_checks = DoHotZoneChecks(*runway_info_itr, taxiroute_index, msgs, &apt);
 			//Nothing to do here yet until we have more checks after this
 		}
 	}
@@ -1083,12 +1152,13 @@ void WED_DoATCRunwayChecks(WED_Airport& apt, validation_error_vector& msgs)
 		TaxiRouteInfoVec_t all_truckroutes;
 		for(TaxiRouteVec_t::const_iterator itr = all_truckroutes_plain.begin(); itr != all_truckroutes_plain.end(); ++itr)
 			all_truckroutes.push_back(TaxiRouteInfo(*itr,translator));
+		TaxiRouteIndex truckroute_index(all_truckroutes);
 	
 		for(RunwayInfoVec_t::iterator runway_info_itr = runway_info_vec.begin();
 			runway_info_itr != runway_info_vec.end();
 			++runway_info_itr)
 		{
-			AnyTruckRouteNearRunway(*runway_info_itr, all_truckroutes, msgs, &apt);
+			AnyTruckRouteNearRunway(*runway_info_itr, truckroute_index, msgs, &apt);
 		}
 	}
 	
@@ -23,6 +23,7 @@
 
 #include "WED_XMLReader.h"
 #include "AssertUtils.h"
+#include "MemFileUtils.h"
 
 WED_XMLReader::WED_XMLReader()
 {
@@ -49,54 +50,86 @@ void	WED_XMLReader::FailWithError(const string& e)
 	XML_StopParser(parser, false);		// we're dead!
 }
 
+// Mapped files are handed to expat in slices this big; expat tokenizes straight out of the
+// mapping and only copies the partial token at each slice boundary.
+#define XML_MAP_SLICE (16*1024*1024)
+
+// When the file can't be mapped we read into expat's own buffer so there is no extra copy.
+#define XML_READ_CHUNK (256*1024)
+
 string	WED_XMLReader::ReadFile(const char * filename, bool * exists)
 {
 	XML_ParserReset(parser, NULL);
 	XML_SetElementHandler(parser, StartElementHandler, EndElementHandler);
 	XML_SetUserData(parser, reinterpret_cast<void*>(this));
 
+	MFMemFile * mf = MemFile_Open(filename);
+	if(mf)
+	{
+		if(exists)
+			*exists = true;
+
+		const char * p = MemFile_GetBegin(mf);
+		const char * e = MemFile_GetEnd(mf);
+		do {
+			int len = min((ptrdiff_t) XML_MAP_SLICE, e - p);
+			if(XML_Parse(parser, p, len, p + len == e) == XML_STATUS_ERROR)
+			{
+				parse_error();
+				break;
+			}
+			p += len;
+		} while(p < e);
+
+		MemFile_Close(mf);
+		return finish_error();
+	}
+
 	FILE * fi = fopen(filename,"rb");
 
-	//If it does exist
 	if(exists)
-	{
-		//Something like it the file pointer
 		*exists = (fi != NULL);
-	}
-	//If the file does not exist
 	if(!fi)
 	{
 		return string("Unable to open file:") + string(filename);
 	}
-	char buf[1024];
 
-	//While there is something left to read
-	while(!feof(fi))
+	while(1)
 	{
-		//len is the amount of read in this loop
-		int len = fread(buf,1,sizeof(buf),fi);
-		if(len > 0)
-		if(XML_Parse(parser, buf, len, 0) == XML_STATUS_ERROR)
+		void * buf = XML_GetBuffer(parser, XML_READ_CHUNK);
+		if(buf == NULL)
 		{
-			XML_Error e = XML_GetErrorCode(parser);
-			if(err.empty())
-				err = XML_ErrorString(e);
-			printf("%s At: %zd,%zd\n", err.c_str(), XML_GetCurrentLineNumber(parser), XML_GetCurrentColumnNumber(parser));
+			parse_error();
 			break;
 		}
-		//if total read == 0
-	}
-	//It reads it again so it can finish off any last pieces remaining
-	XML_Parse(parser, buf, 0, 1);
-	XML_Error result = XML_GetErrorCode(parser);
-	 
-	//If the err string is empty and there is some kind of error
-	if(err.empty() &&  result != XML_ERROR_NONE)
-	{
-		err = XML_ErrorString(result);
+		int len = fread(buf,1,XML_READ_CHUNK,fi);
+		int done = len < XML_READ_CHUNK;
+		if(XML_ParseBuffer(parser, len, done) == XML_STATUS_ERROR)
+		{
+			parse_error();
+			break;
+		}
+		if(done)
+			break;
 	}
 	fclose(fi);
 
+	return finish_error();
+}
+
+void	WED_XMLReader::parse_error(void)
+{
+	XML_Error e = XML_GetErrorCode(parser);
+	if(err.empty())
+		err = XML_ErrorString(e);
+	printf("%s At: %zd,%zd\n", err.c_str(), (size_t) XML_GetCurrentLineNumber(parser), (size_t) XML_GetCurrentColumnNumber(parser));
+}
+
+string	WED_XMLReader::finish_error(void)
+{
+	XML_Error result = XML_GetErrorCode(parser);
+	if(err.empty() && result != XML_ERROR_NONE)
+		err = XML_ErrorString(result);
 	return err;
 }
 
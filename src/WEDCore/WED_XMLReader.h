@@ -75,6 +75,9 @@ private:
 	list<bool>				new_handler_for_element;
 	XML_Parser				parser;
 	string					err;
+
+	void	parse_error(void);
+	string	finish_error(void);
 	
 	static void	StartElementHandler(void *userData,
 						const XML_Char *name,
@@ -24,31 +24,92 @@
 #include "WED_XMLWriter.h"
 #include "AssertUtils.h"
 #include "GUI_Unicode.h"
+#include <math.h>
 /*
 	PERFORMANCE NOTES:
 
-	We could improve memory management by allocating a big shared block of memory and just pushing a ptr
-	to get memory to stash strings (rather than using STL strings).
-	
-	If we do this we need to know when to purge out the memory...the answer:
-	
-	- Each time an obj starts using a block, add a ref to it.
-	- Each time the obj is nuked, decrease ref count.
-	- each time the current block is filled, start a new one.
-	
-	The result: as we run through the files and purge out the <object> blocks, 
-	filled blocks will be retired for re-use.  We save a million tiny alloc/deallocs for STL strings.	
+	The old writer kept a map<string,string> of attributes per element, formatted every number with sprintf
+	into a fresh string and wrote with fprintf - a big save was millions of tiny allocations.  Now:
+
+	- Elements are pooled by the top-level element and recycled as soon as they are written, keeping the
+	  capacity of their attribute vectors, so a warm writer doesn't allocate per element.
+	- Attribute values are packed into one text buffer per element; the attribute list is kept sorted
+	  by name on insert, which is the order the old map wrote them in.
+	- Numbers are formatted by hand straight into a stack buffer.  Doubles are still the fixed "%.Nlf"
+	  that the file has always had (so files don't change) - we only fall back to sprintf for the rare
+	  value where the fast rounding can't be trusted to match it.
+	- Everything goes through one large output buffer that is written with fwrite.
 
 */
 
 #define FIX_EMPTY 0
 
-inline void fi_indent(int n, FILE * fi) { while(n--) fputc(' ', fi); }
+#define OUTPUT_BUF_SIZE	(1024*1024)
+
+class	WED_XMLOutput {
+public:
+
+	WED_XMLOutput(FILE * f) : file(f), used(0) { }
+	~WED_XMLOutput()
+	{
+		flush_buf();
+		for(vector<WED_XMLElement *>::iterator e = pool.begin(); e != pool.end(); ++e)
+			delete *e;
+	}
+
+	void	put(char c)
+	{
+		if(used == OUTPUT_BUF_SIZE) flush_buf();
+		buf[used++] = c;
+	}
 
-inline void fi_escape(const char * str, FILE * fi)
+	void	put(const char * s, int len)
+	{
+		while(len > 0)
+		{
+			if(used == OUTPUT_BUF_SIZE) flush_buf();
+			int chunk = min(len, OUTPUT_BUF_SIZE - used);
+			memcpy(buf + used, s, chunk);
+			used += chunk;
+			s += chunk;
+			len -= chunk;
+		}
+	}
+
+	void	put(const char * s) { put(s, strlen(s)); }
+
+	void	put_indent(int n) { while(n--) put(' '); }
+
+	void	flush_buf(void)
+	{
+		if(used) fwrite(buf, 1, used, file);
+		used = 0;
+	}
+
+	WED_XMLElement *	new_element(void)
+	{
+		if(pool.empty())
+			return new WED_XMLElement(this);
+		WED_XMLElement * e = pool.back();
+		pool.pop_back();
+		return e;
+	}
+
+	void				recycle(WED_XMLElement * e) { pool.push_back(e); }
+
+private:
+
+	FILE *						file;
+	int							used;
+	char						buf[OUTPUT_BUF_SIZE];
+	vector<WED_XMLElement *>	pool;
+
+};
+
+inline void fi_escape(const char * str, int len, WED_XMLOutput * fi)
 {
 	UTF8 * b = (UTF8 *) str;
-	UTF8 * e = b + strlen(str);
+	UTF8 * e = b + len;
 	
 	// This fixes a problem, but not the way I intended, and may be worth some examination.
 	// WED uses UTF8.  Period.  That is all it has ever displayed sanely, and it should be the only thing
@@ -70,6 +131,8 @@ inline void fi_escape(const char * str, FILE * fi)
 	// as %#xC5.  On read-in, Expat thinsk this is U+00C5 and gives us the correct 2-byte sequence UTF8 valid
 	// sequence 0xC3 0x85.  This is of course what the user ORIGINALLY wanted.
 	 
+	static const char hex[] = "0123456789ABCDEF";
+
 	while(b < e)
 	{
 		const UTF8 * v = UTF8_ValidRange(b,e);
@@ -77,23 +140,23 @@ inline void fi_escape(const char * str, FILE * fi)
 		{	
 			switch(*b) {
 			case '<':
-				fprintf(fi,"&lt;");
+				fi->put("&lt;",4);
 				break;			
 			case '>':
-				fprintf(fi,"&gt;");
+				fi->put("&gt;",4);
 				break;
 			case '"':
-				fprintf(fi,"&quot;");
+				fi->put("&quot;",6);
 				break;
 			case '&':
-				fprintf(fi,"&amp;");
+				fi->put("&amp;",5);
 				break;
 			default:
 				// This is STILL not ideal - XML disallows anything above #x10FFFF or the surrogate blocks, but 
 				// for now just notice that control chars are bogus.  Drop control chars, there's just no way to
 				// encode them, and frankly they are silly.
 				if(*b >= ' ' || *b == '\t' || *b == '\r' || *b == '\n')
-					fputc(*b,fi);
+					fi->put(*b);
 				break;
 			}
 			++b;
@@ -103,50 +166,160 @@ inline void fi_escape(const char * str, FILE * fi)
 		{
 			// No low-number chars - that blows up the reader.
 			if(*b >= ' ' || *b == '\t' || *b == '\r' || *b == '\n')
-				fprintf(fi,"&#x%02X;",(int) *b);
+			{
+				char ref[6] = { '&', '#', 'x', hex[*b >> 4], hex[*b & 0xF], ';' };
+				fi->put(ref, 6);
+			}
 			++b;
 		}
 	}	
 }
 
+// Writes the digits of v backwards from the end of a buffer, returns the start.
+static char * format_digits(char * end, unsigned long long v, int min_digits)
+{
+	do {
+		*--end = '0' + (v % 10);
+		v /= 10;
+		--min_digits;
+	} while(v || min_digits > 0);
+	return end;
+}
+
+// Same as sprintf(buf,"%d",value), returns the length.
+static int format_int(char * buf, int value)
+{
+	char tmp[16];
+	char * e = tmp + sizeof(tmp);
+	unsigned long long mag = value < 0 ? -(long long) value : value;
+	char * b = format_digits(e, mag, 1);
+	if(value < 0) *--b = '-';
+	memcpy(buf, b, e - b);
+	return e - b;
+}
+
+// Same as sprintf(buf,"%.*lf",dec,value), returns the length.
+// The fast path rounds value * 10^dec to the nearest integer.  The product is off from the exact one by at most half
+// an ulp, which only matters when it lands right at a rounding boundary - then we let the C library do it.
+static int format_fixed(char * buf, int buf_size, double value, int dec)
+{
+	static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17 };
+	static const unsigned long long ipow10[] = { 1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+						1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+						1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL };
+
+	if(dec >= 0 && dec < 18 && value == value)
+	{
+		bool neg = signbit(value);
+		double scaled = fabs(value) * pow10[dec];
+		if(scaled < 4503599627370496.0)												// 2^52 - the integer and fractional parts are exact
+		{
+			double whole = floor(scaled);
+			double frac = scaled - whole;
+			if(fabs(frac - 0.5) > scaled * 4.5e-16 + 1e-300)
+			{
+				unsigned long long q = (unsigned long long) whole + (frac > 0.5 ? 1 : 0);
+				char tmp[48];
+				char * e = tmp + sizeof(tmp);
+				char * b = e;
+				if(dec > 0)
+				{
+					b = format_digits(b, q % ipow10[dec], dec);
+					*--b = '.';
+				}
+				b = format_digits(b, q / ipow10[dec], 1);
+				if(neg) *--b = '-';
+				memcpy(buf, b, e - b);
+				return e - b;
+			}
+		}
+	}
+
+	char fmt[15];
+	sprintf(fmt,"%%.%dlf",dec);
+	int len = snprintf(buf,buf_size,fmt,value);
+	return min(len, buf_size - 1);
+}
+
 WED_XMLElement::WED_XMLElement(
 									const char *		n,
 									int					i,
 									FILE *				f) : 
-	file(f), indent(i), name(n), flushed(false), parent(NULL)
+	flushed(false), output(new WED_XMLOutput(f)), owns_output(true), indent(i), name(n), parent(NULL)
+{
+}
+
+WED_XMLElement::WED_XMLElement(WED_XMLOutput * o) : 
+	flushed(false), output(o), owns_output(false), indent(0), name(NULL), parent(NULL)
 {
 }
 
 WED_XMLElement::~WED_XMLElement()
 {
-	if(!flushed)
+	if(owns_output)
 	{
-		fi_indent(indent, file);
-		fprintf(file,"<%s",name.c_str());
+		finish();
+		delete output;
+	}
+}
 
-		for(map<string,string>::iterator a = attrs.begin(); a != attrs.end(); ++a)
-		{
-			fprintf(file," %s=\"", a->first.c_str());
-			fi_escape(a->second.c_str(), file);
-			fputc('"',file);
-		}
-		
-		if(children.empty())
-			fprintf(file,"/>\n");
-		else
-			fprintf(file,">\n");
+void WED_XMLElement::init(const char * n, int i, WED_XMLElement * p)
+{
+	flushed = false;
+	indent = i;
+	name = n;
+	parent = p;
+	attrs.clear();
+	attr_text.clear();
+	children.clear();
+}
+
+void WED_XMLElement::write_open_tag(bool no_children)
+{
+	output->put_indent(indent);
+	output->put('<');
+	output->put(name);
+
+	for(vector<attr_t>::iterator a = attrs.begin(); a != attrs.end(); ++a)
+	{
+		output->put(' ');
+		output->put(a->name);
+		output->put("=\"",2);
+		if(a->len)
+			fi_escape(&attr_text[a->value], a->len, output);
+		output->put('"');
 	}
 	
+	if(no_children)
+		output->put("/>\n",3);
+	else
+		output->put(">\n",2);
+}
+
+// Writes whatever is left of us - our tag if nobody flushed it yet, our kids and our closing tag.
+void WED_XMLElement::finish(void)
+{
+	if(!flushed)
+		write_open_tag(children.empty());
+	
 	for(vector<WED_XMLElement *>::iterator c = children.begin(); c != children.end(); ++c)
-		delete *c;
+		(*c)->retire();
 	
 	if(!children.empty() || flushed)
 	{
-		fi_indent(indent,file);
-		fprintf(file,"</%s>\n",name.c_str());
+		output->put_indent(indent);
+		output->put("</",2);
+		output->put(name);
+		output->put(">\n",2);
 	}
 }
 
+void WED_XMLElement::retire(void)
+{
+	finish();
+	output->recycle(this);
+}
+
 void WED_XMLElement::flush()
 {
 	flush_from(NULL);
@@ -161,25 +334,13 @@ void WED_XMLElement::flush_from(WED_XMLElement * who)
 	parent = NULL;
 	
 	if(!flushed)
-	{
-		fi_indent(indent, file);
-		fprintf(file,"<%s",name.c_str());
-
-		for(map<string,string>::iterator a = attrs.begin(); a != attrs.end(); ++a)
-		{
-			fprintf(file," %s=\"", a->first.c_str());
-			fi_escape(a->second.c_str(), file);
-			fputc('"',file);
-		}
-		
-		fprintf(file,">\n");
-	}
+		write_open_tag(false);
 	
 	DebugAssert(who == children.back() || who == NULL);
 	
 	for(vector<WED_XMLElement *>::iterator c = children.begin(); c != children.end(); ++c)
 	if(*c != who)
-		delete *c;
+		(*c)->retire();
 
 	children.clear();
 	if(who)
@@ -187,6 +348,23 @@ void WED_XMLElement::flush_from(WED_XMLElement * who)
 	flushed = true;
 }
 
+// Attributes are kept sorted by name, and setting one twice replaces the value - just like the map we used to have.
+void WED_XMLElement::set_attr(const char * n, const char * value, int len)
+{
+	DebugAssert(!flushed);
+	vector<attr_t>::iterator a = attrs.begin();
+	int cmp = 1;
+	while(a != attrs.end() && (cmp = strcmp(a->name, n)) < 0)
+		++a;
+	if(a == attrs.end() || cmp != 0)
+	{
+		attr_t na = { n, 0, 0 };
+		a = attrs.insert(a, na);
+	}
+	a->value = attr_text.size();
+	a->len = len;
+	attr_text.insert(attr_text.end(), value, value + len);
+}
 	
 void					WED_XMLElement::add_attr_int(const char * name, int value)
 {
@@ -195,10 +373,8 @@ void					WED_XMLElement::add_attr_int(const char * name, int value)
 #else
 	DebugAssert(name && *name);	
 #endif
-	DebugAssert(!flushed);
-	char buf[256];
-	sprintf(buf,"%d",value);
-	attrs[name] = buf;
+	char buf[16];
+	set_attr(name, buf, format_int(buf, value));
 }
 
 void					WED_XMLElement::add_attr_double(const char * name, double value, int dec)
@@ -208,11 +384,8 @@ void					WED_XMLElement::add_attr_double(const char * name, double value, int de
 #else
 	DebugAssert(name && *name);	
 #endif
-	DebugAssert(!flushed);
-	char fmt[15], buf[256];
-	sprintf(fmt,"%%.%dlf",dec);
-	sprintf(buf,fmt,value);
-	attrs[name] = buf;
+	char buf[512];
+	set_attr(name, buf, format_fixed(buf, sizeof(buf), value, dec));
 }
 
 void					WED_XMLElement::add_attr_c_str(const char * name, const char * str)
@@ -223,8 +396,7 @@ void					WED_XMLElement::add_attr_c_str(const char * name, const char * str)
 #else
 	DebugAssert(name && *name && str && *str);
 #endif
-	DebugAssert(!flushed);
-	attrs[name] = str;
+	set_attr(name, str, strlen(str));
 }
 
 void					WED_XMLElement::add_attr_stl_str(const char * name, const string& str)
@@ -234,8 +406,7 @@ void					WED_XMLElement::add_attr_stl_str(const char * name, const string& str)
 #else
 	DebugAssert(name && *name);	
 #endif
-	DebugAssert(!flushed);
-	attrs[name] = str;
+	set_attr(name, str.c_str(), strlen(str.c_str()));		// Not size() - the old writer stopped at an embedded nul too.
 }
 
 WED_XMLElement *		WED_XMLElement::add_sub_element(const char * name)
@@ -246,9 +417,9 @@ WED_XMLElement *		WED_XMLElement::add_sub_element(const char * name)
 	DebugAssert(name && *name);	
 #endif
 
-	WED_XMLElement * child = new WED_XMLElement(name, indent + 4, file);
+	WED_XMLElement * child = output->new_element();
+	child->init(name, indent + 4, this);
 	children.push_back(child);
-	child->parent = this;
 	return child;
 }
 
@@ -261,14 +432,9 @@ WED_XMLElement *		WED_XMLElement::add_or_find_sub_element(const char * name)
 #endif
 
 	DebugAssert(!flushed);
-	string n(name);
 	for(int i = 0; i < children.size(); ++i)
-	if(children[i]->name == n)
+	if(strcmp(children[i]->name, name) == 0)
 		return children[i];
 		
-	WED_XMLElement * child = new WED_XMLElement(name, indent + 4, file);
-	children.push_back(child);
-	child->parent = this;
-	return child;
-	
+	return add_sub_element(name);
 }
@@ -26,12 +26,25 @@
 
 /* 
 	IMPORTANT: const char * name parameters must be "permanent" - that is, they need to remain
-	valid for the duration of the XML element's life.
+	valid for the duration of the XML element's life.  Element and attribute names are NOT copied:
+	the element keeps the pointer until it has written its close tag, which may be well after the
+	call that passed it (at the next flush, or when the top level element is destroyed).  Pass string
+	literals, or strings that live at least as long as the save (e.g. the static property titles
+	WED_PropertyHelper hands in).  Never pass the c_str() of a temporary or a local buffer.
 	
-	C strings passed to add_attr_c_str are copied - you don't need to retire them.
+	C strings passed to add_attr_c_str are copied - you don't need to retire them.  So are the
+	values of every other add_attr call.
+
+	The writer streams: the top level element (the one you construct) owns a big output buffer that
+	is written with large fwrites, plus a pool of sub-elements that are recycled once they have been
+	written out.  Each element keeps its attributes sorted by name in a small vector with their values
+	packed into one text buffer, so once the pool is warm a save does not hit the heap per element.
+	The output is exactly what the old map-of-strings/fprintf writer produced.
 
  */
 
+class	WED_XMLOutput;
+
 class	WED_XMLElement {
 public:
 
@@ -59,15 +72,35 @@ public:
 	
 private:
 
+	struct	attr_t {
+		const char *	name;			// Borrowed - see above.
+		int				value;			// Offset of the value in attr_text
+		int				len;
+	};
+
+							 WED_XMLElement(WED_XMLOutput * output);
+
+	void					init(const char * name, int indent, WED_XMLElement * parent);
+	void					set_attr(const char * name, const char * value, int len);
+	void					write_open_tag(bool no_children);
+	void					finish(void);
+	void					retire(void);
 	void					flush_from(WED_XMLElement * child);
 
 		bool									flushed;
-		FILE *									file;
+		WED_XMLOutput *							output;
+		bool									owns_output;
 		int										indent;
-		string									name;
-		map<string,string>						attrs;
+		const char *							name;			// Borrowed - see above.
+		vector<attr_t>							attrs;
+		vector<char>							attr_text;
 		vector<WED_XMLElement *>				children;
 		WED_XMLElement *						parent;
+
+	friend class WED_XMLOutput;
+	
+	WED_XMLElement(const WED_XMLElement&);
+	WED_XMLElement& operator=(const WED_XMLElement&);
 };	
 	
 #endif /* WED_XMLWriter_H */
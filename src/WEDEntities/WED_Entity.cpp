@@ -86,7 +86,10 @@ void	WED_Entity::CacheInval(int flags)
 		{
 			WED_Entity * e = dynamic_cast<WED_Entity *>(p);
 			if (e)
+			{
+				e->ChildCacheInval(this, new_invals);
 				e->CacheInval(new_invals);
+			}
 		}
 		set<WED_Thing *>	viewers;
 		GetAllViewers(viewers);
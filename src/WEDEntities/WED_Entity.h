@@ -122,6 +122,10 @@ protected:
 			void	CacheInval(int flags);				// Invalidate the cache.
 			int		CacheBuild(int flags) const;		// Set cache to valid.  Returns true if cache needed rebuilding
 
+	// Called on our parent entity with the newly invalidated flags whenever one of its children's caches goes
+	// invalid - even if the parent's own cache already is - so that a parent can track which children changed.
+	virtual	void	ChildCacheInval(WED_Entity * child, int flags) { }
+
 	virtual	void	AddChild(int id, int n);
 	virtual	void	RemoveChild(int id);
 	virtual	void	AddViewer(int id);
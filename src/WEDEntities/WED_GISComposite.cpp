@@ -25,7 +25,14 @@
 
 TRIVIAL_COPY(WED_GISComposite, WED_Entity)
 
-WED_GISComposite::WED_GISComposite(WED_Archive * a, int i) : WED_Entity(a,i)
+// Below this many children a linear walk beats building and querying the tree.
+#define	MIN_CHILDREN_FOR_INDEX	32
+
+// Moved children are tested linearly on every query, so once more than 1 in this many children has moved,
+// the tree is rebuilt instead.
+#define	INDEX_OVERFLOW_FRACTION	16
+
+WED_GISComposite::WED_GISComposite(WED_Archive * a, int i) : WED_Entity(a,i), mIndexValid(false)
 {
 }
 
@@ -72,6 +79,17 @@ bool			WED_GISComposite::IntersectsBox	(GISLayer_t l, const Bbox2&  bounds) cons
 	GetBounds(l,me);
 	if (!bounds.overlap(me)) return false;
 
+	if (l == gis_Geo)
+	{
+		vector<IGISEntity *>	near;
+		GetEntitiesInBox(bounds, near);
+		for (vector<IGISEntity *>::iterator i = near.begin(); i != near.end(); ++i)
+			if ((*i)->IntersectsBox(l,bounds))
+			if(!IsWEDLocked(*i))
+				return true;
+		return false;
+	}
+
 	int n = GetNumEntities();
 	for (int i = 0; i < n; ++i)
 		if (GetNthEntity(i)->IntersectsBox(l,bounds)) 
@@ -98,6 +116,17 @@ bool			WED_GISComposite::PtWithin		(GISLayer_t l, const Point2& p	 ) const
 	GetBounds(l, me);
 	if (!me.contains(p)) return false;
 
+	if (l == gis_Geo)
+	{
+		vector<IGISEntity *>	near;
+		GetEntitiesInBox(Bbox2(p), near);
+		for (vector<IGISEntity *>::iterator i = near.begin(); i != near.end(); ++i)
+			if ((*i)->PtWithin(l, p))
+			if(!IsWEDLocked(*i))
+				return true;
+		return false;
+	}
+
 	int n = GetNumEntities();
 	for (int i = 0; i < n; ++i)
 		if (GetNthEntity(i)->PtWithin(l, p)) 
@@ -114,6 +143,19 @@ bool			WED_GISComposite::PtOnFrame		(GISLayer_t l, const Point2& p, double d) co
 	me.p2 += Vector2(d,d);
 	if (!me.contains(p)) return false;
 
+	if (l == gis_Geo)
+	{
+		Bbox2	near_p(p);
+		near_p.expand(d);
+		vector<IGISEntity *>	near;
+		GetEntitiesInBox(near_p, near);
+		for (vector<IGISEntity *>::iterator i = near.begin(); i != near.end(); ++i)
+			if ((*i)->PtOnFrame(l, p, d))
+			if(!IsWEDLocked(*i))
+				return true;
+		return false;
+	}
+
 	int n = GetNumEntities();
 	for (int i = 0; i < n; ++i)
 		if (GetNthEntity(i)->PtOnFrame(l, p, d)) 
@@ -131,9 +173,10 @@ bool WED_GISComposite::Cull(const Bbox2& b) const
 	if(!b.overlap(me))
 		return false;
 	
-	int n = GetNumEntities();
-	for (int i = 0; i < n; ++i)
-		if(GetNthEntity(i)->Cull(b))
+	vector<IGISEntity *>	near;
+	GetEntitiesInBox(b, near);
+	for (vector<IGISEntity *>::iterator i = near.begin(); i != near.end(); ++i)
+		if((*i)->Cull(b))
 			return true;
 	return false;	
 }
@@ -177,9 +220,138 @@ IGISEntity *	WED_GISComposite::GetNthEntity  (int n) const
 	return mEntities[n];
 }
 
+// The tree is keyed on each child's bounds - padded by the art-asset fudge factor for the kinds of children
+// whose Cull reaches past their bounds (composites, objects and other heading points, runways with their
+// blast pads and shoulders), so that a box query never misses something Cull would have accepted.  Returns
+// false for a child with no bounds.
+static bool	ChildIndexBounds(IGISEntity * ent, Bbox2& out_bounds)
+{
+	ent->GetBounds(gis_Geo, out_bounds);
+	if (out_bounds.is_null())
+		return false;
+	switch(ent->GetGISClass()) {
+	case gis_Composite:
+	case gis_Point_Heading:
+	case gis_Point_HeadingWidthLength:
+	case gis_Line_Width:
+		out_bounds.expand(GLOBAL_WED_ART_ASSET_FUDGE_FACTOR);
+		break;
+	default:
+		break;
+	}
+	return true;
+}
+
+void	WED_GISComposite::GetEntitiesInBox(const Bbox2& bounds, vector<IGISEntity *>& out_entities) const
+{
+	RebuildCache(CacheBuild(cache_Spatial|cache_Topological));
+	out_entities.clear();
+
+	int n = mEntities.size();
+	if (n < MIN_CHILDREN_FOR_INDEX)
+	{
+		out_entities = mEntities;
+		return;
+	}
+
+	if (mIndexValid)
+		FlushIndexChanges();
+	if (!mIndexValid)
+		RebuildIndex();
+
+	// Tree and unbounded hits for moved children are stale - those are re-tested from their current bounds.
+	vector<int>	hits;
+	for (vector<int>::iterator u = mIndexUnbounded.begin(); u != mIndexUnbounded.end(); ++u)
+		if (!mIndexIsOverflow[*u])
+			hits.push_back(*u);
+	if (mIndexOverflow.empty())
+		mIndex.query_value(bounds, back_inserter(hits));
+	else
+	{
+		vector<int>	tree_hits;
+		mIndex.query_value(bounds, back_inserter(tree_hits));
+		for (vector<int>::iterator t = tree_hits.begin(); t != tree_hits.end(); ++t)
+			if (!mIndexIsOverflow[*t])
+				hits.push_back(*t);
+		for (vector<int>::iterator o = mIndexOverflow.begin(); o != mIndexOverflow.end(); ++o)
+		{
+			Bbox2	child;
+			if (!ChildIndexBounds(mEntities[*o], child) || bounds.overlap(child))
+				hits.push_back(*o);
+		}
+	}
+	sort(hits.begin(), hits.end());
+	out_entities.reserve(hits.size());
+	for (vector<int>::iterator h = hits.begin(); h != hits.end(); ++h)
+		out_entities.push_back(mEntities[*h]);
+}
+
+// A moved child only tells us who it is; it goes onto the overflow list at the next query, when the child list
+// is known to match the tree.
+void	WED_GISComposite::ChildCacheInval(WED_Entity * child, int flags)
+{
+	if (!mIndexValid || !(flags & cache_Spatial))
+		return;
+	if (mIndexChanged.size() >= mIndexLookup.size())
+	{
+		mIndexValid = false;
+		mIndexChanged.clear();
+		return;
+	}
+	IGISEntity * ent = dynamic_cast<IGISEntity *>(child);
+	if (ent)
+		mIndexChanged.push_back(ent);
+}
+
+void	WED_GISComposite::FlushIndexChanges(void) const
+{
+	for (vector<IGISEntity *>::iterator c = mIndexChanged.begin(); c != mIndexChanged.end(); ++c)
+	{
+		vector<pair<IGISEntity *, int> >::iterator l = lower_bound(mIndexLookup.begin(), mIndexLookup.end(), pair<IGISEntity *, int>(*c, -1));
+		if (l != mIndexLookup.end() && l->first == *c && !mIndexIsOverflow[l->second])
+		{
+			mIndexIsOverflow[l->second] = 1;
+			mIndexOverflow.push_back(l->second);
+		}
+	}
+	mIndexChanged.clear();
+	if (mIndexOverflow.size() * INDEX_OVERFLOW_FRACTION > mEntities.size())
+		mIndexValid = false;
+}
+
+void	WED_GISComposite::RebuildIndex(void) const
+{
+	vector<ChildIndex::item_type>	items;
+	mIndexUnbounded.clear();
+	mIndexChanged.clear();
+	mIndexOverflow.clear();
+	mIndexIsOverflow.assign(mEntities.size(), 0);
+	mIndexLookup.resize(mEntities.size());
+	items.reserve(mEntities.size());
+
+	for (int i = 0; i < mEntities.size(); ++i)
+	{
+		mIndexLookup[i] = pair<IGISEntity *, int>(mEntities[i], i);
+		Bbox2	child;
+		if (ChildIndexBounds(mEntities[i], child))
+			items.push_back(ChildIndex::item_type(child, i));
+		else
+			mIndexUnbounded.push_back(i);
+	}
+	sort(mIndexLookup.begin(), mIndexLookup.end());
+
+	mIndex.insert(items.begin(), items.end());
+	mIndexValid = true;
+}
+
 
 void	WED_GISComposite::RebuildCache(int flags) const
 {
+	// Moved children are tracked one by one through ChildCacheInval; only a change to the child list
+	// throws the whole tree away.
+	if(flags & cache_Topological)
+		mIndexValid = false;
+
 	if(flags & cache_Topological)
 	{
 		mEntities.clear();
@@ -26,6 +26,7 @@
 
 #include "WED_Entity.h"
 #include "IGIS.h"
+#include "RTree2.h"
 
 class	WED_GISComposite : public WED_Entity, public virtual IGISComposite {
 
@@ -49,14 +50,36 @@ public:
 	virtual	int				GetNumEntities(void ) const;
 	virtual	IGISEntity *	GetNthEntity  (int n) const;
 
+	// Spatial query over our direct children: every child that could pass Cull or a hit-test inside "bounds",
+	// in child order.  This is a superset - callers still Cull/test what comes back.  Big composites answer
+	// from an R-tree of their children's bounds, rebuilt lazily after a topological change; children that
+	// merely moved since then go on an overflow list that is tested linearly, until it gets long enough that
+	// rebuilding the tree is cheaper.
+			void			GetEntitiesInBox(const Bbox2& bounds, vector<IGISEntity *>& out_entities) const;
+
+protected:
+
+	virtual	void			ChildCacheInval(WED_Entity * child, int flags);
+
 private:
 
 			void			RebuildCache(int flags) const;
+			void			RebuildIndex(void) const;
+			void			FlushIndexChanges(void) const;
+
+	typedef	RTree2<int, 8>			ChildIndex;
 
 	mutable	Bbox2					mCacheBounds;
 	mutable	Bbox2					mCacheBoundsUV;
 	mutable	bool					mHasUV;
 	mutable	vector<IGISEntity *>	mEntities;
+	mutable	ChildIndex				mIndex;			// Child indices keyed by (padded) child bounds
+	mutable	vector<int>				mIndexUnbounded;	// Children with no bounds - always returned
+	mutable	bool					mIndexValid;
+	mutable	vector<pair<IGISEntity *, int> >	mIndexLookup;		// Child to index, sorted by child
+	mutable	vector<IGISEntity *>	mIndexChanged;		// Children reported moved since the last query
+	mutable	vector<int>				mIndexOverflow;		// Children whose entry in the tree is stale...
+	mutable	vector<char>			mIndexIsOverflow;	// ...and a flag per child for the same
 
 };
 
@@ -34,6 +34,7 @@
 #include <curl/curl.h>
 #include <json/json.h>
 #include "RAII_Classes.h"
+#include "WED_GatewayPack.h"
 
 #include <sstream>
 
@@ -228,8 +229,8 @@ private:
 	//Where the airport metadata csv file was ultimately downloaded to
 	string              mAirportMetadataCSVPath;
 
-	//The buffers of the specific packs downloaded at the end
-	vector<string>	mSpecificBufs;
+	//The cache files of the specific packs downloaded, imported at the end
+	vector<string>	mSpecificPaths;
 
 //--GUI parts
 
@@ -297,7 +298,7 @@ private:
 
 	//Once a specific version is downloaded this method decodes and imports it into the document
 	//Returns a pointer to the last imported airport
-	WED_Airport * ImportSpecificVersion(const string& json_string);
+	WED_Airport * ImportSpecificVersion(const string& json_path);
 
 	//Keeps the versions downloading until they have all been (atleast attempted to download)
 	//returns false if there is nothing left in the queue
@@ -535,7 +536,6 @@ void WED_GatewayImportDialog::Back()
 	DecorateGUIWindow();//Decorate once we're in the correct place
 }
 
-extern "C" void decode( const char * startP, const char * endP, char * destP, char ** out);
 void WED_GatewayImportDialog::TimerFired()
 {
 	WED_file_cache_response res = WED_file_cache_request_file(mCacheRequest);
@@ -568,7 +568,53 @@ void WED_GatewayImportDialog::TimerFired()
 		mPhase++;
 		DecorateGUIWindow();
 		
-		if(res.out_status == cache_status_available)
+		if(res.out_status == cache_status_available && mPhase - 1 >= imp_dialog_download_specific_version) // -1 to counter act the mPhase++, >= for the fact we have multiple downloads
+		{
+			//Scenery packs can be big - don't hold them in memory, import them from the cache once they are all here
+			mSpecificPaths.push_back(res.out_path);
+
+			//Try to start the next download
+			bool has_versions_left = NextVersionsDownload();
+
+			//We're all done with everything!
+			if(has_versions_left == false)
+			{
+				WED_Thing * wrl = WED_GetWorld(mResolver);
+				wrl->StartOperation("Import Scenery Pack");
+
+				WED_Airport * last_imported = NULL;
+
+				//If it fails anywhere inside it will soon be destroyed
+				for (int i = 0; i < mSpecificPaths.size(); i++)
+				{
+					last_imported = ImportSpecificVersion(mSpecificPaths[i]);
+
+					//We completely abort if _anything_ goes wrong
+					if(last_imported == NULL)
+					{
+						wrl->AbortOperation();
+						this->AsyncDestroy();//All done!
+						return;
+					}
+				}
+
+				//Set the current airport in the sense of "WED's current airport"
+				WED_SetCurrentAirport(mResolver, last_imported);
+
+				//Select the current airport in the sense of selecting something on the map pane
+				ISelection * sel = WED_GetSelect(mResolver);
+				sel->Clear();
+				sel->Insert(last_imported);
+
+				//Zoom to the airport
+				mMapPane->ZoomShowSel();
+
+				wrl->CommitOperation();
+				this->AsyncDestroy();//All done!
+			}
+			return;
+		}
+		else if(res.out_status == cache_status_available)
 		{
 			//Attempt to open the file we just downloaded
 			RAII_FileHandle file(res.out_path.c_str(),"r");
@@ -593,52 +639,6 @@ void WED_GatewayImportDialog::TimerFired()
 				{
 					FillVersionsFromJSON(file_contents);
 				}
-				else if(mPhase - 1 >= imp_dialog_download_specific_version) // -1 to counter act the mPhase++, >= for the fact we have multiple downloads
-				{
-					//Push back the latest buffer
-					mSpecificBufs.push_back(file_contents);
-				
-					//Try to start the next download
-					bool has_versions_left = NextVersionsDownload();
-				
-					//We're all done with everything!
-					if(has_versions_left == false)
-					{
-						WED_Thing * wrl = WED_GetWorld(mResolver);
-						wrl->StartOperation("Import Scenery Pack");
-					
-						WED_Airport * last_imported = NULL;
-					
-						//If it fails anywhere inside it will soon be destroyed
-						for (int i = 0; i < mSpecificBufs.size(); i++)
-						{
-							last_imported = ImportSpecificVersion(mSpecificBufs[i]);
-						
-							//We completely abort if _anything_ goes wrong
-							if(last_imported == NULL)
-							{
-								wrl->AbortOperation();
-								this->AsyncDestroy();//All done!
-								return;
-							}
-						}
-
-						//Set the current airport in the sense of "WED's current airport"
-						WED_SetCurrentAirport(mResolver, last_imported);
-
-						//Select the current airport in the sense of selecting something on the map pane
-						ISelection * sel = WED_GetSelect(mResolver);
-						sel->Clear();
-						sel->Insert(last_imported);
-
-						//Zoom to the airport
-						mMapPane->ZoomShowSel();
-
-						wrl->CommitOperation();
-						this->AsyncDestroy();//All done!
-						return;
-					}
-				}//end if(mPhase == imp_dialog_download_specific_version)
 				return;
 			}
 			file.close();
@@ -972,12 +972,24 @@ bool WED_GatewayImportDialog::NextVersionsDownload()
 	return true;
 }
 
-WED_Airport * WED_GatewayImportDialog::ImportSpecificVersion(const string& json_string)
+WED_Airport * WED_GatewayImportDialog::ImportSpecificVersion(const string& json_path)
 {
-	//Now that we have our rawJSONString we'll be turning it into a JSON object
-	Json::Value root = Json::Value(Json::objectValue);
-	Json::Reader reader;
-	bool success = reader.parse(json_string,root);
+	//The scenery pack stays in the cache file - map it and pick out the members we need,
+	//decoding the zip blob straight from the mapped text.
+	MFMemFile * json_file = MemFile_Open(json_path.c_str());
+	if(json_file == NULL)
+	{
+		mPhase = imp_dialog_error;
+		DecorateGUIWindow("Could not open " + json_path + ". Check if the file exists or if you have sufficient permissions");
+		this->AsyncDestroy();
+		return NULL;
+	}
+
+	string mICAOid;
+	int sceneryId = 0;
+	vector<char> outString;
+	bool success = WED_ReadGatewayPack(MemFile_GetBegin(json_file), MemFile_GetEnd(json_file), mICAOid, sceneryId, outString);
+	MemFile_Close(json_file);
 
 	//Check for errors
 	if(success == false)
@@ -992,15 +1004,6 @@ WED_Airport * WED_GatewayImportDialog::ImportSpecificVersion(const string& json_
 		return NULL;
 	}
 
-	string zipString = root["scenery"]["masterZipBlob"].asString();
-	vector<char> outString = vector<char>(zipString.length());
-
-	char * outP;
-	decode(&*zipString.begin(),&*zipString.end(),&*outString.begin(),&outP);
-				
-	//Fixes the terrible vector padding bug by shrinking it back down to precisely the correct size
-	outString.resize(outP - &*outString.begin());
-
 #if TEST_AT_START
 	//Anything beyond cannot be tested at the start or wouldn't be useful.
 	return NULL;
@@ -1010,7 +1013,6 @@ WED_Airport * WED_GatewayImportDialog::ImportSpecificVersion(const string& json_
 	ILibrarian * lib = WED_GetLibrarian(mResolver);
     lib->LookupPath(filePath);
 
-	string mICAOid = root["scenery"]["icao"].asString();
 	string zipPath = filePath + mICAOid + ".zip";
 
 	if(!outString.empty())
@@ -1079,7 +1081,7 @@ WED_Airport * WED_GatewayImportDialog::ImportSpecificVersion(const string& json_
 	if(!out_apt.empty())
 	{
 		g = out_apt[0];
-		g->SetSceneryID(root["scenery"]["sceneryId"].asInt());
+		g->SetSceneryID(sceneryId);
 	}
 
 	string dsfTextPath = filePath + mICAOid + ".txt";
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "WED_GatewayPack.h"
+
+extern "C" void decode( const char * startP, const char * endP, char * destP, char ** out);
+
+//--JSON scanning code for picking a few members out of a scenery pack--
+//A scenery pack is mostly one huge base64 string. Rather than building a DOM of the whole
+//document (and a second copy of the blob inside it) we walk the text, skipping values we
+//don't care about and only ever looking at the members we need.
+//All of these return NULL if the JSON is malformed.
+
+static const char * json_skip_ws(const char * p, const char * e)
+{
+	while(p < e && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+		++p;
+	return p;
+}
+
+//p points at the opening quote, returns the character after the closing quote
+static const char * json_skip_string(const char * p, const char * e)
+{
+	if(p >= e || *p != '"')
+		return NULL;
+	for(++p; p < e; ++p)
+	{
+		if(*p == '\\')
+			++p;
+		else if(*p == '"')
+			return p + 1;
+	}
+	return NULL;
+}
+
+static const char * json_skip_value(const char * p, const char * e)
+{
+	p = json_skip_ws(p,e);
+	if(p >= e)
+		return NULL;
+	if(*p == '"')
+		return json_skip_string(p,e);
+	if(*p == '{' || *p == '[')
+	{
+		//Strings are the only place brackets don't count, so we only need a depth counter
+		int depth = 0;
+		while(p < e)
+		{
+			if(*p == '"')
+			{
+				p = json_skip_string(p,e);
+				if(p == NULL)
+					return NULL;
+				continue;
+			}
+			if(*p == '{' || *p == '[')
+				++depth;
+			else if(*p == '}' || *p == ']')
+			{
+				if(--depth == 0)
+					return p + 1;
+			}
+			++p;
+		}
+		return NULL;
+	}
+	//Numbers, true, false, null
+	while(p < e && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r')
+		++p;
+	return p;
+}
+
+//p points at an object, returns the start of the value of member key
+static const char * json_find_member(const char * p, const char * e, const char * key)
+{
+	p = json_skip_ws(p,e);
+	if(p >= e || *p != '{')
+		return NULL;
+	size_t key_len = strlen(key);
+	++p;
+	while(1)
+	{
+		p = json_skip_ws(p,e);
+		if(p >= e || *p == '}')
+			return NULL;
+		const char * name = p + 1;
+		p = json_skip_string(p,e);
+		if(p == NULL)
+			return NULL;
+		bool match = (p - 1 - name) == key_len && strncmp(name,key,key_len) == 0;
+		p = json_skip_ws(p,e);
+		if(p >= e || *p != ':')
+			return NULL;
+		p = json_skip_ws(p + 1,e);
+		if(match)
+			return p;
+		p = json_skip_value(p,e);
+		if(p == NULL)
+			return NULL;
+		p = json_skip_ws(p,e);
+		if(p < e && *p == ',')
+			++p;
+	}
+}
+
+//p points at a string, appends its unescaped contents to out
+template <class Buf>
+static bool json_get_string(const char * p, const char * e, Buf& out)
+{
+	const char * end = json_skip_string(p,e);
+	if(end == NULL)
+		return false;
+	for(++p, --end; p < end; ++p)
+	{
+		if(*p != '\\')
+		{
+			out.push_back(*p);
+			continue;
+		}
+		++p;
+		switch(*p) {
+		case 'b':	out.push_back('\b');	break;
+		case 'f':	out.push_back('\f');	break;
+		case 'n':	out.push_back('\n');	break;
+		case 'r':	out.push_back('\r');	break;
+		case 't':	out.push_back('\t');	break;
+		case 'u':
+			{
+				if(end - p < 5)
+					return false;
+				char hex[5] = { p[1], p[2], p[3], p[4], 0 };
+				unsigned int c = strtoul(hex,NULL,16);
+				p += 4;
+				//A UTF-16 surrogate pair is one code point - four bytes of UTF-8, not two three-byte halves.
+				//A lone surrogate is passed through the way it always was.
+				if(c >= 0xD800 && c < 0xDC00 && end - p >= 7 && p[1] == '\\' && p[2] == 'u')
+				{
+					char lo_hex[5] = { p[3], p[4], p[5], p[6], 0 };
+					unsigned int lo = strtoul(lo_hex,NULL,16);
+					if(lo >= 0xDC00 && lo < 0xE000)
+					{
+						c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00);
+						p += 6;
+					}
+				}
+				if(c < 0x80)
+					out.push_back(c);
+				else if(c < 0x800)
+				{
+					out.push_back(0xC0 | (c >> 6));
+					out.push_back(0x80 | (c & 0x3F));
+				}
+				else if(c < 0x10000)
+				{
+					out.push_back(0xE0 | (c >> 12));
+					out.push_back(0x80 | ((c >> 6) & 0x3F));
+					out.push_back(0x80 | (c & 0x3F));
+				}
+				else
+				{
+					out.push_back(0xF0 | (c >> 18));
+					out.push_back(0x80 | ((c >> 12) & 0x3F));
+					out.push_back(0x80 | ((c >> 6) & 0x3F));
+					out.push_back(0x80 | (c & 0x3F));
+				}
+			}
+			break;
+		default:	out.push_back(*p);		break;	// \" \\ \/
+		}
+	}
+	return true;
+}
+//---------------------------------------------------------------------------//
+
+bool	WED_ReadGatewayPack(const char * inBegin, const char * inEnd, string& outICAO, int& outSceneryID, vector<char>& outZip)
+{
+	outICAO.clear();
+	outSceneryID = 0;
+	outZip.clear();
+
+	const char * scenery = json_find_member(inBegin, inEnd, "scenery");
+	const char * icao = scenery ? json_find_member(scenery, inEnd, "icao") : NULL;
+	const char * id = scenery ? json_find_member(scenery, inEnd, "sceneryId") : NULL;
+	const char * blob = scenery ? json_find_member(scenery, inEnd, "masterZipBlob") : NULL;
+
+	if(icao == NULL || blob == NULL || !json_get_string(icao, inEnd, outICAO))
+		return false;
+	if(id)
+		outSceneryID = atoi(id);
+
+	//Post-B64 decoding is always smaller than the text, and decode never writes past what it has read,
+	//so the blob is unescaped and then decoded in the same buffer.
+	const char * blob_end = json_skip_string(blob, inEnd);
+	outZip.reserve(blob_end ? blob_end - blob : 0);
+	if(!json_get_string(blob, inEnd, outZip))
+		return false;
+
+	char * outP = outZip.empty() ? NULL : &*outZip.begin();
+	if(outP)
+		decode(outP,outP + outZip.size(),outP,&outP);
+
+	//Fixes the terrible vector padding bug by shrinking it back down to precisely the correct size
+	outZip.resize(outZip.empty() ? 0 : outP - &*outZip.begin());
+	return true;
+}
@@ -37,6 +37,7 @@
 #include "WED_Colors.h"
 #include "WED_LibraryMgr.h"
 #include "WED_Globals.h"
+#include "WED_Messages.h"
 #include "WED_ResourceMgr.h"
 #include "WED_PreviewLayer.h"
 
@@ -69,6 +70,10 @@ WED_LibraryPreviewPane::WED_LibraryPreviewPane(WED_ResourceMgr * res_mgr, ITexMg
 		mNextButton->SetMsg(next_variant,0);
 		mNextButton->AddListener(this);
 		mNextButton->Hide();
+
+		// Textures arrive from background decodes - redraw when they do.
+		if(GUI_Broadcaster * tex_bcast = dynamic_cast<GUI_Broadcaster *>(tex_mgr))
+			tex_bcast->AddListener(this);
 }
 
 void		WED_LibraryPreviewPane::ReceiveMessage(GUI_Broadcaster * inSrc, intptr_t inMsg, intptr_t inParam)
@@ -83,6 +88,8 @@ void		WED_LibraryPreviewPane::ReceiveMessage(GUI_Broadcaster * inSrc, intptr_t i
 		char s[16]; sprintf(s,"%d/%d",mVariant+1,mNumVariants);
 		mNextButton->SetDescriptor(s);
 	}
+	else if(inMsg == msg_TexturesLoaded)
+		Refresh();
 }
 
 void WED_LibraryPreviewPane::SetResource(const string& r, int res_type)
@@ -110,24 +117,28 @@ void WED_LibraryPreviewPane::SetResource(const string& r, int res_type)
 	}
 
 	if (res_type == res_Polygon)
-	{
-		int tex_x, tex_y;
-		float tex_aspect;
-		pol_info_t pol;
+		UpdateTexAspect();
+}
 
-		mResMgr->GetPol(mRes,pol);
-		TexRef	tref = mTexMgr->LookupTexture(pol.base_tex.c_str(),true, pol.wrap ? (tex_Compress_Ok|tex_Wrap) : tex_Compress_Ok);
-		if (tref)
-		{
-			mTexMgr->GetTexInfo(tref,&tex_x,&tex_y,NULL, NULL, NULL, NULL);
-			tex_aspect = float(pol.proj_s * tex_x) / float(pol.proj_t * tex_y);
-		}
-		else
-			tex_aspect = 1.0;
-			
-		mDs = tex_aspect > 1.0 ? 1.0 : tex_aspect;
-		mDt = tex_aspect > 1.0 ? 1.0/tex_aspect : 1.0;
+// The texture may still be decoding when the resource is picked, so Draw runs this again once it has the texture ID.
+void WED_LibraryPreviewPane::UpdateTexAspect(void)
+{
+	int tex_x, tex_y;
+	float tex_aspect;
+	pol_info_t pol;
+
+	mResMgr->GetPol(mRes,pol);
+	TexRef	tref = mTexMgr->LookupTexture(pol.base_tex.c_str(),true, pol.wrap ? (tex_Compress_Ok|tex_Wrap) : tex_Compress_Ok);
+	if (tref)
+	{
+		mTexMgr->GetTexInfo(tref,&tex_x,&tex_y,NULL, NULL, NULL, NULL);
+		tex_aspect = float(pol.proj_s * tex_x) / float(pol.proj_t * tex_y);
 	}
+	else
+		tex_aspect = 1.0;
+
+	mDs = tex_aspect > 1.0 ? 1.0 : tex_aspect;
+	mDt = tex_aspect > 1.0 ? 1.0/tex_aspect : 1.0;
 }
 
 void WED_LibraryPreviewPane::ClearResource(void)
@@ -261,6 +272,7 @@ void	WED_LibraryPreviewPane::Draw(GUI_GraphState * g)
 				if(tref != NULL)
 				{
 					int tex_id = mTexMgr->GetTexID(tref);
+					UpdateTexAspect();			// GetTexID is what uploads a freshly decoded texture - its size is known from here on.
 
 					if (tex_id != 0)
 					{
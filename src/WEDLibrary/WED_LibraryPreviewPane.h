@@ -50,7 +50,9 @@ public:
 
 
 private:
-	
+
+		void				UpdateTexAspect(void);
+
 		int					mX, mY;
 		float				mPsi,mThe;
 		float				mPsiOrig,mTheOrig;
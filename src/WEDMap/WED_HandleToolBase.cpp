@@ -575,6 +575,26 @@ void WED_HandleToolBase::ProcessSelection(
 }
 
 
+// Every kid whose bounds, grown by the icon slop, can't reach the selection is rejected first thing by ProcessSelectionRecursive -
+// so for our own composites, let their spatial index skip those kids without visiting them at all.
+static void GetSelectableKids(IGISComposite * com, const Bbox2& sel_area, double icon_dist_h, double icon_dist_v, vector<IGISEntity *>& kids)
+{
+	WED_GISComposite * wc = dynamic_cast<WED_GISComposite *>(com);
+	if (wc)
+	{
+		Bbox2	reach(sel_area);
+		reach.expand(icon_dist_h, icon_dist_v);
+		wc->GetEntitiesInBox(reach, kids);
+	}
+	else
+	{
+		int count = com->GetNumEntities();
+		kids.reserve(count);
+		for (int n = 0; n < count; ++n)
+			kids.push_back(com->GetNthEntity(n));
+	}
+}
+
 void WED_HandleToolBase::ProcessSelectionRecursive(
 							IGISEntity *	entity,
 							const Bbox2&	bounds,
@@ -626,9 +646,10 @@ void WED_HandleToolBase::ProcessSelectionRecursive(
 
 		if (com)
 		{
-			int count = com->GetNumEntities();
-			for (int n = 0; n < count; ++n)
-				ProcessSelectionRecursive(com->GetNthEntity(n),bounds,pt_sel, icon_dist_h, icon_dist_v, result);
+			vector<IGISEntity *> kids;
+			GetSelectableKids(com, pt_sel ? Bbox2(psel) : bounds, icon_dist_h, icon_dist_v, kids);
+			for (vector<IGISEntity *>::iterator k = kids.begin(); k != kids.end(); ++k)
+				ProcessSelectionRecursive(*k,bounds,pt_sel, icon_dist_h, icon_dist_v, result);
 		}
 		else if (seq)
 		{
@@ -649,9 +670,10 @@ void WED_HandleToolBase::ProcessSelectionRecursive(
 			result.insert(entity); 
 		else if (com)
 		{
-			int count = com->GetNumEntities();
-			for (int n = 0; n < count; ++n)
-				ProcessSelectionRecursive(com->GetNthEntity(n),bounds,pt_sel, icon_dist_h, icon_dist_v, result);
+			vector<IGISEntity *> kids;
+			GetSelectableKids(com, pt_sel ? Bbox2(psel) : bounds, icon_dist_h, icon_dist_v, kids);
+			for (vector<IGISEntity *>::iterator k = kids.begin(); k != kids.end(); ++k)
+				ProcessSelectionRecursive(*k,bounds,pt_sel, icon_dist_h, icon_dist_v, result);
 		}
 		else if (seq)
 		{
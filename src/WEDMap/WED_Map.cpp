@@ -329,9 +329,20 @@ void		WED_Map::DrawVisFor(WED_MapLayer * layer, int current, const Bbox2& bounds
 		Vector2 span(p1,p2);
 		if(max(span.dx, span.dy) > TOO_SMALL_TO_GO_IN || (p1 == p2) || depth == 0)		// Why p1 == p2?  If the composite contains ONLY ONE POINT it is zero-size.  We'd LOD out.  But if it contains one thing
 		{																				// then we might as well ALWAYS draw it - it's relatively cheap!
-			int t = c->GetNumEntities();												// Depth == 0 means we draw ALL top level objects -- good for airports.
-			for (int n = t-1; n >= 0; --n)
-				DrawVisFor(layer, current, bounds, c->GetNthEntity(n), g, sel, depth+1);
+			WED_GISComposite * wc = dynamic_cast<WED_GISComposite *>(c);						// Our own composites can hand us just the kids near the screen,
+			if (wc)																		// which matters for the huge flat ones like a big ortho or forest import.
+			{
+				vector<IGISEntity *>	kids;
+				wc->GetEntitiesInBox(bounds, kids);
+				for (vector<IGISEntity *>::reverse_iterator k = kids.rbegin(); k != kids.rend(); ++k)
+					DrawVisFor(layer, current, bounds, *k, g, sel, depth+1);
+			}
+			else
+			{
+				int t = c->GetNumEntities();												// Depth == 0 means we draw ALL top level objects -- good for airports.
+				for (int n = t-1; n >= 0; --n)
+					DrawVisFor(layer, current, bounds, c->GetNthEntity(n), g, sel, depth+1);
+			}
 		}
 	}
 }
@@ -355,9 +366,20 @@ void		WED_Map::DrawStrFor(WED_MapLayer * layer, int current, const Bbox2& bounds
 		Vector2 span(p1,p2);
 		if(max(span.dx, span.dy) > TOO_SMALL_TO_GO_IN || (p1 == p2) || depth == 0)
 		{
-			int t = c->GetNumEntities();
-			for (int n = t-1; n >= 0; --n)
-				DrawStrFor(layer, current, bounds, c->GetNthEntity(n), g, sel, depth+1);
+			WED_GISComposite * wc = dynamic_cast<WED_GISComposite *>(c);						// Our own composites can hand us just the kids near the screen,
+			if (wc)																		// which matters for the huge flat ones like a big ortho or forest import.
+			{
+				vector<IGISEntity *>	kids;
+				wc->GetEntitiesInBox(bounds, kids);
+				for (vector<IGISEntity *>::reverse_iterator k = kids.rbegin(); k != kids.rend(); ++k)
+					DrawStrFor(layer, current, bounds, *k, g, sel, depth+1);
+			}
+			else
+			{
+				int t = c->GetNumEntities();
+				for (int n = t-1; n >= 0; --n)
+					DrawStrFor(layer, current, bounds, c->GetNthEntity(n), g, sel, depth+1);
+			}
 		}
 	}
 }
@@ -461,6 +483,7 @@ void		WED_Map::ReceiveMessage(
 							intptr_t				inParam)
 {
 	if(inMsg == msg_ArchiveChanged)	Refresh();
+	if(inMsg == msg_TexturesLoaded)	Refresh();
 }
 
 IGISEntity *	WED_Map::GetGISBase()
@@ -58,6 +58,7 @@
 #include "WED_GroupCommands.h"
 #include "WED_LibraryListAdapter.h"
 #include "WED_LibraryMgr.h"
+#include "ITexMgr.h"
 #include "IDocPrefs.h"
 #include "WED_Orthophoto.h"
 #if WITHNWLINK
@@ -292,6 +293,10 @@ WED_MapPane::WED_MapPane(GUI_Commander * cmdr, double map_bounds[4], IResolver *
 
 	archive->AddListener(mMap);
 
+	// Likewise the texture manager tells us when background texture decodes come in, so the preview can fill in.
+	if(GUI_Broadcaster * tex_bcast = dynamic_cast<GUI_Broadcaster *>(WED_GetTexMgr(resolver)))
+		tex_bcast->AddListener(mMap);
+
 	// This is a band-aid.  We don't restore the current tab in the tab hierarchy (as of WED 1.5) so we don't get a tab changed message.  Instead we just
 	// are always in the selection tab.  So mostly that means the defaults for things like filters are fine, but for the ATC layer it needs to be off!
 	mATCLayer->ToggleVisible();
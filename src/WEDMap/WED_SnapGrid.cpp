@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "WED_SnapGrid.h"
+#include "MathUtils.h"
+
+#define SNAP_GRID_MAX 256		// Cells per side of the snap grid - aim for a handful of points per cell.
+
+WED_SnapGrid::WED_SnapGrid() : mDim(0)
+{
+}
+
+void	WED_SnapGrid::Clear(void)
+{
+	mSlots.clear();
+	mCells.clear();
+	mDim = 0;
+}
+
+int		WED_SnapGrid::AddSlot(const void * owner, bool has, const Point2& loc)
+{
+	slot_t	s;
+	s.loc = loc;
+	s.owner = owner;
+	s.cell = has ? 0 : -1;
+	mSlots.push_back(s);
+	return mSlots.size() - 1;
+}
+
+void	WED_SnapGrid::Build(const Bbox2& bounds)
+{
+	mBounds = bounds;
+	mDim = intlim(sqrt(mSlots.size() / 4.0), 1, SNAP_GRID_MAX);
+	mCells.clear();
+	mCells.resize(mDim * mDim);
+	for (int n = 0; n < mSlots.size(); ++n)
+	{
+		bool has = mSlots[n].cell >= 0;
+		mSlots[n].cell = -1;
+		SetSlot(n, has, mSlots[n].loc);
+	}
+}
+
+int		WED_SnapGrid::CellCoord(double v, double lo, double hi) const
+{
+	if (hi <= lo) return 0;
+	double c = floor((v - lo) * mDim / (hi - lo));
+	if (c < 0.0) return 0;
+	if (c >= mDim) return mDim-1;
+	return (int) c;
+}
+
+// Handles can sit outside the visible area, so points off the grid are clamped into the edge cells rather than dropped.
+void	WED_SnapGrid::SetSlot(int slot, bool has, const Point2& loc)
+{
+	slot_t& s(mSlots[slot]);
+	if (s.cell >= 0)
+	{
+		vector<int>& old_cell(mCells[s.cell]);
+		vector<int>::iterator i = find(old_cell.begin(), old_cell.end(), slot);
+		if (i != old_cell.end())
+		{
+			*i = old_cell.back();
+			old_cell.pop_back();
+		}
+	}
+	s.loc = loc;
+	s.cell = -1;
+	if (has)
+	{
+		s.cell = CellCoord(loc.x(), mBounds.xmin(), mBounds.xmax()) +
+				 CellCoord(loc.y(), mBounds.ymin(), mBounds.ymax()) * mDim;
+		mCells[s.cell].push_back(slot);
+	}
+}
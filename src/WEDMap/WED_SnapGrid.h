@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef WED_SnapGrid_H
+#define WED_SnapGrid_H
+
+#include "CompGeomDefs2.h"
+
+// The vertex tool's snap points.  Points live in slots, in the order they were added - a slot's index breaks
+// distance ties, so a query finds what a front-to-back scan of every point would have.  A slot may be empty
+// (hidden, off-screen, no bezier handle) and still keep its number, so the owner of a moved point can patch its
+// slots in place while dragging.  A uniform grid in lat/lon over the visible area buckets the slots so a query
+// only tests the points near it.
+
+class	WED_SnapGrid {
+public:
+					 WED_SnapGrid();
+
+	// Slots are appended with the grid unbuilt; Build then bins them all into a grid over bounds.
+	void			Clear(void);
+	int				AddSlot(const void * owner, bool has, const Point2& loc);
+	void			Build(const Bbox2& bounds);
+
+	// Moves one slot to a new location, or empties it if has is false.  Only once the grid is built.
+	void			SetSlot(int slot, bool has, const Point2& loc);
+
+	int				CountSlots(void) const { return mSlots.size(); }
+	const void *	GetOwner(int slot) const { return mSlots[slot].owner; }
+	const Point2&	GetLoc(int slot) const { return mSlots[slot].loc; }
+
+	// The slot nearest to pt, less than radius pixels away and not owned by skip, or -1.  The distance test is done
+	// in pixels through the zoomer, exactly as a linear scan would - the grid only picks which slots to test.
+	template <class Zoomer>
+	int				FindNearest(Zoomer * z, const Point2& pt, double radius, const void * skip) const;
+
+private:
+
+	int				CellCoord(double v, double lo, double hi) const;
+
+	struct	slot_t {
+		Point2			loc;
+		const void *	owner;
+		int				cell;		// -1 if this slot has no point.  Before Build, 0 just means it has one.
+	};
+
+	vector<slot_t>			mSlots;
+	vector<vector<int> >	mCells;
+	Bbox2					mBounds;
+	int						mDim;
+};
+
+template <class Zoomer>
+int		WED_SnapGrid::FindNearest(Zoomer * z, const Point2& pt, double radius, const void * skip) const
+{
+	if (mCells.empty()) return -1;
+
+	// Only visit the cells under the radius (plus a pixel of slop).
+	Point2	pt_px = z->LLToPixel(pt);
+	Point2	lo = z->PixelToLL(pt_px - Vector2(radius+1, radius+1));
+	Point2	hi = z->PixelToLL(pt_px + Vector2(radius+1, radius+1));
+	int x1 = CellCoord(min(lo.x(),hi.x()), mBounds.xmin(), mBounds.xmax());
+	int x2 = CellCoord(max(lo.x(),hi.x()), mBounds.xmin(), mBounds.xmax());
+	int y1 = CellCoord(min(lo.y(),hi.y()), mBounds.ymin(), mBounds.ymax());
+	int y2 = CellCoord(max(lo.y(),hi.y()), mBounds.ymin(), mBounds.ymax());
+
+	double	smallest_dist = 9.9e9;
+	int		best = -1;
+	for (int y = y1; y <= y2; ++y)
+	for (int x = x1; x <= x2; ++x)
+	{
+		const vector<int>& cell(mCells[x + y * mDim]);
+		for (vector<int>::const_iterator c = cell.begin(); c != cell.end(); ++c)
+		if (mSlots[*c].owner != skip)
+		{
+			double dist = Vector2(z->LLToPixel(mSlots[*c].loc), pt_px).squared_length();
+			if (dist < (radius * radius) &&
+				(dist < smallest_dist || (dist == smallest_dist && *c < best)))
+			{
+				smallest_dist = dist;
+				best = *c;
+			}
+		}
+	}
+	return best;
+}
+
+#endif /* WED_SnapGrid_H */
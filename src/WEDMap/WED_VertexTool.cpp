@@ -27,6 +27,7 @@
 #include "IOperation.h"
 #include "AssertUtils.h"
 #include "WED_Persistent.h"
+#include "WED_Archive.h"
 #include "CompGeomDefs2.h"
 #include "WED_ToolUtils.h"
 #include "WED_RunwayNode.h"
@@ -104,6 +105,7 @@ void	WED_VertexTool::BeginEdit(void)
 	DebugAssert(sel != NULL && op != NULL);
 	op->StartOperation("Vertex Modification");  // can be any of - split ATC edge - move ATC edge node
 	                                 // - drag a node or modify a bezier node of any previously selected feature
+	mSnapCacheKeyArchive = -1;		// Snap cache is only patched from the archive's change list within one edit.
 }
 
 void	WED_VertexTool::EndEdit(void)
@@ -112,6 +114,7 @@ void	WED_VertexTool::EndEdit(void)
 	IOperation * op = dynamic_cast<IOperation *>(sel);
 	DebugAssert(sel != NULL && op != NULL);
 	op->CommitOperation();
+	mSnapCacheKeyArchive = -1;
 	mInEdit = 0;
 	mIsRotate = 0;
 	mIsSymetric = 0;
@@ -1318,35 +1321,14 @@ void		WED_VertexTool::AddSnapPointRecursive(IGISEntity * e, const Bbox2& vis_are
 	IGISPolygon * poly;
 	IGISComposite * cmp;
 	int c, n;
-	IGISPoint * pt;
-	IGISPoint_Bezier * bt;
-	Point2	loc;
+	WED_Persistent * p;
 
 	switch(e->GetGISClass()) {
 	case gis_Point:
 	case gis_Point_Heading:
 	case gis_Point_HeadingWidthLength:
-		pt = SAFE_CAST(IGISPoint, e);
-		if (pt)
-		{
-			pt->GetLocation(gis_Geo,loc);
-			mSnapCache.push_back(pair<Point2,IGISEntity *>(loc, e));
-		}
-		break;
 	case gis_Point_Bezier:
-		bt = SAFE_CAST(IGISPoint_Bezier, e);
-		if (bt)
-		{
-			bt->GetLocation(gis_Geo,loc);
-			mSnapCache.push_back(pair<Point2,IGISEntity *>(loc, e));
-//			if (sel->IsSelected(e))
-			{
-				if (bt->GetControlHandleLo(gis_Geo,loc))
-					mSnapCache.push_back(pair<Point2,IGISEntity *>(loc, e));
-				if (bt->GetControlHandleHi(gis_Geo,loc))
-					mSnapCache.push_back(pair<Point2,IGISEntity *>(loc, e));
-			}
-		}
+		AddSnapSlots(e);
 		break;
 	case gis_Line:
 	case gis_Line_Width:
@@ -1357,6 +1339,9 @@ void		WED_VertexTool::AddSnapPointRecursive(IGISEntity * e, const Bbox2& vis_are
 		if (ent_bounds.xspan() < MIN_HANDLE_RECURSE_SIZE &&
 			ent_bounds.yspan() < MIN_HANDLE_RECURSE_SIZE) return;
 
+		if ((p = dynamic_cast<WED_Persistent *>(e)) != NULL)
+			mSnapCacheIDs[p->GetID()] = -1;
+
 		if ((ps = SAFE_CAST(IGISPointSequence, e)) != NULL)
 		{
 			c = ps->GetNumPoints();
@@ -1368,6 +1353,9 @@ void		WED_VertexTool::AddSnapPointRecursive(IGISEntity * e, const Bbox2& vis_are
 		if (ent_bounds.xspan() < MIN_HANDLE_RECURSE_SIZE &&
 			ent_bounds.yspan() < MIN_HANDLE_RECURSE_SIZE) return;
 
+		if ((p = dynamic_cast<WED_Persistent *>(e)) != NULL)
+			mSnapCacheIDs[p->GetID()] = -1;
+
 		if ((poly = SAFE_CAST(IGISPolygon, e)) != NULL)
 		{
 			AddSnapPointRecursive(poly->GetOuterRing(),vis_area, sel);
@@ -1380,6 +1368,9 @@ void		WED_VertexTool::AddSnapPointRecursive(IGISEntity * e, const Bbox2& vis_are
 		if (ent_bounds.xspan() < MIN_HANDLE_RECURSE_SIZE &&
 			ent_bounds.yspan() < MIN_HANDLE_RECURSE_SIZE) return;
 
+		if ((p = dynamic_cast<WED_Persistent *>(e)) != NULL)
+			mSnapCacheIDs[p->GetID()] = -1;
+
 		if ((cmp = SAFE_CAST(IGISComposite, e)) != NULL)
 		{
 			c = cmp->GetNumEntities();
@@ -1390,48 +1381,170 @@ void		WED_VertexTool::AddSnapPointRecursive(IGISEntity * e, const Bbox2& vis_are
 	}
 }
 
+// Appends the snap slots for one point entity.  The grid is built once the whole world has been walked.
+void		WED_VertexTool::AddSnapSlots(IGISEntity * e) const
+{
+	WED_Persistent * p = dynamic_cast<WED_Persistent *>(e);
+	IGISPoint * pt = SAFE_CAST(IGISPoint, e);
+	IGISPoint_Bezier * bt = SAFE_CAST(IGISPoint_Bezier, e);
+	if (pt == NULL) return;
+
+	if (p)
+		mSnapCacheIDs[p->GetID()] = mSnapCache.CountSlots();
+
+	Point2	loc;
+	pt->GetLocation(gis_Geo,loc);
+	mSnapCache.AddSlot(e, true, loc);
+
+	if (e->GetGISClass() == gis_Point_Bezier && bt)
+	{
+//		if (sel->IsSelected(e))
+		bool has = bt->GetControlHandleLo(gis_Geo,loc);
+		mSnapCache.AddSlot(e, has, loc);
+		has = bt->GetControlHandleHi(gis_Geo,loc);
+		mSnapCache.AddSlot(e, has, loc);
+	}
+}
+
+void		WED_VertexTool::RebuildSnapCache(const Bbox2& vis_area) const
+{
+	mSnapCache.Clear();
+	mSnapCacheIDs.clear();
+	AddSnapPointRecursive(dynamic_cast<IGISEntity *>(WED_GetWorld(GetResolver())), vis_area, WED_GetSelect(GetResolver()));
+	mSnapCache.Build(vis_area);
+}
+
+// This is the test AddSnapPointRecursive applies before descending into a container.
+static bool	SnapRecursesInto(IGISEntity * e, const Bbox2& vis_area, WED_MapZoomerNew * z)
+{
+	Bbox2	ent_bounds;
+	e->GetBounds(gis_Geo,ent_bounds);
+	if (!ent_bounds.overlap(vis_area)) return false;
+	ent_bounds.p1 = z->LLToPixel(ent_bounds.p1);
+	ent_bounds.p2 = z->LLToPixel(ent_bounds.p2);
+	return ent_bounds.xspan() >= MIN_HANDLE_RECURSE_SIZE || ent_bounds.yspan() >= MIN_HANDLE_RECURSE_SIZE;
+}
+
+// A moved vertex drags its ring's and polygon's bounds with it - if one of them would now be skipped by
+// AddSnapPointRecursive, the siblings have to go too and we need a full rebuild.  We stop at the first composite:
+// one vertex can't meaningfully resize an airport or group, and their bounds are expensive to recompute mid-drag.
+bool		WED_VertexTool::SnapParentsStillRecursed(IGISEntity * e, const Bbox2& vis_area) const
+{
+	WED_Thing * t = dynamic_cast<WED_Thing *>(e);
+	for (t = t ? t->GetParent() : NULL; t; t = t->GetParent())
+	{
+		IGISEntity * g = dynamic_cast<IGISEntity *>(t);
+		if (g == NULL) return false;
+		if (g->GetGISClass() == gis_Composite) return true;
+		hash_map<int,int>::iterator i = mSnapCacheIDs.find(t->GetID());
+		if (i == mSnapCacheIDs.end() || i->second != -1) return false;
+		if (!IsVisibleNow(g) || !SnapRecursesInto(g, vis_area, GetZoomer())) return false;
+	}
+	return true;
+}
+
+// Re-reads the point(s) of one entity into the slots it had at rebuild time.  Returns false if the entity
+// no longer fits its slots or its parents would now be pruned - the caller then rebuilds from scratch.
+bool		WED_VertexTool::UpdateSnapSlots(IGISEntity * e, int first, const Bbox2& vis_area) const
+{
+	IGISPoint * pt = SAFE_CAST(IGISPoint, e);
+	IGISPoint_Bezier * bt = SAFE_CAST(IGISPoint_Bezier, e);
+	bool is_bezier = e->GetGISClass() == gis_Point_Bezier && bt;
+	int count = is_bezier ? 3 : 1;
+
+	if (pt == NULL || first + count > mSnapCache.CountSlots()) return false;
+	for (int k = 0; k < count; ++k)
+		if (mSnapCache.GetOwner(first+k) != e) return false;
+	if (first + count < mSnapCache.CountSlots() && mSnapCache.GetOwner(first+count) == e) return false;
+
+	Bbox2	ent_bounds;
+	e->GetBounds(gis_Geo,ent_bounds);
+	bool on = IsVisibleNow(e) && ent_bounds.overlap(vis_area);
+	if (on && !SnapParentsStillRecursed(e, vis_area)) return false;
+
+	Point2	loc;
+	pt->GetLocation(gis_Geo,loc);
+	mSnapCache.SetSlot(first, on, loc);
+	if (is_bezier)
+	{
+		bool has_lo = on && bt->GetControlHandleLo(gis_Geo,loc);
+		mSnapCache.SetSlot(first+1, has_lo, loc);
+		bool has_hi = on && bt->GetControlHandleHi(gis_Geo,loc);
+		mSnapCache.SetSlot(first+2, has_hi, loc);
+	}
+	return true;
+}
+
+// Brings the snap cache up to date from the archive's list of changed objects.  Within an edit that list
+// holds everything touched since the operation started, which is a superset of what changed since our last
+// sync - re-reading an object twice is harmless.  Returns false if the change can't be patched in place.
+bool		WED_VertexTool::SyncSnapCache(const Bbox2& vis_area) const
+{
+	WED_Archive * arc = WED_GetWorld(GetResolver())->GetArchive();
+	const set<int>& changed(arc->GetChangedIDs());
+
+	for (set<int>::const_iterator id = changed.begin(); id != changed.end(); ++id)
+	{
+		WED_Persistent * obj = arc->Fetch(*id);
+		IGISEntity * e = dynamic_cast<IGISEntity *>(obj);
+		hash_map<int,int>::iterator i = mSnapCacheIDs.find(*id);
+
+		if (i == mSnapCacheIDs.end())
+		{
+			if (e == NULL) continue;			// Deleted, or not spatial (selection, etc.) - nothing to snap to.
+			return false;						// Brand new, or something AddSnapPointRecursive skipped.
+		}
+		if (i->second == -1)
+		{
+			if (e == NULL) return false;
+			if (!IsVisibleNow(e) || !SnapRecursesInto(e, vis_area, GetZoomer())) return false;
+			continue;
+		}
+		if (e == NULL)
+		{
+			const void * dead = mSnapCache.GetOwner(i->second);
+			for (int n = i->second; n < mSnapCache.CountSlots() && mSnapCache.GetOwner(n) == dead; ++n)
+				mSnapCache.SetSlot(n, false, mSnapCache.GetLoc(n));
+			mSnapCacheIDs.erase(i);
+			continue;
+		}
+		if (!UpdateSnapSlots(e, i->second, vis_area)) return false;
+	}
+	return true;
+}
+
 bool		WED_VertexTool::SnapMovePoint(
 					const Point2&			ideal_track_pt,		// This is the ideal place the user is TRYING to drag the thing, without snapping
 					Point2&					io_thing_pt,		// And this is where the thing is right now - we will move it to a NEW loc
 					IGISEntity *			who)
 {
 	Point2	modi(ideal_track_pt);
-	double smallest_dist=9.9e9;
 	Point2	best(modi);
 	bool IsSnap = false;
 
 	if (mSnapToGrid)
 	{
-		ISelection * sel = WED_GetSelect(GetResolver());
 		WED_Thing * wrl = WED_GetWorld(GetResolver());
 		long long key_a = wrl->GetArchive()->CacheKey();
 		long long key_z = GetZoomer()->CacheKey();
 		if (key_a != mSnapCacheKeyArchive || key_z != mSnapCacheKeyZoomer)
 		{
-			mSnapCache.clear();
 			Bbox2	bounds;
 			GetZoomer()->GetMapVisibleBounds(bounds.p1.x_,bounds.p1.y_,bounds.p2.x_,bounds.p2.y_);
 
-			AddSnapPointRecursive(dynamic_cast<IGISEntity *>(wrl), bounds, sel);
+			if (key_z != mSnapCacheKeyZoomer || mSnapCacheKeyArchive == -1 || !SyncSnapCache(bounds))
+				RebuildSnapCache(bounds);
+			mSnapCacheKeyArchive = key_a;
+			mSnapCacheKeyZoomer = key_z;
 		}
 
-		Point2  posi;
 		GetEntityInternal();
-		for(int n = 0; n < mSnapCache.size(); ++n)
-		if (mSnapCache[n].second != who)
-		{
-			posi = mSnapCache[n].first;
 
-			double dist = Vector2(
-				GetZoomer()->LLToPixel(posi),
-				GetZoomer()->LLToPixel(modi)).squared_length();
-			if (dist < (SNAP_RADIUS * SNAP_RADIUS) &&
-				dist < smallest_dist)
-			{
-				smallest_dist = dist;
-				best = posi;
-				IsSnap = true;
-			}
+		int slot = mSnapCache.FindNearest(GetZoomer(), modi, SNAP_RADIUS, who);
+		if (slot >= 0)
+		{
+			best = mSnapCache.GetLoc(slot);
+			IsSnap = true;
 		}
 	}
 
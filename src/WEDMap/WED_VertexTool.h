@@ -27,6 +27,7 @@
 #include "WED_HandleToolBase.h"
 #include "IControlHandles.h"
 #include "IOperation.h"
+#include "WED_SnapGrid.h"
 
 class	IGISEntity;
 class	IGISPoint;
@@ -89,6 +90,11 @@ private:
 			void		GetEntityInternal(void) const;
 			void		AddEntityRecursive(IGISEntity * e, const Bbox2& bounds) const;
 			void		AddSnapPointRecursive(IGISEntity * e, const Bbox2& bounds, ISelection * sel) const;
+			void		AddSnapSlots(IGISEntity * e) const;
+			bool		UpdateSnapSlots(IGISEntity * e, int first, const Bbox2& vis_area) const;
+			bool		SnapParentsStillRecursed(IGISEntity * e, const Bbox2& vis_area) const;
+			void		RebuildSnapCache(const Bbox2& vis_area) const;
+			bool		SyncSnapCache(const Bbox2& vis_area) const;
 			bool		SnapMovePoint(const Point2& ideal_track_pt, Point2& io_thing_pt, IGISEntity * who);
 
 		int						mInEdit;
@@ -115,7 +121,11 @@ private:
 		mutable long long				mEntityCacheKeyArchive;
 		mutable long long				mEntityCacheKeyZoomer;
 
-		mutable vector<pair<Point2,IGISEntity *> >		mSnapCache;
+		// Snap points, in the order AddSnapPointRecursive found them.  Bezier points own three slots (location, lo and
+		// hi handle), other points one.  While dragging, the slots of the entities the archive reports as changed are
+		// patched in place instead of re-walking the world.
+		mutable WED_SnapGrid							mSnapCache;
+		mutable hash_map<int,int>						mSnapCacheIDs;		// ID -> first slot, or -1 for containers we recursed into.
 		mutable long long								mSnapCacheKeyArchive;
 		mutable long long								mSnapCacheKeyZoomer;
 
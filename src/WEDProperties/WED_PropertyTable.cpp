@@ -85,7 +85,9 @@ WED_PropertyTable::WED_PropertyTable(
 	mDynamicCols(dynamic_cols),
 	mSelOnly(sel_only),
 	mResolver(resolver),
-	mCacheValid(false)
+	mRootID(0),
+	mCacheValid(false),
+	mColsScanned(false)
 {
 	RebuildCache();
 
@@ -390,9 +392,14 @@ void	WED_PropertyTable::ToggleDisclose(
 						int							cell_y)
 {
 	WED_Thing * t = FetchNth(mVertical ? cell_x : cell_y);
+	set<int> toggled;
 	if (t)
+	{
 		ToggleOpen(t->GetID());
-	mCacheValid = false;
+		toggled.insert(t->GetID());
+	}
+	if (!UpdateCache(toggled))
+		mCacheValid = false;
 	BroadcastMessage(GUI_TABLE_CONTENT_RESIZED,0);
 }
 
@@ -543,17 +550,15 @@ int		WED_PropertyTable::SelectDisclose(
 						int							all)
 {
 	if (mVertical) return 0;
+	set<int>	things;
 	if (all)
 	{
 		int cc = GetRowCount();
-		vector<int>	things(cc);
 		for (int n = 0; n < cc; ++n)
 		{
 			WED_Thing * t = FetchNth(n);
-			things.push_back(t->GetID());
+			things.insert(t->GetID());
 		}
-		for (int n = 0; n <things.size(); ++n)
-			SetOpen(things[n], open_it);
 	} else {
 		ISelection * sel = WED_GetSelect(mResolver);
 		vector<ISelectable *>	sv;
@@ -563,11 +568,14 @@ int		WED_PropertyTable::SelectDisclose(
 			WED_Thing * t = dynamic_cast<WED_Thing *>(sv[n]);
 			if (t)
 			{
-				SetOpen(t->GetID(), open_it);
+				things.insert(t->GetID());
 			}
 		}
 	}
-	mCacheValid = false;
+	for (set<int>::iterator t = things.begin(); t != things.end(); ++t)
+		SetOpen(*t, open_it);
+	if (!UpdateCache(things))
+		mCacheValid = false;
 	BroadcastMessage(GUI_TABLE_CONTENT_RESIZED,0);
 	return 1;
 }
@@ -808,21 +816,47 @@ GUI_DragOperation		WED_PropertyTable::DoDropBetweenRows(
 #pragma mark -
 
 
-void WED_PropertyTable::RebuildCacheRecursive(WED_Thing * e, ISelection * sel, set<WED_Thing *> * sel_and_friends)
+// Builds (or re-builds) the row node for e and returns how many rows it contributes.  With reuse set, kids that
+// already have a clean node keep it - their rows are already known.
+int WED_PropertyTable::RebuildCacheRecursive(WED_Thing * e, ISelection * sel, set<WED_Thing *> * sel_and_friends, int reuse)
 {
-	if (e == NULL) return;
 	int vis,kids,can_disclose,is_disclose;
 	GetFilterStatus(e,sel,vis,kids,can_disclose, is_disclose);
 
-	if (vis)
-		mThingCache.push_back(e);
+	RowNode& me = mRows[e->GetID()];
+	me.thing = e;
+	me.shown = vis;
+	me.dirty = 0;
+	me.kids.clear();
+	me.kid_end.clear();
 
 	if (sel_and_friends)
 	if (sel_and_friends->count(e) == 0)
-		return;
+		return me.shown;
 
+	vector<int>	kid_ids;
+	vector<int>	kid_end;
+	kid_ids.reserve(kids);
+	kid_end.reserve(kids);
+	int total = 0;
 	for (int n = 0; n < kids; ++n)
-		RebuildCacheRecursive(e->GetNthChild(n), sel, sel_and_friends);
+	{
+		WED_Thing * k = e->GetNthChild(n);
+		if (k == NULL) continue;
+		RowMap::iterator old;
+		if (reuse && (old = mRows.find(k->GetID())) != mRows.end() && !old->second.dirty && old->second.thing == k)
+			total += old->second.rows();
+		else
+			total += RebuildCacheRecursive(k, sel, sel_and_friends, reuse);
+		kid_ids.push_back(k->GetID());
+		kid_end.push_back(total);
+	}
+
+	// Re-fetch - the recursion above may have grown the hash table under our old reference.
+	RowNode& done = mRows[e->GetID()];
+	done.kids.swap(kid_ids);
+	done.kid_end.swap(kid_end);
+	return done.rows();
 }
 
 // Selection iterator: ref is a ptr to a set.  Accumulate the selected thing and all of its parents.
@@ -841,7 +875,8 @@ static int SelectAndParents(ISelectable * what, void * ref)
 
 void WED_PropertyTable::RebuildCache(void)
 {
-	mThingCache.clear();
+	mRows.clear();
+	mRootID = 0;
 	mCacheValid = true;
 	set<WED_Thing*> all_sel;
 
@@ -860,10 +895,84 @@ void WED_PropertyTable::RebuildCache(void)
 	if (mSelOnly)
 		sel->IterateSelectionOr(SelectAndParents,&all_sel);
 	if (root)
-		RebuildCacheRecursive(root,sel,mSelOnly ? &all_sel : NULL);
+	{
+		mRootID = root->GetID();
+		RebuildCacheRecursive(root,sel,mSelOnly ? &all_sel : NULL, 0);
+	}
 }
 
-WED_Thing *	WED_PropertyTable::FetchNth(int row)
+// Apply a set of changed things to the row model in place.  Returns false if the caller has to fall back to a full
+// rebuild - selection-only tables depend on the selection, search results are a flat list, and when a big chunk of
+// the document changed it is just as fast to start over.
+bool WED_PropertyTable::UpdateCache(const set<int>& changed)
+{
+	if (!mCacheValid || mSelOnly || !mSearchFilter.empty())
+		return false;
+
+	WED_Thing * root = WED_GetWorld(mResolver);
+	if (root == NULL || root->GetID() != mRootID || mRows.empty())
+		return false;
+	if (changed.size() * 4 > mRows.size())
+		return false;
+
+	vector<int>	todo;
+	for (set<int>::const_iterator c = changed.begin(); c != changed.end(); ++c)
+	{
+		RowMap::iterator r = mRows.find(*c);
+		if (r != mRows.end())
+		{
+			r->second.dirty = 1;
+			todo.push_back(*c);
+		}
+	}
+
+	// Things that aren't in the model yet are new or were never walked - whoever holds them as a kid changed too, so
+	// they get picked up when that parent is rebuilt.  Dead things are simply dropped by their (dirty) old parent.
+	WED_Archive * arch = root->GetArchive();
+	ISelection * sel = WED_GetSelect(mResolver);
+	for (vector<int>::iterator t = todo.begin(); t != todo.end(); ++t)
+	{
+		RowMap::iterator r = mRows.find(*t);
+		if (r == mRows.end() || !r->second.dirty)
+			continue;
+		WED_Thing * who = dynamic_cast<WED_Thing *>(arch->Fetch(*t));
+		if (who == NULL)
+			continue;
+		RebuildCacheRecursive(who, sel, NULL, 1);
+		PropagateRows(who);
+	}
+	return true;
+}
+
+// After e's node was rebuilt, correct the running row totals of its ancestors.  We stop as soon as the chain leaves
+// the model (or hits a node that is about to be rebuilt anyway) - nothing above there counts e's rows.
+void WED_PropertyTable::PropagateRows(WED_Thing * e)
+{
+	int child_id = e->GetID();
+	int new_rows = mRows[child_id].rows();
+
+	for (WED_Thing * p = e->GetParent(); p; p = p->GetParent())
+	{
+		RowMap::iterator r = mRows.find(p->GetID());
+		if (r == mRows.end() || r->second.dirty)
+			return;
+		RowNode& n = r->second;
+		vector<int>::iterator k = find(n.kids.begin(), n.kids.end(), child_id);
+		if (k == n.kids.end())
+			return;
+		int i = k - n.kids.begin();
+		int old_rows = n.kid_end[i] - (i ? n.kid_end[i-1] : 0);
+		int delta = new_rows - old_rows;
+		if (delta == 0)
+			return;
+		for (; i < n.kid_end.size(); ++i)
+			n.kid_end[i] += delta;
+		child_id = p->GetID();
+		new_rows = n.rows();
+	}
+}
+
+void WED_PropertyTable::CheckCache(void)
 {
 	if (!mCacheValid)
 	{
@@ -876,14 +985,47 @@ WED_Thing *	WED_PropertyTable::FetchNth(int row)
 			Resort();
 		}
 	}
+}
+
+int WED_PropertyTable::CountCachedRows(void)
+{
+	CheckCache();
+	if (!mSearchFilter.empty())
+		return mSortedCache.size();
+	RowMap::iterator r = mRows.find(mRootID);
+	return r == mRows.end() ? 0 : r->second.rows();
+}
 
-	vector<WED_Thing*>& current_cache = mSearchFilter.empty() ? mThingCache : mSortedCache;
+WED_Thing *	WED_PropertyTable::FetchNth(int row)
+{
+	int total = CountCachedRows();
 	if (!mVertical)
 	{
-		row = current_cache.size() - row - 1;
+		row = total - row - 1;
 	}
+	if (row < 0 || row >= total)
+		return NULL;
 
-	return current_cache[row];
+	if (!mSearchFilter.empty())
+		return mSortedCache[row];
+
+	// Walk down from the root, binary searching each node's running totals for the kid that holds our row.
+	RowNode * n = &mRows[mRootID];
+	while (1)
+	{
+		if (n->shown)
+		{
+			if (row == 0)
+				return n->thing;
+			--row;
+		}
+		int k = upper_bound(n->kid_end.begin(), n->kid_end.end(), row) - n->kid_end.begin();
+		if (k >= n->kids.size())
+			return NULL;
+		if (k > 0)
+			row -= n->kid_end[k-1];
+		n = &mRows[n->kids[k]];
+	}
 }
 
 int			WED_PropertyTable::GetThingDepth(WED_Thing * d)
@@ -907,20 +1049,7 @@ int			WED_PropertyTable::GetColCount(void)
 	if (!mVertical)
 		return mColNames.size();
 
-	if (!mCacheValid)
-	{
-		if (mSearchFilter.empty() == true)
-		{
-			RebuildCache();
-		}
-		else
-		{
-			Resort();
-		}
-	}
-
-	vector<WED_Thing*>& current_cache = mSearchFilter.empty() ? mThingCache : mSortedCache;
-	return current_cache.size();
+	return CountCachedRows();
 }
 
 int		WED_PropertyTable::ColForX(int n)
@@ -935,20 +1064,7 @@ int			WED_PropertyTable::GetRowCount(void)
 	if (mVertical)
 		return mColNames.size();
 
-	if (!mCacheValid)
-	{
-		if (mSearchFilter.empty() == true)
-		{
-			RebuildCache();
-		}
-		else
-		{
-			Resort();
-		}
-	}
-
-	vector<WED_Thing*>& current_cache = mSearchFilter.empty() ? mThingCache : mSortedCache;
-	return current_cache.size();
+	return CountCachedRows();
 }
 
 void	WED_PropertyTable::ReceiveMessage(
@@ -959,8 +1075,21 @@ void	WED_PropertyTable::ReceiveMessage(
 //	if (inMsg == msg_SelectionChanged)		BroadcastMessage(GUI_TABLE_CONTENT_CHANGED,0);
 	if (inMsg == msg_ArchiveChanged)
 	{
+		WED_Thing * root = WED_GetWorld(mResolver);
+		set<int>	no_changes;
+		const set<int>& changed = root ? root->GetArchive()->GetChangedIDs() : no_changes;
+
+		for (set<int>::const_iterator c = changed.begin(); c != changed.end(); ++c)
+			mFilterKeys.erase(*c);
+		if (!changed.empty())
+		{
+			mFilterHits.clear();
+			mHitFilter.clear();
+		}
+
 		// Set this to false FIRST, lest we have an explosion due to a stale cache!
 		if (inParam & (wed_Change_CreateDestroy | wed_Change_Topology))
+		if (!UpdateCache(changed))
    			mCacheValid = false;
 
 		if (mSelOnly && (inParam & wed_Change_Selection))
@@ -968,26 +1097,42 @@ void	WED_PropertyTable::ReceiveMessage(
 
 		if (mDynamicCols)
 		{
-			set<string>	cols;
-			cols.insert("Name");
-			mColNames.clear();
-			mColNames.push_back("Name");
+			// The columns only depend on which things we show and their properties - if neither changed, there is no
+			// need to go through every property of every row again.
 			int total_objs = mVertical ? GetColCount() : GetRowCount();
-			for (int i = 0; i < total_objs; ++i)
+			bool rescan = !mColsScanned || total_objs != mColSource.size();
+			for (int i = 0; i < total_objs && !rescan; ++i)
 			{
 				WED_Thing * t = FetchNth(i);
-				if (t)
+				if (t == NULL || mColSource[i] != t || changed.count(t->GetID()))
+					rescan = true;
+			}
+
+			if (rescan)
+			{
+				set<string>	cols;
+				cols.insert("Name");
+				mColNames.clear();
+				mColNames.push_back("Name");
+				mColSource.clear();
+				mColsScanned = true;
+				for (int i = 0; i < total_objs; ++i)
 				{
-					int pcount = t->CountProperties();
-					for (int p = 0; p < pcount; ++p)
+					WED_Thing * t = FetchNth(i);
+					mColSource.push_back(t);
+					if (t)
 					{
-						PropertyInfo_t info;
-						t->GetNthPropertyInfo(p,info);
-						if(!info.prop_name.empty() && info.prop_name[0] != '.')
-						if (cols.count(info.prop_name) == 0)
+						int pcount = t->CountProperties();
+						for (int p = 0; p < pcount; ++p)
 						{
-							cols.insert(info.prop_name);
-							mColNames.insert(mColNames.begin(), info.prop_name);
+							PropertyInfo_t info;
+							t->GetNthPropertyInfo(p,info);
+							if(!info.prop_name.empty() && info.prop_name[0] != '.')
+							if (cols.count(info.prop_name) == 0)
+							{
+								cols.insert(info.prop_name);
+								mColNames.insert(mColNames.begin(), info.prop_name);
+							}
 						}
 					}
 				}
@@ -997,7 +1142,6 @@ void	WED_PropertyTable::ReceiveMessage(
 	}
 }
 
-
 void	WED_PropertyTable::GetHeaderContent(
 				int							cell_x,
 				GUI_HeaderContent&			the_content)
@@ -1054,47 +1198,72 @@ void WED_PropertyTable::SetFilter(const string & filter)
 	BroadcastMessage(GUI_TABLE_CONTENT_RESIZED, 0);
 }
 
+// Same folding as ci_string, so matches don't change - but done once per thing instead of once per keystroke.
+static void fold_case(string& s)
+{
+	for (string::iterator c = s.begin(); c != s.end(); ++c)
+		*c = std::toupper(*c);
+}
+
+const WED_PropertyTable::FilterKey& WED_PropertyTable::GetFilterKey(WED_Thing * thing)
+{
+	FilterKeyMap::iterator k = mFilterKeys.find(thing->GetID());
+	if (k != mFilterKeys.end())
+		return k->second;
+
+	FilterKey& key = mFilterKeys[thing->GetID()];
+	thing->GetName(key.name);
+	fold_case(key.name);
+
+	IHasResourceOrAttr * has_resource_thing = dynamic_cast<IHasResourceOrAttr*>(thing);
+	key.has_res = has_resource_thing != NULL;
+	if (has_resource_thing)
+	{
+		string res;
+		has_resource_thing->GetResource(res);
+		key.res = string ("^") + res + "$";       // Adding ^ and $ are to emulate regex-style line start/end makers, so to
+		                                          // allow macthing one of "Red Line", "Red Line (Black)" or "Wide Red Line"
+		fold_case(key.res);
+	}
+	return key;
+}
+
 //parameters
 //thing - the current thing
-//search_filter - the search filter
-//sorted_cache - the sorted_cache of wed things we're building up
-//sorted_open_ids - the hash map of id and true false if its open or not
+//ufilter - the upper-cased search filter
+//narrow - if set, only things in mFilterHits can have a match
+//hits - accumulates every thing with a match somewhere in its sub-tree
 //returns number of bad leafs
-int collect_recusive(WED_Thing * thing, const ci_string& isearch_filter, vector<WED_Thing*>& sorted_cache)
+int WED_PropertyTable::CollectFiltered(WED_Thing * thing, const string& ufilter, int narrow, set<int>& hits)
 {
 	DebugAssert(thing != NULL);
 
+	// A sub-tree without a single match contributes no rows and always counts as one bad leaf - so when we know
+	// from the last (shorter) filter that there is nothing in here, skip it without looking.
+	if (narrow && mFilterHits.count(thing->GetID()) == 0)
+		return 1;
+
 	bool is_group_like = thing->GetClass() == WED_Group::sClass   ||
 						 thing->GetClass() == WED_Airport::sClass ||
 						 thing->GetClass() == WED_ATCFlow::sClass;
 
-	string thing_name;
-	thing->GetName(thing_name);
-	ci_string ithing_name(thing_name.begin(),thing_name.end());
-	bool is_match = ithing_name.find(isearch_filter) != ci_string::npos;
-	IHasResourceOrAttr * has_resource_thing = NULL;
+	const FilterKey& key = GetFilterKey(thing);
+	bool is_match = key.name.find(ufilter) != string::npos;
+	bool res_match = false;
 
-	if (is_match == false)
+	if (is_match == false && key.has_res)
 	{
-		has_resource_thing = dynamic_cast<IHasResourceOrAttr*>(thing);
-		if (has_resource_thing)
-		{
-			string res;
-			has_resource_thing->GetResource(res);
-//			string n; thing->GetName(n);
-//			printf("%s: r=%s\n",n.c_str(), res.c_str());
-			res = string ("^") + res + "$";       // Adding ^ and $ are to emulate regex-style line start/end makers, so to
-			                                      // allow macthing one of "Red Line", "Red Line (Black)" or "Wide Red Line"
-			is_match |= ci_string(res.begin(), res.end()).find(isearch_filter) != ci_string::npos;
-		}
+		res_match = key.res.find(ufilter) != string::npos;
+		is_match = res_match;
 	}
 
 	int nc = thing->CountChildren();
-	if (nc == 0 || (has_resource_thing && is_match))    // prevent showing nodes for uniformly set taxilines or taxiways
+	if (nc == 0 || res_match)    // prevent showing nodes for uniformly set taxilines or taxiways
 	{
 		if (is_match)
 		{
-			sorted_cache.push_back(thing);
+			mSortedCache.push_back(thing);
+			hits.insert(thing->GetID());
 			return 0; //No bad leafs here!
 		}
 		else
@@ -1104,18 +1273,22 @@ int collect_recusive(WED_Thing * thing, const ci_string& isearch_filter, vector<
 	}
 	else
 	{
-		int current_end_pos = sorted_cache.size();
+		int current_end_pos = mSortedCache.size();
+		int hits_before = hits.size();
 		int bad_leafs = 0;
 		for (int n = 0; n < nc; ++n)
 		{
-			bad_leafs += collect_recusive(thing->GetNthChild(n), isearch_filter, sorted_cache);
+			bad_leafs += CollectFiltered(thing->GetNthChild(n), ufilter, narrow, hits);
 		}
 
+		if (is_match || hits.size() != hits_before)
+			hits.insert(thing->GetID());
+
 		//If bad_leafs is less than the number of kids it means that there is at least some reason to keep this group
 		//Or if the group name exactly matches
 		if ((bad_leafs < nc && is_group_like) || is_match)
 		{
-			sorted_cache.insert(sorted_cache.begin() + current_end_pos, thing);
+			mSortedCache.insert(mSortedCache.begin() + current_end_pos, thing);
 			return 0;
 		}
 		else
@@ -1130,9 +1303,19 @@ void WED_PropertyTable::Resort()
 	mSortedCache.clear();
 	if (mSearchFilter.empty() == false)
 	{
-		mSortedCache.reserve(mThingCache.size());
-		ci_string isearch_filter(mSearchFilter.begin(), mSearchFilter.end());
-		collect_recusive(WED_GetWorld(mResolver), isearch_filter, mSortedCache);
+		string ufilter(mSearchFilter);
+		fold_case(ufilter);
+
+		// Typing more letters only ever narrows the search: whatever matches the longer filter matched the shorter one
+		// too, so we only have to look inside the sub-trees that had hits last time.
+		int narrow = !mHitFilter.empty() && ufilter.find(mHitFilter) != string::npos;
+
+		set<int>	hits;
+		WED_Thing * root = WED_GetWorld(mResolver);
+		if (root)
+			CollectFiltered(root, ufilter, narrow, hits);
+		mFilterHits.swap(hits);
+		mHitFilter = ufilter;
 	}
 	mCacheValid = true;
 }
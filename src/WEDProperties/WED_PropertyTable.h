@@ -172,8 +172,34 @@ public:
 
 private:
 
+	// The row model: one node per thing we have walked, holding the kids we recurse into and a running total of
+	// the rows under them.  Archive changes mark just the touched nodes dirty; rebuilding a node reuses every clean
+	// kid node and only the row totals up the parent chain get fixed up, so an edit costs about the size of the change.
+	struct	RowNode {
+		WED_Thing *		thing;
+		int				shown;				// 1 if the thing has a row of its own
+		int				dirty;
+		vector<int>		kids;				// IDs of the children we recurse into, in order
+		vector<int>		kid_end;			// kid_end[n] = rows under kids[0...n]
+		int				rows(void) const { return shown + (kid_end.empty() ? 0 : kid_end.back()); }
+	};
+	typedef	hash_map<int, RowNode>	RowMap;
+
+	// Upper-cased name and "^resource$" of a thing, as the search filter compares them - filled in lazily and
+	// dropped when the archive reports the thing changed.
+	struct	FilterKey {
+		string			name;
+		string			res;
+		int				has_res;
+	};
+	typedef	hash_map<int, FilterKey>	FilterKeyMap;
+
+			void			CheckCache(void);
 			void			RebuildCache(void);
-			void			RebuildCacheRecursive(WED_Thing * e, ISelection * sel, set<WED_Thing *> * sel_and_friends);
+			int				RebuildCacheRecursive(WED_Thing * e, ISelection * sel, set<WED_Thing *> * sel_and_friends, int reuse);
+			bool			UpdateCache(const set<int>& changed);
+			void			PropagateRows(WED_Thing * e);
+			int				CountCachedRows(void);
 			WED_Thing *		FetchNth(int row);
 			int				GetThingDepth(WED_Thing * d);
 
@@ -186,16 +212,24 @@ private:
 									int&	can_disclose,
 									int&	is_disclose);
 
-			void	Resort();
+			void			Resort();
+			const FilterKey&	GetFilterKey(WED_Thing * thing);
+			int				CollectFiltered(WED_Thing * thing, const string& ufilter, int narrow, set<int>& hits);
 
-	vector<WED_Thing *>			mThingCache;
+	RowMap						mRows;
+	int							mRootID;
 	vector<WED_Thing *>			mSortedCache;
 
 	string						mSearchFilter;
+	FilterKeyMap				mFilterKeys;
+	string						mHitFilter;			// Upper-cased filter that mFilterHits was collected for
+	set<int>					mFilterHits;		// Things with a filter match somewhere in their sub-tree
 
 	bool						mCacheValid;
 
 	vector<string>				mColNames;
+	vector<WED_Thing *>			mColSource;			// Rows the dynamic columns were last collected from
+	bool						mColsScanned;
 
 //	WED_Archive *				mArchive;
 //	int							mEntity;
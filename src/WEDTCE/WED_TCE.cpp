@@ -269,6 +269,7 @@ void		WED_TCE::ReceiveMessage(
 							intptr_t				inParam)
 {
 	if(inMsg == msg_ArchiveChanged)	Refresh();
+	if(inMsg == msg_TexturesLoaded)	Refresh();
 }
 
 IGISEntity *	WED_TCE::GetGISBase()
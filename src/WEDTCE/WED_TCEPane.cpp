@@ -36,6 +36,8 @@
 #include "WED_Colors.h"
 #include "GUI_Fonts.h"
 #include "WED_TCEDebugLayer.h"
+#include "WED_ToolUtils.h"
+#include "ITexMgr.h"
 
 static char	kToolKeys[] = {
 	'v', 'e'
@@ -150,6 +152,10 @@ WED_TCEPane::WED_TCEPane(GUI_Commander * cmdr, IResolver * resolver, WED_Archive
 	// messages (secretly it's our document's GetArchive() member) and anyone who needs it (our map).
 
 	archive->AddListener(mTCE);
+
+	// Orthophoto textures come in from background decodes - the texture manager tells us when, so they can be drawn.
+	if(GUI_Broadcaster * tex_bcast = dynamic_cast<GUI_Broadcaster *>(WED_GetTexMgr(resolver)))
+		tex_bcast->AddListener(mTCE);
 }
 
 WED_TCEPane::~WED_TCEPane()
@@ -1092,28 +1092,23 @@ set<WED_Thing *> WED_select_doubles(WED_Thing * t)
 	}
 
 	set<WED_Thing *> doubles;
-	
-	// Ben says: yes this totally sucks - replace it someday?
+
+	// For each node, the first later node that's too close - both get selected.
+	vector<Point2> locs(pts.size());
 	for(int i = 0; i < pts.size(); ++i)
 	{
-		for(int j = i + 1; j < pts.size(); ++j)
-		{
-			IGISPoint * ii = dynamic_cast<IGISPoint *>(pts[i]);
-			IGISPoint * jj = dynamic_cast<IGISPoint *>(pts[j]);
-			DebugAssert(ii != jj);
-			DebugAssert(ii);
-			DebugAssert(jj);
-			Point2 p1, p2;
-			ii->GetLocation(gis_Geo, p1);
-			jj->GetLocation(gis_Geo, p2);
-			
-			if(p1.squared_distance(p2) < (DOUBLE_PT_DIST*DOUBLE_PT_DIST))
-			{
-				doubles.insert(pts[i]);
-				doubles.insert(pts[j]);
-				break;
-			}			
-		}
+		IGISPoint * ii = dynamic_cast<IGISPoint *>(pts[i]);
+		DebugAssert(ii);
+		ii->GetLocation(gis_Geo, locs[i]);
+	}
+
+	vector<int> next;
+	FindNextNearPoints(locs, DOUBLE_PT_DIST, next);
+	for(int i = 0; i < pts.size(); ++i)
+	if(next[i] != -1)
+	{
+		doubles.insert(pts[i]);
+		doubles.insert(pts[next[i]]);
 	}
 	return doubles;
 }
@@ -1152,43 +1147,57 @@ set<WED_GISEdge *> WED_do_select_crossing(WED_Thing * t)
 set<WED_GISEdge *> WED_do_select_crossing(const vector<WED_GISEdge *> edges)
 {
 	set<WED_GISEdge*> crossed_edges;
-	// Ben says: yes this totally sucks - replace it someday?
+
+	vector<Bezier2> sides(edges.size());
+	vector<bool> is_bez(edges.size());
+	vector<Bbox2> boxes(edges.size());
 	for (int i = 0; i < edges.size(); ++i)
 	{
-		for (int j = i + 1; j < edges.size(); ++j)
+		DebugAssert(edges[i]);
+		is_bez[i] = edges[i]->GetSide(gis_Geo, 0, sides[i]);
+		// Control points bound the whole curve.  Pad a hair, since the segment test can round its crossing
+		// point just past a shared box edge.
+		boxes[i] = Bbox2(sides[i].p1, sides[i].p2);
+		if (is_bez[i])
 		{
-			IGISEdge * ii = edges[i];
-			IGISEdge * jj = edges[j];
-			DebugAssert(ii != jj);
-			DebugAssert(ii);
-			DebugAssert(jj);
-			Bezier2 b1, b2;
-			bool isb1, isb2;
-
-			isb1 = ii->GetSide(gis_Geo, 0, b1);
-			isb2 = jj->GetSide(gis_Geo, 0, b2);
-			
-			if (isb1 || isb2)
-			{   // should never get here, as edges (used for ATC routes only) are not supposed to have bezier segments
-				if (b1.intersect(b2, 10))
-				{
-					crossed_edges.insert(edges[i]);
-					crossed_edges.insert(edges[j]);
-				}
+			boxes[i] += sides[i].c1;
+			boxes[i] += sides[i].c2;
+		}
+		boxes[i].expand(1.0e-9);
+	}
+
+	// Only edges with overlapping bounds can cross - the sweep gives us those, then we run the real test.
+	vector<pair<int,int> > cands;
+	FindOverlappingBoxes(boxes, cands);
+
+	for (vector<pair<int,int> >::iterator c = cands.begin(); c != cands.end(); ++c)
+	{
+		int i = c->first;
+		int j = c->second;
+		DebugAssert(edges[i] != edges[j]);
+		const Bezier2& b1(sides[i]);
+		const Bezier2& b2(sides[j]);
+
+		if (is_bez[i] || is_bez[j])
+		{   // should never get here, as edges (used for ATC routes only) are not supposed to have bezier segments
+			if (b1.intersect(b2, 10))
+			{
+				crossed_edges.insert(edges[i]);
+				crossed_edges.insert(edges[j]);
 			}
-			else 
+		}
+		else
+		{
+			Point2 x;
+			if (b1.p1 != b2.p1 &&
+				b1.p2 != b2.p2 &&
+				b1.p1 != b2.p2 &&
+				b1.p2 != b2.p1)
 			{
-				Point2 x;
-				if (b1.p1 != b2.p1 &&
-					b1.p2 != b2.p2 &&
-					b1.p1 != b2.p2 &&
-					b1.p2 != b2.p1)
+				if (b1.as_segment().intersect(b2.as_segment(), x))
 				{
-					if (b1.as_segment().intersect(b2.as_segment(), x))
-					{
-						crossed_edges.insert(edges[i]);
-						crossed_edges.insert(edges[j]);
-					}
+					crossed_edges.insert(edges[i]);
+					crossed_edges.insert(edges[j]);
 				}
 			}
 		}
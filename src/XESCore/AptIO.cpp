@@ -32,6 +32,7 @@
 #include "AssertUtils.h"
 #include "CompGeomUtils.h"
 #include "STLUtils.h"
+#include "ParallelUtils.h"
 
 #include "WED_Version.h"
 // for now
@@ -233,47 +234,24 @@ string	ReadAptFile(const char * inFileName, AptVector& outApts)
 	return err;
 }
 
-string	ReadAptFileMem(const char * inBegin, const char * inEnd, AptVector& outApts)
-{
-	outApts.clear();
+// The record parser only ever adds an airport and then works on the last one, so it is written against these three
+// calls.  Given an AptVector it is the classic serial reader; given an apt_slot_t it parses one airport's records
+// straight into its place in the result, which is how the airports are read in parallel without copying them.
+struct	apt_slot_t {
+	AptInfo_t *	apt;
+	bool		used;
 
+	void		push_back(const AptInfo_t&)	{ DebugAssert(apt && !used); used = true; }
+	AptInfo_t&	back(void)					{ return *apt; }
+	bool		empty(void) const			{ return !used; }
+};
+
+template <class Apts>
+static string	read_apt_records(const char * inBegin, const char * inEnd, int vers, Apts& outApts, int& ln)
+{
 	MFTextScanner * s = TextScanner_OpenMem(inBegin, inEnd);
 	string ok;
 
-	int ln = 0;
-
-	// Versioning:
-	// 703 (base)
-	// 715 - addded vis flag to tower
-	// 810 - added vasi slope to towers
-	// 850 - added next-gen stuff
-
-		int vers = 0;
-
-	if (TextScanner_IsDone(s))
-		ok = string("File is empty.");
-	if (ok.empty())
-	{
-		string app_win;
-		if (TextScanner_FormatScan(s, "T", &app_win) != 1) ok = "Invalid header";
-		if (app_win != "a" && app_win != "A" && app_win != "i" && app_win != "I") ok = string("Invalid header:") + app_win;
-		TextScanner_Next(s);
-		++ln;
-	}
-	if (ok.empty())
-	{
-		if (TextScanner_FormatScan(s, "i", &vers) != 1) ok = "Invalid version";
-		if (vers != 703 && vers != 715 && vers != 810 && vers != 850 && vers != 1000 && vers != 1050 && vers != 1100)
-		{
-		  if (vers > 1100)
-			ok = "Format is newer than supported by this version of WED";
-		  else
-			ok = "Illegal version";
-		}
-		TextScanner_Next(s);
-		++ln;
-	}
-
 	set<string>		centers;
 	string codez;
 	string			lat_str, lon_str, rot_str, len_str, wid_str;
@@ -301,6 +279,16 @@ string	ReadAptFileMem(const char * inBegin, const char * inEnd, AptVector& outAp
 			continue;
 		}
 
+		// Each airport is parsed on its own, so a segment can't continue the previous airport's polygon
+		// (which in a serial read pointed into a vector that may have grown since, anyway).
+		if (open_poly == NULL && rec_code >= apt_lin_seg && rec_code <= apt_end_crv)
+		{
+			ok = "Error: polygon segment outside of a polygon.";
+			TextScanner_Next(s);
+			++ln;
+			continue;
+		}
+
 		switch(rec_code) {
 		case apt_airport:
 		case apt_seaport:
@@ -1080,61 +1068,248 @@ string	ReadAptFileMem(const char * inBegin, const char * inEnd, AptVector& outAp
 		sprintf(buf," (Line %d)",ln);
 		ok += buf;
 	}
+	return ok;
+}
+
+static void	apt_compute_bounds(AptInfo_t * a)
+{
+	a->bounds = Bbox2();
+	if (a->tower.draw_obj != -1)
+		a->bounds = Bbox2(a->tower.location);
+	if(a->beacon.color_code != apt_beacon_none)
+		a->bounds += a->beacon.location;
+	for (int w = 0; w < a->windsocks.size(); ++w)
+		a->bounds += a->windsocks[w].location;
+	for (int r = 0; r < a->gates.size(); ++r)
+		a->bounds += a->gates[r].location;
+	for (AptPavementVector::iterator p = a->pavements.begin(); p != a->pavements.end(); ++p)
+	{
+		a->bounds +=  p->ends.source();
+		a->bounds +=  p->ends.target();
+	}
+	for (AptRunwayVector::iterator r = a->runways.begin(); r != a->runways.end(); ++r)
+	{
+		a->bounds +=  r->ends.source();
+		a->bounds +=  r->ends.target();
+	}
+	for(AptSealaneVector::iterator s = a->sealanes.begin(); s != a->sealanes.end(); ++s)
+	{
+		a->bounds +=  s->ends.source();
+		a->bounds +=  s->ends.target();
+	}
+	for(AptHelipadVector::iterator h = a->helipads.begin(); h != a->helipads.end(); ++h)
+		a->bounds +=  h->location;
+
+	for(AptTaxiwayVector::iterator t = a->taxiways.begin(); t != a->taxiways.end(); ++t)
+	for(AptPolygon_t::iterator pt = t->area.begin(); pt != t->area.end(); ++pt)
+	{
+		a->bounds +=  pt->pt;
+		if(pt->code == apt_lin_crv || pt->code == apt_rng_crv || pt-> code == apt_end_crv)
+			a->bounds +=  pt->ctrl;
+	}
+
+	for(AptBoundaryVector::iterator b = a->boundaries.begin(); b != a->boundaries.end(); ++b)
+	for(AptPolygon_t::iterator pt = b->area.begin(); pt != b->area.end(); ++pt)
+	{
+		a->bounds +=  pt->pt;
+		if(pt->code == apt_lin_crv || pt->code == apt_rng_crv || pt-> code == apt_end_crv)
+			a->bounds +=  pt->ctrl;
+	}
+
+	//a->bounds.expand(0.001);
+}
+
+struct	apt_parse_job {
+	const AptFileIndex_t *	index;
+	const vector<int> *		which;
+	AptVector *				apts;
+	vector<string>			errs;
+
+	void operator()(int n)
+	{
+		int a = (*which)[n];
+		const char * e = (a + 1 < index->apt_begin.size()) ? index->apt_begin[a + 1] : index->end;
+		apt_slot_t	slot = { &(*apts)[n], false };
+		int ln = index->apt_line[a];
+		errs[n] = read_apt_records(index->apt_begin[a], e, index->version, slot, ln);
+		apt_compute_bounds(slot.apt);
+	}
+};
+
+// Parses the given airports of the index into outApts, in parallel.  The result is what a serial read would give:
+// airports in file order, and on an error everything up to and including the broken airport, plus its message.
+static string	read_indexed_apts(const AptFileIndex_t& inIndex, const vector<int>& inWhich, AptVector& outApts)
+{
+	outApts.clear();
+	outApts.resize(inWhich.size());
+
+	apt_parse_job	job;
+	job.index = &inIndex;
+	job.which = &inWhich;
+	job.apts = &outApts;
+	job.errs.resize(inWhich.size());
+	ParallelFor(inWhich.size(), job);
+
+	string ok;
+	for (int n = 0; n < job.errs.size(); ++n)
+	if (!job.errs[n].empty())
+	{
+		ok = job.errs[n];
+		outApts.erase(outApts.begin() + n + 1, outApts.end());
+		break;
+	}
 
+	#if OPENGL_MAP
 	for (AptVector::iterator a = outApts.begin(); a != outApts.end(); ++a)
+		GenerateOGL(&*a);
+	#endif
+	return ok;
+}
+
+string	ReadAptFileMem(const char * inBegin, const char * inEnd, AptVector& outApts)
+{
+	outApts.clear();
+
+	AptFileIndex_t	index;
+	string ok = IndexAptFileMem(inBegin, inEnd, index);
+	if (!ok.empty())
+		return ok;
+
+	// Anything before the first airport is parsed too, only so that junk there is reported just like before.
+	AptInfo_t	nowhere;
+	apt_slot_t	no_apt = { &nowhere, false };
+	int ln = index.records_line;
+	ok = read_apt_records(index.records, index.apt_begin.empty() ? index.end : index.apt_begin.front(), index.version, no_apt, ln);
+	if (!ok.empty())
+		return ok;
+
+	vector<int>	all(index.apt_begin.size());
+	for (int n = 0; n < all.size(); ++n)
+		all[n] = n;
+	return read_indexed_apts(index, all, outApts);
+}
+
+// The record code of a line exactly as TextScanner_FormatScan's "i" reads it: atoi of the first blank-separated token.
+static int apt_record_code(const char * b, const char * e)
+{
+	while (b < e && (*b == ' ' || *b == '\t')) ++b;
+	const char * t = b;
+	while (t < e && *t != ' ' && *t != '\t') ++t;
+	char buf[32];
+	if (t - b >= sizeof(buf))
+		return atoi(string(b, t).c_str());
+	memcpy(buf, b, t - b);
+	buf[t - b] = 0;
+	return atoi(buf);
+}
+
+// The fifth token of an airport header line - "1 elevation twr bldgs ICAO name..."
+static string apt_record_icao(const char * b, const char * e)
+{
+	for (int n = 0; n < 5; ++n)
 	{
-		a->bounds = Bbox2();
-		if (a->tower.draw_obj != -1)
-			a->bounds = Bbox2(a->tower.location);
-		if(a->beacon.color_code != apt_beacon_none)
-			a->bounds += a->beacon.location;
-		for (int w = 0; w < a->windsocks.size(); ++w)
-			a->bounds += a->windsocks[w].location;
-		for (int r = 0; r < a->gates.size(); ++r)
-			a->bounds += a->gates[r].location;
-		for (AptPavementVector::iterator p = a->pavements.begin(); p != a->pavements.end(); ++p)
-		{
-			a->bounds +=  p->ends.source();
-			a->bounds +=  p->ends.target();
-		}
-		for (AptRunwayVector::iterator r = a->runways.begin(); r != a->runways.end(); ++r)
-		{
-			a->bounds +=  r->ends.source();
-			a->bounds +=  r->ends.target();
-		}
-		for(AptSealaneVector::iterator s = a->sealanes.begin(); s != a->sealanes.end(); ++s)
-		{
-			a->bounds +=  s->ends.source();
-			a->bounds +=  s->ends.target();
-		}
-		for(AptHelipadVector::iterator h = a->helipads.begin(); h != a->helipads.end(); ++h)
-			a->bounds +=  h->location;
+		while (b < e && (*b == ' ' || *b == '\t')) ++b;
+		const char * t = b;
+		while (t < e && *t != ' ' && *t != '\t') ++t;
+		if (n == 4)
+			return string(b, t);
+		b = t;
+	}
+	return string();
+}
+
+string	IndexAptFileMem(const char * inBegin, const char * inEnd, AptFileIndex_t& outIndex)
+{
+	outIndex.version = 0;
+	outIndex.records = outIndex.end = inEnd;
+	outIndex.records_line = 0;
+	outIndex.apt_begin.clear();
+	outIndex.apt_line.clear();
+	outIndex.apt_icao.clear();
+
+	MFTextScanner * s = TextScanner_OpenMem(inBegin, inEnd);
+	string ok;
+
+	int ln = 0;
+
+	// Versioning:
+	// 703 (base)
+	// 715 - addded vis flag to tower
+	// 810 - added vasi slope to towers
+	// 850 - added next-gen stuff
 
-		for(AptTaxiwayVector::iterator t = a->taxiways.begin(); t != a->taxiways.end(); ++t)
-		for(AptPolygon_t::iterator pt = t->area.begin(); pt != t->area.end(); ++pt)
+		int vers = 0;
+
+	if (TextScanner_IsDone(s))
+		ok = string("File is empty.");
+	if (ok.empty())
+	{
+		string app_win;
+		if (TextScanner_FormatScan(s, "T", &app_win) != 1) ok = "Invalid header";
+		if (app_win != "a" && app_win != "A" && app_win != "i" && app_win != "I") ok = string("Invalid header:") + app_win;
+		TextScanner_Next(s);
+		++ln;
+	}
+	if (ok.empty())
+	{
+		if (TextScanner_FormatScan(s, "i", &vers) != 1) ok = "Invalid version";
+		if (vers != 703 && vers != 715 && vers != 810 && vers != 850 && vers != 1000 && vers != 1050 && vers != 1100)
 		{
-			a->bounds +=  pt->pt;
-			if(pt->code == apt_lin_crv || pt->code == apt_rng_crv || pt-> code == apt_end_crv)
-				a->bounds +=  pt->ctrl;
+		  if (vers > 1100)
+			ok = "Format is newer than supported by this version of WED";
+		  else
+			ok = "Illegal version";
 		}
+		TextScanner_Next(s);
+		++ln;
+	}
 
-		for(AptBoundaryVector::iterator b = a->boundaries.begin(); b != a->boundaries.end(); ++b)
-		for(AptPolygon_t::iterator pt = b->area.begin(); pt != b->area.end(); ++pt)
+	if (ok.empty())
+	{
+		outIndex.version = vers;
+		outIndex.records = TextScanner_GetBegin(s);
+		outIndex.records_line = ln;
+
+		// One pass over the line starts; only airport headers get a closer look.  A 99 ends the file, like in the parser.
+		while (!TextScanner_IsDone(s))
 		{
-			a->bounds +=  pt->pt;
-			if(pt->code == apt_lin_crv || pt->code == apt_rng_crv || pt-> code == apt_end_crv)
-				a->bounds +=  pt->ctrl;
+			const char * b = TextScanner_GetBegin(s);
+			const char * e = TextScanner_GetEnd(s);
+			int rec_code = apt_record_code(b, e);
+			if (rec_code == apt_done)
+				break;
+			if (rec_code == apt_airport || rec_code == apt_seaport || rec_code == apt_heliport)
+			{
+				outIndex.apt_begin.push_back(b);
+				outIndex.apt_line.push_back(ln);
+				outIndex.apt_icao.push_back(apt_record_icao(b, e));
+			}
+			TextScanner_Next(s);
+			++ln;
 		}
+		outIndex.end = TextScanner_IsDone(s) ? inEnd : TextScanner_GetBegin(s);
+	}
+	TextScanner_Close(s);
 
-		//a->bounds.expand(0.001);
-
-		#if OPENGL_MAP
-			GenerateOGL(&*a);
-		#endif
+	if (!ok.empty())
+	{
+		char buf[50];
+		sprintf(buf," (Line %d)",ln);
+		ok += buf;
 	}
 	return ok;
 }
 
+string	ReadAptIndexICAO(const AptFileIndex_t& inIndex, const set<string>& inICAOs, AptVector& outApts)
+{
+	outApts.clear();
+	vector<int>	wanted;
+	for (int n = 0; n < inIndex.apt_icao.size(); ++n)
+		if (inICAOs.count(inIndex.apt_icao[n]))
+			wanted.push_back(n);
+	return read_indexed_apts(inIndex, wanted, outApts);
+}
+
 bool	WriteAptFile(const char * inFileName, const AptVector& inApts, int version)
 {
 	FILE * fi = fopen(inFileName, "wb");
@@ -36,6 +36,24 @@ bool	ReadApts(XAtomContainer& container, AptVector& outApts);
 
 string	ReadAptFile(const char * inFileName, AptVector& outApts);
 string	ReadAptFileMem(const char * inBegin, const char * inEnd, AptVector& outApts);
+
+// An apt.dat in memory, split at its airport records by one quick pass over the line starts - nothing but the airport
+// header lines is tokenized.  ReadAptFileMem builds one of these and then parses all airports in parallel; with
+// ReadAptIndexICAO a tool can parse just the airports it needs out of the global apt.dat.  The index points into the
+// file's memory, which must stay around while it is used.
+struct	AptFileIndex_t {
+	int						version;
+	const char *			records;		// first line after the header
+	int						records_line;
+	const char *			end;			// end of the records - the 99 line, if there is one
+	vector<const char *>	apt_begin;		// each airport's header line, in file order...
+	vector<int>				apt_line;		// ...its line number, for error messages...
+	vector<string>			apt_icao;		// ...and its ICAO code.
+};
+
+string	IndexAptFileMem(const char * inBegin, const char * inEnd, AptFileIndex_t& outIndex);
+// All airports with one of the given codes, in file order.  Only those airports are parsed, so only their errors are seen.
+string	ReadAptIndexICAO(const AptFileIndex_t& inIndex, const set<string>& inICAOs, AptVector& outApts);
 bool	WriteAptFile(const char * inFileName, const AptVector& outApts, int version);  
 bool	WriteAptFileOpen(FILE * inFile, const AptVector& outApts, int version);
 bool	WriteAptFileProcs(int (* print_func)(void *, const char *, ...), void * ref, const AptVector& outApts, int version);
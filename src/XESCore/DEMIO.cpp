@@ -108,61 +108,126 @@ void	RemapEnumDEM(	DEMGeo& ioMap, const TokenConversionMap& inMap)
 #pragma mark -
 
 
-bool	ReadRawWithHeader(DEMGeo& inMap, const char * inFilename, const DEMSpec& spec)
+/*
+	WINDOWED READS
+
+	The big raster sources (continent-wide GeoTIFFs and BILs) are far bigger than the tile we are cutting.  Given
+	the file's full extent and size, we work out which rows and columns of the file cover a lon/lat window (plus
+	a margin) and decode only those; the DEM comes back with the window's size and bounds, snapped out to the
+	file's pixel grid.
+
+	Rows are counted the way the files store them - row 0 is the north-most scanline.
+*/
+
+struct	DEMFileWindow {
+	int		col1, col2;		// Columns to read, col2 exclusive
+	int		row1, row2;		// Rows to read from the north, row2 exclusive
+};
+
+// On entry the DEM has the whole file's bounds and post-ness.  Picks the window, then sets the DEM's bounds and
+// size to match it.  A NULL window means the whole file.  Returns false if the window misses the file.
+static bool	SetupDEMWindow(DEMGeo& ioMap, int file_w, int file_h, const double * window, int margin, DEMFileWindow& outWin)
+{
+	outWin.col1 = 0;	outWin.col2 = file_w;
+	outWin.row1 = 0;	outWin.row2 = file_h;
+
+	if (window)
+	{
+		// Pixels per degree, and the window edges in pixel units from the file's SW corner.  The epsilon keeps a
+		// window edge that lands on a sample from pulling in the next row or column over rounding noise.
+		double	xres = (double) (file_w - ioMap.mPost) / (ioMap.mEast - ioMap.mWest);
+		double	yres = (double) (file_h - ioMap.mPost) / (ioMap.mNorth - ioMap.mSouth);
+		const double eps = 1.0e-6;
+
+		int	x1 = floor((window[0] - ioMap.mWest ) * xres + eps) - margin;
+		int	x2 = ceil ((window[2] - ioMap.mWest ) * xres - eps) + ioMap.mPost + margin;
+		int	y1 = floor((window[1] - ioMap.mSouth) * yres + eps) - margin;
+		int	y2 = ceil ((window[3] - ioMap.mSouth) * yres - eps) + ioMap.mPost + margin;
+
+		x1 = max(x1, 0);	x2 = min(x2, file_w);
+		y1 = max(y1, 0);	y2 = min(y2, file_h);
+		if (x1 >= x2 || y1 >= y2)
+			return false;
+
+		outWin.col1 = x1;			outWin.col2 = x2;
+		outWin.row1 = file_h - y2;	outWin.row2 = file_h - y1;
+
+		double	west = ioMap.mWest, south = ioMap.mSouth;
+		ioMap.mWest  = west  + (double)  x1 / xres;
+		ioMap.mEast  = west  + (double) (x2 - ioMap.mPost) / xres;
+		ioMap.mSouth = south + (double)  y1 / yres;
+		ioMap.mNorth = south + (double) (y2 - ioMap.mPost) / yres;
+	}
+
+	ioMap.resize(outWin.col2 - outWin.col1, outWin.row2 - outWin.row1);
+	return ioMap.mData != NULL || ioMap.mWidth * ioMap.mHeight == 0;
+}
+
+bool	ReadRawWithHeader(DEMGeo& inMap, const char * inFilename, const DEMSpec& spec, const double * window, int margin)
 {
 	MFMemFile * fi = MemFile_Open(inFilename);
 	if(!fi) return false;
-	MemFileReader reader(MemFile_GetBegin(fi) + spec.mHeaderBytes,MemFile_GetEnd(fi),spec.mBigEndian ? platform_BigEndian : platform_LittleEndian);
+	const char *	base = MemFile_GetBegin(fi) + spec.mHeaderBytes;
+	size_t			sample_bytes = spec.mBits / 8;
+	DEMFileWindow	win;
 	inMap.mPost = spec.mPost;
 	inMap.mEast = spec.mEast;
 	inMap.mWest = spec.mWest;
 	inMap.mNorth = spec.mNorth;
 	inMap.mSouth = spec.mSouth;
-	inMap.resize(spec.mWidth, spec.mHeight);
 
-	if((spec.mWidth * spec.mHeight * (spec.mBits / 8) - spec.mHeaderBytes) != (MemFile_GetEnd(fi) - MemFile_GetBegin(fi)))
+	if(((size_t) spec.mWidth * (size_t) spec.mHeight * sample_bytes + spec.mHeaderBytes) != (size_t) (MemFile_GetEnd(fi) - MemFile_GetBegin(fi)))
+		goto fail;
+
+	if(!SetupDEMWindow(inMap, spec.mWidth, spec.mHeight, window, margin, win))
 		goto fail;
 
-	for(int y = inMap.mHeight-1; y >= 0; --y)
-	for(int x = 0; x < inMap.mWidth; ++x)
+	// The file is mapped, so seeking to each row of the window only pages in the rows we use.
+	for(int row = win.row1; row < win.row2; ++row)
 	{
-		float vp;
-		short s;
-		int i;
-		float f;
-		double d;
-		if(spec.mFloat)
+		MemFileReader reader(base + ((size_t) row * (size_t) spec.mWidth + win.col1) * sample_bytes, MemFile_GetEnd(fi),
+							spec.mBigEndian ? platform_BigEndian : platform_LittleEndian);
+		int y = win.row2 - 1 - row;
+		for(int x = 0; x < inMap.mWidth; ++x)
 		{
-			switch(spec.mBits) {
-			case 32:
-				reader.ReadFloat(f);
-				vp = f;
-				break;
-			case 64:
-				reader.ReadDouble(d);
-				vp = d;
-				break;
-			default:
-				goto fail;
+			float vp;
+			short s;
+			int i;
+			float f;
+			double d;
+			if(spec.mFloat)
+			{
+				switch(spec.mBits) {
+				case 32:
+					reader.ReadFloat(f);
+					vp = f;
+					break;
+				case 64:
+					reader.ReadDouble(d);
+					vp = d;
+					break;
+				default:
+					goto fail;
+				}
 			}
-		}
-		else
-		{
-			switch(spec.mBits) {
-			case 16:
-				reader.ReadShort(s);
-				vp = s;
-				break;
-			case 32:
-				reader.ReadInt(i);
-				vp = i;
-				break;
-			default:
-				goto fail;
+			else
+			{
+				switch(spec.mBits) {
+				case 16:
+					reader.ReadShort(s);
+					vp = s;
+					break;
+				case 32:
+					reader.ReadInt(i);
+					vp = i;
+					break;
+				default:
+					goto fail;
+				}
 			}
+			if(vp == spec.mNoData) vp = DEM_NO_DATA;
+			inMap(x,y) = vp;
 		}
-		if(vp == spec.mNoData) vp = DEM_NO_DATA;
-		inMap(x,y) = vp;
 	}
 	MemFile_Close(fi);
 	return true;
@@ -218,7 +283,7 @@ bool	ReadRawHGT(DEMGeo& inMap, const char * inFileName)
 
 // RAW HEIGHT FILE: N34W072.HGT
 // These files contian big-endian shorts with -32768 as DEM_NO_DATA
-bool	ReadRawBIL(DEMGeo& inMap, const char * inFileName, int bounds[4])
+bool	ReadRawBIL(DEMGeo& inMap, const char * inFileName, int bounds[4], const double * window, int margin)
 {
 	int	lat, lon;
 	char ns, ew;
@@ -250,23 +315,6 @@ bool	ReadRawBIL(DEMGeo& inMap, const char * inFileName, int bounds[4])
 	MFMemFile *	fi = MemFile_Open(inFileName);
 	if (!fi) return false;
 
-	PlatformType pt  = platform_LittleEndian;
-	{
-		MemFileReader	reader(MemFile_GetBegin(fi), MemFile_GetEnd(fi), platform_LittleEndian);
-		int wds = (MemFile_GetEnd(fi) - MemFile_GetBegin(fi)) / sizeof(short);
-		short low = SHRT_MAX;
-		while(wds--)
-		{
-			short v;
-			reader.ReadShort(v);
-			low = min(low,v);
-		}
-		if (low < -1000) pt = platform_BigEndian;
-	}
-
-
-	MemFileReader	reader(MemFile_GetBegin(fi), MemFile_GetEnd(fi), pt);
-
 	int len = MemFile_GetEnd(fi) - MemFile_GetBegin(fi);
 	long words = len / sizeof(short);
 	long tiles = (inMap.mEast - inMap.mWest) * (inMap.mNorth - inMap.mSouth);
@@ -277,15 +325,41 @@ bool	ReadRawBIL(DEMGeo& inMap, const char * inFileName, int bounds[4])
 	long ydim = dim * (inMap.mNorth - inMap.mSouth);
 	inMap.mPost = xdim % 2;
 
-	inMap.resize(xdim, ydim);
+	DEMFileWindow	win;
+	if (!SetupDEMWindow(inMap, xdim, ydim, window, margin, win))
+	{
+		MemFile_Close(fi);
+		return false;
+	}
+
+	// Guess endian-ness from the samples we are going to use - a big-endian file read little-endian
+	// shows up as wild negative values.
+	PlatformType pt  = platform_LittleEndian;
+	{
+		short low = SHRT_MAX;
+		for (int row = win.row1; row < win.row2; ++row)
+		{
+			MemFileReader	reader(MemFile_GetBegin(fi) + ((size_t) row * xdim + win.col1) * sizeof(short), MemFile_GetEnd(fi), platform_LittleEndian);
+			for (int x = 0; x < inMap.mWidth; ++x)
+			{
+				short v;
+				reader.ReadShort(v);
+				low = min(low,v);
+			}
+		}
+		if (low < -1000) pt = platform_BigEndian;
+	}
+
 	if (inMap.mData)
+	for (int row = win.row1; row < win.row2; ++row)
 	{
-		for (int y = ydim-1; y >= 0; --y)
-		for (int x = 0; x < xdim; ++x)
+		MemFileReader	reader(MemFile_GetBegin(fi) + ((size_t) row * xdim + win.col1) * sizeof(short), MemFile_GetEnd(fi), pt);
+		int y = win.row2 - 1 - row;
+		for (int x = 0; x < inMap.mWidth; ++x)
 		{
 			short	v;
 			reader.ReadShort(v);
-			inMap.mData[x + y * xdim] = v;
+			inMap.mData[x + y * inMap.mWidth] = v;
 		}
 	}
 
@@ -793,13 +867,16 @@ static void 	MemTIFFUnmapFileProc(thandle_t, tdata_t, toff_t)
 template<typename T>
 void copy_scanline(
 				const T * v,
-				int y,
+				int row,
+				const DEMFileWindow& win,
 				DEMGeo& dem)
 {
+	int y = win.row2 - 1 - row;
+	v += win.col1;
 	for (int x = 0; x < dem.mWidth; ++x, ++v)
 	{
 		float e = *v;
-		dem(x,dem.mHeight-y-1) = e;
+		dem(x,y) = e;
 	}
 }
 
@@ -821,18 +898,23 @@ void copy_tile(
 				const T * v,
 				int x,
 				int y,
-				int dx,			// tile size
+				int dx,			// part of the tile that is inside the image
 				int dy,
+				int stride,		// tile width - edge tiles are padded out to the full tile size
+				const DEMFileWindow& win,
 				DEMGeo& dem)
 {
-	for (int cy = 0; cy < dy; ++cy)
-	for (int cx = 0; cx < dx; ++cx)
+	int cy1 = max(0, win.row1 - y), cy2 = min(dy, win.row2 - y);
+	int cx1 = max(0, win.col1 - x), cx2 = min(dx, win.col2 - x);
+	for (int cy = cy1; cy < cy2; ++cy)
 	{
-		int dem_x = x + cx;
-		int dem_y = dem.mHeight - (y + cy) - 1;
-		float e = *v;
-		dem(dem_x,dem_y) = e;
-		++v;
+		const T * p = v + cy * stride + cx1;
+		int dem_y = win.row2 - 1 - (y + cy);
+		for (int cx = cx1; cx < cx2; ++cx, ++p)
+		{
+			float e = *p;
+			dem(x + cx - win.col1,dem_y) = e;
+		}
 	}
 }
 
@@ -860,7 +942,7 @@ void copy_tile(
 	In other words, the CGIAR SRTM files have essentially been shifted to the northeast by 1.5 arc-seconds.
 
 */
-bool	ExtractGeoTiff(DEMGeo& inMap, const char * inFileName, int post_style, int no_geo_needed)
+bool	ExtractGeoTiff(DEMGeo& inMap, const char * inFileName, int post_style, int no_geo_needed, const double * window, int margin)
 {
 	int result = -1;
 	double	corners[8];
@@ -923,7 +1005,15 @@ bool	ExtractGeoTiff(DEMGeo& inMap, const char * inFileName, int post_style, int
 	TIFFGetField(tif, TIFFTAG_SAMPLEFORMAT, &format);
 	printf("Image is: %dx%d, samples: %d, depth: %d, format: %d\n", w, h, cc, d, format);
 
-	inMap.resize(w,h);
+	DEMFileWindow win;
+	if(!SetupDEMWindow(inMap, w, h, window, margin, win))
+	{
+		printf("Window is not inside the image.\n");
+		TIFFClose(tif);
+		goto bail;
+	}
+	if(window)
+		printf("Reading window: columns %d-%d, rows %d-%d\n", win.col1, win.col2, win.row1, win.row2);
 	
 	if(TIFFIsTiled(tif))
 	{
@@ -931,8 +1021,9 @@ bool	ExtractGeoTiff(DEMGeo& inMap, const char * inFileName, int post_style, int
 		TIFFGetField(tif, TIFFTAG_TILEWIDTH, &tw);
 		TIFFGetField(tif, TIFFTAG_TILELENGTH, &th);
 		tdata_t buf = _TIFFmalloc(TIFFTileSize(tif));
-		for (int y = 0; y < h; y += th)
-		for (int x = 0; x < w; x += tw)
+		// Only visit the tiles that intersect the window.
+		for (int y = (win.row1 / th) * th; y < win.row2; y += th)
+		for (int x = (win.col1 / tw) * tw; x < win.col2; x += tw)
 		{
 			result = TIFFReadTile(tif, buf, x, y, 0, 0);
 			if (result == -1) { printf("Tiff error in read.\n"); break; }
@@ -944,13 +1035,13 @@ bool	ExtractGeoTiff(DEMGeo& inMap, const char * inFileName, int post_style, int
 			case SAMPLEFORMAT_UINT:
 				switch(d) {
 				case 8:
-					copy_tile<unsigned char>((const unsigned char *) buf, x,y,ux,uy, inMap);
+					copy_tile<unsigned char>((const unsigned char *) buf, x,y,ux,uy,tw, win, inMap);
 					break;
 				case 16:
-					copy_tile<unsigned short>((const unsigned short *) buf, x,y,ux,uy, inMap);
+					copy_tile<unsigned short>((const unsigned short *) buf, x,y,ux,uy,tw, win, inMap);
 					break;
 				case 32:
-					copy_tile<unsigned int>((const unsigned int *) buf, x,y,ux,uy, inMap);
+					copy_tile<unsigned int>((const unsigned int *) buf, x,y,ux,uy,tw, win, inMap);
 					break;
 				default:
 					printf("TIFF error: unsupported unsigned int sample depth: %d\n", d);
@@ -960,13 +1051,13 @@ bool	ExtractGeoTiff(DEMGeo& inMap, const char * inFileName, int post_style, int
 			case SAMPLEFORMAT_INT:
 				switch(d) {
 				case 8:
-					copy_tile<char>((const char *) buf, x,y,ux,uy, inMap);
+					copy_tile<char>((const char *) buf, x,y,ux,uy,tw, win, inMap);
 					break;
 				case 16:
-					copy_tile<short>((const short *) buf, x,y,ux,uy, inMap);
+					copy_tile<short>((const short *) buf, x,y,ux,uy,tw, win, inMap);
 					break;
 				case 32:
-					copy_tile<int>((const int *) buf, x,y,ux,uy, inMap);
+					copy_tile<int>((const int *) buf, x,y,ux,uy,tw, win, inMap);
 					break;
 				default:
 					printf("TIFF error: unsupported signed int sample depth: %d\n", d);
@@ -976,10 +1067,10 @@ bool	ExtractGeoTiff(DEMGeo& inMap, const char * inFileName, int post_style, int
 			case SAMPLEFORMAT_IEEEFP:
 				switch(d) {
 				case 32:
-					copy_tile<float>((const float *) buf, x,y,ux,uy, inMap);
+					copy_tile<float>((const float *) buf, x,y,ux,uy,tw, win, inMap);
 					break;
 				case 64:
-					copy_tile<double>((const double *) buf, x,y,ux,uy, inMap);
+					copy_tile<double>((const double *) buf, x,y,ux,uy,tw, win, inMap);
 					break;
 				default:
 					printf("TIFF error: unsupported floating point sample depth: %d\n", d);
@@ -1009,7 +1100,7 @@ bool	ExtractGeoTiff(DEMGeo& inMap, const char * inFileName, int post_style, int
 		int nos = TIFFNumberOfStrips(tif);
 		int cr = TIFFCurrentRow  (tif);
 
-		for (int y = 0; y < h; ++y)
+		for (int y = win.row1; y < win.row2; ++y)
 		{
 			result = TIFFReadScanline(tif, aline, y, 0);
 			if (result == -1) { printf("Tiff error in read.\n"); break; }
@@ -1018,13 +1109,13 @@ bool	ExtractGeoTiff(DEMGeo& inMap, const char * inFileName, int post_style, int
 			case SAMPLEFORMAT_UINT:
 				switch(d) {
 				case 8:
-					copy_scanline<unsigned char>((const unsigned char *) aline, y, inMap);
+					copy_scanline<unsigned char>((const unsigned char *) aline, y, win, inMap);
 					break;
 				case 16:
-					copy_scanline<unsigned short>((const unsigned short *) aline, y, inMap);
+					copy_scanline<unsigned short>((const unsigned short *) aline, y, win, inMap);
 					break;
 				case 32:
-					copy_scanline<unsigned int>((const unsigned int *) aline, y, inMap);
+					copy_scanline<unsigned int>((const unsigned int *) aline, y, win, inMap);
 					break;
 				default:
 					printf("TIFF error: unsupported unsigned int sample depth: %d\n", d);
@@ -1034,13 +1125,13 @@ bool	ExtractGeoTiff(DEMGeo& inMap, const char * inFileName, int post_style, int
 			case SAMPLEFORMAT_INT:
 				switch(d) {
 				case 8:
-					copy_scanline<char>((const char *) aline, y, inMap);
+					copy_scanline<char>((const char *) aline, y, win, inMap);
 					break;
 				case 16:
-					copy_scanline<short>((const short *) aline, y, inMap);
+					copy_scanline<short>((const short *) aline, y, win, inMap);
 					break;
 				case 32:
-					copy_scanline<int>((const int *) aline, y, inMap);
+					copy_scanline<int>((const int *) aline, y, win, inMap);
 					break;
 				default:
 					printf("TIFF error: unsupported signed int sample depth: %d\n", d);
@@ -1050,10 +1141,10 @@ bool	ExtractGeoTiff(DEMGeo& inMap, const char * inFileName, int post_style, int
 			case SAMPLEFORMAT_IEEEFP:
 				switch(d) {
 				case 32:
-					copy_scanline<float>((const float *) aline, y, inMap);
+					copy_scanline<float>((const float *) aline, y, win, inMap);
 					break;
 				case 64:
-					copy_scanline<double>((const double *) aline, y, inMap);
+					copy_scanline<double>((const double *) aline, y, win, inMap);
 					break;
 				default:
 					printf("TIFF error: unsupported floating point sample depth: %d\n", d);
@@ -66,7 +66,12 @@ void	RemapEnumDEM(	DEMGeo& ioMap, const TokenConversionMap& inMap);
  * DEM IMPORTERS
  *****************************************************************************/
 
-bool	ReadRawWithHeader(DEMGeo& inMap, const char * inFilename, const DEMSpec& spec);
+// WINDOWED IMPORT: the GeoTiff, BIL and raw-with-header importers can take a window - west, south, east, north
+// in degrees.  Only the file pixels covering the window, plus 'margin' pixels on each side (clamped to the file)
+// are decoded, and the DEM's bounds come back as the window snapped out to the file's pixel grid.  A NULL window
+// reads the whole file.  Use this to cut tiles out of continent-sized sources without loading them.
+
+bool	ReadRawWithHeader(DEMGeo& inMap, const char * inFilename, const DEMSpec& spec, const double * window = NULL, int margin = 0);
 
 // SRTM HGT Files
 //	16-bit signed meter heights in geo projection with -32768 = NO_DATA.
@@ -83,7 +88,7 @@ bool	ExtractIDAFile(DEMGeo& inMap, const char * inFileName);
 bool	ExtractUSGSNaturalFile(DEMGeo& inMap, const char * inFileName);
 
 // GeoTiff - must be geographic projected for us to use.  Origin is NW corner.
-bool	ExtractGeoTiff(DEMGeo& inMap, const char * inFileName, int post_style, int no_geo_needed);
+bool	ExtractGeoTiff(DEMGeo& inMap, const char * inFileName, int post_style, int no_geo_needed, const double * window = NULL, int margin = 0);
 bool	WriteGeoTiff(DEMGeo& inMap, const char * inFileName);
 
 // DTED - contains its own geo info
@@ -93,7 +98,7 @@ bool	ExtractDTED(DEMGeo& inMap, const char * inFileName);
 // DEM location taken from file name in the N42W073 format if bound is NULL or takes explicit bounds.
 // File can be either endian, reader guesses.  The reader routine guesses resolution from the tile bounds.  
 // Origin is NW corner.
-bool	ReadRawBIL(DEMGeo& inMap, const char * inFileName, int bounds[4]);	
+bool	ReadRawBIL(DEMGeo& inMap, const char * inFileName, int bounds[4], const double * window = NULL, int margin = 0);	
 
 // 32-bit floating point with a 5-byte header - an Austin-invented format, but useful
 // because we have the entire US NED dataset in this form.  DEM position is taken from
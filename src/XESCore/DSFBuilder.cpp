@@ -37,6 +37,7 @@
 #include "MathUtils.h"
 #include "PerfUtils.h"
 #include "GISTool_Globals.h"
+#include "ParallelUtils.h"
 
 /*
 	TODO:
@@ -413,32 +414,41 @@ float GetParamConst(const Face_handle face, int e)
 
 #define	INLAND_BLEND_DIST 5.0
 
+// These are called from the patch jobs, so look the terrain up without operator[] - a miss must not insert
+// into the shared table.
+inline int	CustomTerrainType(int n)
+{
+	NaturalTerrainInfoMap::const_iterator i = gNaturalTerrainInfo.find(n);
+	return (i == gNaturalTerrainInfo.end()) ? tex_not_custom : i->second.custom_ter;
+}
+
 inline bool IsCustomOverWaterHard(int n)
 {
 	if (n == terrain_Water)	return false;
 	if (n == terrain_VisualWater)	return false;
-	return gNaturalTerrainInfo[n].custom_ter == tex_custom_hard_water;
+	return CustomTerrainType(n) == tex_custom_hard_water;
 }
 
 inline bool IsCustomOverWaterSoft(int n)
 {
 	if (n == terrain_Water)	return false;
 	if (n == terrain_VisualWater)	return false;
-	return gNaturalTerrainInfo[n].custom_ter == tex_custom_soft_water;
+	return CustomTerrainType(n) == tex_custom_soft_water;
 }
 
 inline bool IsCustomOverWaterAny(int n)
 {
 	if (n == terrain_Water)	return false;
 	if (n == terrain_VisualWater)	return false;
-	return gNaturalTerrainInfo[n].custom_ter == tex_custom_hard_water ||
-			gNaturalTerrainInfo[n].custom_ter == tex_custom_soft_water;
+	int c = CustomTerrainType(n);
+	return c == tex_custom_hard_water ||
+			c == tex_custom_soft_water;
 }
 
 inline bool IsCustom(int n)
 {
 	if (n == terrain_Water)	return false;
-	return gNaturalTerrainInfo[n].custom_ter != tex_not_custom;
+	return CustomTerrainType(n) != tex_not_custom;
 }
 
 
@@ -505,7 +515,7 @@ static double GetWaterBlend(CDT::Vertex_handle v_han, const DEMGeo& dem_land, co
 
 	float ret = interp(0, 0, 50, 1, land_ele - water_ele);
 
-	v_han->info().wave_height = ret;
+	// The caller stores this as the vertex's wave height - we are run from worker threads and must not write to the mesh.
 
 	if (ret > 1.0)
 		printf("Over.\n");
@@ -523,7 +533,8 @@ static double GetTightnessBlend(CDT& inMesh, CDT::Face_handle f_han, CDT::Vertex
 	// ass.  In that case automatically tighten up the border via a cos^2 power curve, for the tightest
 	// border at totally shear angle.
 	Vector3	tproj(0,0,1);
-	int proj = gNaturalTerrainInfo[terrain].proj_angle;
+	NaturalTerrainInfoMap::const_iterator info = gNaturalTerrainInfo.find(terrain);
+	int proj = (info == gNaturalTerrainInfo.end()) ? proj_Down : info->second.proj_angle;
 	if (proj == proj_EastWest)	tproj = Vector3(1,0,0);
 	if (proj == proj_NorthSouth)	tproj = Vector3(0,1,0);
 
@@ -927,6 +938,247 @@ static int IsAliased(int lu)
 	return 0;
 }
 
+/************************************************************************************************
+ * PARALLEL PATCH ASSEMBLY
+ ************************************************************************************************
+ *
+ * For each land use we build every patch of every bucket into a ready-made buffer on worker
+ * threads, then feed the buffers to the DSF writer in bucket order - base patches first, then
+ * borders, exactly as if we had emitted them inline.  The jobs only read the mesh; anything that
+ * has to be written back (wave heights) is deferred to the serial emit.
+ *
+ */
+
+struct	DSFPatchBuffer {
+	DSFPatchBuffer() : used(false), tris(0), tri_fans(0), border_tris(0), fan_pool_tris(0) { }
+
+	bool						used;
+	double						near_lod;
+	double						far_lod;
+	int							flags;
+	int							depth;
+	vector<int>					prim_types;
+	vector<int>					prim_starts;	// Index of first vertex of each primitive, plus one past the end.
+	vector<double>				coords;			// depth doubles per vertex
+	vector<CDT::Vertex_handle>	wave_verts;		// For water patches: the vertex behind each emitted vertex.
+
+	int							tris;
+	int							tri_fans;
+	int							border_tris;
+	int							fan_pool_tris;
+
+	void	begin_prim(int t) { prim_types.push_back(t); prim_starts.push_back(coords.size() / depth); }
+	void	end_patch(void) { prim_starts.push_back(coords.size() / depth); }
+};
+
+struct	DSFPatchJob {
+
+	int									terrain;
+	bool								is_water;
+	bool								is_overlay;
+	const tex_proj_info *				pinfo;
+	CDT *								mesh;
+	const DEMGeo *						elevation;
+	const DEMGeo *						bathymetry;
+	const vector<CDT::Face_handle> *	tris;		// PATCH_DIM_HI * PATCH_DIM_HI buckets
+	const set<int> *					lus;
+	const set<int> *					borders;
+	vector<DSFPatchBuffer>				base;
+	vector<DSFPatchBuffer>				border;
+
+	void operator()(int cur_id)
+	{
+		if (lus[cur_id].count(terrain))
+			build_base(cur_id, base[cur_id]);
+#if !NO_BORDERS
+		if (terrain >= terrain_Natural)
+		if (borders[cur_id].count(terrain))							// Quick check: do we have ANY border tris in this layer in this patch?
+			build_border(cur_id, border[cur_id]);
+#endif
+	}
+
+	void	build_base(int cur_id, DSFPatchBuffer& out)
+	{
+		TriFanBuilder	fan_builder(mesh);
+		const vector<CDT::Face_handle>& bucket(tris[cur_id]);
+		for (int tri = 0; tri < bucket.size(); ++tri)
+		{
+			CDT::Face_handle f = bucket[tri];
+			if (f->info().terrain == terrain ||
+				(IsCustomOverWaterHard(f->info().terrain) && terrain == terrain_VisualWater) ||		// Take hard cus tris when doing vis water
+				(IsCustomOverWaterSoft(f->info().terrain) && terrain == terrain_Water))				// Take soft cus tris when doing real water
+			{
+				CHECK_TRI(f->vertex(0),f->vertex(1),f->vertex(2));
+				fan_builder.AddTriToFanPool(f);
+
+				++out.fan_pool_tris;
+			}
+		}
+		fan_builder.CalcFans();
+
+		out.used = true;
+		out.near_lod = TERRAIN_NEAR_LOD;
+		out.far_lod = TERRAIN_FAR_LOD;
+		out.flags = 0;
+		if(is_overlay)  out.flags |= dsf_Flag_Overlay;
+		if(terrain != terrain_VisualWater &&				// Every patch is physical EXCEPT: visual water, obviously just for looks!
+			!IsCustomOverWaterSoft(terrain))				// custom over soft water - we get physics from who is underneath
+			out.flags |= dsf_Flag_Physical;
+		out.depth = is_water ? 7 : (pinfo ? 7 : 5);
+
+		list<CDT::Vertex_handle>				primv;
+		list<CDT::Vertex_handle>::iterator		vert;
+		int										primt;
+		double									coords8[8];
+		while(1)
+		{
+			primt = fan_builder.GetNextPrimitive(primv);
+			if(primv.empty()) break;
+			if(primt != dsf_Tri)
+			{
+				++out.tri_fans;
+				out.tris += (primv.size() - 2);
+			} else {
+				out.tris += (primv.size() / 3);
+			}
+			out.begin_prim(primt);
+			for(vert = primv.begin(); vert != primv.end(); ++vert)
+			{
+				// Ben says: the use of doblim warrants some explanation: CGAL provides EXACT arithmetic, but it does not give exact
+				// conversion back to float EVEN when that is possible!!  So the edge of our tile is guaranteed to be exactly on the DSF
+				// border but is not guaranteed to be within the DSF border once rounded.
+				// Because of this, we have to clamp our output to the double-precision bounds after conversion, since DSFLib is sensitive
+				// to out-of-boundary conditions!
+				coords8[0] = doblim(CGAL::to_double((*vert)->point().x()),elevation->mWest ,elevation->mEast );
+				coords8[1] = doblim(CGAL::to_double((*vert)->point().y()),elevation->mSouth,elevation->mNorth);
+				DebugAssert(coords8[0] >= elevation->mWest  && coords8[0] <= elevation->mEast );
+				DebugAssert(coords8[1] >= elevation->mSouth && coords8[1] <= elevation->mNorth);
+				coords8[2] =USE_DEM_H( (*vert)->info().height, is_water,*mesh,(*vert));
+				coords8[3] =USE_DEM_N( (*vert)->info().normal[0]);
+				coords8[4] =USE_DEM_N(-(*vert)->info().normal[1]);
+				if (is_water)
+				{
+					coords8[5] = GetWaterBlend((*vert), *elevation, *bathymetry);
+					coords8[6] = CategorizeVertex(*mesh,*vert,terrain_Water) >= 0 ? 0.0 : 1.0;
+					DebugAssert(coords8[5] >= 0.0);
+					DebugAssert(coords8[5] <= 1.0);
+					out.wave_verts.push_back(*vert);
+				}
+				else if (pinfo)	{
+					ProjectTex(coords8[0],coords8[1],coords8[5],coords8[6],pinfo);
+					DebugAssert(coords8[5] >= 0.0);
+					DebugAssert(coords8[5] <= 1.0);
+					DebugAssert(coords8[6] >= 0.0);
+					DebugAssert(coords8[6] <= 1.0);
+				}
+				DebugAssert(coords8[3] >= -1.0);
+				DebugAssert(coords8[3] <=  1.0);
+				DebugAssert(coords8[4] >= -1.0);
+				DebugAssert(coords8[4] <=  1.0);
+				out.coords.insert(out.coords.end(), coords8, coords8 + out.depth);
+			}
+		}
+		out.end_patch();
+	}
+
+	void	build_border(int cur_id, DSFPatchBuffer& out)
+	{
+		out.used = true;
+		out.near_lod = TERRAIN_NEAR_BORDER_LOD;
+		out.far_lod = TERRAIN_FAR_BORDER_LOD;
+		out.flags = dsf_Flag_Overlay;
+		out.depth = /*is_composite ? 8 :*/ 7;
+
+		double	coords8[8];
+		int		tris_this_patch = 0;
+		const vector<CDT::Face_handle>& bucket(tris[cur_id]);
+		out.begin_prim(dsf_Tri);
+		for (int tri = 0; tri < bucket.size(); ++tri)						// For each tri
+		{
+			CDT::Face_handle f = bucket[tri];
+			if (f->info().terrain_border.count(terrain))					// If it has this border...
+			{
+				float	bblend[3];
+				int vi;
+				for (vi = 0; vi < 3; ++vi)
+				{
+					// Don't use [] - it would insert into the vertex, and other jobs are reading it.
+					hash_map<int, float>::const_iterator bb = f->vertex(vi)->info().border_blend.find(terrain);
+					bblend[vi] = (bb == f->vertex(vi)->info().border_blend.end()) ? 0.0f : bb->second;
+				}
+
+				// Ben says: normally we would like to draw one DSF overdrawn tri for each border tri.  But there is an exception case:
+				// if ALL of our border blends are 100% but our border is NOT a variant (e.g. this is a meaningful border change) then
+				// we really need to make 3 border tris that all fade out...this allows the CENTER of our tri to show the base terrain
+				// while the borders show the neighboring tris.  (Without this, a single tri of cliff will be COMPLETELY covered by
+				// the non-cliff terrain surrouding on 3 sides.)  In this case we make THREE passes and force one vertex to 0% blend for
+				// each pass.
+				int ts = -1, te = 0;
+				if (bblend[0] == bblend[1] &&
+					bblend[1] == bblend[2] &&
+					bblend[0] == 1.0)
+				{
+					ts = 0; te = 3;
+				}
+
+				for (int border_pass = ts; border_pass < te; ++border_pass)
+				{
+					if (tris_this_patch >= MAX_TRIS_PER_PATCH)
+					{
+						out.begin_prim(dsf_Tri);
+						tris_this_patch = 0;
+					}
+
+					for (vi = 2; vi >= 0 ; --vi)
+					{
+						coords8[0] = doblim(CGAL::to_double(f->vertex(vi)->point().x()),elevation->mWest ,elevation->mEast );
+						coords8[1] = doblim(CGAL::to_double(f->vertex(vi)->point().y()),elevation->mSouth,elevation->mNorth);
+						DebugAssert(coords8[0] >= elevation->mWest  && coords8[0] <= elevation->mEast );
+						DebugAssert(coords8[1] >= elevation->mSouth && coords8[1] <= elevation->mNorth);
+
+						coords8[2] =USE_DEM_H( f->vertex(vi)->info().height , is_water, *mesh,f->vertex(vi));
+						coords8[3] =USE_DEM_N( f->vertex(vi)->info().normal[0]);
+						coords8[4] =USE_DEM_N(-f->vertex(vi)->info().normal[1]);
+						coords8[5] = vi == border_pass ? 0.0 : bblend[vi];
+						coords8[6] = GetTightnessBlend(*mesh, f, f->vertex(vi), terrain);
+						DebugAssert(coords8[5] >= 0.0);
+						DebugAssert(coords8[5] <= 1.0);
+						DebugAssert(coords8[6] >= 0.0);
+						DebugAssert(coords8[6] <= 1.0);
+						DebugAssert(!is_water);
+						DebugAssert(coords8[3] >= -1.0);
+						DebugAssert(coords8[3] <=  1.0);
+						DebugAssert(coords8[4] >= -1.0);
+						DebugAssert(coords8[4] <=  1.0);
+						out.coords.insert(out.coords.end(), coords8, coords8 + out.depth);
+					}
+					++out.tris;
+					++out.border_tris;
+					++tris_this_patch;
+				}
+			}
+		}
+		out.end_patch();
+	}
+};
+
+// Hand one built patch to the DSF writer.  This is also where deferred writes to the mesh happen.
+static void	EmitPatchBuffer(const DSFPatchBuffer& buf, int terrain_idx, DSFCallbacks_t& cbs, void * writer)
+{
+	cbs.BeginPatch_f(terrain_idx, buf.near_lod, buf.far_lod, buf.flags, buf.depth, writer);
+	for (int p = 0; p < buf.prim_types.size(); ++p)
+	{
+		cbs.BeginPrimitive_f(buf.prim_types[p], writer);
+		for (int v = buf.prim_starts[p]; v < buf.prim_starts[p+1]; ++v)
+			cbs.AddPatchVertex_f(const_cast<double *>(&buf.coords[v * buf.depth]), writer);
+		cbs.EndPrimitive_f(writer);
+	}
+	cbs.EndPatch_f(writer);
+
+	for (int v = 0; v < buf.wave_verts.size(); ++v)
+		buf.wave_verts[v]->info().wave_height = buf.coords[v * buf.depth + 5];
+}
+
 void	BuildDSF(
 			const char *	inFileName1,
 			const char *	inFileName2,
@@ -1236,6 +1488,21 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 
 	if (inProgress && inProgress(0, 5, "Compiling Mesh", 1.0)) return;
 
+#if STUB_FANS
+	// The patch jobs read vertex coordinates from several threads.  A lazy coordinate can refine its interval the
+	// first time it is converted to double, and CHECK_TRI's compares can compute its exact value - both write to the
+	// shared vertex.  Do both here, once, before any threads start.
+	if(writer1)
+	for (CDT::Finite_vertices_iterator v = inHiresMesh.finite_vertices_begin(); v != inHiresMesh.finite_vertices_end(); ++v)
+	{
+		const CDT::Point& p(v->point());
+		CGAL::to_double(p.x());
+		CGAL::to_double(p.y());
+		if (p.x().approx().inf() != p.x().approx().sup())	p.x().exact();
+		if (p.y().approx().inf() != p.y().approx().sup())	p.y().exact();
+	}
+#endif
+
 	if(writer1)
 	for (prog_c = 0.0, lu_ranked = landuses.begin(); lu_ranked != landuses.end(); ++lu_ranked, prog_c += 1.0)
 	{
@@ -1302,180 +1569,50 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 #endif
 
 		/***************************************************************************************************************************************
-		 * WRITE OUT HI RES BASE PATCHES
+		 * WRITE OUT HI RES BASE AND BORDER PATCHES
 		 ***************************************************************************************************************************************/
-		for (cur_id = 0; cur_id < (PATCH_DIM_HI*PATCH_DIM_HI); ++cur_id)
-		if (sHiResLU[cur_id].count(lu_ranked->first))
 		{
-			TriFanBuilder	fan_builder(&inHiresMesh);
-			for (tri = 0; tri < sHiResTris[cur_id].size(); ++tri)
-			{
-				f = sHiResTris[cur_id][tri];
-				if (f->info().terrain == lu_ranked->first ||
-					(IsCustomOverWaterHard(f->info().terrain) && lu_ranked->first == terrain_VisualWater) ||		// Take hard cus tris when doing vis water
-					(IsCustomOverWaterSoft(f->info().terrain) && lu_ranked->first == terrain_Water))				// Take soft cus tris when doing real water
-				{
-					CHECK_TRI(f->vertex(0),f->vertex(1),f->vertex(2));
-					fan_builder.AddTriToFanPool(f);
-
-					++debug_add_tri_fan;
-				}
-			}
-			fan_builder.CalcFans();
-
-			tex_proj_info * pinfo = (gTexProj.count(lu_ranked->first)) ? &gTexProj[lu_ranked->first] : NULL;
-
-			int flags = 0;
-			if(is_overlay)  flags |= dsf_Flag_Overlay;
-			if(lu_ranked->first != terrain_VisualWater &&			// Every patch is physical EXCEPT: visual water, obviously just for looks!
-				!IsCustomOverWaterSoft(lu_ranked->first))			// custom over soft water - we get physics from who is underneath
-				flags |= dsf_Flag_Physical;
+			DSFPatchJob	job;
+			job.terrain = lu_ranked->first;
+			job.is_water = is_water;
+			job.is_overlay = is_overlay;
+			job.pinfo = (gTexProj.count(lu_ranked->first)) ? &gTexProj[lu_ranked->first] : NULL;
+			job.mesh = &inHiresMesh;
+			job.elevation = &inElevation;
+			job.bathymetry = &inBathymetry;
+			job.tris = sHiResTris;
+			job.lus = sHiResLU;
+			job.borders = sHiResBO;
+			job.base.resize(PATCH_DIM_HI*PATCH_DIM_HI);
+			job.border.resize(PATCH_DIM_HI*PATCH_DIM_HI);
+
+#if STUB_FANS
+			ParallelFor(PATCH_DIM_HI*PATCH_DIM_HI, job);
+#else
+			// The real tri-fan builder marks faces in the mesh as it goes - buckets can't be built concurrently.
+			for (cur_id = 0; cur_id < (PATCH_DIM_HI*PATCH_DIM_HI); ++cur_id)
+				job(cur_id);
+#endif
 
-			cbs.BeginPatch_f(lu_ranked->second, TERRAIN_NEAR_LOD, TERRAIN_FAR_LOD, flags, is_water ? 7 : (pinfo ? 7 : 5), writer1);
-			list<CDT::Vertex_handle>				primv;
-			list<CDT::Vertex_handle>::iterator		vert;
-			int										primt;
-			while(1)
+			for (cur_id = 0; cur_id < (PATCH_DIM_HI*PATCH_DIM_HI); ++cur_id)
+			if (job.base[cur_id].used)
 			{
-                primt = fan_builder.GetNextPrimitive(primv);
-                if(primv.empty()) break;
-                if(primt != dsf_Tri)
-                 {
-                    ++total_tri_fans;
-                    total_tris += (primv.size() - 2);
-                } else {
-                    total_tris += (primv.size() / 3);
-                    tris_this_patch += (primv.size() / 3);
-                }
-                cbs.BeginPrimitive_f(primt, writer1);
-                for(vert = primv.begin(); vert != primv.end(); ++vert)
-                {
-					// Ben says: the use of doblim warrants some explanation: CGAL provides EXACT arithmetic, but it does not give exact
-					// conversion back to float EVEN when that is possible!!  So the edge of our tile is guaranteed to be exactly on the DSF
-					// border but is not guaranteed to be within the DSF border once rounded.
-					// Because of this, we have to clamp our output to the double-precision bounds after conversion, since DSFLib is sensitive
-					// to out-of-boundary conditions!
-					DebugAssert((*vert)->point().x() >= inElevation.mWest  && (*vert)->point().x() <= inElevation.mEast );
-					DebugAssert((*vert)->point().y() >= inElevation.mSouth && (*vert)->point().y() <= inElevation.mNorth);
-					coords8[0] = doblim(CGAL::to_double((*vert)->point().x()),inElevation.mWest ,inElevation.mEast );
-					coords8[1] = doblim(CGAL::to_double((*vert)->point().y()),inElevation.mSouth,inElevation.mNorth);
-					DebugAssert(coords8[0] >= inElevation.mWest  && coords8[0] <= inElevation.mEast );
-					DebugAssert(coords8[1] >= inElevation.mSouth && coords8[1] <= inElevation.mNorth);
-					coords8[2] =USE_DEM_H( (*vert)->info().height, is_water,inHiresMesh,(*vert));
-					coords8[3] =USE_DEM_N( (*vert)->info().normal[0]);
-					coords8[4] =USE_DEM_N(-(*vert)->info().normal[1]);
-					if (is_water)
-					{
-						coords8[5] = GetWaterBlend((*vert), inElevation, inBathymetry);
-						coords8[6] = CategorizeVertex(inHiresMesh,*vert,terrain_Water) >= 0 ? 0.0 : 1.0;
-						DebugAssert(coords8[5] >= 0.0);
-						DebugAssert(coords8[5] <= 1.0);
-					}
-					else if (pinfo)	{
-						ProjectTex(coords8[0],coords8[1],coords8[5],coords8[6],pinfo);
-						DebugAssert(coords8[5] >= 0.0);
-						DebugAssert(coords8[5] <= 1.0);
-						DebugAssert(coords8[6] >= 0.0);
-						DebugAssert(coords8[6] <= 1.0);
-					}
-					DebugAssert(coords8[3] >= -1.0);
-					DebugAssert(coords8[3] <=  1.0);
-					DebugAssert(coords8[4] >= -1.0);
-					DebugAssert(coords8[4] <=  1.0);
-					cbs.AddPatchVertex_f(coords8, writer1);
-				}
-				cbs.EndPrimitive_f(writer1);
+				EmitPatchBuffer(job.base[cur_id], lu_ranked->second, cbs, writer1);
+				debug_add_tri_fan += job.base[cur_id].fan_pool_tris;
+				total_tri_fans += job.base[cur_id].tri_fans;
+				total_tris += job.base[cur_id].tris;
+				++total_patches;
 			}
-			cbs.EndPatch_f(writer1);
-			++total_patches;
-		}
-
-		/***************************************************************************************************************************************
-		 * WRITE OUT HI RES BORDER PATCHES
-		 ***************************************************************************************************************************************/
 
-#if !NO_BORDERS
-		for (cur_id = 0; cur_id < (PATCH_DIM_HI*PATCH_DIM_HI); ++cur_id)		// For each triangle in this patch
-		if (lu_ranked->first >= terrain_Natural)
-		if (sHiResBO[cur_id].count(lu_ranked->first))							// Quick check: do we have ANY border tris in this layer in this patch?
-		{
-			cbs.BeginPatch_f(lu_ranked->second, TERRAIN_NEAR_BORDER_LOD, TERRAIN_FAR_BORDER_LOD, dsf_Flag_Overlay, /*is_composite ? 8 :*/ 7, writer1);
-			cbs.BeginPrimitive_f(dsf_Tri, writer1);
-			tris_this_patch = 0;
-			for (tri = 0; tri < sHiResTris[cur_id].size(); ++tri)				// For each tri
+			for (cur_id = 0; cur_id < (PATCH_DIM_HI*PATCH_DIM_HI); ++cur_id)
+			if (job.border[cur_id].used)
 			{
-				f = sHiResTris[cur_id][tri];
-				if (f->info().terrain_border.count(lu_ranked->first))			// If it has this border...
-				{
-					float	bblend[3];
-					int vi;
-					for (vi = 0; vi < 3; ++vi)
-						bblend[vi] = f->vertex(vi)->info().border_blend[lu_ranked->first];
-
-					// Ben says: normally we would like to draw one DSF overdrawn tri for each border tri.  But there is an exception case:
-					// if ALL of our border blends are 100% but our border is NOT a variant (e.g. this is a meaningful border change) then
-					// we really need to make 3 border tris that all fade out...this allows the CENTER of our tri to show the base terrain
-					// while the borders show the neighboring tris.  (Without this, a single tri of cliff will be COMPLETELY covered by
-					// the non-cliff terrain surrouding on 3 sides.)  In this case we make THREE passes and force one vertex to 0% blend for
-					// each pass.
-					int ts = -1, te = 0;
-//					if (!AreVariants(lu_ranked->first, f->info().terrain))
-					if (bblend[0] == bblend[1] &&
-						bblend[1] == bblend[2] &&
-						bblend[0] == 1.0)
-					{
-						ts = 0; te = 3;
-					}
-
-					for (int border_pass = ts; border_pass < te; ++border_pass)
-					{
-
-						if (tris_this_patch >= MAX_TRIS_PER_PATCH)
-						{
-							cbs.EndPrimitive_f(writer1);
-							cbs.BeginPrimitive_f(dsf_Tri, writer1);
-							tris_this_patch = 0;
-						}
-
-						for (vi = 2; vi >= 0 ; --vi)
-						{
-							DebugAssert(f->vertex(vi)->point().x() >= inElevation.mWest  && f->vertex(vi)->point().x() <= inElevation.mEast );
-							DebugAssert(f->vertex(vi)->point().y() >= inElevation.mSouth && f->vertex(vi)->point().y() <= inElevation.mNorth);
-							coords8[0] = doblim(CGAL::to_double(f->vertex(vi)->point().x()),inElevation.mWest ,inElevation.mEast );
-							coords8[1] = doblim(CGAL::to_double(f->vertex(vi)->point().y()),inElevation.mSouth,inElevation.mNorth);
-							DebugAssert(coords8[0] >= inElevation.mWest  && coords8[0] <= inElevation.mEast );
-							DebugAssert(coords8[1] >= inElevation.mSouth && coords8[1] <= inElevation.mNorth);
-
-							coords8[2] =USE_DEM_H( f->vertex(vi)->info().height , is_water, inHiresMesh,f->vertex(vi));
-							coords8[3] =USE_DEM_N( f->vertex(vi)->info().normal[0]);
-							coords8[4] =USE_DEM_N(-f->vertex(vi)->info().normal[1]);
-//							coords8[5] = f->vertex(vi)->info().border_blend[lu_ranked->first];
-							coords8[5] = vi == border_pass ? 0.0 : bblend[vi];
-							coords8[6] = GetTightnessBlend(inHiresMesh, f, f->vertex(vi), lu_ranked->first);
-							DebugAssert(coords8[5] >= 0.0);
-							DebugAssert(coords8[5] <= 1.0);
-							DebugAssert(coords8[6] >= 0.0);
-							DebugAssert(coords8[6] <= 1.0);
-							DebugAssert(!is_water);
-	//						if (is_composite)
-	//							coords8[7] = is_water ? GetWaterBlend(f->vertex(vi), waterType) : f->vertex(vi)->info().vege_density;
-							DebugAssert(coords8[3] >= -1.0);
-							DebugAssert(coords8[3] <=  1.0);
-							DebugAssert(coords8[4] >= -1.0);
-							DebugAssert(coords8[4] <=  1.0);
-							cbs.AddPatchVertex_f(coords8, writer1);
-						}
-						++total_tris;
-						++border_tris;
-						++tris_this_patch;
-					}
-				}
+				EmitPatchBuffer(job.border[cur_id], lu_ranked->second, cbs, writer1);
+				total_tris += job.border[cur_id].tris;
+				border_tris += job.border[cur_id].border_tris;
+				++total_patches;
 			}
-			cbs.EndPrimitive_f(writer1);
-			cbs.EndPatch_f(writer1);
-			++total_patches;
 		}
-#endif
 	}
 
 	if(writer1)
@@ -338,6 +338,7 @@ public:
 #if OPENGL_MAP
 	vector<const float *>		mGLTris;						// Pre-expanded triangle indices
 	unsigned char				mGLColor[4];
+	Bbox2						mGLBounds;						// Outer CCB bounds, cached for the index
 #endif
 };
 
@@ -77,13 +77,13 @@
 
 
 typedef multimap<float, void *, greater<float> >			FaceQueue;	// YUCK - hard cast to avoid snarky problems with forward decls
-typedef multimap<double, void *>							VertexQueue;
 
 struct	MeshVertexInfo {
-	MeshVertexInfo() : height(0.0), wave_height(1.0) { }
+	MeshVertexInfo() : height(0.0), wave_height(1.0), self(-1) { }
 	MeshVertexInfo(const MeshVertexInfo& rhs) :
 								height(rhs.height),
-								border_blend(rhs.border_blend) {
+								border_blend(rhs.border_blend),
+								self(-1) {
 								normal[0] = rhs.normal[0];
 								normal[1] = rhs.normal[1];
 								normal[2] = rhs.normal[2]; }
@@ -101,7 +101,7 @@ struct	MeshVertexInfo {
 	hash_map<int, float>	border_blend;			// blend level for a border of this layer at this triangle!
 	
 	Vertex_handle			orig_vertex;			// Original vertex in the Pmwx.
-	VertexQueue::iterator	self;
+	int						self;					// Slot in MeshSimplify's queue, -1 if not queued.
 
 };
 
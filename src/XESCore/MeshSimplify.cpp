@@ -53,9 +53,8 @@ void MeshSimplify::simplify(double in_max_err)
 	
 	while(!queue.empty())
 	{
-		CDT::Vertex_handle v = CDT_Recover_Handle((CDT::Vertex *) queue.begin()->second);
-		queue.erase(queue.begin());
-		v->info().self = queue.end();
+		CDT::Vertex_handle v = CDT_Recover_Handle(queue.front_value());
+		queue.pop_front();
 		
 		run_vertex(v);		
 	}
@@ -63,18 +62,21 @@ void MeshSimplify::simplify(double in_max_err)
 
 void MeshSimplify::init_q(void)
 {
+	// Everything goes in at once, so build the heap in one go rather than sifting each vertex in.
+	queue.reserve(mesh.number_of_vertices());
 	for(CDT::Finite_vertices_iterator q = mesh.finite_vertices_begin(); q != mesh.finite_vertices_end(); ++q)
 	{
-		q->info().self = queue.end();
+		q->info().self = -1;
 		CDT::Vertex_handle p, r;
 		double err;
 		if(can_remove_locked(q,p,r))
 		if((err = calc_remove_error(p,q,r)) < max_err)
 		if(can_remove_topo(p,q,r))
 		{
-			q->info().self = queue.insert(VertexQueue::value_type(err, &*q));
+			queue.append(err, &*q);
 		}
 	}
+	queue.rebuild();
 }
 
 void MeshSimplify::run_vertex(CDT::Vertex_handle q)
@@ -139,8 +141,8 @@ void		MeshSimplify::update_q(CDT::Vertex_handle q)
 {
 	bool	want_q = false;
 	double	err = max_err;
-	bool	is_queued = q->info().self != queue.end();
-	double	old_err = is_queued ? q->info().self->first : max_err;
+	bool	is_queued = queue.contains(&*q);
+	double	old_err = is_queued ? queue.priority(&*q) : max_err;
 	CDT::Vertex_handle p, r;
 	
 	if(can_remove_locked(q,p,r))
@@ -153,20 +155,14 @@ void		MeshSimplify::update_q(CDT::Vertex_handle q)
 	if(want_q != is_queued)
 	{
 		if(want_q)
-		{
-			q->info().self = queue.insert(VertexQueue::value_type(err, &*q));
-		}
+			queue.insert(err, &*q);
 		else
-		{
-			queue.erase(q->info().self);
-			q->info().self = queue.end();
-		}
+			queue.erase(&*q);
 	}
 	else if(want_q && old_err != err)
 	{
-		// Only do the remove and insert thing if the error changed?
-		queue.erase(q->info().self);
-		q->info().self = queue.insert(VertexQueue::value_type(err, &*q));
+		// Only re-prioritize if the error changed - this sends q behind its equals, same as a remove and insert.
+		queue.reprioritize(&*q, err);
 	}
 }
 
@@ -37,9 +37,16 @@
  */
 
 #include "MeshDefs.h"
+#include "STLUtils.h"
 
 typedef double (*mesh_error_f)(const Point_2& p, const Point_2& q, const Point_2& r);
 
+struct	MeshVertexSlot {
+	int& operator()(CDT::Vertex * v) const { return v->info().self; }
+};
+
+typedef indexed_heap<double, CDT::Vertex *, MeshVertexSlot>	VertexQueue;
+
 
 class	MeshSimplify {
 public:
@@ -34,6 +34,7 @@
 #include "DEMTables.h"
 #include "Zoning.h"
 #include "CompGeomUtils.h"
+#include "ParallelUtils.h"
 #if OPENGL_MAP && DEV
 	#include "RF_Selection.h"
 #endif
@@ -612,7 +613,7 @@ void	apply_combos_to_roads(Pmwx::Vertex_handle v, const vector<Pmwx::Halfedge_ha
 		set_he_level_at(hes[n],v,levels[n]);
 }
 
-int	optimize_one_junction(Pmwx::Vertex_handle v)
+int	optimize_one_junction(Pmwx::Vertex_handle v, bool skip_repeats)
 {
 	int score = score_for_junction(v);
 	if(score < E_HPLG) return score;
@@ -630,6 +631,9 @@ int	optimize_one_junction(Pmwx::Vertex_handle v)
 	vector<int>		best;
 	int				best_score=0;
 		
+	// The level vector is the whole signature of a trial - nothing else at the junction changes - so a trial
+	// that only uses levels below l-1 was already scored on an earlier pass, and with the strict < below it
+	// can never displace the first hit.  Skipping those cuts about a third of the scoring at 8 roads.
 	for(int l = 1; l <= he_list.size(); ++l)
 	{
 		int mc = max_code(he_list.size(), l);
@@ -637,6 +641,8 @@ int	optimize_one_junction(Pmwx::Vertex_handle v)
 		{
 			vector<int>	trial;
 			apply_levels(he_list.size(),l,code,trial);
+			if(skip_repeats && *max_element(trial.begin(),trial.end()) < l-1)
+				continue;
 			apply_combos_to_roads(v,he_list, trial);
 			int this_score = score_for_junction(v);
 			if(best.empty() || this_score < best_score)
@@ -861,6 +867,105 @@ void check_junction_highways(Pmwx::Vertex_handle v, set<Pmwx::Vertex_handle>& ch
 	}
 }
 
+// Waves smaller than this aren't worth starting threads for.
+#define JUNCTION_WAVE_MIN_PARALLEL 64
+
+struct	optimize_junction_job {
+	const vector<Pmwx::Vertex_handle> *	juncs;
+	const vector<int> *					wave;		// Indices into juncs
+	vector<int> *						scores;		// Per junction
+	bool								skip_repeats;
+
+	void operator()(int n)
+	{
+		int j = (*wave)[n];
+		(*scores)[j] = optimize_one_junction((*juncs)[j], skip_repeats);
+	}
+};
+
+void optimize_junctions(Pmwx& io_map, list<Pmwx::Vertex_handle>& out_crsh_starts, bool in_serial, bool skip_repeats)
+{
+	vector<Pmwx::Vertex_handle>		juncs;
+	for(Pmwx::Vertex_iterator v = io_map.vertices_begin(); v != io_map.vertices_end(); ++v)
+	#if OPENGL_MAP && DEV
+	if(gVertexSelection.empty() || gVertexSelection.count(v))
+	#endif
+		juncs.push_back(v);
+
+	vector<int>	scores(juncs.size());
+	if(in_serial)
+	{
+		for(int j = 0; j < juncs.size(); ++j)
+			scores[j] = optimize_one_junction(juncs[j], skip_repeats);
+	}
+	else
+	{
+		// Junctions are optimized in waves so they can run concurrently and still match the serial pass exactly.
+		// Scoring a junction reads the far ends of its roads, so each junction must see its road neighbors that come
+		// earlier in vertex order already optimized and the later ones untouched.  A junction's wave is one past the
+		// latest wave of its earlier neighbors; junctions in one wave never share a road, so a wave is independent.
+		vector<vector<int> >			waves;
+		map<Pmwx::Vertex_handle,int>	wave_of;
+
+		// Pull every coordinate to a double once up front: a lazy exact coordinate may refine itself the first time
+		// it is read, and we don't want that happening from two threads.
+		for(Pmwx::Vertex_iterator v = io_map.vertices_begin(); v != io_map.vertices_end(); ++v)
+			cgal2ben(v->point());
+
+		for(int j = 0; j < juncs.size(); ++j)
+		{
+			int w = 0;
+			if(!juncs[j]->is_isolated())
+			{
+				Pmwx::Halfedge_around_vertex_circulator circ, stop;
+				circ = stop = juncs[j]->incident_halfedges();
+				do {
+					if(he_has_any_roads(circ))
+					{
+						map<Pmwx::Vertex_handle,int>::iterator n = wave_of.find(circ->source());
+						if(n != wave_of.end())
+							w = max(w, n->second + 1);
+					}
+				} while(++circ != stop);
+			}
+			wave_of[juncs[j]] = w;
+			if(w >= waves.size())
+				waves.resize(w+1);
+			waves[w].push_back(j);
+		}
+		wave_of.clear();
+
+		for(int w = 0; w < waves.size(); ++w)
+		{
+			optimize_junction_job	job;
+			job.juncs = &juncs;
+			job.wave = &waves[w];
+			job.scores = &scores;
+			job.skip_repeats = skip_repeats;
+			if(waves[w].size() < JUNCTION_WAVE_MIN_PARALLEL)
+				for(int n = 0; n < waves[w].size(); ++n)
+					job(n);
+			else
+				ParallelFor(waves[w].size(), job);
+		}
+	}
+
+	for(int j = 0; j < juncs.size(); ++j)
+	{
+		int score = scores[j];
+
+		#if OPENGL_MAP && DEV
+		if(score >= E_RAMP)
+			debug_mesh_point(cgal2ben(juncs[j]->point()),1,0,0);
+		#endif
+
+		if(score >= E_CRSH && score < E_RAMP)
+		{
+			out_crsh_starts.push_back(juncs[j]);
+		}
+	}
+}
+
 void repair_network(Pmwx& io_map)
 {
 	// First: we get little bits of goo laying around.  We're going to strip out any tiny antenna sticking
@@ -1029,32 +1134,17 @@ void repair_network(Pmwx& io_map)
 	// contiguous on ramp.
 	list<Pmwx::Vertex_handle> crsh_starts;
 
-	for(Pmwx::Vertex_iterator v = io_map.vertices_begin(); v != io_map.vertices_end(); ++v)
-	#if OPENGL_MAP && DEV
-	if(gVertexSelection.empty() || gVertexSelection.count(v))
-	#endif
-	{
-		int score = optimize_one_junction(v);
-
-		#if OPENGL_MAP && DEV
-		if(score >= E_RAMP)
-			debug_mesh_point(cgal2ben(v->point()),1,0,0);
-		#endif
-
-		if(score >= E_CRSH && score < E_RAMP)
-		{
-			crsh_starts.push_back(v);
-		}
-	}
+	optimize_junctions(io_map, crsh_starts);
 
 	multimap<double, list<Pmwx::Halfedge_handle> >	crshs;
 
 	// Now: crash collection: run along each 'crash' vertex and collect the entire contiguous road
 	// in both directions and stash it by length.
 
+	set<Pmwx::Halfedge_handle>	processed;
 	for(list<Pmwx::Vertex_handle>::iterator v = crsh_starts.begin(); v != crsh_starts.end(); ++v)
 	{
-		set<Pmwx::Halfedge_handle>	processed;
+		processed.clear();
 
 		Pmwx::Halfedge_handle opp;
 		Pmwx::Halfedge_around_vertex_circulator circ,stop;
@@ -41,7 +41,15 @@ void	debug_network(Pmwx& io_map);
 void	repair_network(Pmwx& io_map);
 
 int score_for_junction(Pmwx::Vertex_handle v);
-int optimize_one_junction(Pmwx::Vertex_handle v);
+
+// Tries every level combination at one junction and keeps the best.  skip_repeats passes over the combinations a
+// smaller level count already scored - the result is the same, with fewer scorings.
+int optimize_one_junction(Pmwx::Vertex_handle v, bool skip_repeats = true);
+
+// Optimizes every junction in vertex order and appends the ones left with a crash to out_crsh_starts, also in
+// vertex order.  Junctions that share no road run concurrently in waves; in_serial runs them one at a time.
+// Either way the road levels come out the same.
+void optimize_junctions(Pmwx& io_map, list<Pmwx::Vertex_handle>& out_crsh_starts, bool in_serial = false, bool skip_repeats = true);
 
 void MarkFunkyRoadIssues(Pmwx& ioMap);
 
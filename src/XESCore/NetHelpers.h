@@ -248,9 +248,11 @@ inline void swap_he_road_dir(Pmwx::Halfedge_handle he)
 
 inline int get_he_road_use(Pmwx::Halfedge_handle he)
 {
+	// Lookup only - operator[] may rehash, and junctions are scored from several threads at once.
 	int rep = get_he_rep_type(he);
-	if (gNetReps.count(rep) == 0) return use_None;
-	return gNetReps[rep].use_mode;
+	NetRepInfoTable::const_iterator i = gNetReps.find(rep);
+	if (i == gNetReps.end()) return use_None;
+	return i->second.use_mode;
 }
 
 inline int get_he_limited_access(Pmwx::Halfedge_handle he)
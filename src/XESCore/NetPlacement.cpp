@@ -32,6 +32,7 @@
 #include "STLUtils.h"
 #include "MathUtils.h"
 #include "GISTool_Globals.h"
+#include <queue>
 #if OPENGL_MAP
 #include "RF_Selection.h"
 #endif
@@ -335,183 +336,234 @@ void	OptimizeNetwork(Net_JunctionInfoSet& ioJunctions, Net_ChainInfoSet& outChai
 		}
 	}
 
-	// Now go through and take out the trash...schedule for deletion every 0-valence
-	// junction.
-	Net_JunctionInfoSet	deadJuncs;
-	for (Net_JunctionInfoSet::iterator junc = ioJunctions.begin(); junc != ioJunctions.end(); ++junc)
+	// Now go through and take out the trash - every 0-valence junction goes.  Erasing a set node
+	// doesn't invalidate the others, so we can do this in one walk.
+	for (Net_JunctionInfoSet::iterator junc = ioJunctions.begin(); junc != ioJunctions.end(); )
 	{
 		if ((*junc)->chains.empty())
 		{
-			deadJuncs.insert(*junc);
+			delete (*junc);
+			ioJunctions.erase(junc++);
 			++total_removed;
 		}
-	}
-
-	// Finally do the actual deletion.
-	for (Net_JunctionInfoSet::iterator junc = deadJuncs.begin(); junc != deadJuncs.end(); ++junc)
-	{
-		ioJunctions.erase(*junc);
-		delete (*junc);
+		else
+			++junc;
 	}
 	int s = 0;//NukeStraightShapePoints(outChains);
 	printf("Optimize: %d merged, %d removed, %d straight.\n", total_merged, total_removed, s);
 
 }
 
-typedef pair<Net_JunctionInfo_t *,Net_JunctionInfo_t *>	JuncPair;
+inline bool within_box(const Point2& p1, const Point2& p2, double d)
+{
+	if(fabs(p1.x() - p2.x()) <= d)
+	if(fabs(p1.y() - p2.y()) <= d)
+		return true;
+	return false;
+}
+
+// A spatial hash over junction locations.  Cells are at least as big as the merge distance, so any junction
+// within the merge box of a point lives in one of the 3x3 cells around it.  Cells are hashed into buckets;
+// two cells sharing a bucket just means a few extra candidates that the distance check throws out.
+class	Net_JunctionGrid {
+public:
+	Net_JunctionGrid(double cell_size) : mCell(max(cell_size, 1.0e-7)) { }
 
-struct sort_by_sqr_dist {
-	bool operator()(const JuncPair& lhs, const JuncPair& rhs) const
+	void	insert(Net_JunctionInfo_t * j)
 	{
-		double d1 = lhs.first->location.squared_distance(lhs.second->location);
-		double d2 = rhs.first->location.squared_distance(rhs.second->location);
-		return d1 < d2;
+		mBuckets[key_for(cell_x(j->location.x()), cell_y(j->location.y()))].push_back(j);
+	}
+
+	void	remove(Net_JunctionInfo_t * j)
+	{
+		BucketMap::iterator b = mBuckets.find(key_for(cell_x(j->location.x()), cell_y(j->location.y())));
+		DebugAssert(b != mBuckets.end());
+		vector<Net_JunctionInfo_t *>::iterator i = find(b->second.begin(), b->second.end(), j);
+		DebugAssert(i != b->second.end());
+		*i = b->second.back();
+		b->second.pop_back();
+		if(b->second.empty())
+			mBuckets.erase(b);
 	}
-};
 
-struct sort_by_y {
-	bool operator()(Net_JunctionInfo_t * const & p1, Net_JunctionInfo_t * const & p2) const 
+	// Appends every junction other than j within the merge box of j.
+	void	gather_near(Net_JunctionInfo_t * j, double dist, vector<Net_JunctionInfo_t *>& out_near) const
 	{
-		return p1->location.y() < p2->location.y(); 
+		int cx = cell_x(j->location.x());
+		int cy = cell_y(j->location.y());
+		unsigned int	seen[9];
+		int	nseen = 0;
+		for(int dy = -1; dy <= 1; ++dy)
+		for(int dx = -1; dx <= 1; ++dx)
+		{
+			unsigned int k = key_for(cx + dx, cy + dy);
+			if(find(seen, seen + nseen, k) != seen + nseen)
+				continue;
+			seen[nseen++] = k;
+			BucketMap::const_iterator b = mBuckets.find(k);
+			if(b == mBuckets.end())
+				continue;
+			for(vector<Net_JunctionInfo_t *>::const_iterator i = b->second.begin(); i != b->second.end(); ++i)
+			if(*i != j && within_box(j->location, (*i)->location, dist))
+				out_near.push_back(*i);
+		}
 	}
+
+	int		bucket_count(void) const { return mBuckets.size(); }
+
+private:
+
+	typedef hash_map<unsigned int, vector<Net_JunctionInfo_t *> >	BucketMap;
+
+	int		cell_x(double x) const { return (int) floor(x / mCell); }
+	int		cell_y(double y) const { return (int) floor(y / mCell); }
+	// Unsigned so the multiplies wrap rather than overflow.  Cells that collide share a bucket, which is harmless.
+	static unsigned int	key_for(int cx, int cy) { return ((unsigned int) cx * 73856093u) ^ ((unsigned int) cy * 19349663u); }
+
+	double		mCell;
+	BucketMap	mBuckets;
 };
 
-inline bool within_box(const Point2& p1, const Point2& p2, double d)
+// A candidate merge, ordered so that a priority queue hands back the closest pair first.  Ties go by
+// location so the merge order does not depend on where the allocator put the junctions.
+inline bool lesser_y_then_x(const Point2& a, const Point2& b)
 {
-	if(fabs(p1.x() - p2.x()) <= d)
-	if(fabs(p1.y() - p2.y()) <= d)
-		return true;
-	return false;
+	return a.y() < b.y() || (a.y() == b.y() && a.x() < b.x());
 }
 
-typedef multiset<Net_JunctionInfo_t *, sort_by_y>	y_sorted_set;
+struct	NearJuncPair_t {
+	double					dist_sqr;
+	Net_JunctionInfo_t *	first;		// The survivor - the lower (by y then x) of the two when the pair was found.
+	Net_JunctionInfo_t *	second;
+
+	NearJuncPair_t(Net_JunctionInfo_t * a, Net_JunctionInfo_t * b)
+	{
+		if(lesser_y_then_x(b->location, a->location))
+			swap(a,b);
+		first = a;
+		second = b;
+		dist_sqr = a->location.squared_distance(b->location);
+	}
+
+	bool operator<(const NearJuncPair_t& rhs) const
+	{
+		if(dist_sqr != rhs.dist_sqr)	return dist_sqr > rhs.dist_sqr;
+		if(first->location != rhs.first->location)	return lesser_y_then_x(rhs.first->location, first->location);
+		return lesser_y_then_x(rhs.second->location, second->location);
+	}
+};
 
+// Merge every pair of junctions within dist (in both x and y) of each other, closest pairs first.  The survivor
+// moves to the midpoint, which can bring it into range of new neighbors; we find those from the grid right away,
+// so one pass over the candidate queue finishes the job.
 void	MergeNearJunctions(Net_JunctionInfoSet& juncs, Net_ChainInfoSet& chains, double dist)
 {
 //		ValidateNetworkTopology(juncs,chains);
 
 	printf("Before merge: %zd juncs, %zd chains.\n", juncs.size(), chains.size());
 
-	while(1)
+	Net_JunctionGrid					grid(dist);
+	priority_queue<NearJuncPair_t>		candidates;
+	vector<Net_JunctionInfo_t *>		near;
+	int									total_candidates = 0, stale = 0, merged = 0, dead_chains = 0;
+
+	for(Net_JunctionInfoSet::iterator j = juncs.begin(); j != juncs.end(); ++j)
+		grid.insert(*j);
+
+	for(Net_JunctionInfoSet::iterator j = juncs.begin(); j != juncs.end(); ++j)
 	{
+		near.clear();
+		grid.gather_near(*j, dist, near);
+		for(vector<Net_JunctionInfo_t *>::iterator n = near.begin(); n != near.end(); ++n)
+		if(*j < *n)											// Each pair once.
+			candidates.push(NearJuncPair_t(*j, *n));
+	}
+	total_candidates = candidates.size();
+	int grid_buckets = grid.bucket_count();
 
-		bool did_work = false;
-		y_sorted_set	sorted_juncs;
-		
-		copy(juncs.begin(),juncs.end(),set_inserter(sorted_juncs));
+	while(!candidates.empty())
+	{
+		NearJuncPair_t jp(candidates.top());
+		candidates.pop();
 
-		vector<JuncPair> kill;
-		for(y_sorted_set::iterator i = sorted_juncs.begin(); i != sorted_juncs.end(); ++i)
+		// A pair goes stale when either end was merged away, or when the survivor of some earlier merge moved -
+		// in which case we already queued its new neighbors at their new distances.
+		if(!juncs.count(jp.first) || !juncs.count(jp.second) ||
+			jp.first->location.squared_distance(jp.second->location) != jp.dist_sqr)
 		{
-			y_sorted_set::iterator j(i);
-			++j;
-			while(j != sorted_juncs.end() && (((*j)->location.y() - (*i)->location.y()) < (2.0*dist)))
-			{
-//				printf("Measuring: 0x%08x, 0x%08x\n", (*i), (*j));
-			
-				if(within_box((*i)->location,(*j)->location,dist))
-				{
-					kill.push_back(JuncPair(*i,*j));
-				}
-				++j;
-			}
+			++stale;
+			continue;
 		}
-		sort(kill.begin(),kill.end(), sort_by_sqr_dist());
+		DebugAssert(within_box(jp.first->location,jp.second->location,dist));
+
+		list<Net_ChainInfo_t *>	dead;
+		for(Net_ChainInfoSet::iterator c = jp.first->chains.begin(); c != jp.first->chains.end(); ++c)
+		if((*c)->other_junc(jp.first) == jp.second)
+			dead.push_back(*c);
+
+		// The chains between the two junctions collapse to nothing - they come out of both junctions before
+		// the second junction's chains move over, or they'd come back as zero-length loops.
+		copy(dead.begin(),dead.end(),set_eraser(chains));
+		copy(dead.begin(),dead.end(),set_eraser(jp.first->chains));
+		copy(dead.begin(),dead.end(),set_eraser(jp.second->chains));
+		for(list<Net_ChainInfo_t *>::iterator d = dead.begin(); d != dead.end(); ++d)
+			delete *d;
+		dead_chains += dead.size();
+
+		grid.remove(jp.first);
+		grid.remove(jp.second);
+
+		jp.first->location = Point2(
+						(jp.first->location.x() + jp.second->location.x()) * 0.5,
+						(jp.first->location.y() + jp.second->location.y()) * 0.5);
+		copy(jp.second->chains.begin(),jp.second->chains.end(), set_inserter(jp.first->chains));
+
+		for(Net_ChainInfoSet::iterator c = jp.second->chains.begin(); c != jp.second->chains.end(); ++c)
+		{
+			if((*c)->start_junction == jp.second) (*c)->start_junction = jp.first;
+			if((*c)->end_junction == jp.second) (*c)->end_junction = jp.first;
+		}
+
+		DebugAssert(juncs.count(jp.second));
+		juncs.erase(jp.second);
+		delete jp.second;
+		++merged;
 
-		for(vector<JuncPair>::iterator jp = kill.begin(); jp != kill.end(); ++jp)
+		grid.insert(jp.first);
+		near.clear();
+		grid.gather_near(jp.first, dist, near);
+		for(vector<Net_JunctionInfo_t *>::iterator n = near.begin(); n != near.end(); ++n)
 		{
-//			printf("Considering: 0x%08x, 0x%08x\n", jp->first, jp->second);			
-			if(juncs.count(jp->first) && juncs.count(jp->second))
-			if(within_box(jp->first->location,jp->second->location,dist))
-			{
-//				printf("Killing: 0x%08x, 0x%08x\n", jp->first, jp->second);			
-				list<Net_ChainInfo_t *>	dead;
-				for(Net_ChainInfoSet::iterator c = jp->first->chains.begin(); c != jp->first->chains.end(); ++c)
-				if((*c)->other_junc(jp->first) == jp->second)
-					dead.push_back(*c);
-
-				copy(dead.begin(),dead.end(),set_eraser(chains));
-				copy(dead.begin(),dead.end(),set_eraser(jp->first->chains));
-				
-				jp->first->location = Point2(
-								(jp->first->location.x() + jp->second->location.x()) * 0.5,
-								(jp->first->location.y() + jp->second->location.y()) * 0.5);
-				copy(jp->second->chains.begin(),jp->second->chains.end(), set_inserter(jp->first->chains));
-				
-				for(Net_ChainInfoSet::iterator c = jp->second->chains.begin(); c != jp->second->chains.end(); ++c)
-				{
-					if((*c)->start_junction == jp->second) (*c)->start_junction = jp->first;
-					if((*c)->end_junction == jp->second) (*c)->end_junction = jp->first;
-				}
-				
-				DebugAssert(juncs.count(jp->second));
-				juncs.erase(jp->second);
-				delete jp->second;
-				did_work = true;
-				// This was serious paranoia in inital implementation, but don't even have in dev, makes alg very slow.
-		//		ValidateNetworkTopology(juncs,chains);		
-			}
-		}	
+			candidates.push(NearJuncPair_t(jp.first, *n));
+			++total_candidates;
+		}
+	}
+
 	#if DEV
 		ValidateNetworkTopology(juncs,chains);
 	#endif
-		if(!did_work)	
-			break;
-		else
-			printf("After merge: %zd juncs, %zd chains.\n", juncs.size(), chains.size());
-	}
-	
-	Net_JunctionInfo_t * bad_a = NULL, * bad_b = NULL;
 
-#if DEV	
+	printf("After merge: %zd juncs, %zd chains.\n", juncs.size(), chains.size());
+	if(gTiming)
+		printf("Merge stats: %d buckets, %d candidate pairs, %d stale, %d merges, %d collapsed chains.\n",
+			grid_buckets, total_candidates, stale, merged, dead_chains);
+
+#if DEV
 	for(Net_ChainInfoSet::iterator c = chains.begin(); c != chains.end(); ++c)
 	{
+		if((*c)->start_junction != (*c)->end_junction)
 		if(within_box((*c)->start_junction->location, (*c)->end_junction->location, dist))
 		{
-			bad_a = (*c)->start_junction; bad_b = (*c)->end_junction;
-			printf("%p: %f,%f to %f, %f\n", (*c), 
+			printf("%p: %f,%f to %f, %f\n", (*c),
 						(*c)->start_junction->location.x(),
 						(*c)->start_junction->location.y(),
 						(*c)->end_junction->location.x(),
 						(*c)->end_junction->location.y());
-			printf("ERROR: junctions too close together (%p, %p).\n", 
+			printf("ERROR: junctions too close together (%p, %p).\n",
 						(*c)->start_junction,(*c)->end_junction);
 		}
 	}
 #endif
-
-/*	
-	{
-		y_sorted_set	sorted_juncs;
-		
-		copy(juncs.begin(),juncs.end(),set_inserter(sorted_juncs));
-
-		printf("Bad a: %d\n", sorted_juncs.count(bad_a));
-		printf("Bad a: %d\n", sorted_juncs.count(bad_b));
-
-		vector<JuncPair> kill;
-		for(y_sorted_set::iterator i = sorted_juncs.begin(); i != sorted_juncs.end(); ++i)
-		{
-			y_sorted_set::iterator j(i);
-			++j;
-			while(j != sorted_juncs.end() && (((*j)->location.y() - (*i)->location.y()) < (2.0*dist)))
-			{
-				if(*i == bad_a || *j == bad_a ||
-				   *i == bad_b || *j == bad_b)
-				printf("Measuring: 0x%08x, 0x%08x\n", (*i), (*j));
-			
-				if(within_box((*i)->location,(*j)->location,dist))
-				{
-					if(*i == bad_a || *j == bad_a ||
-					   *i == bad_b || *j == bad_b)
-						printf("Killing: 0x%08x, 0x%08x\n", (*i), (*j));
-					kill.push_back(JuncPair(*i,*j));
-				}
-				++j;
-			}
-		}
-	}
-*/	
 }
 
 
@@ -608,6 +660,9 @@ void	CleanupNetworkTopology(Net_JunctionInfoSet& outJunctions, Net_ChainInfoSet&
 
 	for (Net_ChainInfoSet::iterator j = outChains.begin(); j != outChains.end(); ++j)
 		delete (*j);
+
+	outJunctions.clear();
+	outChains.clear();
 }
 
 // This routine checks the connectivity of the network for linkage and ptr errors.
@@ -44,6 +44,29 @@ RepTableTerrainIndex			gRepTableTerrainIndex;
 string							gObjPlacementFile;
 string							gObjLibPrefix;
 
+// Size index: for each terrain and feature, the facade and object rows that could ever be returned,
+// in table (priority) order, with their size envelopes packed together.  lo[i] and hi[i] are the
+// smallest and largest value of each field over rows i...end, so a query can stop as soon as its
+// size falls outside what any remaining row could accept.
+struct	RepSizeRow_t {
+	int		row;
+	float	width_min, width_max;
+	float	depth_min, depth_max;
+	float	height_min, height_max;
+	int		road, fill;
+};
+
+struct	RepSizeBucket_t {
+	vector<RepSizeRow_t>	rows;
+	vector<RepSizeRow_t>	lo;
+	vector<RepSizeRow_t>	hi;
+};
+
+typedef hash_map<int, hash_map<int, RepSizeBucket_t> >	RepSizeIndex;		// terrain -> feature -> bucket
+
+static RepSizeIndex				sFacSizeIndex;
+static RepSizeIndex				sObjSizeIndex;
+
 static int ObjScheduleJump(int height)
 {
 	// This is the "Obj Jump schedule" - it indicates the increments between successive objects.
@@ -276,6 +299,15 @@ void	LoadObjTables(void)
 //			gFeatureAsFacade.insert(i->first);
 //	}
 
+	IndexObjTables();
+}
+
+void	IndexObjTables(void)
+{
+	gRepTableTerrainIndex.clear();
+	sFacSizeIndex.clear();
+	sObjSizeIndex.clear();
+
 	hash_map<int, int>	mins, maxs;
 	for (int n = 0; n < gRepTable.size(); ++n)
 	{
@@ -293,6 +325,61 @@ void	LoadObjTables(void)
 		int ihi = maxs[terrain];
 		gRepTableTerrainIndex[terrain] = pair<int,int>(ilow, ihi);
 	}
+
+	// Build the size index.  A terrain's rows are the ones in its table range that pass the terrain rule;
+	// the enum rules (type, feature, terrain) don't depend on the query size so we apply them once here.
+	for (RepTableTerrainIndex::iterator range = gRepTableTerrainIndex.begin(); range != gRepTableTerrainIndex.end(); ++range)
+	for (int n = range->second.first; n < range->second.second; ++n)
+	{
+		RepInfo_t& rec = gRepTable[n];
+		if (rec.terrain != NO_VALUE && rec.terrain != range->first)
+			continue;
+		RepSizeIndex * idx = NULL;
+		if (rec.obj_type == rep_Fac)	idx = &sFacSizeIndex;
+		if (rec.obj_type == rep_Obj)	idx = &sObjSizeIndex;
+		if (idx == NULL)
+			continue;
+		RepSizeRow_t r;
+		r.row = n;
+		r.width_min = rec.width_min;		r.width_max = rec.width_max;
+		r.depth_min = rec.depth_min;		r.depth_max = rec.depth_max;
+		r.height_min = rec.height_min;		r.height_max = rec.height_max;
+		r.road = rec.road != 0;
+		r.fill = rec.fill != 0;
+		(*idx)[range->first][rec.feature].rows.push_back(r);
+	}
+
+	RepSizeIndex * indices[2] = { &sFacSizeIndex, &sObjSizeIndex };
+	for (int i = 0; i < 2; ++i)
+	for (RepSizeIndex::iterator t = indices[i]->begin(); t != indices[i]->end(); ++t)
+	for (hash_map<int, RepSizeBucket_t>::iterator f = t->second.begin(); f != t->second.end(); ++f)
+	{
+		RepSizeBucket_t& b(f->second);
+		b.lo = b.rows;
+		b.hi = b.rows;
+		for (int n = (int) b.rows.size() - 2; n >= 0; --n)
+		{
+			RepSizeRow_t& l(b.lo[n]), &ln(b.lo[n+1]);
+			RepSizeRow_t& h(b.hi[n]), &hn(b.hi[n+1]);
+			l.width_min = min(l.width_min, ln.width_min);		h.width_min = max(h.width_min, hn.width_min);
+			l.width_max = min(l.width_max, ln.width_max);		h.width_max = max(h.width_max, hn.width_max);
+			l.depth_min = min(l.depth_min, ln.depth_min);		h.depth_min = max(h.depth_min, hn.depth_min);
+			l.depth_max = min(l.depth_max, ln.depth_max);		h.depth_max = max(h.depth_max, hn.depth_max);
+			l.height_min = min(l.height_min, ln.height_min);	h.height_min = max(h.height_min, hn.height_min);
+			l.height_max = min(l.height_max, ln.height_max);	h.height_max = max(h.height_max, hn.height_max);
+			l.road = min(l.road, ln.road);						h.road = max(h.road, hn.road);
+			l.fill = min(l.fill, ln.fill);						h.fill = max(h.fill, hn.fill);
+		}
+	}
+}
+
+static const RepSizeBucket_t * FindSizeBucket(const RepSizeIndex& idx, int terrain, int feature)
+{
+	RepSizeIndex::const_iterator t = idx.find(terrain);
+	if (t == idx.end()) return NULL;
+	hash_map<int, RepSizeBucket_t>::const_iterator f = t->second.find(feature);
+	if (f == t->second.end()) return NULL;
+	return &f->second;
 }
 
 /************************************************************************************************
@@ -322,33 +409,33 @@ int	QueryUsableFacsBySize(
 					int				inMaxResults)
 {
 	int 						ret = 0;
-	pair<int,int>				range = gRepTableTerrainIndex[terrain];
-	for (int row = range.first; row < range.second; ++row)
+	const RepSizeBucket_t *		b = FindSizeBucket(sFacSizeIndex, terrain, feature);
+	if (b == NULL)
+		return 0;
+	for (int n = 0; n < b->rows.size(); ++n)
 	{
-		RepInfo_t& rec = gRepTable[row];
-
-		// Evaluate this choice
-		if (rec.obj_type == rep_Fac)
-//		if ((rec.max_num == 0 || rec.max_num > gRepUsage[rec.obj_name]) &&
-//			(rec.freq == 0.0 || (rec.freq * (float) gRepUsageTotal >= gRepUsage[rec.obj_name])) &&
-
-			// Enum rules
-		if ((rec.feature == feature) &&
-			(rec.terrain == NO_VALUE || rec.terrain == terrain) &&
-			// Range Rules
-//			RANGE_RULE(temp) &&
-//			RANGE_RULE(slope) &&
-//			RANGE_RULE(rain) &&
-//			RANGE_RULE(urban_dense) &&
-//			RANGE_RULE(urban_radial) &&
-//			RANGE_RULE(urban_trans) &&
-
-			(inLongSide >= rec.width_min && inLongSide <= rec.width_max) &&			// FACADES: the width range limits the 'big' side, the
+		// Nothing from here on can take a block this size - stop.
+		if (inLongSide < b->lo[n].width_min || inLongSide > b->hi[n].width_max ||
+			inShortSide < b->lo[n].depth_min || inShortSide > b->hi[n].depth_max ||
+			inTargetHeight < b->lo[n].height_min || inTargetHeight > b->hi[n].height_max)
+			break;
+
+		const RepSizeRow_t& rec(b->rows[n]);
+
+		// Range Rules
+//		RANGE_RULE(temp) &&
+//		RANGE_RULE(slope) &&
+//		RANGE_RULE(rain) &&
+//		RANGE_RULE(urban_dense) &&
+//		RANGE_RULE(urban_radial) &&
+//		RANGE_RULE(urban_trans) &&
+
+		if ((inLongSide >= rec.width_min && inLongSide <= rec.width_max) &&			// FACADES: the width range limits the 'big' side, the
 			(inShortSide >= rec.depth_min && inShortSide <= rec.depth_max) &&		// depth range limits the 'small' side.  We must know this - we are making a facade.
 
 			(inTargetHeight >= rec.height_min && inTargetHeight <= rec.height_max))
 		{
-			outResults[ret] = row;
+			outResults[ret] = rec.row;
 			++ret;
 			if (ret >= inMaxResults)
 				return ret;
@@ -395,28 +482,32 @@ int QueryUsableObjsBySize(
 	// since the antenna is in the smack middle of the facade, it
 	// is conceivable that a huge object could fit there.
 
-	pair<int,int>				range = gRepTableTerrainIndex[terrain];
-	for (int row = range.first; row < range.second; ++row)
+	// The size index has already dropped the rows of other types, features and terrains.
+
+	const RepSizeBucket_t *		b = FindSizeBucket(sObjSizeIndex, terrain, feature);
+	if (b == NULL)
+		return 0;
+	for (int n = 0; n < b->rows.size(); ++n)
 	{
-		RepInfo_t& rec = gRepTable[row];
-
-		// Evaluate this choice
-		if (rec.obj_type == rep_Obj)
-//		if ((rec.max_num == 0 || rec.max_num > gRepUsage[rec.obj_name]) &&
-//			(rec.freq == 0.0 || (rec.freq * (float) gRepUsageTotal >= gRepUsage[rec.obj_name])) &&
-
-			// Enum rules
-		if ((rec.feature == feature) &&
-			(rec.terrain == NO_VALUE || rec.terrain == terrain) &&
-			// Range Rules
-//			RANGE_RULE(slope) &&
-//			RANGE_RULE(temp) &&
-//			RANGE_RULE(rain) &&
-//			RANGE_RULE(urban_dense) &&
-//			RANGE_RULE(urban_radial) &&
-//			RANGE_RULE(urban_trans) &&
-			// Obj Rules
-			(inWidth == -1 || (inWidth >= rec.width_max)) &&					// FOR OBJECTS: give an object if (1) we have NO idea how big this slot is (try 'em all)
+		// Every object from here on is too big or lacks the road/fill flag we need - stop.
+		if ((inWidth != -1 && inWidth < b->lo[n].width_max) ||
+			(inDepth != -1 && inDepth < b->lo[n].depth_max) ||
+			inHeightMax < b->lo[n].height_max ||
+			(fill && !b->hi[n].fill) ||
+			(road && !b->hi[n].road))
+			break;
+
+		const RepSizeRow_t& rec(b->rows[n]);
+
+		// Range Rules
+//		RANGE_RULE(slope) &&
+//		RANGE_RULE(temp) &&
+//		RANGE_RULE(rain) &&
+//		RANGE_RULE(urban_dense) &&
+//		RANGE_RULE(urban_radial) &&
+//		RANGE_RULE(urban_trans) &&
+		// Obj Rules
+		if ((inWidth == -1 || (inWidth >= rec.width_max)) &&					// FOR OBJECTS: give an object if (1) we have NO idea how big this slot is (try 'em all)
 			(inDepth == -1 || (inDepth >= rec.depth_max)) &&					// or if the lot is at least as bigger than the obj
 
 			(inHeightMax >= rec.height_max) &&				// For objs - obj height less than max!
@@ -424,7 +515,7 @@ int QueryUsableObjsBySize(
 			(!fill || rec.fill) &&
 			(!road || rec.road))
 		{
-			outResults[ret] = row;
+			outResults[ret] = rec.row;
 			++ret;
 			if (ret >= inMaxResults)
 				return ret;
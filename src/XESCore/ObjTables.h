@@ -96,6 +96,9 @@ typedef hash_map<int, FeatureInfo>		FeatureInfoTable;
 extern	FeatureInfoTable				gFeatures;
 
 void	LoadObjTables(void);
+// Rebuilds the per-terrain row ranges and the size index from gRepTable.  LoadObjTables does this;
+// call it yourself only if you fill in gRepTable by hand.
+void	IndexObjTables(void);
 
 // This routines returns facades that fit this profile sorted from biggest
 // to smallest.  Note that they give you table indices, not feature types!
@@ -35,6 +35,49 @@ const	int	kTokensID = 'TOKN';
 
 const	int	kAptID = 'aptD';
 
+const	int	kTOCID = 'XTOC';
+const	int	kPadID = 'PAD ';
+
+// TOC layout: int version, int count, then for each atom: int kind, int id, int offset, int length.
+// Offsets are from the start of the file and lengths include the atom header.
+const	int	kTOCVersion = 1;
+const	int	kTOCEntrySize = 4 * sizeof(int);
+
+enum {
+	toc_Tokens = 0,
+	toc_Map = 1,
+	toc_Mesh = 2,
+	toc_DEMDir = 3,
+	toc_Apts = 4,
+	toc_DEM = 5
+};
+
+// Header of a DEM atom's contents: width, height, then four doubles of bounds.
+const	int	kDEMHeaderSize = 2 * sizeof(int) + 4 * sizeof(double);
+const	int	kDEMAlign = 16;
+
+struct	XESTOCEntry {
+	int	kind;
+	int	id;
+	int	offset;
+	int	length;
+};
+
+// Pad the file with a filler atom so that the samples of the DEM atom that follows
+// start on an aligned boundary.  A filler atom cannot be shorter than its header.
+static void	AlignForDEM(FILE * fi)
+{
+	int pos = ftell(fi);
+	int sample_start = pos + sizeof(XAtomHeader_t) + kDEMHeaderSize;
+	int pad = (kDEMAlign - (sample_start % kDEMAlign)) % kDEMAlign;
+	if (pad == 0) return;
+	if (pad < (int) sizeof(XAtomHeader_t))
+		pad += kDEMAlign;
+	StAtomWriter	padAtom(fi, kPadID, true);
+	for (int n = (int) sizeof(XAtomHeader_t); n < pad; ++n)
+		fputc(0, fi);
+}
+
 void	WriteXESFile(
 				const char *	inFileName,
 				const Pmwx&		inMap,
@@ -46,10 +89,36 @@ void	WriteXESFile(
 	FILE * fi = fopen(inFileName, "wb");
 	if (!fi) return;
 
+	vector<XESTOCEntry>	toc;
+	XESTOCEntry			e;
+
+	// Reserve the table of contents up front - we know how many atoms we will write, but
+	// not where they will land, so it is filled in when we are done.
+	int toc_count = 4 + inDEM.size() + (inApts.empty() ? 0 : 1);
+	int toc_start = ftell(fi);
+	{
+		StAtomWriter	tocAtom(fi, kTOCID);
+		FileWriter		writer(fi);
+		writer.WriteInt(kTOCVersion);
+		writer.WriteInt(toc_count);
+		for (int n = 0; n < toc_count * 4; ++n)
+			writer.WriteInt(0);
+	}
+
+	#define	TOC_BEGIN(k,i)	e.kind = (k); e.id = (i); e.offset = ftell(fi);
+	#define TOC_END			e.length = ftell(fi) - e.offset; toc.push_back(e);
+
+	TOC_BEGIN(toc_Tokens, kTokensID)
 	WriteEnumsAtomToFile(fi, gTokens, kTokensID);
+	TOC_END
+	TOC_BEGIN(toc_Map, kMapID)
 	WriteMap(fi, inMap, inFunc, kMapID);
+	TOC_END
+	TOC_BEGIN(toc_Mesh, kMeshID)
 	WriteMesh(fi, inMesh, kMeshID, inFunc);
+	TOC_END
 
+	TOC_BEGIN(toc_DEMDir, kDemDirID)
 	{
 		StAtomWriter	demDir(fi, kDemDirID);
 		FileWriter		writer(fi);
@@ -57,19 +126,47 @@ void	WriteXESFile(
 		for (DEMGeoMap::iterator dem = inDEM.begin(); dem != inDEM.end(); ++dem)
 			writer.WriteInt(dem->first);
 	}
+	TOC_END
 
 	if (!inApts.empty())
 	{
-		StAtomWriter	aptDir(fi, kAptID);
-		WriteAptFileOpen(fi, inApts, LATEST_APT_VERSION);
+		TOC_BEGIN(toc_Apts, kAptID)
+		{
+			StAtomWriter	aptDir(fi, kAptID);
+			WriteAptFileOpen(fi, inApts, LATEST_APT_VERSION);
+		}
+		TOC_END
 	}
 
 	for (DEMGeoMap::iterator dem = inDEM.begin(); dem != inDEM.end(); ++dem)
 	{
-		StAtomWriter	demAtom(fi, dem->first);
+		AlignForDEM(fi);
+		TOC_BEGIN(toc_DEM, dem->first)
+		{
+			StAtomWriter	demAtom(fi, dem->first);
+			FileWriter		writer(fi);
+			WriteDEM(dem->second, &writer);
+		}
+		TOC_END
+	}
+
+	#undef TOC_BEGIN
+	#undef TOC_END
+
+	DebugAssert(toc.size() == toc_count);
+	int end_of_file = ftell(fi);
+	fseek(fi, toc_start + sizeof(XAtomHeader_t) + 2 * sizeof(int), SEEK_SET);
+	{
 		FileWriter		writer(fi);
-		WriteDEM(dem->second, &writer);
+		for (vector<XESTOCEntry>::iterator t = toc.begin(); t != toc.end(); ++t)
+		{
+			writer.WriteInt(t->kind);
+			writer.WriteInt(t->id);
+			writer.WriteInt(t->offset);
+			writer.WriteInt(t->length);
+		}
 	}
+	fseek(fi, end_of_file, SEEK_SET);
 
 	fclose(fi);
 }
@@ -84,61 +181,246 @@ void	ReadXESFile(
 {
 	if (inApts) inApts->clear();
 
-	XAtomContainer	container;
-	container.begin = (char *) MemFile_GetBegin(inFile);
-	container.end = (char *) MemFile_GetEnd(inFile);
+	XESContainer	container(inFile);
 
-	TokenMap			fileTokens;
-	TokenConversionMap 	conversionMap;
+	if (inMap)
+		container.ReadMap(*inMap, inFunc);
 
-	ReadEnumsAtomFromFile(container, fileTokens, kTokensID);
-	BuildTokenConversionMap(gTokens, fileTokens, conversionMap);
+	if (inMesh)
+		container.ReadMesh(*inMesh, inFunc);
 
-	XAtom	mapAtom, demAtom, demDirAtom, aptAtom;
-	XSpan	mapAtomData, demAtomData, demDirAtomData, aptAtomData;
+	if (inApts)
+		container.ReadApts(*inApts);
 
-	vector<int>	dems;
+	if (inDEM)
+	{
+		vector<int>	dems;
+		container.GetDEMList(dems);
+		for (int i = 0; i < dems.size(); ++i)
+		{
+			DEMGeo	aDem;
+			if (container.ReadDEM(dems[i], aDem))
+				(*inDEM)[dems[i]].swap(aDem);
+		}
+	}
+}
 
-	if (inMap)
-	ReadMap(container, *inMap, inFunc, kMapID, conversionMap);
+/************************************************************************************************
+ * PER-LAYER ACCESS
+ ************************************************************************************************/
 
-	if (inMesh)
-	ReadMesh(container, *inMesh, kMeshID, conversionMap, inFunc);
+XESContainer::XESContainer(MFMemFile * inFile) : mHasTOC(false)
+{
+	mFile.begin = (char *) MemFile_GetBegin(inFile);
+	mFile.end = (char *) MemFile_GetEnd(inFile);
 
-	if (container.GetNthAtomOfID(kDemDirID, 0, demDirAtom))
+	vector<int>	dem_ids;	// File token space
+	XAtom		atom;
+	XSpan		contents;
+
+	if (mFile.GetFirst(atom) && atom.GetID() == kTOCID)
 	{
-		demDirAtom.GetContents(demDirAtomData);
-		MemFileReader	reader(demDirAtomData.begin, demDirAtomData.end);
-		int count, demID;
+		atom.GetContents(contents);
+		MemFileReader	reader(contents.begin, contents.end);
+		int version, count;
+		reader.ReadInt(version);
 		reader.ReadInt(count);
-		while (count--)
+		if (version == kTOCVersion && count >= 0 && count * kTOCEntrySize <= (contents.end - contents.begin) - (int) (2 * sizeof(int)))
 		{
-			reader.ReadInt(demID);
-			dems.push_back(demID);
+			mHasTOC = true;
+			while (count--)
+			{
+				XESTOCEntry	e;
+				reader.ReadInt(e.kind);
+				reader.ReadInt(e.id);
+				reader.ReadInt(e.offset);
+				reader.ReadInt(e.length);
+				if (e.offset < 0 || e.length < (int) sizeof(XAtomHeader_t) || e.offset + e.length > (mFile.end - mFile.begin))
+				{
+					// A damaged TOC - don't trust any of it; we will walk the atoms instead.
+					mHasTOC = false;
+					mAtoms.clear();
+					dem_ids.clear();
+					break;
+				}
+				XSpan	span;
+				span.begin = mFile.begin + e.offset;
+				span.end = span.begin + e.length;
+				mAtoms[e.id] = span;		// DEMs are keyed by file token until remapped below.
+				if (e.kind == toc_DEM)
+					dem_ids.push_back(e.id);
+			}
 		}
 	}
 
-	if (inApts)
-	if (container.GetNthAtomOfID(kAptID, 0, aptAtom))
+	if (!mHasTOC)
 	{
-		aptAtom.GetContents(aptAtomData);
-		ReadAptFileMem(aptAtomData.begin, aptAtomData.end, *inApts);
-	}
+		// Old-style file: find the well-known atoms, then the DEMs listed in the DEM directory.
+		static const int	kKnownAtoms[] = { kTokensID, kMapID, kMeshID, kDemDirID, kAptID };
+		for (int n = 0; n < sizeof(kKnownAtoms) / sizeof(kKnownAtoms[0]); ++n)
+		if (mFile.GetNthAtomOfID(kKnownAtoms[n], 0, atom))
+			mAtoms[kKnownAtoms[n]] = atom;
 
-	if (inDEM)
-	for (int i = 0; i < dems.size(); ++i)
-	{
-		if (container.GetNthAtomOfID(dems[i], 0, demAtom))
+		XAtomContainer	dir;
+		if (FindAtom(kDemDirID, dir))
 		{
-			demAtom.GetContents(demAtomData);
-			MemFileReader	reader(demAtomData.begin, demAtomData.end);
-			DEMGeo	aDem;
-			ReadDEM(aDem, &reader);
-			int demID = conversionMap[dems[i]];
-			if (demID == dem_LandUse || demID == dem_Climate)	// || demID == dem_NudeColor)
-				RemapEnumDEM(aDem, conversionMap);
-			//inDEM->insert(DEMGeoMap::value_type(demID, aDem));
-			(*inDEM)[demID] = aDem;
+			XAtom	dirAtom;
+			dir.GetFirst(dirAtom);
+			dirAtom.GetContents(contents);
+			MemFileReader	reader(contents.begin, contents.end);
+			int count, demID;
+			reader.ReadInt(count);
+			while (count--)
+			{
+				reader.ReadInt(demID);
+				if (mFile.GetNthAtomOfID(demID, 0, atom))
+				{
+					dem_ids.push_back(demID);
+					mAtoms[demID] = atom;
+				}
+			}
 		}
 	}
+
+	TokenMap			fileTokens;
+	XAtomContainer		tokens;
+	if (FindAtom(kTokensID, tokens))
+		ReadEnumsAtomFromFile(tokens, fileTokens, kTokensID);
+	BuildTokenConversionMap(gTokens, fileTokens, mConversion);
+
+	for (int i = 0; i < dem_ids.size(); ++i)
+	{
+		map<int, XSpan>::iterator a = mAtoms.find(dem_ids[i]);
+		if (a == mAtoms.end()) continue;
+		int demID = (dem_ids[i] >= 0 && dem_ids[i] < mConversion.size()) ? mConversion[dem_ids[i]] : dem_ids[i];
+		mDEMs[demID] = a->second;
+		mAtoms.erase(a);
+	}
+}
+
+bool	XESContainer::HasMap(void) const
+{
+	return mAtoms.count(kMapID) > 0;
+}
+
+bool	XESContainer::HasMesh(void) const
+{
+	return mAtoms.count(kMeshID) > 0;
+}
+
+bool	XESContainer::HasApts(void) const
+{
+	return mAtoms.count(kAptID) > 0;
+}
+
+bool	XESContainer::HasDEM(int inDEMID) const
+{
+	return mDEMs.count(inDEMID) > 0;
+}
+
+void	XESContainer::GetDEMList(vector<int>& outDEMs) const
+{
+	outDEMs.clear();
+	for (map<int, XSpan>::const_iterator d = mDEMs.begin(); d != mDEMs.end(); ++d)
+		outDEMs.push_back(d->first);
+}
+
+void	XESContainer::ReadMap(Pmwx& outMap, ProgressFunc inFunc)
+{
+	XAtomContainer	atom;
+	if (FindAtom(kMapID, atom))
+		::ReadMap(atom, outMap, inFunc, kMapID, mConversion);
+}
+
+void	XESContainer::ReadMesh(CDT& outMesh, ProgressFunc inFunc)
+{
+	XAtomContainer	atom;
+	if (FindAtom(kMeshID, atom))
+		::ReadMesh(atom, outMesh, kMeshID, mConversion, inFunc);
+}
+
+void	XESContainer::ReadApts(AptVector& outApts)
+{
+	outApts.clear();
+	XAtomContainer	atom;
+	if (FindAtom(kAptID, atom))
+	{
+		XAtom	aptAtom;
+		XSpan	aptAtomData;
+		atom.GetFirst(aptAtom);
+		aptAtom.GetContents(aptAtomData);
+		ReadAptFileMem(aptAtomData.begin, aptAtomData.end, outApts);
+	}
+}
+
+bool	XESContainer::ReadDEM(int inDEMID, DEMGeo& outDEM)
+{
+	XAtom	demAtom;
+	XSpan	demAtomData;
+	if (!FindDEMAtom(inDEMID, demAtom))
+		return false;
+	demAtom.GetContents(demAtomData);
+	MemFileReader	reader(demAtomData.begin, demAtomData.end);
+	::ReadDEM(outDEM, &reader);
+	if (inDEMID == dem_LandUse || inDEMID == dem_Climate)	// || demID == dem_NudeColor)
+		RemapEnumDEM(outDEM, mConversion);
+	return true;
+}
+
+bool	XESContainer::MapDEM(int inDEMID, XESMappedDEM& outDEM)
+{
+#if BIG
+	return false;
+#else
+	XAtom	demAtom;
+	XSpan	demAtomData;
+	if (!FindDEMAtom(inDEMID, demAtom))
+		return false;
+
+	// Enum layers are stored in the file's token space; if that differs from ours they
+	// must be decoded and remapped.
+	if (inDEMID == dem_LandUse || inDEMID == dem_Climate)
+	for (int n = 0; n < mConversion.size(); ++n)
+	if (mConversion[n] != n)
+		return false;
+
+	demAtom.GetContents(demAtomData);
+	if (demAtomData.end - demAtomData.begin < kDEMHeaderSize)
+		return false;
+	const char * samples = demAtomData.begin + kDEMHeaderSize;
+	if (((uintptr_t) samples) % sizeof(float) != 0)
+		return false;
+
+	MemFileReader	reader(demAtomData.begin, demAtomData.end);
+	reader.ReadInt(outDEM.mWidth);
+	reader.ReadInt(outDEM.mHeight);
+	reader.ReadDouble(outDEM.mWest);
+	reader.ReadDouble(outDEM.mSouth);
+	reader.ReadDouble(outDEM.mEast);
+	reader.ReadDouble(outDEM.mNorth);
+	if ((demAtomData.end - samples) < (ptrdiff_t) outDEM.mWidth * outDEM.mHeight * sizeof(float))
+		return false;
+	outDEM.mData = (const float *) samples;
+	return true;
+#endif
+}
+
+bool	XESContainer::FindAtom(int inID, XAtomContainer& outAtom) const
+{
+	map<int, XSpan>::const_iterator a = mAtoms.find(inID);
+	if (a == mAtoms.end())
+		return false;
+	outAtom.begin = a->second.begin;
+	outAtom.end = a->second.end;
+	return true;
+}
+
+bool	XESContainer::FindDEMAtom(int inDEMID, XAtom& outAtom) const
+{
+	map<int, XSpan>::const_iterator a = mDEMs.find(inDEMID);
+	if (a == mDEMs.end())
+		return false;
+	outAtom.begin = a->second.begin;
+	outAtom.end = a->second.end;
+	return true;
 }
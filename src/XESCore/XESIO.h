@@ -34,12 +34,20 @@
 	- An atom that contains a directory locating the raster planes.
 	- An atom storing the token dictionary for this XES file.
 
+	Newer XES files also start with a table-of-contents atom that records the
+	offset and length of every other atom, so that a reader can go straight to
+	the layers it wants.  DEM atoms are padded so that their float payload sits
+	on a 16-byte boundary within the file; since the file is memory mapped, a
+	DEM can then be used in place without copying it out.  Files without a
+	table of contents are indexed by walking their atoms once.
+
  */
 
 #include "AptDefs.h"
 #include "MapIO.h"
 #include "DEMIO.h"
 #include "MemFileUtils.h"
+#include "XChunkyFileUtils.h"
 
 class CDT;
 
@@ -59,4 +67,60 @@ void	ReadXESFile(
 				AptVector *		inApts,		// Can be NULL
 				ProgressFunc	inFunc);	// Can be NULL
 
+/*
+ * XESContainer - per-layer access to an XES file.  The container only indexes
+ * the atoms when it is built; each layer is decoded when it is asked for.  The
+ * MFMemFile must outlive the container and any mapped DEMs taken from it.
+ *
+ */
+
+// A read-only view of a DEM's samples, sitting directly in the mapped file.
+struct	XESMappedDEM {
+	int				mWidth;
+	int				mHeight;
+	double			mWest;
+	double			mSouth;
+	double			mEast;
+	double			mNorth;
+	const float *	mData;
+
+	float	get(int x, int y) const { return (x < 0 || y < 0 || x >= mWidth || y >= mHeight) ? DEM_NO_DATA : mData[x + y * mWidth]; }
+};
+
+class	XESContainer {
+public:
+
+					XESContainer(MFMemFile * inFile);
+
+	bool			HasTableOfContents(void) const { return mHasTOC; }
+
+	bool			HasMap(void) const;
+	bool			HasMesh(void) const;
+	bool			HasApts(void) const;
+	bool			HasDEM(int inDEMID) const;
+	void			GetDEMList(vector<int>& outDEMs) const;		// Returns DEM enums in the current token space.
+
+	void			ReadMap(Pmwx& outMap, ProgressFunc inFunc);
+	void			ReadMesh(CDT& outMesh, ProgressFunc inFunc);
+	void			ReadApts(AptVector& outApts);
+	bool			ReadDEM(int inDEMID, DEMGeo& outDEM);
+
+	// Returns false if the samples cannot be used in place: the file is an old
+	// unpadded one, the platform is big endian, or the DEM is an enum layer
+	// whose values must be remapped to the current token space.
+	bool			MapDEM(int inDEMID, XESMappedDEM& outDEM);
+
+private:
+
+	bool			FindAtom(int inID, XAtomContainer& outAtom) const;
+	bool			FindDEMAtom(int inDEMID, XAtom& outAtom) const;
+
+	XAtomContainer		mFile;
+	bool				mHasTOC;
+	map<int, XSpan>		mAtoms;			// File atom ID -> atom (with header) for map, mesh, apts, tokens.
+	map<int, XSpan>		mDEMs;			// DEM enum (current token space) -> atom (with header).
+	TokenConversionMap	mConversion;
+
+};
+
 #endif
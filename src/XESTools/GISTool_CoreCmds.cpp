@@ -256,6 +256,60 @@ static int DoLoad(const vector<const char *>& args)
 	return 0;
 }
 
+// Load only some layers of an XES file: "map", "mesh", "apt" or the name of a DEM layer.
+// Layers that are not named are left alone, so this can also be used to pull one DEM into
+// the current state.
+static int DoLoadLayers(const vector<const char *>& args)
+{
+	if (gVerbose) printf("Loading layers of file %s...\n", args[0]);
+	MFMemFile * load = MemFile_Open(args[0]);
+	if (!load)
+	{
+		fprintf(stderr,"Could not load file %s.\n", args[0]);
+		return 1;
+	}
+
+	XESContainer	container(load);
+	int				err = 0;
+	for (int n = 1; n < args.size(); ++n)
+	{
+		if (strcmp(args[n], "map") == 0)
+		{
+			gMap.clear();
+			container.ReadMap(gMap, gProgress);
+		}
+		else if (strcmp(args[n], "mesh") == 0)
+		{
+			gTriangulationHi.clear();
+			container.ReadMesh(gTriangulationHi, gProgress);
+		}
+		else if (strcmp(args[n], "apt") == 0)
+		{
+			container.ReadApts(gApts);
+			IndexAirports(gApts, gAptIndex);
+		}
+		else
+		{
+			int token = LookupToken(args[n]);
+			DEMGeo	dem;
+			if (token == -1 || !container.ReadDEM(token, dem))
+			{
+				fprintf(stderr,"File %s has no layer %s.\n", args[0], args[n]);
+				err = 1;
+				continue;
+			}
+			gDem[token].swap(dem);
+			if (gVerbose) printf("Loaded DEM %s: %d x %d\n", args[n], gDem[token].mWidth, gDem[token].mHeight);
+		}
+	}
+	MemFile_Close(load);
+
+#if OPENGL_MAP
+	RF_Notifiable::Notify(rf_Cat_File, rf_Msg_FileLoaded, NULL);
+#endif
+	return err;
+}
+
 static int DoOverlay(const vector<const char *>& args)
 {
 	if (gVerbose) printf("Overlaying file %s...\n", args[0]);
@@ -2998,6 +3052,7 @@ static	GISTool_RegCmd_t		sCoreCmds[] = {
 { "-extent", 		4, 4, DoExtent, 		"Set the bounds for further crop and import commands.", "" },
 { "-validate", 		0, 0, DoValidate, 		"Test vector map integrity.", "" },
 { "-load", 			1, 1, DoLoad, 			"Load an XES file.", "" },
+{ "-load_layers",	2, -1, DoLoadLayers,	"Load only some layers of an XES file.", "Usage: -load_layers <file> <map|mesh|apt|dem_name> ...\n" },
 { "-save", 			1, 1, DoSave, 			"Save an XES file.", "" },
 { "-force_save", 	1, 1, DoSaveForce,		"Save an XES file, even if empty.", "" },
 { "-ifempty",		1, 2, DoIfEmpty,		"Skip the next N commands unless the map or a layer is empty.", "" },
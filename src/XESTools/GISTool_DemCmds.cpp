@@ -55,6 +55,7 @@
 " a GeoTiff only - allow DEM to be area data if file contains area data.\n"\
 " a bil/hgt only - force area-style DEM.  Otherwise area/point comes from the particular .hdr file.\n"\
 " l force DEM location to current bounding box.\n"\
+" w tiff/bil/flt only - read only the part of the file covering the current bounding box, plus one pixel.\n"\
 "Format can be one of: \n"\
 "tiff\n"\
 "hgt\n"\
@@ -81,6 +82,9 @@ static int DoRasterImport(const vector<const char *>& args)
 	if(strstr(args[0],"a"))
 		mode = dem_want_File;
 
+	double	extent[4] = { gMapWest, gMapSouth, gMapEast, gMapNorth };
+	double * window = strstr(args[0],"w") ? extent : NULL;
+
 	DEMGeo * kill = NULL, * dem = NULL;
 	if((strstr(args[0],"o") || strstr(args[0],"e")) && gDem.count(layer))
 	{
@@ -102,7 +106,7 @@ static int DoRasterImport(const vector<const char *>& args)
 	}
 	else if(strcmp(args[1],"tiff") == 0)
 	{
-		if(!ExtractGeoTiff(*dem, args[2], mode, strstr(args[0],"l") != NULL))
+		if(!ExtractGeoTiff(*dem, args[2], mode, strstr(args[0],"l") != NULL, window, 1))
 		{
 			if(strstr(args[0],"i")) return 0;
 			fprintf(stderr,"Unable to read GeoTiff file %s\n", args[2]);
@@ -124,7 +128,7 @@ static int DoRasterImport(const vector<const char *>& args)
 		spec.mHeaderBytes = 0;
 		
 		ReadHDR(args[2], spec, strstr(args[0],"a"));
-		if(!ReadRawWithHeader(*dem, args[2], spec))
+		if(!ReadRawWithHeader(*dem, args[2], spec, window, 1))
 		{
 			if(strstr(args[0],"i")) return 0;
 			fprintf(stderr,"Unable to read flt file %s\n", args[2]);
@@ -156,7 +160,7 @@ static int DoRasterImport(const vector<const char *>& args)
 		
 		ReadHDR(args[2], spec, strstr(args[0],"a"));
 		
-		if(!ReadRawWithHeader(*dem, args[2], spec))
+		if(!ReadRawWithHeader(*dem, args[2], spec, window, 1))
 		{
 			if(strstr(args[0],"i")) return 0;
 			fprintf(stderr,"Unable to read bil file %s\n", args[2]);
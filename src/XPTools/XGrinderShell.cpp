@@ -36,6 +36,8 @@
 #include "XGrinderApp.h"
 #include "MemFileUtils.h"
 #include "PlatformUtils.h"
+#include "ParallelUtils.h"
+#include "PerfUtils.h"
 #include <string>
 #include <vector>
 #include <sys/stat.h>
@@ -47,11 +49,18 @@
 #define popen xpt_popen
 #define pclose xpt_pclose
 
-HANDLE stdout_read, stdout_write;
-HANDLE stderr_read, stderr_write;
-HANDLE stdin_read, stdin_write;
+// Converters run from several threads at once, so the pipe handles are per stream.  Pipe creation and
+// CreateProcess are serialized: while one child is being spawned, no other job's child-side handles are
+// inheritable, so a child never keeps another job's pipe open past its own exit.
+struct xpt_pipe {
+	HANDLE stdin_write;
+	HANDLE stderr_read;
+};
+
+static boost::mutex				s_pipe_lock;
+static map<FILE *, xpt_pipe>	s_pipes;
 
-int spawn_process(char* cmdline)
+int spawn_process(char* cmdline, HANDLE stdout_write, HANDLE stdin_read, HANDLE stderr_write)
 {
 	DWORD e = 0;
 	STARTUPINFO si = {};
@@ -70,11 +79,13 @@ int spawn_process(char* cmdline)
 FILE* xpt_popen(const char *command, const char *mode)
 {
 	SECURITY_ATTRIBUTES sa;
-	DWORD nread;
-	char buf[4096] = {};
+	HANDLE stdout_read, stdout_write;
+	HANDLE stderr_read, stderr_write;
+	HANDLE stdin_read, stdin_write;
 
 	if (strcmp(mode, "r"))
 		return 0;
+	boost::mutex::scoped_lock	lock(s_pipe_lock);
 	sa.nLength = sizeof(SECURITY_ATTRIBUTES);
 	sa.bInheritHandle = 1;
 	sa.lpSecurityDescriptor = 0;
@@ -89,7 +100,7 @@ FILE* xpt_popen(const char *command, const char *mode)
 	CreatePipe(&stderr_read, &stderr_write, &sa, 0);
 	SetHandleInformation(stderr_read, HANDLE_FLAG_INHERIT, 0);
 
-	spawn_process(const_cast<char*>(command));
+	spawn_process(const_cast<char*>(command), stdout_write, stdin_read, stderr_write);
 
 	// Spawn process has given these 3 handles to our child.  We no longer need our copies.  We close them now; 
 	// for example, we are not going to put data down the child's stdout pipe - we READ from the other side.
@@ -99,19 +110,31 @@ FILE* xpt_popen(const char *command, const char *mode)
 	CloseHandle(stdin_read);
 	CloseHandle(stderr_write);
 
-	return _fdopen( _open_osfhandle((intptr_t)stdout_read, _O_RDONLY), "r");
+	FILE * stream = _fdopen( _open_osfhandle((intptr_t)stdout_read, _O_RDONLY), "r");
+	xpt_pipe& our_side(s_pipes[stream]);
+	our_side.stdin_write = stdin_write;
+	our_side.stderr_read = stderr_read;
+	return stream;
 }
 
 int xpt_pclose(FILE *stream)
 {
+	xpt_pipe our_side;
+	{
+		boost::mutex::scoped_lock	lock(s_pipe_lock);
+		map<FILE *, xpt_pipe>::iterator p = s_pipes.find(stream);
+		if (p == s_pipes.end()) return -1;
+		our_side = p->second;
+		s_pipes.erase(p);
+	}
 	fclose(stream);		// This closes stdout_read FOR US.
 
 	// When we close our connection to the child process, we close the other halves of the pipes - OUR halves that
 	// we were using. Since stream wraps an FD, which wraps a HANDLE, closing our stream closes stdout_read for us.
 
 	// We didn't ever wrap stdin or stderr (our side) so we close those directly.
-	CloseHandle(stdin_write);
-	CloseHandle(stderr_read);
+	CloseHandle(our_side.stdin_write);
+	CloseHandle(our_side.stderr_read);
 	return 0;
 }
 
@@ -141,6 +164,14 @@ struct flag_menu_info {
 	vector<flag_item_info>	items;
 };
 
+// One converter run.  Jobs only fill in their own log and error code while they run; everything that
+// touches the UI or log.txt happens afterward, on the main thread, in the order the files were dropped.
+struct grind_job {
+	string					cmd_line;
+	string					log_txt;
+	int						err_code;
+};
+
 static vector<flag_menu_info>			flag_menus;
 static vector<conversion_info*>			conversions;
 static xmenu							conversion_menu;
@@ -148,6 +179,14 @@ static map<string,conversion_info *>	selected_conversions;
 
 static string g_me;
 
+static xmenu							jobs_menu;
+static int								jobs_count = 0;			// 0 = one per core
+static int								jobs_skip_current = 0;	// skip files whose output is newer than the input
+
+static const int						kJobCounts[] = { 0, 1, 2, 4, 8 };
+static const int						kJobCountItems = sizeof(kJobCounts) / sizeof(kJobCounts[0]);
+static const int						kJobSkipItem = kJobCountItems + 1;	// after a divider
+
 static bool file_cb(const char * fileName, bool isDir, unsigned long long modTime, void * ref);
 static void	sync_menu_checks();
 static void sub_str(string& io_str, const string& key, const string& rep);
@@ -172,6 +211,10 @@ static void	sync_menu_checks()
 	for (int i = 0; i < m->items.size(); ++i)
 	if (!m->items[i].item_name.empty())
 		XWin::CheckMenuItem(m->menu, i, m->items[i].enabled);
+
+	for (int n = 0; n < kJobCountItems; ++n)
+		XWin::CheckMenuItem(jobs_menu, n, jobs_count == kJobCounts[n]);
+	XWin::CheckMenuItem(jobs_menu, kJobSkipItem, jobs_skip_current);
 }
 
 #if IBM
@@ -274,19 +317,13 @@ static bool file_cb(const char * fileName, bool isDir, unsigned long long modTim
 	return true;
 }
 
-static void spool_job(const char * cmd_line)
+static void run_job(grind_job& job)
 {
-	FILE * log = fopen("log.txt", "a");
-	if(log == NULL) log = stdout;
-	fprintf(log,"%s\n",cmd_line);
-	XGrinder_ShowMessage("%s",cmd_line);
-	string quoted(cmd_line);
+	string quoted(job.cmd_line);
 #if IBM
 // not applicable with xpt_popen()
 //	quoted = "\"" + quoted + "\"";
 #endif
-	string log_txt;
-
 	FILE * pipe = popen(quoted.c_str(), "r");
 	while(!feof(pipe))
 	{
@@ -294,36 +331,36 @@ static void spool_job(const char * cmd_line)
 		int count = fread(buf,1,sizeof(buf),pipe);
 		if(count == -1)
 		{
-			fprintf(log,"Error: %d\n", errno);
+			sprintf(buf,"Error: %d\n", errno);
+			job.log_txt += buf;
 			break;
 		}
-		fwrite(buf,1,count,log);
 		if(count)
-			log_txt.insert(log_txt.end(), buf,buf+count);
-	}
-	int err_code = pclose(pipe);
-	if(err_code)
-	{
-		if(log_txt.empty())
-			XGrinder_ShowMessage("%s: error code %d.\n", cmd_line, err_code);
-		else
-			XGrinder_ShowMessage("%s",log_txt.c_str());
+			job.log_txt.insert(job.log_txt.end(), buf,buf+count);
 	}
-	if(log != stdout)
-		fclose(log);
+	job.err_code = pclose(pipe);
 }
 
-
-
-void	XGrindFiles(const vector<string>& files)
+static void report_job(const grind_job& job)
 {
-	for (vector<string>::const_iterator i = files.begin(); i != files.end(); ++i)
+	FILE * log = fopen("log.txt", "a");
+	if(log == NULL) log = stdout;
+	fprintf(log,"%s\n",job.cmd_line.c_str());
+	XGrinder_ShowMessage("%s",job.cmd_line.c_str());
+	fwrite(job.log_txt.c_str(),1,job.log_txt.size(),log);
+	if(job.err_code)
 	{
-		grind_file(i->c_str());
+		if(job.log_txt.empty())
+			XGrinder_ShowMessage("%s: error code %d.\n", job.cmd_line.c_str(), job.err_code);
+		else
+			XGrinder_ShowMessage("%s",job.log_txt.c_str());
 	}
+	if(log != stdout)
+		fclose(log);
 }
 
-void	grind_file(const char * inFileName)
+// Works out the command line for one file.  Returns false (after telling the user why) if the file can't be ground.
+static bool	setup_job(const char * inFileName, grind_job& job, string& out_name)
 {
 	string fname(inFileName);
 	string::size_type p = fname.rfind('.');
@@ -360,14 +397,91 @@ void	grind_file(const char * inFileName)
 			for(map<string,string>::iterator p = sub_flags.begin(); p != sub_flags.end(); ++p)
 				sub_str(cmd_line,p->first,p->second);
 
-			spool_job(cmd_line.c_str());
+			job.cmd_line = cmd_line;
+			job.err_code = 0;
+			out_name = newname;
+			return true;
 		}
 	} else
 		XGrinder_ShowMessage("Unable to convert file '%s' - no extension.",inFileName);
+	return false;
+}
+
+static bool is_up_to_date(const string& in_name, const string& out_name)
+{
+	struct stat in_ss, out_ss;
+	if(stat(in_name.c_str(), &in_ss) != 0) return false;
+	if(stat(out_name.c_str(), &out_ss) != 0) return false;
+	return out_ss.st_mtime >= in_ss.st_mtime;
+}
+
+struct grind_jobs_runner {
+	vector<grind_job> *		jobs;
+	void operator()(int n) { run_job((*jobs)[n]); }
+};
+
+void	XGrindFiles(const vector<string>& files)
+{
+	unsigned long long start = query_hpc();
+	vector<grind_job>	jobs;
+	int					skipped = 0;
+	for (vector<string>::const_iterator i = files.begin(); i != files.end(); ++i)
+	{
+		grind_job	job;
+		string		out_name;
+		if (!setup_job(i->c_str(), job, out_name))
+			continue;
+		if (jobs_skip_current && is_up_to_date(*i, out_name))
+			++skipped;
+		else
+			jobs.push_back(job);
+	}
+
+	SetParallelWorkerCount(jobs_count);
+	grind_jobs_runner	runner;
+	runner.jobs = &jobs;
+	ParallelFor(jobs.size(), runner);
+
+	int failed = 0;
+	for (vector<grind_job>::iterator j = jobs.begin(); j != jobs.end(); ++j)
+	{
+		report_job(*j);
+		if (j->err_code) ++failed;
+	}
+
+	if (files.size() > 1)
+	{
+		double secs = hpc_to_microseconds(query_hpc() - start) / 1000000.0;
+		XGrinder_ShowMessage("Converted %d files (%d failed, %d up to date) in %.1f seconds - %.1f files per second using %d jobs.",
+			(int) jobs.size(), failed, skipped, secs, secs > 0.0 ? jobs.size() / secs : 0.0,
+			min((int) jobs.size(), ParallelWorkerCount()));
+	}
+}
+
+void	grind_file(const char * inFileName)
+{
+	grind_job	job;
+	string		out_name;
+	if (setup_job(inFileName, job, out_name))
+	{
+		run_job(job);
+		report_job(job);
+	}
 }
 
 int	XGrinderMenuPick(xmenu menu, int item)
 {
+	if(menu==jobs_menu)
+	{
+		if(item < kJobCountItems)
+			jobs_count = kJobCounts[item];
+		else if(item == kJobSkipItem)
+			jobs_skip_current = !jobs_skip_current;
+		else
+			return 0;
+		sync_menu_checks();
+		return 1;
+	}
 	if(menu==conversion_menu)
 	{
 		if(conversions[item] != NULL)
@@ -497,6 +611,9 @@ void	XGrindInit(string& t)
 		delete [] items;
 	}
 
+	const char * job_items[] = { "One Job Per Core", "1 Job", "2 Jobs", "4 Jobs", "8 Jobs", "-", "Skip Up-To-Date Files", 0 };
+	jobs_menu = XGrinder_AddMenu("Jobs", job_items);
+
 	sync_menu_checks();
 }
 